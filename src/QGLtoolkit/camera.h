@@ -18,6 +18,7 @@
 
 
 #include "cameraFrame.h"
+#include "frustum.h"
 
 
 namespace qgltoolkit {
@@ -50,10 +51,24 @@ class Camera : public QObject
         mutable bool m_viewMatrixIsUpToDate;        /*!< false if view matrix has been modified */
         mutable glm::mat4 m_projectionMatrix;       /*!< projection matrix */
         mutable bool m_projectionMatrixIsUpToDate;  /*!< false if projection matrix has been modified*/
+        mutable Frustum m_frustum;                  /*!< planes of the view frustum (world space) */
+        mutable bool m_frustumIsUpToDate;           /*!< false if view or projection matrix has been recomputed */
+        uint64_t m_version;                         /*!< increased each time the camera (or its frame) is modified */
 
         glm::vec3 m_sceneCenter;                    /*!< coords of scene center */
         double m_zClippingCoef;                     /*!< defines margin between scene radius and frustum borders  */
         double m_orthoCoef;                         /*!< defines dimensions for orthogonal projection */
+
+
+        /*!
+        * \fn setProjectionModified
+        * \brief Called when a parameter of the projection is modified: the matrix must be recomputed.
+        */
+        void setProjectionModified()
+        {
+            m_projectionMatrixIsUpToDate = false;
+            m_version++;
+        }
        
 
 
@@ -71,6 +86,7 @@ class Camera : public QObject
         {
             m_projectionMatrixIsUpToDate = false;
             m_viewMatrixIsUpToDate = false;
+            m_version++;
         }
 
 
@@ -89,6 +105,14 @@ class Camera : public QObject
         */
         CameraFrame *frame() const { return m_frame; }
 
+        /*!
+        * \fn version
+        * \brief Returns a counter increased each time the camera or its frame is modified (it never decreases):
+        * view and projection matrices, and anything computed from them (e.g. uniforms), are unchanged
+        * as long as the version is the same.
+        */
+        uint64_t version() const { return m_version; }
+
         /*!
         * \fn pivotPoint
         * \brief Returns pivot point.
@@ -143,6 +167,58 @@ class Camera : public QObject
         */
         glm::mat4 viewProjectionMatrix() const { return  m_projectionMatrix * m_viewMatrix; }
 
+        /*!
+        * \fn frustum
+        * \brief Returns the planes of the view frustum, in world space.
+        * Planes are extracted from viewProjectionMatrix(), so both PERSPECTIVE and ORTHOGRAPHIC projType() are handled.
+        * They are only recomputed when the view or projection matrix is.
+        */
+        const Frustum &frustum() const
+        {
+            computeProjectionMatrix();
+            computeViewMatrix();
+
+            if (!m_frustumIsUpToDate)
+            {
+                m_frustum.setFromMatrix(viewProjectionMatrix());
+                m_frustumIsUpToDate = true;
+            }
+            return m_frustum;
+        }
+
+        /*!
+        * \fn sphereIsVisible
+        * \brief Returns true if a bounding sphere (world space) is at least partially inside the view frustum.
+        */
+        bool sphereIsVisible(const glm::vec3 &_center, float _radius) const { return frustum().sphereIsVisible(_center, _radius); }
+
+        /*!
+        * \fn aabbIsVisible
+        * \brief Returns true if an axis aligned bounding box (world space) is at least partially inside the view frustum.
+        */
+        bool aabbIsVisible(const glm::vec3 &_min, const glm::vec3 &_max) const { return frustum().boxIsVisible(_min, _max); }
+
+        /*!
+        * \fn classifySpheres
+        * \brief Classify an array of bounding spheres (world space, SoA layout) against the view frustum,
+        * see Frustum::classifySpheres(). _result receives a Frustum::Visibility per sphere.
+        */
+        void classifySpheres(const float *_x, const float *_y, const float *_z, const float *_radius, size_t _count, uint8_t *_result) const
+        {
+            frustum().classifySpheres(_x, _y, _z, _radius, _count, _result);
+        }
+
+        /*!
+        * \fn classifyBoxes
+        * \brief Classify an array of axis aligned bounding boxes (world space, SoA layout) against the view frustum,
+        * see Frustum::classifyBoxes(). _result receives a Frustum::Visibility per box.
+        */
+        void classifyBoxes(const float *_minX, const float *_minY, const float *_minZ,
+                           const float *_maxX, const float *_maxY, const float *_maxZ, size_t _count, uint8_t *_result) const
+        {
+            frustum().classifyBoxes(_minX, _minY, _minZ, _maxX, _maxY, _maxZ, _count, _result);
+        }
+
         /*!
         * \fn sceneCenter
         * \brief Returns cords of scene center.
@@ -261,6 +337,7 @@ class Camera : public QObject
             }
 
             m_projectionMatrixIsUpToDate = true;
+            m_frustumIsUpToDate = false;
         }
 
         /*!
@@ -296,6 +373,7 @@ class Camera : public QObject
             m_viewMatrix = glm::lookAt(position(),  position() - quatZ , quatU );
 
             m_viewMatrixIsUpToDate = true; 
+            m_frustumIsUpToDate = false;
         }
 
         /*!
@@ -306,7 +384,7 @@ class Camera : public QObject
         {
             frame()->setScreenWidthAndHeight(_width, _height);
 
-            m_projectionMatrixIsUpToDate = false;
+            setProjectionModified();
         }
 
         /*!
@@ -361,6 +439,32 @@ class Camera : public QObject
         */
         glm::vec3 worldCoordinatesOf(const glm::vec3 &_src) const { return frame()->inverseCoordinatesOf(_src); }
 
+        /*!
+        * \fn convertClickToLine
+        * \brief Calculates the world space ray going through a pixel, from the near plane to the far plane.
+        * The pixel is unprojected with the inverse of viewProjectionMatrix(), so both PERSPECTIVE
+        * (rays start near the camera position) and ORTHOGRAPHIC (parallel rays) projType() are handled.
+        * \param _pixel: pixel coords (origin at the upper left corner of the window, as in Qt events)
+        * \param _origin: returned origin of the ray, on the near plane
+        * \param _direction: returned unit direction of the ray
+        */
+        void convertClickToLine(const QPoint &_pixel, glm::vec3 &_origin, glm::vec3 &_direction) const
+        {
+            computeProjectionMatrix();
+            computeViewMatrix();
+
+            // normalized device coordinates of the center of the pixel (y axis upwards)
+            const float x = 2.0f * (static_cast<float>(_pixel.x()) + 0.5f) / static_cast<float>(screenWidth()) - 1.0f;
+            const float y = 1.0f - 2.0f * (static_cast<float>(_pixel.y()) + 0.5f) / static_cast<float>(screenHeight());
+
+            const glm::mat4 inverseViewProjection = glm::inverse(viewProjectionMatrix());
+            const glm::vec4 nearPoint = inverseViewProjection * glm::vec4(x, y, -1.0f, 1.0f);
+            const glm::vec4 farPoint = inverseViewProjection * glm::vec4(x, y, 1.0f, 1.0f);
+
+            _origin = glm::vec3(nearPoint) / nearPoint.w;
+            _direction = glm::normalize(glm::vec3(farPoint) / farPoint.w - _origin);
+        }
+
         /*!
         * \fn getOrthoWidthHeight
         * \brief Calculates half diemrensions of window when orthographic projection is used.
@@ -419,7 +523,7 @@ class Camera : public QObject
             if ((prevDist > std::numeric_limits<float>::epsilon()) && (newDist > std::numeric_limits<float>::epsilon()))
                 m_orthoCoef *= prevDist / newDist;
 
-            m_projectionMatrixIsUpToDate = false;
+            setProjectionModified();
         }
 
         /*! \fn setAspectRatio 
@@ -437,7 +541,7 @@ class Camera : public QObject
         {
             //m_fieldOfView = _fov;
             frame()->setFieldOfView(_fov);
-            m_projectionMatrixIsUpToDate = false;
+            setProjectionModified();
         }
 
         /*! \fn setFOVToFitScene 
@@ -461,7 +565,7 @@ class Camera : public QObject
                 
             //m_projType = _type;
             frame()->setProjType(_type);
-            m_projectionMatrixIsUpToDate = false;
+            setProjectionModified();
         }
 
         /*! \fn setSceneCenter 
@@ -471,7 +575,7 @@ class Camera : public QObject
         {
             m_sceneCenter = _center;
             setPivotPoint(sceneCenter());
-            m_projectionMatrixIsUpToDate = false;
+            setProjectionModified();
         }
 
         /*! \fn setSceneRadius 
@@ -480,7 +584,7 @@ class Camera : public QObject
         void setSceneRadius(double _radius)
         {
             frame()->setSceneRadius(_radius);
-            m_projectionMatrixIsUpToDate = false;
+            setProjectionModified();
         }
 
         /*! \fn setSceneBoundingBox 
@@ -499,7 +603,7 @@ class Camera : public QObject
         void setZClippingCoefficient(double _coef) 
         {
             m_zClippingCoef = _coef;
-            m_projectionMatrixIsUpToDate = false;
+            setProjectionModified();
         }
 
         /*! \fn setPosition 
@@ -624,7 +728,7 @@ class Camera : public QObject
         * \brief Destructor of Camera.
         */
         Camera() 
-        : m_frame(NULL), m_viewMatrixIsUpToDate(false), m_projectionMatrixIsUpToDate(false)
+        : m_frame(NULL), m_viewMatrixIsUpToDate(false), m_projectionMatrixIsUpToDate(false), m_frustumIsUpToDate(false), m_version(1)
         {
             setFrame(new CameraFrame());
             setSceneRadius(1.0);
@@ -670,7 +774,7 @@ class Camera : public QObject
 
 
             m_orthoCoef = _camera.m_orthoCoef;
-            m_projectionMatrixIsUpToDate = false;
+            setProjectionModified();
 
             m_frame->setPosition(_camera.position());
             m_frame->setOrientation(_camera.orientation());
@@ -692,7 +796,7 @@ class Camera : public QObject
         * \fn CameraFrame
         * \brief Copy constructor of CameraFrame.
         */
-        Camera(const Camera &_camera) : QObject(), m_frame(nullptr) 
+        Camera(const Camera &_camera) : QObject(), m_frame(nullptr), m_frustumIsUpToDate(false), m_version(1)
         {
             setFrame(new CameraFrame(*_camera.frame()));
 
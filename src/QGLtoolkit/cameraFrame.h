@@ -119,6 +119,7 @@ class CameraFrame : public qgltoolkit::Frame
             // Prevent negative and zero dimensions that would cause divisions by zero.
             m_screenWidth = _width > 0 ? _width : 1;
             m_screenHeight = _height > 0 ? _height : 1;
+            setModified();
         }
 
         /*!
@@ -138,6 +139,7 @@ class CameraFrame : public qgltoolkit::Frame
                 return;
             }
             m_sceneRadius = _radius;
+            setModified();
         }
 
         /*!
@@ -149,7 +151,7 @@ class CameraFrame : public qgltoolkit::Frame
         /*! \fn setProjType 
         * \brief Set type of projection.
         */
-        void setProjType(CameraFrame::ProjectionType _type) { m_projType = _type; }
+        void setProjType(CameraFrame::ProjectionType _type) { m_projType = _type; setModified(); }
 
         /*!
         * \fn fieldOfView
@@ -160,7 +162,7 @@ class CameraFrame : public qgltoolkit::Frame
         /*! \fn setFieldOfView 
         * \brief Set FOV.
         */
-        void setFieldOfView(double _fov) { m_fieldOfView = _fov; }
+        void setFieldOfView(double _fov) { m_fieldOfView = _fov; setModified(); }
 
         /*!
         * \fn viewDirection
@@ -17,6 +17,8 @@
 #define QGLTOOLKIT_FRAME_H
 
 
+#include <cstdint>
+
 #include <QObject>
 #include <QString>
 
@@ -46,6 +48,7 @@ class Frame : public QObject
 
         glm::vec3 m_t;   /*!< position (i.e., translation vector) */
         Quaternion m_q;  /*!< orientation (i.e., quaternion rotation) */
+        uint64_t m_version;  /*!< increased each time the Frame is modified */
 
 
     Q_SIGNALS:
@@ -68,7 +71,7 @@ class Frame : public QObject
         * \fn Frame
         * \brief Destructor of Frame.
         */
-        Frame() {}
+        Frame() : m_version(1) {}
 
         /*!
         * \fn ~Frame
@@ -83,7 +86,7 @@ class Frame : public QObject
         * \param _orientation : orientation as quaternion
         */
         Frame(const glm::vec3 &_position, const Quaternion &_orientation)
-        : m_t(_position), m_q(_orientation)
+        : m_t(_position), m_q(_orientation), m_version(1)
         {}
                 
         /*!
@@ -103,7 +106,7 @@ class Frame : public QObject
         * \fn Frame
         * \brief Copy constructor of Frame.
         */
-        Frame(const Frame &_frame) : QObject() { (*this) = _frame; }
+        Frame(const Frame &_frame) : QObject(), m_version(1) { (*this) = _frame; }
 
 
         /*------------------------------------------------------------------------------------------------------------+
@@ -138,6 +141,13 @@ class Frame : public QObject
         */
         Quaternion orientation() const { return rotation(); }
 
+        /*!
+        * \fn version
+        * \brief Returns a counter increased each time the Frame is modified (it never decreases),
+        * to find out if something depending on the Frame must be updated.
+        */
+        uint64_t version() const { return m_version; }
+
 
 
         /*------------------------------------------------------------------------------------------------------------+
@@ -153,7 +163,7 @@ class Frame : public QObject
         void setTranslation(const glm::vec3 _translation) 
         {
             m_t = _translation;
-            Q_EMIT modified();
+            setModified();
         }
 
         /*!
@@ -177,7 +187,7 @@ class Frame : public QObject
         void setRotation(const Quaternion &_rotation) 
         {
             m_q = _rotation;
-            Q_EMIT modified();
+            setModified();
         }
 
         /*!
@@ -204,7 +214,7 @@ class Frame : public QObject
         {
             m_t = _translation;
             m_q = _rotation;
-            Q_EMIT modified();
+            setModified();
         }
 
 
@@ -267,7 +277,7 @@ class Frame : public QObject
             m_t = _position;
             m_q = _orientation;
 
-            Q_EMIT modified();
+            setModified();
         }
 
 
@@ -283,7 +293,7 @@ class Frame : public QObject
         void translate(glm::vec3 &_t) 
         {
             m_t += _t;
-            Q_EMIT modified();
+            setModified();
         }
 
         /*!
@@ -306,7 +316,7 @@ class Frame : public QObject
         {
             m_q *= _q;
             m_q.normalize(); // Prevents numerical drift
-            Q_EMIT modified();
+            setModified();
         }
 
         /*!
@@ -385,7 +395,7 @@ class Frame : public QObject
 
             m_t += trans;
             
-            Q_EMIT modified();
+            setModified();
         }
 
 
@@ -537,6 +547,19 @@ class Frame : public QObject
         //    return m;
         //}
 
+
+    protected:
+
+        /*!
+        * \fn setModified
+        * \brief Increase version() and emit the modified() signal. Called by every modification of the Frame.
+        */
+        void setModified()
+        {
+            m_version++;
+            Q_EMIT modified();
+        }
+
 };
 
 
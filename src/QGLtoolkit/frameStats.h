@@ -0,0 +1,191 @@
+/*********************************************************************************************************************
+ *
+ * frameStats.h
+ *
+ * Timings and draw counts of the recent frames of a viewer
+ *
+ * QGL_toolkit
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#ifndef QGLTOOLKIT_FRAMESTATS_H
+#define QGLTOOLKIT_FRAMESTATS_H
+
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+
+
+namespace qgltoolkit
+{
+
+
+/*!
+* \struct FrameTiming
+* \brief Measures of one frame painted by a QGLViewer (times in milliseconds)
+*/
+struct FrameTiming
+{
+    uint64_t frame;             /*!< number of the frame, since the creation of the viewer */
+    double intervalMs;          /*!< time since the start of the previous frame (0 for the first frame) */
+    double eventMs;             /*!< CPU time of the input events handled since the previous frame */
+    double cameraMs;            /*!< CPU time of the update of the camera matrices */
+    double drawMs;              /*!< CPU time of draw() (submission of the GL commands) */
+    double gpuMs;               /*!< GPU time of draw(), negative until the timer query result is read back (or if unsupported) */
+    uint64_t triangles;         /*!< number of triangles submitted by draw() */
+    uint64_t drawCalls;         /*!< number of draw calls submitted by draw() */
+};
+
+
+/*!
+* \class FrameStats
+* \brief Ring buffer of the FrameTiming of the last capacity() frames.
+* The GPU time of a frame is known a few frames later (timer queries are read back without waiting):
+* it is set afterwards by setGpuTime(), as long as the frame is still in the buffer.
+*/
+class FrameStats
+{
+
+    private:
+
+        std::vector<FrameTiming> m_frames;  /*!< ring buffer of the recorded frames */
+        size_t m_nbFrames;                  /*!< number of frames in the buffer (<= capacity) */
+        uint64_t m_nextFrame;               /*!< number of the next recorded frame */
+
+
+    public:
+
+        /*!
+        * \fn FrameStats
+        * \brief Constructor
+        * \param _capacity : number of recorded frames
+        */
+        explicit FrameStats(size_t _capacity = 128)
+        : m_frames(_capacity > 0 ? _capacity : 1), m_nbFrames(0), m_nextFrame(0)
+        {}
+
+        /*!
+        * \fn capacity
+        * \brief Returns the maximal number of recorded frames
+        */
+        size_t capacity() const { return m_frames.size(); }
+
+        /*!
+        * \fn size
+        * \brief Returns the number of recorded frames
+        */
+        size_t size() const { return m_nbFrames; }
+
+        /*!
+        * \fn clear
+        * \brief Forget the recorded frames (the frame numbers keep increasing)
+        */
+        void clear() { m_nbFrames = 0; }
+
+        /*!
+        * \fn nextFrame
+        * \brief Returns the number of the frame which will be recorded by the next call to record()
+        */
+        uint64_t nextFrame() const { return m_nextFrame; }
+
+        /*!
+        * \fn record
+        * \brief Add a frame, the oldest one is dropped if the buffer is full. The frame number of _timing is set.
+        * \return number of the recorded frame
+        */
+        uint64_t record(const FrameTiming &_timing)
+        {
+            FrameTiming &timing = m_frames[m_nextFrame % m_frames.size()];
+            timing = _timing;
+            timing.frame = m_nextFrame;
+            if(m_nbFrames < m_frames.size())
+                m_nbFrames++;
+
+            return m_nextFrame++;
+        }
+
+        /*!
+        * \fn setGpuTime
+        * \brief Set the GPU time of a frame, ignored if the frame is not in the buffer anymore
+        * \param _frame : number of the frame (returned by record())
+        * \param _gpuMs : GPU time, in milliseconds
+        */
+        void setGpuTime(uint64_t _frame, double _gpuMs)
+        {
+            if(_frame >= m_nextFrame || m_nextFrame - _frame > m_nbFrames)
+                return;
+
+            m_frames[_frame % m_frames.size()].gpuMs = _gpuMs;
+        }
+
+        /*!
+        * \fn frame
+        * \brief Returns a recorded frame
+        * \param _age : 0 for the last recorded frame, up to size() - 1 for the oldest one
+        */
+        const FrameTiming &frame(size_t _age) const
+        {
+            return m_frames[(m_nextFrame - 1 - _age) % m_frames.size()];
+        }
+
+        /*!
+        * \fn average
+        * \brief Returns the mean of the last frames. The GPU time is averaged over the frames whose
+        * time is known (negative if none), the interval over the frames after the first one.
+        * \param _nbFrames : number of frames (clamped to size())
+        */
+        FrameTiming average(size_t _nbFrames) const
+        {
+            FrameTiming mean = { m_nextFrame > 0 ? m_nextFrame - 1 : 0, 0.0, 0.0, 0.0, 0.0, -1.0, 0, 0 };
+            const size_t n = (_nbFrames < m_nbFrames) ? _nbFrames : m_nbFrames;
+            if(n == 0)
+                return mean;
+
+            double gpuMs = 0.0;
+            size_t nbGpuFrames = 0;
+            size_t nbIntervals = 0;
+            uint64_t triangles = 0;
+            uint64_t drawCalls = 0;
+            for(size_t i = 0; i < n; i++)
+            {
+                const FrameTiming &timing = frame(i);
+                if(timing.intervalMs > 0.0)
+                {
+                    mean.intervalMs += timing.intervalMs;
+                    nbIntervals++;
+                }
+                mean.eventMs += timing.eventMs;
+                mean.cameraMs += timing.cameraMs;
+                mean.drawMs += timing.drawMs;
+                if(timing.gpuMs >= 0.0)
+                {
+                    gpuMs += timing.gpuMs;
+                    nbGpuFrames++;
+                }
+                triangles += timing.triangles;
+                drawCalls += timing.drawCalls;
+            }
+
+            if(nbIntervals > 0)
+                mean.intervalMs /= double(nbIntervals);
+            mean.eventMs /= double(n);
+            mean.cameraMs /= double(n);
+            mean.drawMs /= double(n);
+            if(nbGpuFrames > 0)
+                mean.gpuMs = gpuMs / double(nbGpuFrames);
+            mean.triangles = triangles / n;
+            mean.drawCalls = drawCalls / n;
+
+            return mean;
+        }
+
+};
+
+
+} // namespace qgltoolkit
+
+
+#endif // QGLTOOLKIT_FRAMESTATS_H
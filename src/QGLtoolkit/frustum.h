@@ -0,0 +1,354 @@
+/*********************************************************************************************************************
+ *
+ * frustum.h
+ *
+ * View frustum planes, and visibility tests of bounding spheres and boxes
+ *
+ * QGL_toolkit
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#ifndef QGLTOOLKIT_FRUSTUM_H
+#define QGLTOOLKIT_FRUSTUM_H
+
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <cmath>
+
+
+// SSE2 is always available on x86-64, AVX only if enabled when compiling
+#if defined(__AVX__)
+    #include <immintrin.h>
+    #define QGLTOOLKIT_FRUSTUM_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define QGLTOOLKIT_FRUSTUM_SSE2
+#endif
+
+
+namespace qgltoolkit {
+
+
+/*!
+* \class Frustum
+* \brief The 6 planes of a view frustum, and visibility tests of bounding volumes.
+*
+* Planes are extracted from a view-projection matrix (Gribb and Hartmann), so perspective and
+* orthographic projections are handled the same way, and tests match what is rendered.
+* Planes are normalized and point inwards: the signed distance of a point to a plane is dot(n, p) + d.
+*
+* Batch tests classify arrays of volumes given in SoA layout (one array per coordinate),
+* 4 (SSE2) or 8 (AVX) volumes at a time.
+*/
+class Frustum
+{
+    public:
+
+        /*!
+        * \enum Visibility
+        * \brief Classification of a bounding volume
+        */
+        enum Visibility
+        {
+            OUTSIDE = 0,            // outside of the frustum (not visible)
+            INTERSECTING = 1,       // crosses at least one plane (partially visible)
+            INSIDE = 2              // inside all the planes (entirely visible)
+        };
+
+        // (not NEAR/FAR: both are macros of windows.h)
+        enum Plane { LEFT_PLANE = 0, RIGHT_PLANE = 1, BOTTOM_PLANE = 2, TOP_PLANE = 3, NEAR_PLANE = 4, FAR_PLANE = 5 };
+
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                               CONSTRUCTORS                                                  |
+        +------------------------------------------------------------------------------------------------------------*/
+
+        /*!
+        * \fn Frustum
+        * \brief Default constructor of Frustum: the clip space cube
+        */
+        Frustum() { setFromMatrix(glm::mat4(1.0f)); }
+
+        /*!
+        * \fn Frustum
+        * \brief Constructor of Frustum from a (model)view-projection matrix
+        */
+        explicit Frustum(const glm::mat4 &_viewProjection) { setFromMatrix(_viewProjection); }
+
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                              GETTERS/SETTERS                                                |
+        +-------------------------------------------------------------------------------------------------------------*/
+
+        /*!
+        * \fn setFromMatrix
+        * \brief Extract the planes of a (model)view-projection matrix.
+        * Planes are in the space transformed by the matrix (world space for a view-projection matrix).
+        */
+        void setFromMatrix(const glm::mat4 &_viewProjection)
+        {
+            // row i of the matrix is (m[0][i], m[1][i], m[2][i], m[3][i]) with glm column-major storage
+            const glm::vec4 row3(_viewProjection[0][3], _viewProjection[1][3], _viewProjection[2][3], _viewProjection[3][3]);
+            for (int i = 0; i < 3; i++)
+            {
+                const glm::vec4 row(_viewProjection[0][i], _viewProjection[1][i], _viewProjection[2][i], _viewProjection[3][i]);
+                m_planes[2 * i] = row3 + row;
+                m_planes[2 * i + 1] = row3 - row;
+            }
+
+            for (int p = 0; p < 6; p++)
+            {
+                const float length = std::sqrt(m_planes[p].x * m_planes[p].x + m_planes[p].y * m_planes[p].y + m_planes[p].z * m_planes[p].z);
+                if (length > 0.0f)
+                    m_planes[p] = m_planes[p] * (1.0f / length);
+
+                m_nx[p] = m_planes[p].x;
+                m_ny[p] = m_planes[p].y;
+                m_nz[p] = m_planes[p].z;
+                m_d[p] = m_planes[p].w;
+            }
+        }
+
+        /*!
+        * \fn plane
+        * \brief Returns plane _p as (normal, d), see Plane
+        */
+        const glm::vec4 &plane(int _p) const { return m_planes[_p]; }
+
+        /*!
+        * \fn distance
+        * \brief Returns the signed distance of a point to plane _p (positive inside)
+        */
+        float distance(int _p, const glm::vec3 &_point) const
+        {
+            return m_nx[_p] * _point.x + m_ny[_p] * _point.y + m_nz[_p] * _point.z + m_d[_p];
+        }
+
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                                   TESTS                                                     |
+        +------------------------------------------------------------------------------------------------------------*/
+
+        /*!
+        * \fn classifySphere
+        * \brief Classify a bounding sphere
+        */
+        Visibility classifySphere(const glm::vec3 &_center, float _radius) const
+        {
+            Visibility result = INSIDE;
+            for (int p = 0; p < 6; p++)
+            {
+                const float d = distance(p, _center);
+                if (d < -_radius)
+                    return OUTSIDE;
+                if (d < _radius)
+                    result = INTERSECTING;
+            }
+            return result;
+        }
+
+        /*!
+        * \fn classifyBox
+        * \brief Classify an axis aligned bounding box
+        */
+        Visibility classifyBox(const glm::vec3 &_min, const glm::vec3 &_max) const
+        {
+            const glm::vec3 center = 0.5f * (_min + _max);
+            const glm::vec3 extent = 0.5f * (_max - _min);
+
+            Visibility result = INSIDE;
+            for (int p = 0; p < 6; p++)
+            {
+                // half size of the box along the normal of the plane
+                const float d = distance(p, center);
+                const float r = std::abs(m_nx[p]) * extent.x + std::abs(m_ny[p]) * extent.y + std::abs(m_nz[p]) * extent.z;
+                if (d < -r)
+                    return OUTSIDE;
+                if (d < r)
+                    result = INTERSECTING;
+            }
+            return result;
+        }
+
+        /*! \fn sphereIsVisible \brief Returns true if a bounding sphere is at least partially visible */
+        bool sphereIsVisible(const glm::vec3 &_center, float _radius) const { return classifySphere(_center, _radius) != OUTSIDE; }
+
+        /*! \fn boxIsVisible \brief Returns true if an axis aligned bounding box is at least partially visible */
+        bool boxIsVisible(const glm::vec3 &_min, const glm::vec3 &_max) const { return classifyBox(_min, _max) != OUTSIDE; }
+
+
+        /*!
+        * \fn classifySpheres
+        * \brief Classify an array of bounding spheres (SoA layout)
+        * \param _x, _y, _z : coordinates of the centers
+        * \param _radius : radii
+        * \param _count : number of spheres
+        * \param _result : output, Visibility of each sphere
+        */
+        void classifySpheres(const float *_x, const float *_y, const float *_z, const float *_radius, size_t _count, uint8_t *_result) const
+        {
+            size_t i = 0;
+#if defined(QGLTOOLKIT_FRUSTUM_AVX)
+            for (; i + 8 <= _count; i += 8)
+            {
+                const __m256 x = _mm256_loadu_ps(_x + i), y = _mm256_loadu_ps(_y + i), z = _mm256_loadu_ps(_z + i);
+                const __m256 r = _mm256_loadu_ps(_radius + i);
+                const __m256 minusR = _mm256_sub_ps(_mm256_setzero_ps(), r);
+
+                __m256 outside = _mm256_setzero_ps(), intersecting = _mm256_setzero_ps();
+                for (int p = 0; p < 6; p++)
+                {
+                    const __m256 d = planeDistance(p, x, y, z);
+                    outside = _mm256_or_ps(outside, _mm256_cmp_ps(d, minusR, _CMP_LT_OQ));
+                    intersecting = _mm256_or_ps(intersecting, _mm256_cmp_ps(d, r, _CMP_LT_OQ));
+                }
+                storeVisibility(_mm256_movemask_ps(outside), _mm256_movemask_ps(intersecting), 8, _result + i);
+            }
+#elif defined(QGLTOOLKIT_FRUSTUM_SSE2)
+            for (; i + 4 <= _count; i += 4)
+            {
+                const __m128 x = _mm_loadu_ps(_x + i), y = _mm_loadu_ps(_y + i), z = _mm_loadu_ps(_z + i);
+                const __m128 r = _mm_loadu_ps(_radius + i);
+                const __m128 minusR = _mm_sub_ps(_mm_setzero_ps(), r);
+
+                __m128 outside = _mm_setzero_ps(), intersecting = _mm_setzero_ps();
+                for (int p = 0; p < 6; p++)
+                {
+                    const __m128 d = planeDistance(p, x, y, z);
+                    outside = _mm_or_ps(outside, _mm_cmplt_ps(d, minusR));
+                    intersecting = _mm_or_ps(intersecting, _mm_cmplt_ps(d, r));
+                }
+                storeVisibility(_mm_movemask_ps(outside), _mm_movemask_ps(intersecting), 4, _result + i);
+            }
+#endif
+            for (; i < _count; i++)
+                _result[i] = static_cast<uint8_t>( classifySphere(glm::vec3(_x[i], _y[i], _z[i]), _radius[i]) );
+        }
+
+        /*!
+        * \fn classifyBoxes
+        * \brief Classify an array of axis aligned bounding boxes (SoA layout)
+        * \param _minX, _minY, _minZ : coordinates of the min corners
+        * \param _maxX, _maxY, _maxZ : coordinates of the max corners
+        * \param _count : number of boxes
+        * \param _result : output, Visibility of each box
+        */
+        void classifyBoxes(const float *_minX, const float *_minY, const float *_minZ,
+                           const float *_maxX, const float *_maxY, const float *_maxZ, size_t _count, uint8_t *_result) const
+        {
+            size_t i = 0;
+#if defined(QGLTOOLKIT_FRUSTUM_AVX)
+            const __m256 half = _mm256_set1_ps(0.5f);
+            const __m256 signMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+            for (; i + 8 <= _count; i += 8)
+            {
+                const __m256 minX = _mm256_loadu_ps(_minX + i), minY = _mm256_loadu_ps(_minY + i), minZ = _mm256_loadu_ps(_minZ + i);
+                const __m256 maxX = _mm256_loadu_ps(_maxX + i), maxY = _mm256_loadu_ps(_maxY + i), maxZ = _mm256_loadu_ps(_maxZ + i);
+                const __m256 cx = _mm256_mul_ps(_mm256_add_ps(minX, maxX), half);
+                const __m256 cy = _mm256_mul_ps(_mm256_add_ps(minY, maxY), half);
+                const __m256 cz = _mm256_mul_ps(_mm256_add_ps(minZ, maxZ), half);
+                const __m256 ex = _mm256_mul_ps(_mm256_sub_ps(maxX, minX), half);
+                const __m256 ey = _mm256_mul_ps(_mm256_sub_ps(maxY, minY), half);
+                const __m256 ez = _mm256_mul_ps(_mm256_sub_ps(maxZ, minZ), half);
+
+                __m256 outside = _mm256_setzero_ps(), intersecting = _mm256_setzero_ps();
+                for (int p = 0; p < 6; p++)
+                {
+                    const __m256 d = planeDistance(p, cx, cy, cz);
+                    const __m256 r = _mm256_add_ps(_mm256_add_ps(
+                                        _mm256_mul_ps(_mm256_and_ps(_mm256_set1_ps(m_nx[p]), signMask), ex),
+                                        _mm256_mul_ps(_mm256_and_ps(_mm256_set1_ps(m_ny[p]), signMask), ey)),
+                                        _mm256_mul_ps(_mm256_and_ps(_mm256_set1_ps(m_nz[p]), signMask), ez));
+                    outside = _mm256_or_ps(outside, _mm256_cmp_ps(d, _mm256_sub_ps(_mm256_setzero_ps(), r), _CMP_LT_OQ));
+                    intersecting = _mm256_or_ps(intersecting, _mm256_cmp_ps(d, r, _CMP_LT_OQ));
+                }
+                storeVisibility(_mm256_movemask_ps(outside), _mm256_movemask_ps(intersecting), 8, _result + i);
+            }
+#elif defined(QGLTOOLKIT_FRUSTUM_SSE2)
+            const __m128 half = _mm_set1_ps(0.5f);
+            const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+            for (; i + 4 <= _count; i += 4)
+            {
+                const __m128 minX = _mm_loadu_ps(_minX + i), minY = _mm_loadu_ps(_minY + i), minZ = _mm_loadu_ps(_minZ + i);
+                const __m128 maxX = _mm_loadu_ps(_maxX + i), maxY = _mm_loadu_ps(_maxY + i), maxZ = _mm_loadu_ps(_maxZ + i);
+                const __m128 cx = _mm_mul_ps(_mm_add_ps(minX, maxX), half);
+                const __m128 cy = _mm_mul_ps(_mm_add_ps(minY, maxY), half);
+                const __m128 cz = _mm_mul_ps(_mm_add_ps(minZ, maxZ), half);
+                const __m128 ex = _mm_mul_ps(_mm_sub_ps(maxX, minX), half);
+                const __m128 ey = _mm_mul_ps(_mm_sub_ps(maxY, minY), half);
+                const __m128 ez = _mm_mul_ps(_mm_sub_ps(maxZ, minZ), half);
+
+                __m128 outside = _mm_setzero_ps(), intersecting = _mm_setzero_ps();
+                for (int p = 0; p < 6; p++)
+                {
+                    const __m128 d = planeDistance(p, cx, cy, cz);
+                    const __m128 r = _mm_add_ps(_mm_add_ps(
+                                        _mm_mul_ps(_mm_and_ps(_mm_set1_ps(m_nx[p]), signMask), ex),
+                                        _mm_mul_ps(_mm_and_ps(_mm_set1_ps(m_ny[p]), signMask), ey)),
+                                        _mm_mul_ps(_mm_and_ps(_mm_set1_ps(m_nz[p]), signMask), ez));
+                    outside = _mm_or_ps(outside, _mm_cmplt_ps(d, _mm_sub_ps(_mm_setzero_ps(), r)));
+                    intersecting = _mm_or_ps(intersecting, _mm_cmplt_ps(d, r));
+                }
+                storeVisibility(_mm_movemask_ps(outside), _mm_movemask_ps(intersecting), 4, _result + i);
+            }
+#endif
+            for (; i < _count; i++)
+                _result[i] = static_cast<uint8_t>( classifyBox(glm::vec3(_minX[i], _minY[i], _minZ[i]), glm::vec3(_maxX[i], _maxY[i], _maxZ[i])) );
+        }
+
+
+    private:
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                                ATTRIBUTES                                                   |
+        +------------------------------------------------------------------------------------------------------------*/
+
+        glm::vec4 m_planes[6];          /*!< planes (normal, d), see Plane */
+
+        float m_nx[6];                  /*!< x coordinates of the normals of the planes (SoA copy used by the tests) */
+        float m_ny[6];                  /*!< y coordinates of the normals */
+        float m_nz[6];                  /*!< z coordinates of the normals */
+        float m_d[6];                   /*!< offsets of the planes */
+
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                                   MISC.                                                     |
+        +------------------------------------------------------------------------------------------------------------*/
+
+#if defined(QGLTOOLKIT_FRUSTUM_AVX)
+        /*! \fn planeDistance \brief Signed distances of 8 points to plane _p */
+        __m256 planeDistance(int _p, __m256 _x, __m256 _y, __m256 _z) const
+        {
+            return _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(m_nx[_p]), _x), _mm256_mul_ps(_mm256_set1_ps(m_ny[_p]), _y)),
+                                 _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(m_nz[_p]), _z), _mm256_set1_ps(m_d[_p])));
+        }
+#elif defined(QGLTOOLKIT_FRUSTUM_SSE2)
+        /*! \fn planeDistance \brief Signed distances of 4 points to plane _p */
+        __m128 planeDistance(int _p, __m128 _x, __m128 _y, __m128 _z) const
+        {
+            return _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(m_nx[_p]), _x), _mm_mul_ps(_mm_set1_ps(m_ny[_p]), _y)),
+                              _mm_add_ps(_mm_mul_ps(_mm_set1_ps(m_nz[_p]), _z), _mm_set1_ps(m_d[_p])));
+        }
+#endif
+
+        /*!
+        * \fn storeVisibility
+        * \brief Write the Visibility of _count volumes from the sign masks of the outside and intersecting tests
+        */
+        static void storeVisibility(int _outside, int _intersecting, int _count, uint8_t *_result)
+        {
+            for (int k = 0; k < _count; k++)
+            {
+                _result[k] = ((_outside >> k) & 1) ? static_cast<uint8_t>(OUTSIDE) :
+                             ((_intersecting >> k) & 1) ? static_cast<uint8_t>(INTERSECTING) : static_cast<uint8_t>(INSIDE);
+            }
+        }
+};
+
+} // namespace qgltoolkit
+
+#endif // QGLTOOLKIT_FRUSTUM_H
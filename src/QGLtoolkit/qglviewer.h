@@ -30,16 +30,36 @@
 #include <QString>
 #include <QOpenGLWidget>
 #include <QKeyEvent>
+#include <QPainter>
+#include <QElapsedTimer>
+#if !defined(QT_OPENGL_ES_2)
+#include <QOpenGLTimerQuery>
+#endif
 
 
 
 #include "camera.h"
+#include "selectionRegion.h"
+#include "frameStats.h"
 
 
 
 namespace qgltoolkit 
 {
 
+
+/*!
+* \struct PickResult
+* \brief Surface point under a pixel, found by QGLViewer::pick()
+*/
+struct PickResult
+{
+    glm::vec3 point;            /*!< world coords of the picked point */
+    float distance;             /*!< distance from the origin of the ray (near plane) to the point */
+    uint32_t triangle;          /*!< index of the picked triangle, as defined by the scene */
+    glm::vec2 barycentric;      /*!< barycentric coords of the point w.r.t. the second and third vertices of the triangle */
+};
+
     
 /*!
 * \class QGLViewer
@@ -58,6 +78,44 @@ class QGLViewer : public QOpenGLWidget
      
         qgltoolkit::Camera *m_camera;   /*!< camera */
 
+        SelectionRegion m_selectionRegion;  /*!< region drawn with the mouse, while isSelecting() */
+        bool m_selecting;                   /*!< a selection region is being drawn */
+
+        uint64_t m_paintedCameraVersion;    /*!< version of the camera at the last paintGL() */
+        uint64_t m_paintedSceneVersion;     /*!< version of the scene at the last paintGL() */
+
+        FrameStats m_frameStats;            /*!< timings and draw counts of the last frames */
+        bool m_statsDisplayed;              /*!< the stats overlay is drawn over the scene */
+        QElapsedTimer m_clock;              /*!< started at the creation of the viewer */
+        qint64 m_lastFrameStart;            /*!< m_clock time of the start of the last paintGL() (ns), -1 before the first one */
+        double m_eventMs;                   /*!< CPU time of the input events handled since the last paintGL() */
+        uint64_t m_drawnTriangles;          /*!< triangles reported by draw() (see addDrawStats()) */
+        uint64_t m_drawCalls;               /*!< draw calls reported by draw() (see addDrawStats()) */
+        QString m_statsText;                /*!< text of the stats overlay */
+        qint64 m_statsTextTime;             /*!< m_clock time of the last update of m_statsText (ns) */
+
+#if !defined(QT_OPENGL_ES_2)
+        static const int NB_GPU_TIMERS = 4;                 /*!< frames whose GPU time can be pending */
+        QOpenGLTimerQuery *m_gpuTimers[NB_GPU_TIMERS];      /*!< GL_TIME_ELAPSED queries, created by the first paintGL() */
+        uint64_t m_gpuTimerFrames[NB_GPU_TIMERS];           /*!< frame measured by each pending query */
+        bool m_gpuTimerPending[NB_GPU_TIMERS];              /*!< the result of the query is not read back yet */
+        bool m_gpuTimersCreated;                            /*!< creation of the queries was attempted */
+#endif
+
+
+    public Q_SLOTS:
+
+        /*!
+        * \fn updateIfModified
+        * \brief Schedule a repaint (see update()) only if the camera or the scene changed since the last one
+        * (see isModified()). Connected to the modified() signal of the camera frame.
+        */
+        void updateIfModified()
+        {
+            if(isModified())
+                this->update();
+        }
+
 
     public:
   
@@ -123,12 +181,201 @@ class QGLViewer : public QOpenGLWidget
         void showEntireScene() 
         {
             camera()->showEntireScene();
-            this->update();
+            updateIfModified();
+        }
+
+        /*!
+        * \fn sceneVersion
+        * \brief Returns a counter increased each time the scene content is modified.
+        * Override it to return the version of the scene (e.g. of its meshes), so that the viewer
+        * repaints when it changes (see updateIfModified()). The default scene is empty and never changes.
+        */
+        virtual uint64_t sceneVersion() const { return 0; }
+
+        /*!
+        * \fn isModified
+        * \brief Returns true if the camera or the scene versions changed since the last paintGL()
+        */
+        bool isModified() const
+        {
+            return camera()->version() != m_paintedCameraVersion || sceneVersion() != m_paintedSceneVersion;
         }
 
+        /*!
+        * \fn pick
+        * \brief Find the surface point under a pixel: the ray of the pixel (see Camera::convertClickToLine())
+        * is intersected with the scene on the CPU by intersectRay(), without reading the depth buffer back.
+        * \param _pixel: pixel coords (as in Qt mouse events)
+        * \param _result: returned picked point, if any
+        * \return true if a point was found
+        */
+        bool pick(const QPoint &_pixel, PickResult &_result) const
+        {
+            glm::vec3 origin, direction;
+            camera()->convertClickToLine(_pixel, origin, direction);
+            return intersectRay(origin, direction, _result);
+        }
+
+        /*!
+        * \fn setPivotPointFromPixel
+        * \brief Set the pivot point of the camera on the surface point under a pixel (see pick()),
+        * or on the scene center if there is none.
+        * \param _pixel: pixel coords (as in Qt mouse events)
+        * \return true if a surface point was found
+        */
+        bool setPivotPointFromPixel(const QPoint &_pixel)
+        {
+            PickResult result;
+            const bool found = pick(_pixel, result);
+            camera()->setPivotPoint(found ? result.point : sceneCenter());
+            updateIfModified();
+            return found;
+        }
+
+        /*!
+        * \fn isSelecting
+        * \brief Returns true while a selection region is drawn with the mouse
+        * (Ctrl + left button: rectangle, Ctrl + Shift + left button: lasso)
+        */
+        bool isSelecting() const { return m_selecting; }
+
+        /*!
+        * \fn selectionRegion
+        * \brief Returns the selection region being drawn (empty if isSelecting() is false)
+        */
+        const SelectionRegion &selectionRegion() const { return m_selectionRegion; }
+
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                                 FRAME STATS                                                 |
+        +------------------------------------------------------------------------------------------------------------*/
+
+        /*!
+        * \fn frameStats
+        * \brief Returns the timings and draw counts of the last painted frames
+        */
+        const FrameStats &frameStats() const { return m_frameStats; }
+
+        /*!
+        * \fn addDrawStats
+        * \brief Count triangles and draw calls in the current frame: to be called by draw() for what it submits
+        */
+        void addDrawStats(uint64_t _triangles, uint64_t _drawCalls)
+        {
+            m_drawnTriangles += _triangles;
+            m_drawCalls += _drawCalls;
+        }
+
+        /*! \fn statsAreDisplayed */
+        bool statsAreDisplayed() const { return m_statsDisplayed; }
+
+        /*!
+        * \fn setStatsDisplayed
+        * \brief Show or hide the overlay of the frame rate, CPU and GPU times and draw counts (see drawStats())
+        */
+        void setStatsDisplayed(bool _displayed) 
+        { 
+            m_statsDisplayed = _displayed; 
+            m_statsText.clear();
+            this->update(); 
+        }
+
+        /*! \fn toggleStatsDisplayed */
+        void toggleStatsDisplayed() { setStatsDisplayed(!m_statsDisplayed); }
+
 
     private:
 
+        /*!
+        * \fn beginGpuTimer
+        * \brief Start the GPU timer query of a frame, if one is free (the queries are created on the first call)
+        * \return index of the started query, -1 if none
+        */
+        int beginGpuTimer()
+        {
+#if !defined(QT_OPENGL_ES_2)
+            if(!m_gpuTimersCreated)
+            {
+                m_gpuTimersCreated = true;
+                for(int i = 0; i < NB_GPU_TIMERS; i++)
+                {
+                    m_gpuTimers[i] = new QOpenGLTimerQuery();
+                    if(!m_gpuTimers[i]->create())
+                    {
+                        std::cerr << "[WARNING] QGLViewer::beginGpuTimer(): timer queries are not supported, no GPU time in frame stats" << std::endl;
+                        releaseGpuTimers();
+                        break;
+                    }
+                }
+            }
+
+            // (no free query if the GPU is more than NB_GPU_TIMERS frames late: this frame is not measured)
+            for(int i = 0; i < NB_GPU_TIMERS; i++)
+            {
+                if(m_gpuTimers[i] && !m_gpuTimerPending[i])
+                {
+                    m_gpuTimers[i]->begin();
+                    return i;
+                }
+            }
+#endif
+            return -1;
+        }
+
+        /*!
+        * \fn endGpuTimer
+        * \brief Stop a query started by beginGpuTimer(), its result is read back by a later readGpuTimers()
+        */
+        void endGpuTimer(int _timer, uint64_t _frame)
+        {
+#if !defined(QT_OPENGL_ES_2)
+            if(_timer < 0)
+                return;
+
+            m_gpuTimers[_timer]->end();
+            m_gpuTimerFrames[_timer] = _frame;
+            m_gpuTimerPending[_timer] = true;
+#else
+            Q_UNUSED(_timer);
+            Q_UNUSED(_frame);
+#endif
+        }
+
+        /*!
+        * \fn readGpuTimers
+        * \brief Set the GPU times of the previous frames whose query result is available, without waiting for the others
+        */
+        void readGpuTimers()
+        {
+#if !defined(QT_OPENGL_ES_2)
+            for(int i = 0; i < NB_GPU_TIMERS; i++)
+            {
+                if(!m_gpuTimerPending[i] || !m_gpuTimers[i]->isResultAvailable())
+                    continue;
+
+                // (the result is available: no wait)
+                m_frameStats.setGpuTime(m_gpuTimerFrames[i], double(m_gpuTimers[i]->waitForResult()) * 1e-6);
+                m_gpuTimerPending[i] = false;
+            }
+#endif
+        }
+
+        /*!
+        * \fn releaseGpuTimers
+        * \brief Destroy the GPU timer queries (the GL context must be current)
+        */
+        void releaseGpuTimers()
+        {
+#if !defined(QT_OPENGL_ES_2)
+            for(int i = 0; i < NB_GPU_TIMERS; i++)
+            {
+                delete m_gpuTimers[i];
+                m_gpuTimers[i] = nullptr;
+                m_gpuTimerPending[i] = false;
+            }
+#endif
+        }
+
         /*!
         * \fn setCamera
         * \brief Set a new camera.
@@ -143,11 +390,12 @@ class QGLViewer : public QOpenGLWidget
 
             _camera->setScreenWidthAndHeight(width(), height());
 
-            //// Disconnect current camera from this viewer.
-            //disconnect(this->camera()->frame(), SIGNAL(manipulated()), this, SLOT(update()));
+            // Disconnect current camera from this viewer.
+            disconnect(this->camera()->frame(), SIGNAL(modified()), this, SLOT(updateIfModified()));
 
-            //// Connect camera frame to this viewer.
-            //connect(camera->frame(), SIGNAL(manipulated()), SLOT(update()));
+            // Connect camera frame to this viewer: it is repainted when the frame is modified, 
+            // by mouse events or by the application.
+            connect(_camera->frame(), SIGNAL(modified()), this, SLOT(updateIfModified()));
 
             m_camera = _camera;
 
@@ -166,6 +414,27 @@ class QGLViewer : public QOpenGLWidget
         { 
             setFocusPolicy(Qt::StrongFocus); 
 
+            m_selecting = false;
+            m_paintedCameraVersion = 0;
+            m_paintedSceneVersion = 0;
+
+            m_statsDisplayed = false;
+            m_clock.start();
+            m_lastFrameStart = -1;
+            m_eventMs = 0.0;
+            m_drawnTriangles = 0;
+            m_drawCalls = 0;
+            m_statsTextTime = 0;
+#if !defined(QT_OPENGL_ES_2)
+            m_gpuTimersCreated = false;
+            for(int i = 0; i < NB_GPU_TIMERS; i++)
+            {
+                m_gpuTimers[i] = nullptr;
+                m_gpuTimerFrames[i] = 0;
+                m_gpuTimerPending[i] = false;
+            }
+#endif
+
             m_camera = new qgltoolkit::Camera();
             this->setSceneRadius(1.0);
             this->setSceneCenter( glm::vec3(0.0f) );
@@ -227,7 +496,18 @@ class QGLViewer : public QOpenGLWidget
         * \fn ~QGLViewer
         * \brief QGLViewer destructor
         */
-        virtual ~QGLViewer(){}
+        virtual ~QGLViewer()
+        {
+#if !defined(QT_OPENGL_ES_2)
+            // GL objects are destroyed in their context
+            if(m_gpuTimersCreated)
+            {
+                makeCurrent();
+                releaseGpuTimers();
+                doneCurrent();
+            }
+#endif
+        }
 
     
 
@@ -253,7 +533,133 @@ class QGLViewer : public QOpenGLWidget
 
         virtual void draw() {}
 
-        virtual void paintGL() { draw(); }
+        virtual void paintGL() 
+        { 
+            const qint64 frameStart = m_clock.nsecsElapsed();
+            readGpuTimers();
+
+            FrameTiming timing;
+            timing.intervalMs = (m_lastFrameStart < 0) ? 0.0 : double(frameStart - m_lastFrameStart) * 1e-6;
+            timing.eventMs = m_eventMs;
+            m_lastFrameStart = frameStart;
+            m_eventMs = 0.0;
+
+            // (the matrices are computed lazily: draw() gets them for free)
+            camera()->computeProjectionMatrix();
+            camera()->computeViewMatrix();
+            const qint64 cameraEnd = m_clock.nsecsElapsed();
+            timing.cameraMs = double(cameraEnd - frameStart) * 1e-6;
+
+            m_drawnTriangles = 0;
+            m_drawCalls = 0;
+            const int gpuTimer = beginGpuTimer();
+            draw(); 
+            timing.drawMs = double(m_clock.nsecsElapsed() - cameraEnd) * 1e-6;
+            timing.gpuMs = -1.0;
+            timing.triangles = m_drawnTriangles;
+            timing.drawCalls = m_drawCalls;
+            endGpuTimer(gpuTimer, m_frameStats.record(timing));
+
+            if(m_selecting)
+                drawSelectionRegion();
+            if(m_statsDisplayed)
+                drawStats();
+
+            // (after draw(), which may modify the scene, e.g. by uploading it progressively)
+            m_paintedCameraVersion = camera()->version();
+            m_paintedSceneVersion = sceneVersion();
+        }
+
+        /*!
+        * \fn drawStats
+        * \brief Draw the frame stats in the top left corner, with a QPainter: a single text block averaged 
+        * over the last frames, refreshed 4 times per second to be readable (and cheap to draw).
+        */
+        virtual void drawStats()
+        {
+            const qint64 now = m_clock.nsecsElapsed();
+            if(m_statsText.isEmpty() || now - m_statsTextTime > 250000000)
+            {
+                const FrameTiming mean = m_frameStats.average(32);
+                const FrameTiming &last = m_frameStats.frame(0);
+                const double cpuMs = mean.eventMs + mean.cameraMs + mean.drawMs;
+                m_statsText = QString("%1 fps (%2 ms)\n").arg(mean.intervalMs > 0.0 ? 1000.0 / mean.intervalMs : 0.0, 0, 'f', 1)
+                                                         .arg(mean.intervalMs, 0, 'f', 2);
+                m_statsText += QString("CPU %1 ms: events %2, camera %3, draw %4\n").arg(cpuMs, 0, 'f', 2)
+                                                                                   .arg(mean.eventMs, 0, 'f', 2)
+                                                                                   .arg(mean.cameraMs, 0, 'f', 2)
+                                                                                   .arg(mean.drawMs, 0, 'f', 2);
+                m_statsText += (mean.gpuMs < 0.0) ? QString("GPU -\n") : QString("GPU %1 ms\n").arg(mean.gpuMs, 0, 'f', 2);
+                m_statsText += QString("%1 triangles, %2 draw calls").arg(last.triangles).arg(last.drawCalls);
+                m_statsTextTime = now;
+            }
+
+            QPainter painter(this);
+            const QRect rect = painter.boundingRect(QRect(8, 8, width(), height()), Qt::AlignLeft | Qt::AlignTop, m_statsText);
+            painter.fillRect(rect.adjusted(-4, -4, 4, 4), QColor(0, 0, 0, 160));
+            painter.setPen(Qt::white);
+            painter.drawText(rect, Qt::AlignLeft | Qt::AlignTop, m_statsText);
+            painter.end();
+        }
+
+        /*!
+        * \fn drawSelectionRegion
+        * \brief Draw the outline of the selection region over the scene, with a QPainter
+        */
+        virtual void drawSelectionRegion()
+        {
+            const std::vector<glm::vec2> &points = m_selectionRegion.points();
+            if(points.size() < 2)
+                return;
+
+            QPainter painter(this);
+            painter.setPen( QPen(Qt::white, 1.0, Qt::DashLine) );
+            if(m_selectionRegion.shape() == SelectionRegion::RECTANGLE)
+            {
+                const glm::vec2 &bBoxMin = m_selectionRegion.bBoxMin();
+                const glm::vec2 &bBoxMax = m_selectionRegion.bBoxMax();
+                painter.drawRect( QRectF(bBoxMin.x, bBoxMin.y, bBoxMax.x - bBoxMin.x, bBoxMax.y - bBoxMin.y) );
+            }
+            else
+            {
+                QPolygonF polygon;
+                for(size_t i = 0; i < points.size(); i++)
+                    polygon << QPointF(points[i].x, points[i].y);
+                painter.drawPolygon(polygon);
+            }
+            painter.end();
+        }
+
+        /*!
+        * \fn intersectRay
+        * \brief Find the first intersection of a world space ray with the scene, used by pick().
+        * Override it to make the scene pickable (e.g. with a BVH of its triangles). The default scene is empty.
+        * \param _origin: origin of the ray
+        * \param _direction: unit direction of the ray
+        * \param _result: returned closest intersection, if any
+        * \return true if the ray hits the scene
+        */
+        virtual bool intersectRay(const glm::vec3 &_origin, const glm::vec3 &_direction, PickResult &_result) const
+        {
+            Q_UNUSED(_origin);
+            Q_UNUSED(_direction);
+            Q_UNUSED(_result);
+            return false;
+        }
+
+        /*!
+        * \fn selectRegion
+        * \brief Select the parts of the scene inside a region of the screen (see SelectionRegion).
+        * Called each time the region is modified while the mouse is dragged, and once more when the button is released:
+        * override it to select the scene (e.g. with a projection of its vertices). The default scene is empty.
+        * \param _region: region, in pixel coords
+        * \param _finished: true when the mouse button is released (final selection)
+        */
+        virtual void selectRegion(const SelectionRegion &_region, bool _finished)
+        {
+            Q_UNUSED(_region);
+            Q_UNUSED(_finished);
+        }
 
         virtual std::string helpString() const 
         {
@@ -263,6 +669,9 @@ class QGLViewer : public QOpenGLWidget
                         text += " Middle mouse button / wheel: translates camera toward scene center (zoom) \n";
                         text += " Double click left: aligns the closer axis with the camera (if close enough) \n";
                         text += " Double click right : re-centers the scene \n";
+                        text += " Shift + double click left: rotates around the surface point under the cursor \n";
+                        text += " Ctrl + left mouse button: selects in a rectangle (with Shift: in a lasso) \n";
+                        text += " F key : toggles the display of the frame stats (fps, CPU and GPU times) \n";
             return text;
         }
 
@@ -271,12 +680,48 @@ class QGLViewer : public QOpenGLWidget
         |                                                    EVENTS                                                   |
         +------------------------------------------------------------------------------------------------------------*/
 
+        /*!
+        * \fn event
+        * \brief Dispatch the events to their handler, the CPU time of the input events is added to the frame stats
+        */
+        virtual bool event(QEvent *_e)
+        {
+            switch(_e->type())
+            {
+                case QEvent::MouseButtonPress:
+                case QEvent::MouseButtonRelease:
+                case QEvent::MouseButtonDblClick:
+                case QEvent::MouseMove:
+                case QEvent::Wheel:
+                case QEvent::KeyPress:
+                case QEvent::KeyRelease:
+                {
+                    const qint64 start = m_clock.nsecsElapsed();
+                    const bool accepted = QOpenGLWidget::event(_e);
+                    m_eventMs += double(m_clock.nsecsElapsed() - start) * 1e-6;
+                    return accepted;
+                }
+                default:
+                    return QOpenGLWidget::event(_e);
+            }
+        }
+
         /*!
         * \fn mousePressEvent
         * \brief Event handler for mouse button pressed.
         */
         virtual void mousePressEvent(QMouseEvent * _e)
         {
+            if(_e->button() == Qt::LeftButton && (_e->modifiers() & Qt::ControlModifier))
+            {
+                const SelectionRegion::Shape shape = (_e->modifiers() & Qt::ShiftModifier) ? SelectionRegion::LASSO 
+                                                                                           : SelectionRegion::RECTANGLE;
+                m_selectionRegion.start(shape, glm::vec2(_e->pos().x(), _e->pos().y()));
+                m_selecting = true;
+                update();
+                return;
+            }
+
             qgltoolkit::CameraFrame::MouseAction action;
 
             if( _e->button()  == Qt::RightButton)
@@ -289,7 +734,8 @@ class QGLViewer : public QOpenGLWidget
             camera()->frame()->startAction(action);
             camera()->frame()->mousePressEvent(_e );
 
-            update();
+            // nothing moves until the mouse does
+            updateIfModified();
 
         }
 
@@ -299,6 +745,13 @@ class QGLViewer : public QOpenGLWidget
         */
         virtual void mouseMoveEvent(QMouseEvent *_e)
         {
+            if(m_selecting)
+            {
+                m_selectionRegion.extend(glm::vec2(_e->pos().x(), _e->pos().y()));
+                selectRegion(m_selectionRegion, false);
+                this->update();
+                return;
+            }
 
             //if (camera()->frame()->isManipulated()) 
             //{
@@ -306,14 +759,29 @@ class QGLViewer : public QOpenGLWidget
             //} 
              camera()->frame()->mouseMoveEvent(_e, camera()->sceneCenter() );
 
-            this->update();
+            // (no repaint for a move without camera action)
+            updateIfModified();
         }
 
         /*!
         * \fn mouseReleaseEvent
         * \brief Event handler for mouse button released.
         */
-        virtual void mouseReleaseEvent(QMouseEvent *_e){ _e->ignore(); }
+        virtual void mouseReleaseEvent(QMouseEvent *_e)
+        { 
+            if(m_selecting && _e->button() == Qt::LeftButton)
+            {
+                m_selectionRegion.extend(glm::vec2(_e->pos().x(), _e->pos().y()));
+                selectRegion(m_selectionRegion, true);
+                m_selectionRegion.clear();
+                m_selecting = false;
+                this->update();
+                return;
+            }
+
+            camera()->frame()->mouseReleaseEvent(_e);
+            _e->ignore(); 
+        }
 
         /*!
         * \fn mouseDoubleClickEvent
@@ -322,8 +790,14 @@ class QGLViewer : public QOpenGLWidget
         virtual void mouseDoubleClickEvent(QMouseEvent *_e)
         { 
             //_e->ignore(); 
+            if (_e->modifiers() == Qt::ShiftModifier && _e->button() == Qt::LeftButton)
+            {
+                setPivotPointFromPixel(_e->pos());
+                return;
+            }
+
             camera()->frame()->mouseDoubleClickEvent(_e, camera()->sceneCenter() );
-            this->update();
+            updateIfModified();
         }
 
         /*!
@@ -337,14 +811,18 @@ class QGLViewer : public QOpenGLWidget
             camera()->frame()->startAction(action);
             camera()->frame()->wheelEvent(_e);
    
-            this->update();
+            updateIfModified();
         }
 
         /*!
         * \fn keyPressEvent
         * \brief Event handler for keyboard key pressed.
         */
-        virtual void keyPressEvent(QKeyEvent *_e) { }
+        virtual void keyPressEvent(QKeyEvent *_e) 
+        { 
+            if(_e->key() == Qt::Key_F)
+                toggleStatsDisplayed();
+        }
 
         /*!
         * \fn keyPressEvent
@@ -0,0 +1,340 @@
+/*********************************************************************************************************************
+ *
+ * selectionRegion.h
+ *
+ * Rectangle or lasso region of the screen, drawn with the mouse to select parts of the scene
+ *
+ * QGL_toolkit
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#ifndef QGLTOOLKIT_SELECTIONREGION_H
+#define QGLTOOLKIT_SELECTIONREGION_H
+
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+
+
+
+namespace qgltoolkit
+{
+
+
+/*!
+* \class SelectionRegion
+* \brief Rectangle or lasso (closed polygon) in pixel coords (as in Qt mouse events, y pointing down).
+* A point is inside a lasso if the center of its pixel is inside the polygon (even-odd rule).
+* The lasso is rasterized into a mask of its bounding box each time it is extended, with a summed area table,
+* so that contains() and classifyRect() take constant time: they can be called from several threads.
+*/
+class SelectionRegion
+{
+
+    public:
+
+        /*!
+        * \enum Shape
+        * \brief Shape of the region
+        */
+        enum Shape
+        {
+            RECTANGLE,      /*!< rectangle between the first and the last points */
+            LASSO           /*!< polygon through all the points */
+        };
+
+        /*!
+        * \enum Coverage
+        * \brief Position of a rectangle w.r.t. the region
+        */
+        enum Coverage
+        {
+            OUTSIDE = 0,        /*!< no point of the rectangle is in the region */
+            INTERSECTING = 1,   /*!< some points of the rectangle may be in the region */
+            INSIDE = 2          /*!< all the points of the rectangle are in the region */
+        };
+
+
+    private:
+
+        Shape m_shape;                      /*!< rectangle or lasso */
+        std::vector<glm::vec2> m_points;    /*!< rectangle: first and last points, lasso: vertices of the polygon */
+        glm::vec2 m_bBoxMin;                /*!< min corner of the bounding box of the points */
+        glm::vec2 m_bBoxMax;                /*!< max corner of the bounding box of the points */
+
+        int m_maskX;                        /*!< first column of the lasso mask */
+        int m_maskY;                        /*!< first row of the lasso mask */
+        int m_maskWidth;                    /*!< number of columns of the lasso mask */
+        int m_maskHeight;                   /*!< number of rows of the lasso mask */
+        std::vector<uint8_t> m_mask;        /*!< 1 for the pixels of the bounding box inside the lasso */
+        std::vector<uint32_t> m_coverage;   /*!< summed area table of the mask ((width + 1) x (height + 1)) */
+
+
+    public:
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                                 CONSTRUCTORS                                                |
+        +------------------------------------------------------------------------------------------------------------*/
+
+        /*!
+        * \fn SelectionRegion
+        * \brief Default constructor of SelectionRegion (empty rectangle)
+        */
+        SelectionRegion()
+        : m_shape(RECTANGLE), m_bBoxMin(0.0f), m_bBoxMax(0.0f), m_maskX(0), m_maskY(0), m_maskWidth(0), m_maskHeight(0)
+        { }
+
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                              GETTERS / SETTERS                                              |
+        +------------------------------------------------------------------------------------------------------------*/
+
+        /*! \fn shape */
+        Shape shape() const { return m_shape; }
+
+        /*! \fn points \brief Rectangle: first and last points, lasso: vertices of the polygon (closed implicitly) */
+        const std::vector<glm::vec2> &points() const { return m_points; }
+
+        /*! \fn bBoxMin \brief Min corner of the bounding box of the region */
+        const glm::vec2 &bBoxMin() const { return m_bBoxMin; }
+
+        /*! \fn bBoxMax \brief Max corner of the bounding box of the region */
+        const glm::vec2 &bBoxMax() const { return m_bBoxMax; }
+
+        /*! \fn isEmpty \brief Returns true if the region has no area */
+        bool isEmpty() const
+        {
+            return m_points.size() < ((m_shape == LASSO) ? 3u : 2u) || m_bBoxMax.x <= m_bBoxMin.x || m_bBoxMax.y <= m_bBoxMin.y;
+        }
+
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                                    MISC.                                                    |
+        +------------------------------------------------------------------------------------------------------------*/
+
+        /*!
+        * \fn start
+        * \brief Start a new region at a point (e.g. where the mouse button is pressed)
+        */
+        void start(Shape _shape, const glm::vec2 &_point)
+        {
+            m_shape = _shape;
+            m_points.assign(1, _point);
+            m_bBoxMin = m_bBoxMax = _point;
+            if(m_shape == RECTANGLE)
+                m_points.push_back(_point);
+            rasterize();
+        }
+
+        /*!
+        * \fn extend
+        * \brief Move the second corner of a rectangle, or add a point to a lasso
+        * (points closer than one pixel to the previous one are skipped)
+        */
+        void extend(const glm::vec2 &_point)
+        {
+            if(m_points.empty())
+            {
+                start(m_shape, _point);
+                return;
+            }
+
+            if(m_shape == RECTANGLE)
+            {
+                m_points[1] = _point;
+                m_bBoxMin = glm::min(m_points[0], m_points[1]);
+                m_bBoxMax = glm::max(m_points[0], m_points[1]);
+                return;
+            }
+
+            const glm::vec2 delta = _point - m_points.back();
+            if(glm::dot(delta, delta) < 1.0f)
+                return;
+
+            m_points.push_back(_point);
+            m_bBoxMin = glm::min(m_bBoxMin, _point);
+            m_bBoxMax = glm::max(m_bBoxMax, _point);
+            rasterize();
+        }
+
+        /*!
+        * \fn clear
+        * \brief Remove all the points
+        */
+        void clear()
+        {
+            m_points.clear();
+            m_bBoxMin = m_bBoxMax = glm::vec2(0.0f);
+            m_maskWidth = m_maskHeight = 0;
+            m_mask.clear();
+            m_coverage.clear();
+        }
+
+        /*!
+        * \fn contains
+        * \brief Returns true if a point (pixel coords) is inside the region
+        */
+        bool contains(float _x, float _y) const
+        {
+            if(m_shape == RECTANGLE)
+                return _x >= m_bBoxMin.x && _x <= m_bBoxMax.x && _y >= m_bBoxMin.y && _y <= m_bBoxMax.y;
+
+            if(!(_x >= m_bBoxMin.x && _x <= m_bBoxMax.x && _y >= m_bBoxMin.y && _y <= m_bBoxMax.y))
+                return false;
+
+            const int i = static_cast<int>(std::floor(_x)) - m_maskX;
+            const int j = static_cast<int>(std::floor(_y)) - m_maskY;
+            if(i < 0 || j < 0 || i >= m_maskWidth || j >= m_maskHeight)
+                return false;
+
+            return m_mask[static_cast<size_t>(j) * m_maskWidth + i] != 0;
+        }
+
+        /*!
+        * \fn classifyRect
+        * \brief Position of a rectangle (pixel coords) w.r.t. the region:
+        * INSIDE if contains() is true for all of its points, OUTSIDE if it is false for all of them.
+        * \param _min, _max: min and max corners of the rectangle
+        */
+        Coverage classifyRect(const glm::vec2 &_min, const glm::vec2 &_max) const
+        {
+            // (comparisons are false for NaN coords, which are classified INTERSECTING)
+            if(_max.x < m_bBoxMin.x || _min.x > m_bBoxMax.x || _max.y < m_bBoxMin.y || _min.y > m_bBoxMax.y)
+                return OUTSIDE;
+
+            const bool inBBox = _min.x >= m_bBoxMin.x && _max.x <= m_bBoxMax.x && _min.y >= m_bBoxMin.y && _max.y <= m_bBoxMax.y;
+
+            if(m_shape == RECTANGLE)
+                return inBBox ? INSIDE : INTERSECTING;
+
+            if(m_maskWidth == 0 || m_maskHeight == 0)
+                return OUTSIDE;
+
+            // range of pixels of the rectangle, clamped to the mask (the clamping is NaN safe)
+            const float maxX = static_cast<float>(m_maskWidth - 1);
+            const float maxY = static_cast<float>(m_maskHeight - 1);
+            const int i0 = static_cast<int>( std::min(maxX, std::max(0.0f, std::floor(_min.x) - m_maskX)) );
+            const int i1 = static_cast<int>( std::min(maxX, std::max(0.0f, std::floor(_max.x) - m_maskX)) );
+            const int j0 = static_cast<int>( std::min(maxY, std::max(0.0f, std::floor(_min.y) - m_maskY)) );
+            const int j1 = static_cast<int>( std::min(maxY, std::max(0.0f, std::floor(_max.y) - m_maskY)) );
+
+            const size_t stride = static_cast<size_t>(m_maskWidth) + 1;
+            const uint32_t covered = m_coverage[(j1 + 1) * stride + (i1 + 1)] - m_coverage[j0 * stride + (i1 + 1)]
+                                   - m_coverage[(j1 + 1) * stride + i0] + m_coverage[j0 * stride + i0];
+
+            if(covered == 0)
+                return OUTSIDE;
+
+            const uint32_t area = static_cast<uint32_t>(i1 - i0 + 1) * static_cast<uint32_t>(j1 - j0 + 1);
+            return (inBBox && covered == area) ? INSIDE : INTERSECTING;
+        }
+
+
+    private:
+
+        /*!
+        * \fn rasterize
+        * \brief Compute the mask of the pixels inside the lasso, and its summed area table.
+        * Each edge adds its crossings with the rows of pixel centers, then the pixels between
+        * pairs of sorted crossings are filled.
+        */
+        void rasterize()
+        {
+            m_maskWidth = m_maskHeight = 0;
+            m_mask.clear();
+            m_coverage.clear();
+            if(m_shape != LASSO || m_points.size() < 3)
+                return;
+
+            m_maskX = static_cast<int>(std::floor(m_bBoxMin.x));
+            m_maskY = static_cast<int>(std::floor(m_bBoxMin.y));
+            m_maskWidth = static_cast<int>(std::floor(m_bBoxMax.x)) - m_maskX + 1;
+            m_maskHeight = static_cast<int>(std::floor(m_bBoxMax.y)) - m_maskY + 1;
+
+            // rows [first, end) of pixel centers crossed by an edge
+            const size_t nbPoints = m_points.size();
+            auto rowRange = [&](const glm::vec2 &_a, const glm::vec2 &_b, int &_first, int &_end)
+            {
+                const float yMin = std::min(_a.y, _b.y) - m_maskY - 0.5f;
+                const float yMax = std::max(_a.y, _b.y) - m_maskY - 0.5f;
+                _first = std::max(0, static_cast<int>(std::ceil(yMin)));
+                _end = std::min(m_maskHeight, static_cast<int>(std::ceil(yMax)));
+            };
+
+            // crossings sorted by row (counting sort)
+            std::vector<uint32_t> rowOffsets(m_maskHeight + 1, 0);
+            for(size_t e = 0; e < nbPoints; e++)
+            {
+                int first, end;
+                rowRange(m_points[e], m_points[(e + 1) % nbPoints], first, end);
+                for(int j = first; j < end; j++)
+                    rowOffsets[j + 1]++;
+            }
+            for(int j = 0; j < m_maskHeight; j++)
+                rowOffsets[j + 1] += rowOffsets[j];
+
+            std::vector<float> crossings(rowOffsets[m_maskHeight]);
+            std::vector<uint32_t> rowSizes(m_maskHeight, 0);
+            for(size_t e = 0; e < nbPoints; e++)
+            {
+                const glm::vec2 &a = m_points[e];
+                const glm::vec2 &b = m_points[(e + 1) % nbPoints];
+                int first, end;
+                rowRange(a, b, first, end);
+                for(int j = first; j < end; j++)
+                {
+                    const float y = static_cast<float>(m_maskY + j) + 0.5f;
+                    crossings[rowOffsets[j] + rowSizes[j]++] = a.x + (y - a.y) * (b.x - a.x) / (b.y - a.y);
+                }
+            }
+
+            // fill the pixels whose centers are between pairs of crossings
+            m_mask.assign(static_cast<size_t>(m_maskWidth) * m_maskHeight, 0);
+            for(int j = 0; j < m_maskHeight; j++)
+            {
+                float *row = crossings.data() + rowOffsets[j];
+                const uint32_t count = rowOffsets[j + 1] - rowOffsets[j];
+                std::sort(row, row + count);
+
+                uint8_t *maskRow = m_mask.data() + static_cast<size_t>(j) * m_maskWidth;
+                for(uint32_t k = 0; k + 1 < count; k += 2)
+                {
+                    const int first = std::max(0, static_cast<int>(std::ceil(row[k] - m_maskX - 0.5f)));
+                    const int end = std::min(m_maskWidth, static_cast<int>(std::ceil(row[k + 1] - m_maskX - 0.5f)));
+                    if(end > first)
+                        std::memset(maskRow + first, 1, end - first);
+                }
+            }
+
+            // summed area table, with a first row and column of zeros
+            const size_t stride = static_cast<size_t>(m_maskWidth) + 1;
+            m_coverage.assign(stride * (m_maskHeight + 1), 0);
+            for(int j = 0; j < m_maskHeight; j++)
+            {
+                const uint8_t *maskRow = m_mask.data() + static_cast<size_t>(j) * m_maskWidth;
+                const uint32_t *previous = m_coverage.data() + j * stride;
+                uint32_t *current = m_coverage.data() + (j + 1) * stride;
+                uint32_t rowSum = 0;
+                for(int i = 0; i < m_maskWidth; i++)
+                {
+                    rowSum += maskRow[i];
+                    current[i + 1] = previous[i + 1] + rowSum;
+                }
+            }
+        }
+
+};
+
+
+} // namespace qgltoolkit
+
+
+#endif // QGLTOOLKIT_SELECTIONREGION_H
@@ -0,0 +1,172 @@
+/*********************************************************************************************************************
+ *
+ * compressed_obj_bench.cpp
+ *
+ * Benchmark: load time of an OBJ file, uncompressed vs gzip/zstd compressed
+ *
+ * usage: qgltoolkit_bench_compressed <file.obj> [nb_runs]
+ * The compressed copies (<file.obj>.gz, <file.obj>.zst) are created next to the file if they do not exist.
+ *
+ * QGL_toolkit demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <vector>
+
+#ifdef QGL_HAVE_ZLIB
+    #include <zlib.h>
+#endif
+#ifdef QGL_HAVE_ZSTD
+    #include <zstd.h>
+#endif
+
+
+#include "demo/objparser.h"
+
+
+namespace
+{
+    bool fileExists(const std::string &_filename)
+    {
+        std::ifstream f(_filename.c_str(), std::ios::binary);
+        return f.is_open();
+    }
+
+    size_t fileSize(const std::string &_filename)
+    {
+        std::ifstream f(_filename.c_str(), std::ios::binary | std::ios::ate);
+        return f.is_open() ? static_cast<size_t>(f.tellg()) : 0;
+    }
+
+#ifdef QGL_HAVE_ZLIB
+    bool writeGzip(const std::string &_filename, const std::vector<char> &_data)
+    {
+        gzFile file = gzopen(_filename.c_str(), "wb6");
+        if (file == nullptr)
+            return false;
+        bool ok = gzwrite(file, _data.data(), static_cast<unsigned int>(_data.size())) == static_cast<int>(_data.size());
+        return (gzclose(file) == Z_OK) && ok;
+    }
+#endif
+
+#ifdef QGL_HAVE_ZSTD
+    bool writeZstd(const std::string &_filename, const std::vector<char> &_data)
+    {
+        std::vector<char> compressed( ZSTD_compressBound(_data.size()) );
+        size_t size = ZSTD_compress(compressed.data(), compressed.size(), _data.data(), _data.size(), 3);
+        if (ZSTD_isError(size))
+            return false;
+        std::ofstream f(_filename.c_str(), std::ios::binary);
+        return f.is_open() && f.write(compressed.data(), size);
+    }
+#endif
+
+    /*!
+    * \fn bestTime
+    * \brief Run _load _nbRuns times, return the best wall-clock time (in seconds), or a negative value on failure
+    */
+    double bestTime(const std::function<bool(ObjChunk&)> &_load, int _nbRuns, ObjChunk &_obj)
+    {
+        double best = -1.0;
+        for (int i = 0; i < _nbRuns; i++)
+        {
+            _obj = ObjChunk();
+            auto start = std::chrono::steady_clock::now();
+            if (!_load(_obj))
+                return -1.0;
+            double t = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            if (best < 0.0 || t < best)
+                best = t;
+        }
+        return best;
+    }
+
+    void report(const std::string &_name, const std::string &_filename, double _time, size_t _textSize, const ObjChunk &_obj, const ObjChunk &_ref)
+    {
+        if (_time < 0.0)
+        {
+            std::cout << std::setw(14) << _name << "  failed to read " << _filename << std::endl;
+            return;
+        }
+
+        bool same = _obj.positions.size() == _ref.positions.size() && _obj.normals.size() == _ref.normals.size()
+                 && _obj.texcoords.size() == _ref.texcoords.size() && _obj.corners == _ref.corners;
+
+        std::cout << std::setw(14) << _name
+                  << std::setw(12) << std::fixed << std::setprecision(1) << fileSize(_filename) / 1.0e6 << " MB"
+                  << std::setw(10) << std::setprecision(3) << _time << " s"
+                  << std::setw(10) << std::setprecision(1) << _textSize / 1.0e6 / _time << " MB/s"
+                  << (same ? "" : "  [MISMATCH]") << std::endl;
+    }
+
+} // anonymous namespace
+
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        std::cerr << "usage: " << argv[0] << " <file.obj> [nb_runs]" << std::endl;
+        return 1;
+    }
+
+    const std::string filename = argv[1];
+    const int nbRuns = (argc > 2) ? std::max(1, std::atoi(argv[2])) : 3;
+
+    std::vector<char> text;
+    if (!readOBJFile(filename, text))
+    {
+        std::cerr << "[ERROR] Could not open " << filename << std::endl;
+        return 1;
+    }
+
+#ifdef QGL_HAVE_ZLIB
+    if (!fileExists(filename + ".gz") && !writeGzip(filename + ".gz", text))
+        std::cerr << "[WARNING] Could not write " << filename << ".gz" << std::endl;
+#endif
+#ifdef QGL_HAVE_ZSTD
+    if (!fileExists(filename + ".zst") && !writeZstd(filename + ".zst", text))
+        std::cerr << "[WARNING] Could not write " << filename << ".zst" << std::endl;
+#endif
+    const size_t textSize = text.size();
+    text = std::vector<char>();
+
+    std::cout << std::setw(14) << "input" << std::setw(15) << "file size" << std::setw(12) << "time"
+              << std::setw(15) << "throughput" << "  (best of " << nbRuns << " runs, throughput of uncompressed text)" << std::endl;
+
+    // uncompressed: single read, then parse
+    ObjChunk ref;
+    double time = bestTime([&](ObjChunk &_obj)
+    {
+        std::vector<char> buffer;
+        if (!readOBJFile(filename, buffer))
+            return false;
+        _obj.reserve(buffer.size());
+        parseOBJChunk(buffer.data(), buffer.data() + buffer.size(), _obj);
+        return true;
+    }, nbRuns, ref);
+    report("obj", filename, time, textSize, ref, ref);
+
+    // compressed: decompression and parsing pipelined on two threads
+    const char *extensions[] = { ".gz", ".zst" };
+    for (const char *ext : extensions)
+    {
+        const std::string compressedFilename = filename + ext;
+        if (!fileExists(compressedFilename))
+            continue;
+
+        ObjChunk obj;
+        time = bestTime([&](ObjChunk &_obj) { return parseCompressedOBJFile(compressedFilename, _obj); }, nbRuns, obj);
+        report(std::string("obj") + ext, compressedFilename, time, textSize, obj, ref);
+    }
+
+    return 0;
+}
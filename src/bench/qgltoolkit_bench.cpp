@@ -0,0 +1,651 @@
+/*********************************************************************************************************************
+ *
+ * qgltoolkit_bench.cpp
+ *
+ * Benchmark of the mesh import pipeline on synthetic OBJ files (no GL context needed)
+ *
+ * usage: qgltoolkit_bench [--faces=1K,10K,100K,1M] [--syntax=v,vt,vn,vtn] [--runs=3] [--threads=0]
+ *                         [--dir=<temp dir>] [--output=<file.json>] [--keep] [--trace=<file.json>]
+ *
+ * For each size and face syntax, a grid mesh is written as an OBJ file, then each stage
+ * of the loader is timed separately (best of --runs). Results are written as JSON
+ * (to stdout, or to --output), with throughput and peak RSS of every stage, and the vertex cache
+ * efficiency (ACMR, ATVR) of the mesh before and after optimizeIndexOrder(), its number of meshlets
+ * and of BVH nodes, the number of vertices of a lasso selection, and the number of triangles and the error
+ * of its levels of detail. With --trace, the profiling zones of all the stages are written as
+ * a Chrome trace (requires the QGL_ENABLE_TRACING CMake option).
+ *
+ * QGL_toolkit demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+    #define NOMINMAX
+    #include <windows.h>
+    #include <psapi.h>
+#else
+    #include <sys/resource.h>
+#endif
+
+
+#include "demo/trimesh.h"
+#include "demo/objparser.h"
+#include "demo/threadpool.h"
+#include "demo/trace.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+
+namespace
+{
+    // Face syntaxes of the generated files
+    enum FaceSyntax { SYNTAX_V, SYNTAX_VT, SYNTAX_VN, SYNTAX_VTN };
+    const char * const SYNTAX_KEYS[] = { "v", "vt", "vn", "vtn" };
+    const char * const SYNTAX_NAMES[] = { "f v", "f v/t", "f v//n", "f v/t/n" };
+
+    // Largest supported size (faces)
+    const size_t MAX_FACES = 50000000;
+
+
+    /*!
+    * \struct BenchOptions
+    * \brief Command line options
+    */
+    struct BenchOptions
+    {
+        std::vector<size_t> faces;
+        std::vector<FaceSyntax> syntaxes;
+        int runs = 3;
+        unsigned int threads = 0;
+        std::string dir;
+        std::string output;
+        std::string trace;
+        bool keepFiles = false;
+    };
+
+
+    /*!
+    * \struct StageResult
+    * \brief Timing of a stage of the loader
+    */
+    struct StageResult
+    {
+        std::string name;
+        double seconds;             // best time of the runs
+        size_t bytes;               // bytes processed by the stage
+        size_t faces;               // faces processed by the stage
+        double peakRSS;             // peak resident set size during the stage (MB)
+    };
+
+
+    /*!
+    * \class BenchMesh
+    * \brief TriMesh exposing the loader stages
+    */
+    class BenchMesh : public TriMesh
+    {
+        public:
+            using TriMesh::importOBJ;
+            using TriMesh::importOBJParallel;
+
+            size_t numFaces() const { return m_indices.size() / 3; }
+            size_t numVertices() const { return m_vertices.size(); }
+    };
+
+
+    /*------------------------------------------------------------------------------------------------------------+
+    |                                                 MEMORY                                                      |
+    +-------------------------------------------------------------------------------------------------------------*/
+
+    // Reset the peak RSS of the process (only supported on Linux, where it is the "VmHWM" counter)
+    void resetPeakRSS()
+    {
+#if defined(__linux__)
+        std::ofstream clearRefs("/proc/self/clear_refs");
+        if (clearRefs.is_open())
+            clearRefs << "5";
+#endif
+    }
+
+    // Peak RSS of the process (MB)
+    double peakRSS()
+    {
+#if defined(_WIN32)
+        PROCESS_MEMORY_COUNTERS counters;
+        if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+            return counters.PeakWorkingSetSize / (1024.0 * 1024.0);
+        return 0.0;
+#else
+    #if defined(__linux__)
+        std::ifstream status("/proc/self/status");
+        std::string line;
+        while (std::getline(status, line))
+            if (line.compare(0, 6, "VmHWM:") == 0)
+                return std::atof(line.c_str() + 6) / 1024.0;
+    #endif
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+    #if defined(__APPLE__)
+        return usage.ru_maxrss / (1024.0 * 1024.0);
+    #else
+        return usage.ru_maxrss / 1024.0;
+    #endif
+#endif
+    }
+
+
+    /*------------------------------------------------------------------------------------------------------------+
+    |                                               GENERATOR                                                     |
+    +-------------------------------------------------------------------------------------------------------------*/
+
+    /*!
+    * \class TextWriter
+    * \brief Buffered writer of OBJ records
+    */
+    class TextWriter
+    {
+        public:
+
+            explicit TextWriter(FILE *_file) : m_file(_file), m_size(0) { m_buffer.reserve(BUFFER_SIZE + 256); }
+            ~TextWriter() { flush(); }
+
+            void put(const char *_str) { m_buffer += _str; check(); }
+            void put(char _c) { m_buffer += _c; }
+
+            void put(float _value)
+            {
+                char text[32];
+                std::to_chars_result res = std::to_chars(text, text + sizeof(text), _value, std::chars_format::fixed, 6);
+                m_buffer.append(text, res.ptr);
+            }
+
+            void put(size_t _value)
+            {
+                char text[32];
+                std::to_chars_result res = std::to_chars(text, text + sizeof(text), _value);
+                m_buffer.append(text, res.ptr);
+            }
+
+            void endLine() { m_buffer += '\n'; check(); }
+
+            size_t size() const { return m_size + m_buffer.size(); }
+
+        private:
+
+            static const size_t BUFFER_SIZE = 1 << 20;
+
+            FILE *m_file;
+            std::string m_buffer;
+            size_t m_size;
+
+            void check()
+            {
+                if (m_buffer.size() >= BUFFER_SIZE)
+                    flush();
+            }
+
+            void flush()
+            {
+                std::fwrite(m_buffer.data(), 1, m_buffer.size(), m_file);
+                m_size += m_buffer.size();
+                m_buffer.clear();
+            }
+    };
+
+    /*!
+    * \fn writeGridOBJ
+    * \brief Write a height field grid with exactly _nbFaces triangles, using the face syntax _syntax
+    * (each vertex has its own texcoord and normal, with the same index)
+    * \return size of the file (in bytes), 0 if it could not be written
+    */
+    size_t writeGridOBJ(const std::string &_filename, size_t _nbFaces, FaceSyntax _syntax)
+    {
+        FILE *file = std::fopen(_filename.c_str(), "wb");
+        if (file == nullptr)
+            return 0;
+
+        // nearly square grid of 2 triangles per cell
+        const size_t nbCells = (_nbFaces + 1) / 2;
+        const size_t nbColumns = std::max<size_t>(1, static_cast<size_t>( std::ceil(std::sqrt(static_cast<double>(nbCells))) ));
+        const size_t nbRows = (nbCells + nbColumns - 1) / nbColumns;
+        const size_t rowSize = nbColumns + 1;
+
+        const bool hasTexcoords = (_syntax == SYNTAX_VT || _syntax == SYNTAX_VTN);
+        const bool hasNormals = (_syntax == SYNTAX_VN || _syntax == SYNTAX_VTN);
+
+        size_t size = 0;
+        {
+            TextWriter writer(file);
+            writer.put("# qgltoolkit_bench grid\n");
+
+            for (size_t r = 0; r <= nbRows; r++)
+            {
+                for (size_t c = 0; c <= nbColumns; c++)
+                {
+                    const float u = static_cast<float>(c) / nbColumns;
+                    const float v = static_cast<float>(r) / nbRows;
+                    const float height = 0.05f * std::sin(12.0f * u) * std::cos(9.0f * v);
+
+                    writer.put("v "); writer.put(u); writer.put(' '); writer.put(v); writer.put(' '); writer.put(height); writer.endLine();
+                    if (hasTexcoords)
+                    {
+                        writer.put("vt "); writer.put(u); writer.put(' '); writer.put(v); writer.endLine();
+                    }
+                    if (hasNormals)
+                    {
+                        const float dx = 0.6f * std::cos(12.0f * u) * std::cos(9.0f * v);
+                        const float dy = -0.45f * std::sin(12.0f * u) * std::sin(9.0f * v);
+                        const float norm = std::sqrt(dx * dx + dy * dy + 1.0f);
+                        writer.put("vn "); writer.put(-dx / norm); writer.put(' '); writer.put(-dy / norm); writer.put(' '); writer.put(1.0f / norm); writer.endLine();
+                    }
+                }
+            }
+
+            size_t nbWritten = 0;
+            for (size_t cell = 0; cell < nbCells && nbWritten < _nbFaces; cell++)
+            {
+                const size_t r = cell / nbColumns;
+                const size_t c = cell % nbColumns;
+                const size_t i00 = r * rowSize + c + 1;     // 1-based OBJ indices
+                const size_t i01 = i00 + 1;
+                const size_t i10 = i00 + rowSize;
+                const size_t i11 = i10 + 1;
+
+                const size_t triangles[2][3] = { { i00, i01, i11 }, { i00, i11, i10 } };
+                for (unsigned int t = 0; t < 2 && nbWritten < _nbFaces; t++, nbWritten++)
+                {
+                    writer.put('f');
+                    for (unsigned int k = 0; k < 3; k++)
+                    {
+                        const size_t index = triangles[t][k];
+                        writer.put(' ');
+                        writer.put(index);
+                        if (_syntax == SYNTAX_VT)  { writer.put('/');  writer.put(index); }
+                        if (_syntax == SYNTAX_VN)  { writer.put("//"); writer.put(index); }
+                        if (_syntax == SYNTAX_VTN) { writer.put('/');  writer.put(index); writer.put('/'); writer.put(index); }
+                    }
+                    writer.endLine();
+                }
+            }
+            size = writer.size();
+        }
+
+        bool ok = (std::ferror(file) == 0);
+        ok = (std::fclose(file) == 0) && ok;
+        return ok ? size : 0;
+    }
+
+
+    /*------------------------------------------------------------------------------------------------------------+
+    |                                                 TIMING                                                      |
+    +-------------------------------------------------------------------------------------------------------------*/
+
+    /*!
+    * \fn runStage
+    * \brief Run _stage _runs times, and return its best time and the peak RSS
+    * \param _setup : called before each run, not timed
+    * \param _stage : timed function
+    */
+    template <typename Setup, typename Stage>
+    StageResult runStage(const std::string &_name, int _runs, size_t _bytes, size_t _faces, Setup _setup, Stage _stage)
+    {
+        StageResult result;
+        result.name = _name;
+        result.seconds = -1.0;
+        result.bytes = _bytes;
+        result.faces = _faces;
+
+        resetPeakRSS();
+        for (int i = 0; i < _runs; i++)
+        {
+            _setup();
+            auto start = std::chrono::steady_clock::now();
+            _stage();
+            double t = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            if (result.seconds < 0.0 || t < result.seconds)
+                result.seconds = t;
+        }
+        result.peakRSS = peakRSS();
+
+        std::cerr << "    " << _name << ": " << result.seconds * 1000.0 << " ms" << std::endl;
+        return result;
+    }
+
+
+    /*------------------------------------------------------------------------------------------------------------+
+    |                                             COMMAND LINE                                                    |
+    +-------------------------------------------------------------------------------------------------------------*/
+
+    // Parse a size with an optional K or M suffix (e.g. "10K", "2.5M")
+    bool parseSize(const std::string &_text, size_t &_size)
+    {
+        char *end = nullptr;
+        double value = std::strtod(_text.c_str(), &end);
+        if (end == _text.c_str())
+            return false;
+        if (*end == 'k' || *end == 'K') { value *= 1e3; end++; }
+        else if (*end == 'm' || *end == 'M') { value *= 1e6; end++; }
+        if (*end != '\0' || value < 1.0)
+            return false;
+        _size = static_cast<size_t>(value);
+        return true;
+    }
+
+    std::vector<std::string> split(const std::string &_text)
+    {
+        std::vector<std::string> items;
+        std::stringstream stream(_text);
+        std::string item;
+        while (std::getline(stream, item, ','))
+            if (!item.empty())
+                items.push_back(item);
+        return items;
+    }
+
+    bool parseOptions(int argc, char *argv[], BenchOptions &_options)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            const std::string arg = argv[i];
+            const size_t equal = arg.find('=');
+            const std::string key = arg.substr(0, equal);
+            const std::string value = (equal == std::string::npos) ? std::string() : arg.substr(equal + 1);
+
+            if (key == "--faces")
+            {
+                _options.faces.clear();
+                for (const std::string &item : split(value))
+                {
+                    size_t size;
+                    if (!parseSize(item, size) || size > MAX_FACES)
+                    {
+                        std::cerr << "[ERROR] Invalid number of faces: " << item << " (1 to 50M)" << std::endl;
+                        return false;
+                    }
+                    _options.faces.push_back(size);
+                }
+            }
+            else if (key == "--syntax")
+            {
+                _options.syntaxes.clear();
+                for (const std::string &item : split(value))
+                {
+                    const char * const *found = std::find_if(std::begin(SYNTAX_KEYS), std::end(SYNTAX_KEYS),
+                                                             [&](const char *_key) { return item == _key; });
+                    if (found == std::end(SYNTAX_KEYS))
+                    {
+                        std::cerr << "[ERROR] Invalid face syntax: " << item << " (v, vt, vn or vtn)" << std::endl;
+                        return false;
+                    }
+                    _options.syntaxes.push_back( static_cast<FaceSyntax>(found - std::begin(SYNTAX_KEYS)) );
+                }
+            }
+            else if (key == "--runs")
+            {
+                _options.runs = std::max(1, std::atoi(value.c_str()));
+            }
+            else if (key == "--threads")
+            {
+                _options.threads = static_cast<unsigned int>( std::max(0, std::atoi(value.c_str())) );
+            }
+            else if (key == "--dir")
+            {
+                _options.dir = value;
+            }
+            else if (key == "--output")
+            {
+                _options.output = value;
+            }
+            else if (key == "--keep")
+            {
+                _options.keepFiles = true;
+            }
+            else if (key == "--trace")
+            {
+                _options.trace = value;
+            }
+            else
+            {
+                std::cerr << "usage: " << argv[0] << " [--faces=1K,10K,100K,1M] [--syntax=v,vt,vn,vtn] [--runs=3] [--threads=0]"
+                          << " [--dir=<temp dir>] [--output=<file.json>] [--keep] [--trace=<file.json>]" << std::endl;
+                return false;
+            }
+        }
+
+        if (_options.faces.empty() || _options.syntaxes.empty())
+        {
+            std::cerr << "[ERROR] Nothing to run" << std::endl;
+            return false;
+        }
+        if (_options.threads == 0)
+            _options.threads = std::max(1u, std::thread::hardware_concurrency());
+        if (_options.dir.empty())
+        {
+            std::error_code ec;
+            _options.dir = std::filesystem::temp_directory_path(ec).string();
+        }
+        return true;
+    }
+
+
+    /*------------------------------------------------------------------------------------------------------------+
+    |                                                 OUTPUT                                                      |
+    +-------------------------------------------------------------------------------------------------------------*/
+
+    void writeStageJSON(std::ostream &_out, const StageResult &_stage)
+    {
+        const double seconds = std::max(_stage.seconds, 1e-9);
+        _out << "        { \"name\": \"" << _stage.name << "\""
+             << ", \"seconds\": " << _stage.seconds
+             << ", \"mb_per_s\": " << _stage.bytes / (1024.0 * 1024.0) / seconds
+             << ", \"faces_per_s\": " << _stage.faces / seconds
+             << ", \"peak_rss_mb\": " << _stage.peakRSS << " }";
+    }
+
+} // anonymous namespace
+
+
+int main(int argc, char *argv[])
+{
+    BenchOptions options;
+    options.faces = { 1000, 10000, 100000, 1000000 };
+    options.syntaxes = { SYNTAX_V, SYNTAX_VT, SYNTAX_VN, SYNTAX_VTN };
+    if (!parseOptions(argc, argv, options))
+        return 1;
+    QGL_TRACE_THREAD_NAME("bench");
+
+    std::ofstream outputFile;
+    if (!options.output.empty())
+    {
+        outputFile.open(options.output.c_str());
+        if (!outputFile.is_open())
+        {
+            std::cerr << "[ERROR] Could not open " << options.output << std::endl;
+            return 1;
+        }
+    }
+
+    // messages printed by TriMesh go to stderr, stdout only receives the JSON results
+    std::ostream standardOutput(std::cout.rdbuf());
+    std::cout.rdbuf(std::cerr.rdbuf());
+    std::ostream &out = options.output.empty() ? standardOutput : outputFile;
+    out.precision(6);
+
+    out << "{\n"
+        << "  \"benchmark\": \"qgltoolkit_bench\",\n"
+        << "  \"runs\": " << options.runs << ",\n"
+        << "  \"threads\": " << options.threads << ",\n"
+        << "  \"cases\": [\n";
+
+    bool firstCase = true;
+    for (size_t f = 0; f < options.faces.size(); f++)
+    {
+        for (size_t s = 0; s < options.syntaxes.size(); s++)
+        {
+            const size_t nbFaces = options.faces[f];
+            const FaceSyntax syntax = options.syntaxes[s];
+            const std::string filename = (std::filesystem::path(options.dir) /
+                                          ("qgltoolkit_bench_" + std::to_string(nbFaces) + "_" + SYNTAX_KEYS[syntax] + ".obj")).string();
+
+            std::cerr << "[INFO] " << nbFaces << " faces, " << SYNTAX_NAMES[syntax] << std::endl;
+            const size_t fileSize = writeGridOBJ(filename, nbFaces, syntax);
+            if (fileSize == 0)
+            {
+                std::cerr << "[ERROR] Could not write " << filename << std::endl;
+                return 1;
+            }
+
+            std::vector<StageResult> stages;
+
+            // 1. Read the file in memory
+            std::vector<char> buffer;
+            stages.push_back( runStage("read", options.runs, fileSize, nbFaces,
+                                       [&]() { buffer = std::vector<char>(); },
+                                       [&]() { readOBJFile(filename, buffer); }) );
+
+            // 2. Tokenize the records
+            ObjChunk obj;
+            stages.push_back( runStage("tokenize", options.runs, fileSize, nbFaces,
+                                       [&]() { obj = ObjChunk(); obj.reserve(buffer.size()); },
+                                       [&]() { parseOBJChunk(buffer.data(), buffer.data() + buffer.size(), obj); }) );
+            buffer = std::vector<char>();
+            obj = ObjChunk();
+
+            // 3. Whole import (read, tokenize, index, and normals if not provided), serial and parallel
+            std::unique_ptr<BenchMesh> mesh;
+            stages.push_back( runStage("importOBJ", options.runs, fileSize, nbFaces,
+                                       [&]() { mesh.reset(); mesh.reset(new BenchMesh()); },
+                                       [&]() { mesh->importOBJ(filename); }) );
+
+            stages.push_back( runStage("importOBJParallel", options.runs, fileSize, nbFaces,
+                                       [&]() { mesh.reset(); mesh.reset(new BenchMesh()); },
+                                       [&]() { mesh->importOBJParallel(filename, options.threads); }) );
+
+            // 4. Geometry processing on the imported mesh (throughput is measured on the arrays read)
+            const size_t numVertices = mesh->numVertices();
+            const size_t numFaces = mesh->numFaces();
+            stages.push_back( runStage("computeNormals", options.runs, numVertices * sizeof(glm::vec3) + numFaces * 3 * sizeof(uint32_t), numFaces,
+                                       []() {},
+                                       [&]() { mesh->computeNormals(NORMALS_UNIFORM); }) );
+
+            stages.push_back( runStage("computeNormalsArea", options.runs, numVertices * sizeof(glm::vec3) + numFaces * 3 * sizeof(uint32_t), numFaces,
+                                       []() {},
+                                       [&]() { mesh->computeNormals(NORMALS_AREA); }) );
+
+            stages.push_back( runStage("computeNormalsAngle", options.runs, numVertices * sizeof(glm::vec3) + numFaces * 3 * sizeof(uint32_t), numFaces,
+                                       []() {},
+                                       [&]() { mesh->computeNormals(NORMALS_ANGLE); }) );
+
+            stages.push_back( runStage("computeAABB", options.runs, numVertices * sizeof(glm::vec3), numFaces,
+                                       []() {},
+                                       [&]() { mesh->computeAABB(); }) );
+
+            stages.push_back( runStage("computeBoundingSphere", options.runs, numVertices * sizeof(glm::vec3), numFaces,
+                                       []() {},
+                                       [&]() { mesh->computeBoundingSphere(); }) );
+
+            // 5. Index reordering (the mesh is imported again before each run, untimed)
+            const VertexCacheStats before = mesh->analyzeVertexCache();
+            stages.push_back( runStage("optimizeIndexOrder", options.runs, numFaces * 3 * sizeof(uint32_t), numFaces,
+                                       [&]() { mesh.reset(); mesh.reset(new BenchMesh()); mesh->importOBJ(filename); },
+                                       [&]() { mesh->optimizeIndexOrder(); }) );
+            const VertexCacheStats after = mesh->analyzeVertexCache();
+            const size_t numMeshlets = mesh->meshlets().size();
+
+            // 6. Levels of detail of the optimized mesh
+            stages.push_back( runStage("generateLODs", options.runs, numVertices * sizeof(glm::vec3) + numFaces * 3 * sizeof(uint32_t), numFaces,
+                                       []() {},
+                                       [&]() { mesh->generateLODs(); }) );
+            const std::vector<LevelOfDetail> lods = mesh->levelsOfDetail();
+
+            // 7. Bounding volume hierarchy for ray queries
+            stages.push_back( runStage("computeBVH", options.runs, numVertices * sizeof(glm::vec3) + numFaces * 3 * sizeof(uint32_t), numFaces,
+                                       []() {},
+                                       [&]() { mesh->computeBVH(); }) );
+            const size_t numBvhNodes = mesh->bvh().nodes().size();
+
+            // 8. Lasso selection of the vertices, the whole mesh seen by a 1920 x 1080 camera
+            stages.push_back( runStage("computeVertexClusters", options.runs, numVertices * sizeof(glm::vec3), numFaces,
+                                       []() {},
+                                       [&]() { mesh->computeVertexClusters(); }) );
+
+            // (the mesh was imported again by the optimizeIndexOrder stage)
+            mesh->computeAABB();
+            mesh->computeBoundingSphere();
+            const glm::vec3 center = mesh->getBSphereCenter();
+            const float radius = mesh->getBSphereRadius();
+            const glm::vec2 screenSize(1920.0f, 1080.0f);
+            const glm::mat4 viewProjection = glm::perspective(0.8f, screenSize.x / screenSize.y, 0.5f * radius, 4.0f * radius)
+                                           * glm::lookAt(center + glm::vec3(0.0f, 0.0f, 2.5f * radius), center, glm::vec3(0.0f, 1.0f, 0.0f));
+            qgltoolkit::SelectionRegion lasso;
+            for (int k = 0; k < 64; k++)
+            {
+                const float angle = 6.2831853f * k / 64.0f;
+                const glm::vec2 point(0.5f * screenSize.x * (1.0f + 0.6f * std::cos(angle)), 0.5f * screenSize.y * (1.0f + 0.6f * std::sin(angle)));
+                if (k == 0)
+                    lasso.start(qgltoolkit::SelectionRegion::LASSO, point);
+                else
+                    lasso.extend(point);
+            }
+            std::vector<uint64_t> selection;
+            stages.push_back( runStage("selectVertices", options.runs, numVertices * sizeof(glm::vec3), numFaces,
+                                       []() {},
+                                       [&]() { selectVertices(mesh->vertexData(), mesh->numVertexData(), mesh->vertexClusters().data(),
+                                                              lasso, viewProjection, screenSize, selection, ThreadPool::global()); }) );
+            const size_t numSelected = countSelected(selection);
+            mesh.reset();
+
+            if (!options.keepFiles)
+                std::remove(filename.c_str());
+
+            out << (firstCase ? "" : ",\n")
+                << "    {\n"
+                << "      \"faces\": " << nbFaces << ",\n"
+                << "      \"syntax\": \"" << SYNTAX_NAMES[syntax] << "\",\n"
+                << "      \"file_bytes\": " << fileSize << ",\n"
+                << "      \"vertices\": " << numVertices << ",\n"
+                << "      \"acmr\": [" << before.acmr << ", " << after.acmr << "],\n"
+                << "      \"atvr\": [" << before.atvr << ", " << after.atvr << "],\n"
+                << "      \"meshlets\": " << numMeshlets << ",\n"
+                << "      \"bvh_nodes\": " << numBvhNodes << ",\n"
+                << "      \"selected_vertices\": " << numSelected << ",\n"
+                << "      \"lods\": [";
+            for (size_t i = 0; i < lods.size(); i++)
+                out << (i > 0 ? ", " : "") << "[" << lods[i].count / 3 << ", " << lods[i].error << "]";
+            out << "],\n"
+                << "      \"stages\": [\n";
+            for (size_t i = 0; i < stages.size(); i++)
+            {
+                writeStageJSON(out, stages[i]);
+                out << (i + 1 < stages.size() ? ",\n" : "\n");
+            }
+            out << "      ]\n"
+                << "    }";
+            firstCase = false;
+        }
+    }
+
+    out << "\n  ]\n"
+        << "}" << std::endl;
+
+    if (!options.trace.empty() && !writeChromeTrace(options.trace))
+        return 1;
+
+    return 0;
+}
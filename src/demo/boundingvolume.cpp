@@ -0,0 +1,326 @@
+/*********************************************************************************************************************
+ *
+ * boundingvolume.cpp
+ *
+ * Bounding box and bounding sphere of point sets
+ *
+ * QGL_toolkit demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+
+#include "boundingvolume.h"
+#include "threadpool.h"
+#include "simd.h"
+
+
+namespace
+{
+    // Number of points processed by a task
+    const size_t BLOCK_SIZE = 1 << 16;
+
+    // Max number of growth steps of the bounding sphere (each one reads all the points)
+    const unsigned int MAX_GROWTH_STEPS = 32;
+
+
+#if defined(QGL_USE_AVX)
+    typedef __m256 SimdFloat;
+    const size_t SIMD_WIDTH = 8;
+    inline SimdFloat simdLoad(const float *_p) { return _mm256_loadu_ps(_p); }
+    inline void simdStore(float *_p, SimdFloat _a) { _mm256_storeu_ps(_p, _a); }
+    inline SimdFloat simdSet1(float _value) { return _mm256_set1_ps(_value); }
+    inline SimdFloat simdMin(SimdFloat _a, SimdFloat _b) { return _mm256_min_ps(_a, _b); }
+    inline SimdFloat simdMax(SimdFloat _a, SimdFloat _b) { return _mm256_max_ps(_a, _b); }
+#elif defined(QGL_USE_SSE2)
+    typedef __m128 SimdFloat;
+    const size_t SIMD_WIDTH = 4;
+    inline SimdFloat simdLoad(const float *_p) { return _mm_loadu_ps(_p); }
+    inline void simdStore(float *_p, SimdFloat _a) { _mm_storeu_ps(_p, _a); }
+    inline SimdFloat simdSet1(float _value) { return _mm_set1_ps(_value); }
+    inline SimdFloat simdMin(SimdFloat _a, SimdFloat _b) { return _mm_min_ps(_a, _b); }
+    inline SimdFloat simdMax(SimdFloat _a, SimdFloat _b) { return _mm_max_ps(_a, _b); }
+#endif
+
+
+    /*!
+    * \struct PointBlock
+    * \brief Range of points processed by a task
+    */
+    struct PointBlock
+    {
+        const char *data;
+        size_t count;
+        size_t stride;
+    };
+
+    // Split arrays of points into blocks of at most BLOCK_SIZE points
+    std::vector<PointBlock> splitArrays(const std::vector<PointArray> &_arrays)
+    {
+        std::vector<PointBlock> blocks;
+        for (size_t a = 0; a < _arrays.size(); a++)
+        {
+            for (size_t first = 0; first < _arrays[a].count; first += BLOCK_SIZE)
+            {
+                PointBlock block;
+                block.data = _arrays[a].data + first * _arrays[a].stride;
+                block.count = std::min(BLOCK_SIZE, _arrays[a].count - first);
+                block.stride = _arrays[a].stride;
+                blocks.push_back(block);
+            }
+        }
+        return blocks;
+    }
+
+    inline glm::vec3 loadPoint(const char *_p)
+    {
+        float coords[3];
+        std::memcpy(coords, _p, sizeof(coords));
+        return glm::vec3(coords[0], coords[1], coords[2]);
+    }
+
+
+    /*!
+    * \fn blockBoundingBox
+    * \brief Bounding box of a block of points (NaN coordinates are ignored)
+    */
+    void blockBoundingBox(const PointBlock &_block, glm::vec3 &_min, glm::vec3 &_max)
+    {
+        const float inf = std::numeric_limits<float>::infinity();
+        _min = glm::vec3(inf);
+        _max = glm::vec3(-inf);
+
+        size_t i = 0;
+#if defined(QGL_USE_AVX) || defined(QGL_USE_SSE2)
+        if (_block.stride == 3 * sizeof(float))
+        {
+            // SIMD_WIDTH points fill 3 registers: lane j of register k always holds coordinate (SIMD_WIDTH * k + j) % 3,
+            // so the packed coordinates are reduced without being shuffled.
+            // New values are the first operand of min/max, which return the second one if a value is NaN.
+            const float *coords = reinterpret_cast<const float*>(_block.data);
+            SimdFloat minValues[3] = { simdSet1(inf), simdSet1(inf), simdSet1(inf) };
+            SimdFloat maxValues[3] = { simdSet1(-inf), simdSet1(-inf), simdSet1(-inf) };
+            for (; i + SIMD_WIDTH <= _block.count; i += SIMD_WIDTH)
+            {
+                for (unsigned int k = 0; k < 3; k++)
+                {
+                    const SimdFloat values = simdLoad(coords + 3 * i + SIMD_WIDTH * k);
+                    minValues[k] = simdMin(values, minValues[k]);
+                    maxValues[k] = simdMax(values, maxValues[k]);
+                }
+            }
+
+            float lanes[SIMD_WIDTH];
+            for (unsigned int k = 0; k < 3; k++)
+            {
+                simdStore(lanes, minValues[k]);
+                for (unsigned int j = 0; j < SIMD_WIDTH; j++)
+                    _min[(SIMD_WIDTH * k + j) % 3] = std::min(_min[(SIMD_WIDTH * k + j) % 3], lanes[j]);
+                simdStore(lanes, maxValues[k]);
+                for (unsigned int j = 0; j < SIMD_WIDTH; j++)
+                    _max[(SIMD_WIDTH * k + j) % 3] = std::max(_max[(SIMD_WIDTH * k + j) % 3], lanes[j]);
+            }
+        }
+#endif
+        for (; i < _block.count; i++)
+        {
+            const glm::vec3 p = loadPoint(_block.data + i * _block.stride);
+            for (unsigned int c = 0; c < 3; c++)
+            {
+                if (p[c] < _min[c]) { _min[c] = p[c]; }
+                if (p[c] > _max[c]) { _max[c] = p[c]; }
+            }
+        }
+    }
+
+
+    /*!
+    * \fn blockFarthestPoint
+    * \brief Point of a block farthest from _center (the first one if several are at the same distance)
+    * \return squared distance to _center, -1 if the block has no valid point
+    */
+    float blockFarthestPoint(const PointBlock &_block, const glm::vec3 &_center, glm::vec3 &_point)
+    {
+        float bestDistance2 = -1.0f;
+        size_t bestIndex = 0;
+
+        size_t i = 0;
+#ifdef QGL_USE_SSE2
+        if (_block.stride == 3 * sizeof(float))
+        {
+            const float *coords = reinterpret_cast<const float*>(_block.data);
+            const __m128 cx = _mm_set1_ps(_center.x);
+            const __m128 cy = _mm_set1_ps(_center.y);
+            const __m128 cz = _mm_set1_ps(_center.z);
+            __m128 laneDistances2 = _mm_set1_ps(-1.0f);
+            __m128i laneIndices = _mm_setzero_si128();
+            __m128i indices = _mm_setr_epi32(0, 1, 2, 3);
+            const __m128i four = _mm_set1_epi32(4);
+
+            for (; i + 4 <= _block.count; i += 4)
+            {
+                // transpose 4 packed points (x0 y0 z0 x1 | y1 z1 x2 y2 | z2 x3 y3 z3) into x, y and z registers
+                const __m128 a = _mm_loadu_ps(coords + 3 * i);
+                const __m128 b = _mm_loadu_ps(coords + 3 * i + 4);
+                const __m128 c = _mm_loadu_ps(coords + 3 * i + 8);
+                const __m128 x2y2x3y3 = _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 1, 3, 2));
+                const __m128 y0z0y1z1 = _mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 0, 2, 1));
+                const __m128 x = _mm_shuffle_ps(a, x2y2x3y3, _MM_SHUFFLE(2, 0, 3, 0));
+                const __m128 y = _mm_shuffle_ps(y0z0y1z1, x2y2x3y3, _MM_SHUFFLE(3, 1, 2, 0));
+                const __m128 z = _mm_shuffle_ps(y0z0y1z1, c, _MM_SHUFFLE(3, 0, 3, 1));
+
+                const __m128 dx = _mm_sub_ps(x, cx);
+                const __m128 dy = _mm_sub_ps(y, cy);
+                const __m128 dz = _mm_sub_ps(z, cz);
+                const __m128 distances2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+
+                // strictly farther (false for NaN): keep the first point of each lane in case of equality
+                const __m128 farther = _mm_cmpgt_ps(distances2, laneDistances2);
+                laneDistances2 = _mm_or_ps(_mm_and_ps(farther, distances2), _mm_andnot_ps(farther, laneDistances2));
+                const __m128i fartherMask = _mm_castps_si128(farther);
+                laneIndices = _mm_or_si128(_mm_and_si128(fartherMask, indices), _mm_andnot_si128(fartherMask, laneIndices));
+                indices = _mm_add_epi32(indices, four);
+            }
+
+            alignas(16) float distances[4];
+            alignas(16) int32_t lanes[4];
+            _mm_store_ps(distances, laneDistances2);
+            _mm_store_si128(reinterpret_cast<__m128i*>(lanes), laneIndices);
+            for (unsigned int j = 0; j < 4; j++)
+            {
+                const size_t index = static_cast<size_t>(lanes[j]);
+                if (distances[j] > bestDistance2 || (distances[j] == bestDistance2 && index < bestIndex))
+                {
+                    bestDistance2 = distances[j];
+                    bestIndex = index;
+                }
+            }
+        }
+#endif
+        for (; i < _block.count; i++)
+        {
+            const glm::vec3 d = loadPoint(_block.data + i * _block.stride) - _center;
+            const float distance2 = d.x * d.x + d.y * d.y + d.z * d.z;
+            if (distance2 > bestDistance2)
+            {
+                bestDistance2 = distance2;
+                bestIndex = i;
+            }
+        }
+
+        if (bestDistance2 >= 0.0f)
+            _point = loadPoint(_block.data + bestIndex * _block.stride);
+        return bestDistance2;
+    }
+
+    /*!
+    * \fn farthestPoint
+    * \brief Point farthest from _center (same result whatever the number of threads)
+    * \return distance to _center
+    */
+    float farthestPoint(const std::vector<PointBlock> &_blocks, const glm::vec3 &_center, glm::vec3 &_point, ThreadPool &_pool)
+    {
+        std::vector<float> distances2(_blocks.size());
+        std::vector<glm::vec3> points(_blocks.size(), _center);
+        _pool.run(_blocks.size(), [&](size_t b)
+        {
+            distances2[b] = blockFarthestPoint(_blocks[b], _center, points[b]);
+        });
+
+        float bestDistance2 = 0.0f;
+        _point = _center;
+        for (size_t b = 0; b < _blocks.size(); b++)
+        {
+            if (distances2[b] > bestDistance2)
+            {
+                bestDistance2 = distances2[b];
+                _point = points[b];
+            }
+        }
+        return std::sqrt(bestDistance2);
+    }
+
+} // anonymous namespace
+
+
+bool computeBoundingBox(const std::vector<PointArray> &_arrays, glm::vec3 &_min, glm::vec3 &_max, ThreadPool &_pool)
+{
+    const std::vector<PointBlock> blocks = splitArrays(_arrays);
+
+    std::vector<glm::vec3> blockMin(blocks.size());
+    std::vector<glm::vec3> blockMax(blocks.size());
+    _pool.run(blocks.size(), [&](size_t b)
+    {
+        blockBoundingBox(blocks[b], blockMin[b], blockMax[b]);
+    });
+
+    const float inf = std::numeric_limits<float>::infinity();
+    _min = glm::vec3(inf);
+    _max = glm::vec3(-inf);
+    for (size_t b = 0; b < blocks.size(); b++)
+    {
+        _min = glm::min(_min, blockMin[b]);
+        _max = glm::max(_max, blockMax[b]);
+    }
+
+    // no point (or only NaN coordinates)
+    if (!(_min.x <= _max.x && _min.y <= _max.y && _min.z <= _max.z))
+    {
+        _min = _max = glm::vec3(0.0f);
+        return false;
+    }
+    return true;
+}
+
+
+bool computeBoundingSphere(const std::vector<PointArray> &_arrays, const glm::vec3 &_bBoxMin, const glm::vec3 &_bBoxMax,
+                           glm::vec3 &_center, float &_radius, ThreadPool &_pool)
+{
+    const std::vector<PointBlock> blocks = splitArrays(_arrays);
+    if (blocks.empty())
+    {
+        _center = glm::vec3(0.0f);
+        _radius = 0.0f;
+        return false;
+    }
+
+    // 1. smallest sphere centered on the bounding box
+    glm::vec3 p, q;
+    _center = 0.5f * (_bBoxMin + _bBoxMax);
+    _radius = farthestPoint(blocks, _center, p, _pool);
+
+    // 2. Ritter's initial sphere: p is far from the center, q is the point farthest from p
+    farthestPoint(blocks, p, q, _pool);
+    glm::vec3 center = 0.5f * (p + q);
+    float radius = 0.5f * glm::length(q - p);
+
+    // 3. grow the sphere towards the farthest point, until it contains all the points.
+    // The last search gives the exact radius around the final center.
+    for (unsigned int i = 0; ; i++)
+    {
+        glm::vec3 farthest;
+        const float distance = farthestPoint(blocks, center, farthest, _pool);
+        if (distance <= radius || i == MAX_GROWTH_STEPS)
+        {
+            radius = distance;
+            break;
+        }
+
+        const float newRadius = 0.5f * (radius + distance);
+        center += (farthest - center) * ((newRadius - radius) / distance);
+        radius = newRadius;
+    }
+
+    if (radius < _radius)
+    {
+        _center = center;
+        _radius = radius;
+    }
+    return true;
+}
@@ -0,0 +1,65 @@
+/*********************************************************************************************************************
+ *
+ * boundingvolume.h
+ *
+ * Bounding box and bounding sphere of point sets
+ *
+ * QGL_toolkit demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#ifndef BOUNDINGVOLUME_H
+#define BOUNDINGVOLUME_H
+
+#include <vector>
+#include <cstddef>
+
+
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+
+
+class ThreadPool;
+
+
+/*!
+* \struct PointArray
+* \brief Array of 3D points (3 consecutive floats per point), possibly interleaved with other data
+*/
+struct PointArray
+{
+    const char *data;           /*!< address of the first point */
+    size_t count;               /*!< number of points */
+    size_t stride;              /*!< distance between two consecutive points (in bytes), 12 if tightly packed */
+};
+
+
+/*!
+* \fn computeBoundingBox
+* \brief Compute the axis aligned bounding box of a set of points, in parallel
+* (SIMD min/max reductions on tightly packed arrays). NaN coordinates are ignored.
+* \param _arrays : arrays of points
+* \param _min, _max : output corners of the box
+* \param _pool : threads used for the computation
+* \return false if there is no point
+*/
+bool computeBoundingBox(const std::vector<PointArray> &_arrays, glm::vec3 &_min, glm::vec3 &_max, ThreadPool &_pool);
+
+/*!
+* \fn computeBoundingSphere
+* \brief Compute a tight bounding sphere of a set of points (Ritter's algorithm).
+* The initial sphere has the points farthest from each other as diameter,
+* then it grows towards the point farthest from its center until all points are inside.
+* Each step is a parallel (SIMD) search of the farthest point, so the points are read a few times only.
+* The result is never larger than the sphere centered on the bounding box.
+* \param _arrays : arrays of points
+* \param _bBoxMin, _bBoxMax : bounding box of the points
+* \param _center, _radius : output sphere
+* \param _pool : threads used for the computation
+* \return false if there is no point
+*/
+bool computeBoundingSphere(const std::vector<PointArray> &_arrays, const glm::vec3 &_bBoxMin, const glm::vec3 &_bBoxMax,
+                           glm::vec3 &_center, float &_radius, ThreadPool &_pool);
+
+#endif // BOUNDINGVOLUME_H
@@ -0,0 +1,924 @@
+/*********************************************************************************************************************
+ *
+ * bvh.cpp
+ *
+ * Bounding volume hierarchy of the triangles of a mesh, and ray queries
+ *
+ * QGL_toolkit demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+
+#include "bvh.h"
+#include "threadpool.h"
+#include "simd.h"
+#include "trace.h"
+
+
+namespace
+{
+    // Number of triangles processed by a task
+    const size_t BLOCK_SIZE = 1 << 16;
+
+    // Max number of bins of the centroids along each axis (small nodes have fewer bins, see Binning)
+    const unsigned int BIN_COUNT = 16;
+
+    // Max number of triangles of a leaf
+    const size_t MAX_LEAF_SIZE = 8;
+
+    // Cost of visiting a node, relative to the intersection of a triangle
+    const float TRAVERSAL_COST = 1.0f;
+
+    // Nodes with at most this number of triangles are built by a single task
+    const size_t SUBTREE_SIZE = 1 << 14;
+
+    // Depth from which nodes are split in halves, which bounds the depth of the tree (see STACK_SIZE)
+    const unsigned int MAX_SAH_DEPTH = 32;
+
+    // Size of the traversal stacks (the tree is at most MAX_SAH_DEPTH + 32 levels deep)
+    const size_t STACK_SIZE = 64;
+
+
+#if defined(QGL_USE_AVX)
+    typedef __m256 SimdFloat;
+    const size_t SIMD_WIDTH = 8;
+    inline SimdFloat simdLoad(const float *_p) { return _mm256_loadu_ps(_p); }
+    inline void simdStore(float *_p, SimdFloat _a) { _mm256_storeu_ps(_p, _a); }
+    inline SimdFloat simdSet1(float _value) { return _mm256_set1_ps(_value); }
+    inline SimdFloat simdSet1(uint32_t _value) { return _mm256_castsi256_ps(_mm256_set1_epi32(static_cast<int>(_value))); }
+    inline SimdFloat simdAdd(SimdFloat _a, SimdFloat _b) { return _mm256_add_ps(_a, _b); }
+    inline SimdFloat simdSub(SimdFloat _a, SimdFloat _b) { return _mm256_sub_ps(_a, _b); }
+    inline SimdFloat simdMul(SimdFloat _a, SimdFloat _b) { return _mm256_mul_ps(_a, _b); }
+    inline SimdFloat simdDiv(SimdFloat _a, SimdFloat _b) { return _mm256_div_ps(_a, _b); }
+    inline SimdFloat simdMin(SimdFloat _a, SimdFloat _b) { return _mm256_min_ps(_a, _b); }
+    inline SimdFloat simdMax(SimdFloat _a, SimdFloat _b) { return _mm256_max_ps(_a, _b); }
+    inline SimdFloat simdLess(SimdFloat _a, SimdFloat _b) { return _mm256_cmp_ps(_a, _b, _CMP_LT_OQ); }
+    inline SimdFloat simdLessEqual(SimdFloat _a, SimdFloat _b) { return _mm256_cmp_ps(_a, _b, _CMP_LE_OQ); }
+    inline SimdFloat simdAnd(SimdFloat _a, SimdFloat _b) { return _mm256_and_ps(_a, _b); }
+    inline SimdFloat simdOr(SimdFloat _a, SimdFloat _b) { return _mm256_or_ps(_a, _b); }
+    inline SimdFloat simdSelect(SimdFloat _mask, SimdFloat _a, SimdFloat _b) { return _mm256_blendv_ps(_b, _a, _mask); }
+    inline int simdMoveMask(SimdFloat _a) { return _mm256_movemask_ps(_a); }
+#elif defined(QGL_USE_SSE2)
+    typedef __m128 SimdFloat;
+    const size_t SIMD_WIDTH = 4;
+    inline SimdFloat simdLoad(const float *_p) { return _mm_loadu_ps(_p); }
+    inline void simdStore(float *_p, SimdFloat _a) { _mm_storeu_ps(_p, _a); }
+    inline SimdFloat simdSet1(float _value) { return _mm_set1_ps(_value); }
+    inline SimdFloat simdSet1(uint32_t _value) { return _mm_castsi128_ps(_mm_set1_epi32(static_cast<int>(_value))); }
+    inline SimdFloat simdAdd(SimdFloat _a, SimdFloat _b) { return _mm_add_ps(_a, _b); }
+    inline SimdFloat simdSub(SimdFloat _a, SimdFloat _b) { return _mm_sub_ps(_a, _b); }
+    inline SimdFloat simdMul(SimdFloat _a, SimdFloat _b) { return _mm_mul_ps(_a, _b); }
+    inline SimdFloat simdDiv(SimdFloat _a, SimdFloat _b) { return _mm_div_ps(_a, _b); }
+    inline SimdFloat simdMin(SimdFloat _a, SimdFloat _b) { return _mm_min_ps(_a, _b); }
+    inline SimdFloat simdMax(SimdFloat _a, SimdFloat _b) { return _mm_max_ps(_a, _b); }
+    inline SimdFloat simdLess(SimdFloat _a, SimdFloat _b) { return _mm_cmplt_ps(_a, _b); }
+    inline SimdFloat simdLessEqual(SimdFloat _a, SimdFloat _b) { return _mm_cmple_ps(_a, _b); }
+    inline SimdFloat simdAnd(SimdFloat _a, SimdFloat _b) { return _mm_and_ps(_a, _b); }
+    inline SimdFloat simdOr(SimdFloat _a, SimdFloat _b) { return _mm_or_ps(_a, _b); }
+    inline SimdFloat simdSelect(SimdFloat _mask, SimdFloat _a, SimdFloat _b) { return _mm_or_ps(_mm_and_ps(_mask, _a), _mm_andnot_ps(_mask, _b)); }
+    inline int simdMoveMask(SimdFloat _a) { return _mm_movemask_ps(_a); }
+#else
+    const size_t SIMD_WIDTH = 1;
+#endif
+
+
+    /*------------------------------------------------------------------------------------------------------------+
+    |                                               CONSTRUCTION                                                  |
+    +-------------------------------------------------------------------------------------------------------------*/
+
+    /*!
+    * \struct Bounds
+    * \brief Axis aligned box, empty by default
+    */
+    struct Bounds
+    {
+        glm::vec3 min;
+        glm::vec3 max;
+
+        Bounds() : min(std::numeric_limits<float>::infinity()), max(-std::numeric_limits<float>::infinity()) {}
+
+        void grow(const glm::vec3 &_point) { min = glm::min(min, _point); max = glm::max(max, _point); }
+        void grow(const glm::vec3 &_min, const glm::vec3 &_max) { min = glm::min(min, _min); max = glm::max(max, _max); }
+        void grow(const Bounds &_bounds) { grow(_bounds.min, _bounds.max); }
+
+        // half of the surface area (0 if the box is empty)
+        float halfArea() const
+        {
+            const glm::vec3 size = max - min;
+            return (size.x < 0.0f) ? 0.0f : size.x * size.y + size.y * size.z + size.z * size.x;
+        }
+    };
+
+    /*!
+    * \struct PrimRef
+    * \brief Bounding box of a triangle, moved around by the construction
+    */
+    struct PrimRef
+    {
+        glm::vec3 bMin;
+        uint32_t id;
+        glm::vec3 bMax;
+
+        glm::vec3 centroid() const { return 0.5f * (bMin + bMax); }
+    };
+
+    /*!
+    * \struct Binning
+    * \brief Mapping of the centroids of a node to the bins of each axis
+    */
+    struct Binning
+    {
+        glm::vec3 origin;       // min corner of the centroids
+        glm::vec3 scale;        // number of bins per unit, 0 if the centroids are flat along the axis
+        unsigned int count;     // number of bins along each axis
+
+        Binning(const Bounds &_centroids, size_t _nbTriangles)
+        : origin(_centroids.min), scale(0.0f), count( static_cast<unsigned int>(std::min<size_t>(BIN_COUNT, 4 + _nbTriangles / 4)) )
+        {
+            for (unsigned int a = 0; a < 3; a++)
+            {
+                const float extent = _centroids.max[a] - _centroids.min[a];
+                const float binsPerUnit = count * (1.0f - 1e-5f) / extent;
+                if (extent > 0.0f && std::isfinite(binsPerUnit))
+                    scale[a] = binsPerUnit;
+            }
+        }
+
+        unsigned int bin(const glm::vec3 &_centroid, unsigned int _axis) const
+        {
+            const int b = static_cast<int>( (_centroid[_axis] - origin[_axis]) * scale[_axis] );
+            return static_cast<unsigned int>( std::min(std::max(b, 0), static_cast<int>(count) - 1) );
+        }
+    };
+
+    /*!
+    * \struct Bins
+    * \brief Bounds and number of the triangles of each bin, along the 3 axes
+    */
+    struct Bins
+    {
+        Bounds bounds[3][BIN_COUNT];
+        uint32_t counts[3][BIN_COUNT];
+
+        Bins() { std::memset(counts, 0, sizeof(counts)); }
+
+        void add(const PrimRef *_refs, size_t _begin, size_t _end, const Binning &_binning)
+        {
+            for (size_t i = _begin; i < _end; i++)
+            {
+                const glm::vec3 centroid = _refs[i].centroid();
+                for (unsigned int a = 0; a < 3; a++)
+                {
+                    const unsigned int b = _binning.bin(centroid, a);
+                    bounds[a][b].grow(_refs[i].bMin, _refs[i].bMax);
+                    counts[a][b]++;
+                }
+            }
+        }
+
+        void merge(const Bins &_bins)
+        {
+            for (unsigned int a = 0; a < 3; a++)
+            {
+                for (unsigned int b = 0; b < BIN_COUNT; b++)
+                {
+                    bounds[a][b].grow(_bins.bounds[a][b]);
+                    counts[a][b] += _bins.counts[a][b];
+                }
+            }
+        }
+    };
+
+    /*!
+    * \struct Split
+    * \brief Split of a node: leaf, halves, or triangles whose centroid is in the bins [0, bin) of axis go left
+    */
+    struct Split
+    {
+        enum Kind { LEAF, HALVES, BINS };
+        Kind kind;
+        unsigned int axis;
+        unsigned int bin;
+
+        bool goesLeft(const PrimRef &_ref, const Binning &_binning) const { return _binning.bin(_ref.centroid(), axis) < bin; }
+    };
+
+
+    // Bounding box of the triangles of a range, and of their centroids
+    void rangeBounds(const PrimRef *_refs, size_t _begin, size_t _end, Bounds &_bounds, Bounds &_centroids)
+    {
+        for (size_t i = _begin; i < _end; i++)
+        {
+            _bounds.grow(_refs[i].bMin, _refs[i].bMax);
+            _centroids.grow(_refs[i].centroid());
+        }
+    }
+
+    /*!
+    * \fn chooseSplit
+    * \brief Cheapest split of a node according to the surface area heuristic (or a leaf if it is cheaper)
+    */
+    Split chooseSplit(const Bins &_bins, const Binning &_binning, const Bounds &_bounds, size_t _count, unsigned int _depth)
+    {
+        Split split;
+        split.kind = Split::LEAF;
+        split.axis = 0;
+        split.bin = 0;
+        if (_count <= 1)
+            return split;
+
+        if (_depth >= MAX_SAH_DEPTH)
+        {
+            split.kind = (_count <= MAX_LEAF_SIZE) ? Split::LEAF : Split::HALVES;
+            return split;
+        }
+
+        float bestCost = std::numeric_limits<float>::infinity();
+        for (unsigned int a = 0; a < 3; a++)
+        {
+            if (_binning.scale[a] == 0.0f)
+                continue;
+
+            // cost of the right side of each split position, then sweep from the left
+            float rightCosts[BIN_COUNT];
+            Bounds right;
+            uint32_t rightCount = 0;
+            for (unsigned int b = _binning.count - 1; b > 0; b--)
+            {
+                right.grow(_bins.bounds[a][b]);
+                rightCount += _bins.counts[a][b];
+                rightCosts[b] = (rightCount > 0) ? right.halfArea() * rightCount : -1.0f;
+            }
+
+            Bounds left;
+            uint32_t leftCount = 0;
+            for (unsigned int b = 1; b < _binning.count; b++)
+            {
+                left.grow(_bins.bounds[a][b - 1]);
+                leftCount += _bins.counts[a][b - 1];
+                if (leftCount == 0 || rightCosts[b] < 0.0f)
+                    continue;
+
+                const float cost = left.halfArea() * leftCount + rightCosts[b];
+                if (cost < bestCost)
+                {
+                    bestCost = cost;
+                    split.kind = Split::BINS;
+                    split.axis = a;
+                    split.bin = b;
+                }
+            }
+        }
+
+        // all centroids in the same bin
+        if (split.kind == Split::LEAF)
+        {
+            split.kind = (_count <= MAX_LEAF_SIZE) ? Split::LEAF : Split::HALVES;
+            return split;
+        }
+
+        const float area = _bounds.halfArea();
+        if (_count <= MAX_LEAF_SIZE && area > 0.0f && static_cast<float>(_count) <= TRAVERSAL_COST + bestCost / area)
+            split.kind = Split::LEAF;
+
+        return split;
+    }
+
+
+    /*!
+    * \fn buildSubtree
+    * \brief Build the subtree of a range of triangles serially. _nodes[0] receives its root,
+    * and child indices are relative to _nodes.
+    */
+    void buildSubtree(PrimRef *_refs, size_t _begin, size_t _end, unsigned int _depth, std::vector<BvhNode> &_nodes)
+    {
+        struct Task
+        {
+            uint32_t node;
+            size_t begin;
+            size_t end;
+            unsigned int depth;
+        };
+
+        _nodes.resize(1);
+        std::vector<Task> stack;
+        stack.push_back( Task{ 0, _begin, _end, _depth } );
+        while (!stack.empty())
+        {
+            const Task task = stack.back();
+            stack.pop_back();
+
+            Bounds bounds, centroids;
+            rangeBounds(_refs, task.begin, task.end, bounds, centroids);
+            _nodes[task.node].bBoxMin = bounds.min;
+            _nodes[task.node].bBoxMax = bounds.max;
+
+            const Binning binning(centroids, task.end - task.begin);
+            Bins bins;
+            bins.add(_refs, task.begin, task.end, binning);
+            const Split split = chooseSplit(bins, binning, bounds, task.end - task.begin, task.depth);
+
+            if (split.kind == Split::LEAF)
+            {
+                _nodes[task.node].first = static_cast<uint32_t>(task.begin);
+                _nodes[task.node].count = static_cast<uint32_t>(task.end - task.begin);
+                continue;
+            }
+
+            size_t middle = (task.begin + task.end) / 2;
+            if (split.kind == Split::BINS)
+            {
+                middle = std::partition(_refs + task.begin, _refs + task.end,
+                                        [&](const PrimRef &_ref) { return split.goesLeft(_ref, binning); }) - _refs;
+            }
+
+            const uint32_t child = static_cast<uint32_t>(_nodes.size());
+            _nodes.resize(_nodes.size() + 2);
+            _nodes[task.node].first = child;
+            _nodes[task.node].count = 0;
+
+            // left child on top of the stack: subtrees are stored depth first
+            stack.push_back( Task{ child + 1, middle, task.end, task.depth + 1 } );
+            stack.push_back( Task{ child, task.begin, middle, task.depth + 1 } );
+        }
+    }
+
+
+    /*------------------------------------------------------------------------------------------------------------+
+    |                                                  QUERIES                                                    |
+    +-------------------------------------------------------------------------------------------------------------*/
+
+    // Inverse of a direction coordinate, finite even if the coordinate is 0
+    inline float safeInverse(float _d)
+    {
+        const float epsilon = 1e-20f;
+        return 1.0f / ( (std::abs(_d) > epsilon) ? _d : std::copysign(epsilon, _d) );
+    }
+
+    // Slab test of a ray against the box of a node, _tNear receives the entry point
+    inline bool intersectBox(const BvhNode &_node, const glm::vec3 &_origin, const glm::vec3 &_invDirection,
+                             float _tMin, float _tMax, float &_tNear)
+    {
+        const glm::vec3 t0 = (_node.bBoxMin - _origin) * _invDirection;
+        const glm::vec3 t1 = (_node.bBoxMax - _origin) * _invDirection;
+        _tNear = std::max( std::max(std::min(t0.x, t1.x), std::min(t0.y, t1.y)), std::max(std::min(t0.z, t1.z), _tMin) );
+        const float tFar = std::min( std::min(std::max(t0.x, t1.x), std::max(t0.y, t1.y)), std::min(std::max(t0.z, t1.z), _tMax) );
+        return _tNear <= tFar;
+    }
+
+    // Intersection of a ray with a triangle in (_tMin, _tMax) (Moller and Trumbore), double sided
+    inline bool intersectTriangle(const BvhTriangle &_triangle, const Ray &_ray, float _tMin, float _tMax,
+                                  float &_t, float &_u, float &_v)
+    {
+        const glm::vec3 p = glm::cross(_ray.direction, _triangle.e2);
+        const float det = glm::dot(_triangle.e1, p);
+        if (det == 0.0f)
+            return false;
+
+        const float invDet = 1.0f / det;
+        const glm::vec3 s = _ray.origin - _triangle.v0;
+        const float u = glm::dot(s, p) * invDet;
+        if (!(u >= 0.0f && u <= 1.0f))
+            return false;
+
+        const glm::vec3 q = glm::cross(s, _triangle.e1);
+        const float v = glm::dot(_ray.direction, q) * invDet;
+        if (!(v >= 0.0f && u + v <= 1.0f))
+            return false;
+
+        const float t = glm::dot(_triangle.e2, q) * invDet;
+        if (!(t > _tMin && t < _tMax))
+            return false;
+
+        _t = t;
+        _u = u;
+        _v = v;
+        return true;
+    }
+
+} // anonymous namespace
+
+
+/*------------------------------------------------------------------------------------------------------------+
+|                                                CONSTRUCTION                                                 |
++-------------------------------------------------------------------------------------------------------------*/
+
+void Bvh::build(const uint32_t *_indices, size_t _nbIndices, const glm::vec3 *_vertices, size_t _nbVertices, ThreadPool &_pool)
+{
+    QGL_TRACE_SCOPE("Bvh::build");
+    clear();
+
+    const size_t nbTriangles = _nbIndices / 3;
+    const size_t nbBlocks = (nbTriangles + BLOCK_SIZE - 1) / BLOCK_SIZE;
+
+    // 1. boxes of the valid triangles (finite coordinates and indices in range), in the order of the mesh
+    std::vector<size_t> blockOffsets(nbBlocks + 1, 0);
+    _pool.run(nbBlocks, [&](size_t _block)
+    {
+        const size_t end = std::min(nbTriangles, (_block + 1) * BLOCK_SIZE);
+        size_t count = 0;
+        for (size_t f = _block * BLOCK_SIZE; f < end; f++)
+        {
+            bool valid = true;
+            for (unsigned int k = 0; k < 3 && valid; k++)
+            {
+                const uint32_t v = _indices[3 * f + k];
+                valid = v < _nbVertices && std::isfinite(_vertices[v].x) && std::isfinite(_vertices[v].y) && std::isfinite(_vertices[v].z);
+            }
+            count += valid ? 1 : 0;
+        }
+        blockOffsets[_block + 1] = count;
+    });
+    for (size_t b = 0; b < nbBlocks; b++)
+        blockOffsets[b + 1] += blockOffsets[b];
+
+    const size_t nbRefs = blockOffsets[nbBlocks];
+    if (nbRefs == 0)
+        return;
+
+    std::vector<PrimRef> refs(nbRefs);
+    _pool.run(nbBlocks, [&](size_t _block)
+    {
+        const size_t end = std::min(nbTriangles, (_block + 1) * BLOCK_SIZE);
+        size_t r = blockOffsets[_block];
+        for (size_t f = _block * BLOCK_SIZE; f < end && r < blockOffsets[_block + 1]; f++)
+        {
+            bool valid = true;
+            for (unsigned int k = 0; k < 3 && valid; k++)
+            {
+                const uint32_t v = _indices[3 * f + k];
+                valid = v < _nbVertices && std::isfinite(_vertices[v].x) && std::isfinite(_vertices[v].y) && std::isfinite(_vertices[v].z);
+            }
+            if (!valid)
+                continue;
+
+            const glm::vec3 &p0 = _vertices[_indices[3 * f]];
+            const glm::vec3 &p1 = _vertices[_indices[3 * f + 1]];
+            const glm::vec3 &p2 = _vertices[_indices[3 * f + 2]];
+            refs[r].bMin = glm::min(p0, glm::min(p1, p2));
+            refs[r].bMax = glm::max(p0, glm::max(p1, p2));
+            refs[r].id = static_cast<uint32_t>(f);
+            r++;
+        }
+    });
+
+    // 2. top levels: all the nodes of a level are split at once, each one by several tasks
+    struct Task
+    {
+        uint32_t node;
+        size_t begin;
+        size_t end;
+        unsigned int depth;
+    };
+    struct Chunk
+    {
+        size_t task;
+        size_t begin;
+        size_t end;
+    };
+
+    m_nodes.resize(1);
+    std::vector<Task> level, subtrees;
+    if (nbRefs > SUBTREE_SIZE)
+        level.push_back( Task{ 0, 0, nbRefs, 0 } );
+    else
+        subtrees.push_back( Task{ 0, 0, nbRefs, 0 } );
+
+    std::vector<PrimRef> partitioned;
+    if (!level.empty())
+        partitioned.resize(nbRefs);
+
+    while (!level.empty())
+    {
+        std::vector<Chunk> chunks;
+        std::vector<size_t> firstChunks(level.size() + 1);
+        for (size_t t = 0; t < level.size(); t++)
+        {
+            firstChunks[t] = chunks.size();
+            for (size_t begin = level[t].begin; begin < level[t].end; begin += BLOCK_SIZE)
+                chunks.push_back( Chunk{ t, begin, std::min(level[t].end, begin + BLOCK_SIZE) } );
+        }
+        firstChunks[level.size()] = chunks.size();
+
+        // bounds of the triangles and of their centroids
+        std::vector<Bounds> chunkBounds(chunks.size()), chunkCentroids(chunks.size());
+        _pool.run(chunks.size(), [&](size_t _c)
+        {
+            rangeBounds(refs.data(), chunks[_c].begin, chunks[_c].end, chunkBounds[_c], chunkCentroids[_c]);
+        });
+
+        std::vector<Bounds> bounds(level.size());
+        std::vector<Binning> binnings;
+        for (size_t t = 0; t < level.size(); t++)
+        {
+            Bounds centroids;
+            for (size_t c = firstChunks[t]; c < firstChunks[t + 1]; c++)
+            {
+                bounds[t].grow(chunkBounds[c]);
+                centroids.grow(chunkCentroids[c]);
+            }
+            binnings.push_back( Binning(centroids, level[t].end - level[t].begin) );
+
+            m_nodes[level[t].node].bBoxMin = bounds[t].min;
+            m_nodes[level[t].node].bBoxMax = bounds[t].max;
+        }
+
+        // bins
+        std::vector<Bins> chunkBins(chunks.size());
+        _pool.run(chunks.size(), [&](size_t _c)
+        {
+            chunkBins[_c].add(refs.data(), chunks[_c].begin, chunks[_c].end, binnings[chunks[_c].task]);
+        });
+
+        std::vector<Split> splits(level.size());
+        for (size_t t = 0; t < level.size(); t++)
+        {
+            Bins bins;
+            for (size_t c = firstChunks[t]; c < firstChunks[t + 1]; c++)
+                bins.merge(chunkBins[c]);
+            splits[t] = chooseSplit(bins, binnings[t], bounds[t], level[t].end - level[t].begin, level[t].depth);
+        }
+
+        // stable partition: left triangles of each chunk, then offsets of the chunks in the left and right sides
+        std::vector<size_t> leftCounts(chunks.size(), 0);
+        _pool.run(chunks.size(), [&](size_t _c)
+        {
+            const Chunk &chunk = chunks[_c];
+            const Split &split = splits[chunk.task];
+            if (split.kind != Split::BINS)
+                return;
+            for (size_t i = chunk.begin; i < chunk.end; i++)
+                leftCounts[_c] += split.goesLeft(refs[i], binnings[chunk.task]) ? 1 : 0;
+        });
+
+        std::vector<size_t> middles(level.size());
+        std::vector<size_t> leftOffsets(chunks.size()), rightOffsets(chunks.size());
+        for (size_t t = 0; t < level.size(); t++)
+        {
+            if (splits[t].kind != Split::BINS)
+            {
+                middles[t] = (level[t].begin + level[t].end) / 2;
+                continue;
+            }
+
+            size_t left = level[t].begin;
+            for (size_t c = firstChunks[t]; c < firstChunks[t + 1]; c++)
+            {
+                leftOffsets[c] = left;
+                left += leftCounts[c];
+            }
+            middles[t] = left;
+
+            size_t right = left;
+            for (size_t c = firstChunks[t]; c < firstChunks[t + 1]; c++)
+            {
+                rightOffsets[c] = right;
+                right += (chunks[c].end - chunks[c].begin) - leftCounts[c];
+            }
+        }
+
+        _pool.run(chunks.size(), [&](size_t _c)
+        {
+            const Chunk &chunk = chunks[_c];
+            const Split &split = splits[chunk.task];
+            if (split.kind != Split::BINS)
+                return;
+            size_t left = leftOffsets[_c];
+            size_t right = rightOffsets[_c];
+            for (size_t i = chunk.begin; i < chunk.end; i++)
+            {
+                if (split.goesLeft(refs[i], binnings[chunk.task]))
+                    partitioned[left++] = refs[i];
+                else
+                    partitioned[right++] = refs[i];
+            }
+        });
+        _pool.run(chunks.size(), [&](size_t _c)
+        {
+            if (splits[chunks[_c].task].kind == Split::BINS)
+                std::copy(partitioned.begin() + chunks[_c].begin, partitioned.begin() + chunks[_c].end, refs.begin() + chunks[_c].begin);
+        });
+
+        // children: large ones are split by the next level, small ones become subtrees
+        std::vector<Task> nextLevel;
+        for (size_t t = 0; t < level.size(); t++)
+        {
+            const uint32_t child = static_cast<uint32_t>(m_nodes.size());
+            m_nodes.resize(m_nodes.size() + 2);
+            m_nodes[level[t].node].first = child;
+            m_nodes[level[t].node].count = 0;
+
+            const Task children[2] = { Task{ child, level[t].begin, middles[t], level[t].depth + 1 },
+                                       Task{ child + 1, middles[t], level[t].end, level[t].depth + 1 } };
+            for (unsigned int k = 0; k < 2; k++)
+            {
+                if (children[k].end - children[k].begin > SUBTREE_SIZE)
+                    nextLevel.push_back(children[k]);
+                else
+                    subtrees.push_back(children[k]);
+            }
+        }
+        level.swap(nextLevel);
+    }
+    partitioned = std::vector<PrimRef>();
+
+    // 3. subtrees in parallel, then appended to the node array
+    std::vector< std::vector<BvhNode> > subtreeNodes(subtrees.size());
+    _pool.run(subtrees.size(), [&](size_t _s)
+    {
+        buildSubtree(refs.data(), subtrees[_s].begin, subtrees[_s].end, subtrees[_s].depth, subtreeNodes[_s]);
+    });
+
+    size_t nbNodes = m_nodes.size();
+    for (size_t s = 0; s < subtrees.size(); s++)
+        nbNodes += subtreeNodes[s].size() - 1;
+    m_nodes.reserve(nbNodes);
+
+    for (size_t s = 0; s < subtrees.size(); s++)
+    {
+        // local node k > 0 goes to offset + k - 1
+        const uint32_t offset = static_cast<uint32_t>(m_nodes.size());
+        std::vector<BvhNode> &nodes = subtreeNodes[s];
+        for (size_t k = 0; k < nodes.size(); k++)
+        {
+            if (nodes[k].count == 0)
+                nodes[k].first += offset - 1;
+        }
+        m_nodes[subtrees[s].node] = nodes[0];
+        m_nodes.insert(m_nodes.end(), nodes.begin() + 1, nodes.end());
+        nodes = std::vector<BvhNode>();
+    }
+
+    // 4. triangles in the order of the leaves
+    m_triangles.resize(nbRefs);
+    _pool.run((nbRefs + BLOCK_SIZE - 1) / BLOCK_SIZE, [&](size_t _block)
+    {
+        const size_t end = std::min(nbRefs, (_block + 1) * BLOCK_SIZE);
+        for (size_t i = _block * BLOCK_SIZE; i < end; i++)
+        {
+            const uint32_t *triangle = _indices + 3 * static_cast<size_t>(refs[i].id);
+            BvhTriangle &dest = m_triangles[i];
+            dest.v0 = _vertices[triangle[0]];
+            dest.e1 = _vertices[triangle[1]] - dest.v0;
+            dest.e2 = _vertices[triangle[2]] - dest.v0;
+            dest.id = refs[i].id;
+        }
+    });
+}
+
+
+void Bvh::clear()
+{
+    m_nodes = std::vector<BvhNode>();
+    m_triangles = std::vector<BvhTriangle>();
+}
+
+
+/*------------------------------------------------------------------------------------------------------------+
+|                                                  QUERIES                                                    |
++-------------------------------------------------------------------------------------------------------------*/
+
+bool Bvh::intersect(const Ray &_ray, RayHit &_hit) const
+{
+    return traverse(_ray, _hit, false);
+}
+
+
+bool Bvh::occluded(const Ray &_ray) const
+{
+    RayHit hit;
+    return traverse(_ray, hit, true);
+}
+
+
+void Bvh::intersect(const Ray *_rays, size_t _count, RayHit *_hits) const
+{
+    for (size_t first = 0; first < _count; first += SIMD_WIDTH)
+        traversePacket(_rays + first, std::min(SIMD_WIDTH, _count - first), _hits + first, false);
+}
+
+
+void Bvh::occluded(const Ray *_rays, size_t _count, uint8_t *_occluded) const
+{
+    RayHit hits[SIMD_WIDTH];
+    for (size_t first = 0; first < _count; first += SIMD_WIDTH)
+    {
+        const size_t count = std::min(SIMD_WIDTH, _count - first);
+        traversePacket(_rays + first, count, hits, true);
+        for (size_t k = 0; k < count; k++)
+            _occluded[first + k] = (hits[k].triangle != NO_HIT) ? 1 : 0;
+    }
+}
+
+
+bool Bvh::traverse(const Ray &_ray, RayHit &_hit, bool _anyHit) const
+{
+    _hit.t = _ray.tMax;
+    _hit.u = 0.0f;
+    _hit.v = 0.0f;
+    _hit.triangle = NO_HIT;
+
+    const glm::vec3 invDirection(safeInverse(_ray.direction.x), safeInverse(_ray.direction.y), safeInverse(_ray.direction.z));
+
+    float tNear;
+    if (m_nodes.empty() || !intersectBox(m_nodes[0], _ray.origin, invDirection, _ray.tMin, _hit.t, tNear))
+        return false;
+
+    // nodes to visit, with their entry point (skipped if farther than the closest hit found since)
+    uint32_t stackNodes[STACK_SIZE];
+    float stackNears[STACK_SIZE];
+    size_t stackSize = 0;
+
+    uint32_t node = 0;
+    for (;;)
+    {
+        const BvhNode &current = m_nodes[node];
+        if (current.count > 0)
+        {
+            for (uint32_t i = current.first; i < current.first + current.count; i++)
+            {
+                if (intersectTriangle(m_triangles[i], _ray, _ray.tMin, _hit.t, _hit.t, _hit.u, _hit.v))
+                {
+                    _hit.triangle = m_triangles[i].id;
+                    if (_anyHit)
+                        return true;
+                }
+            }
+        }
+        else
+        {
+            // visit the nearest child first
+            float tNear0, tNear1;
+            const bool hit0 = intersectBox(m_nodes[current.first], _ray.origin, invDirection, _ray.tMin, _hit.t, tNear0);
+            const bool hit1 = intersectBox(m_nodes[current.first + 1], _ray.origin, invDirection, _ray.tMin, _hit.t, tNear1);
+            if (hit0 && hit1)
+            {
+                const bool firstIsNear = (tNear0 <= tNear1);
+                stackNodes[stackSize] = firstIsNear ? current.first + 1 : current.first;
+                stackNears[stackSize] = firstIsNear ? tNear1 : tNear0;
+                stackSize++;
+                node = firstIsNear ? current.first : current.first + 1;
+                continue;
+            }
+            if (hit0 || hit1)
+            {
+                node = hit0 ? current.first : current.first + 1;
+                continue;
+            }
+        }
+
+        // next node of the stack which may still be closer than the closest hit
+        do
+        {
+            if (stackSize == 0)
+                return _hit.triangle != NO_HIT;
+            stackSize--;
+        }
+        while (stackNears[stackSize] > _hit.t);
+        node = stackNodes[stackSize];
+    }
+}
+
+
+#if defined(QGL_USE_AVX) || defined(QGL_USE_SSE2)
+
+void Bvh::traversePacket(const Ray *_rays, size_t _count, RayHit *_hits, bool _anyHit) const
+{
+    // rays in SoA layout, unused lanes get an empty segment
+    float lanes[12][SIMD_WIDTH];
+    glm::vec3 meanDirection(0.0f);
+    for (size_t k = 0; k < SIMD_WIDTH; k++)
+    {
+        const Ray ray = (k < _count) ? _rays[k] : Ray{ glm::vec3(0.0f), 1.0f, glm::vec3(1.0f), 0.0f };
+        for (unsigned int c = 0; c < 3; c++)
+        {
+            lanes[c][k] = ray.origin[c];
+            lanes[3 + c][k] = ray.direction[c];
+            lanes[6 + c][k] = safeInverse(ray.direction[c]);
+        }
+        lanes[9][k] = ray.tMin;
+        lanes[10][k] = ray.tMax;
+        if (k < _count)
+            meanDirection += ray.direction;
+    }
+
+    const SimdFloat ox = simdLoad(lanes[0]), oy = simdLoad(lanes[1]), oz = simdLoad(lanes[2]);
+    const SimdFloat dx = simdLoad(lanes[3]), dy = simdLoad(lanes[4]), dz = simdLoad(lanes[5]);
+    const SimdFloat ix = simdLoad(lanes[6]), iy = simdLoad(lanes[7]), iz = simdLoad(lanes[8]);
+    const SimdFloat tMin = simdLoad(lanes[9]);
+    const SimdFloat zero = simdSet1(0.0f), one = simdSet1(1.0f);
+
+    // closest hits so far (for any hit queries, t becomes -infinity once a lane hits, which stops it)
+    SimdFloat t = simdLoad(lanes[10]);
+    SimdFloat u = zero, v = zero;
+    SimdFloat ids = simdSet1(NO_HIT);
+    const int allLanes = (1 << _count) - 1;
+    int hitLanes = 0;
+
+    uint32_t stack[STACK_SIZE];
+    size_t stackSize = 0;
+    if (!m_nodes.empty())
+        stack[stackSize++] = 0;
+
+    while (stackSize > 0)
+    {
+        const BvhNode &current = m_nodes[stack[--stackSize]];
+
+        // slab test of the lanes whose segment is not empty
+        const SimdFloat tx0 = simdMul(simdSub(simdSet1(current.bBoxMin.x), ox), ix);
+        const SimdFloat tx1 = simdMul(simdSub(simdSet1(current.bBoxMax.x), ox), ix);
+        const SimdFloat ty0 = simdMul(simdSub(simdSet1(current.bBoxMin.y), oy), iy);
+        const SimdFloat ty1 = simdMul(simdSub(simdSet1(current.bBoxMax.y), oy), iy);
+        const SimdFloat tz0 = simdMul(simdSub(simdSet1(current.bBoxMin.z), oz), iz);
+        const SimdFloat tz1 = simdMul(simdSub(simdSet1(current.bBoxMax.z), oz), iz);
+        const SimdFloat tNear = simdMax( simdMax(simdMin(tx0, tx1), simdMin(ty0, ty1)), simdMax(simdMin(tz0, tz1), tMin) );
+        const SimdFloat tFar = simdMin( simdMin(simdMax(tx0, tx1), simdMax(ty0, ty1)), simdMin(simdMax(tz0, tz1), t) );
+        if (simdMoveMask(simdLessEqual(tNear, tFar)) == 0)
+            continue;
+
+        if (current.count == 0)
+        {
+            // the child nearest along the mean direction of the packet is visited first
+            const glm::vec3 delta = (m_nodes[current.first + 1].bBoxMin + m_nodes[current.first + 1].bBoxMax)
+                                  - (m_nodes[current.first].bBoxMin + m_nodes[current.first].bBoxMax);
+            const bool firstIsNear = glm::dot(delta, meanDirection) >= 0.0f;
+            stack[stackSize++] = firstIsNear ? current.first + 1 : current.first;
+            stack[stackSize++] = firstIsNear ? current.first : current.first + 1;
+            continue;
+        }
+
+        for (uint32_t i = current.first; i < current.first + current.count; i++)
+        {
+            // Moller and Trumbore, one triangle against all the lanes
+            const BvhTriangle &triangle = m_triangles[i];
+            const SimdFloat e1x = simdSet1(triangle.e1.x), e1y = simdSet1(triangle.e1.y), e1z = simdSet1(triangle.e1.z);
+            const SimdFloat e2x = simdSet1(triangle.e2.x), e2y = simdSet1(triangle.e2.y), e2z = simdSet1(triangle.e2.z);
+
+            const SimdFloat px = simdSub(simdMul(dy, e2z), simdMul(dz, e2y));
+            const SimdFloat py = simdSub(simdMul(dz, e2x), simdMul(dx, e2z));
+            const SimdFloat pz = simdSub(simdMul(dx, e2y), simdMul(dy, e2x));
+            const SimdFloat invDet = simdDiv(one, simdAdd(simdAdd(simdMul(e1x, px), simdMul(e1y, py)), simdMul(e1z, pz)));
+
+            const SimdFloat sx = simdSub(ox, simdSet1(triangle.v0.x));
+            const SimdFloat sy = simdSub(oy, simdSet1(triangle.v0.y));
+            const SimdFloat sz = simdSub(oz, simdSet1(triangle.v0.z));
+            const SimdFloat hitU = simdMul(simdAdd(simdAdd(simdMul(sx, px), simdMul(sy, py)), simdMul(sz, pz)), invDet);
+
+            const SimdFloat qx = simdSub(simdMul(sy, e1z), simdMul(sz, e1y));
+            const SimdFloat qy = simdSub(simdMul(sz, e1x), simdMul(sx, e1z));
+            const SimdFloat qz = simdSub(simdMul(sx, e1y), simdMul(sy, e1x));
+            const SimdFloat hitV = simdMul(simdAdd(simdAdd(simdMul(dx, qx), simdMul(dy, qy)), simdMul(dz, qz)), invDet);
+            const SimdFloat hitT = simdMul(simdAdd(simdAdd(simdMul(e2x, qx), simdMul(e2y, qy)), simdMul(e2z, qz)), invDet);
+
+            // comparisons are false for the NaN of parallel rays (det = 0)
+            const SimdFloat hit = simdAnd( simdAnd(simdLessEqual(zero, hitU), simdLessEqual(zero, hitV)),
+                                           simdAnd( simdLessEqual(simdAdd(hitU, hitV), one),
+                                                    simdAnd(simdLess(tMin, hitT), simdLess(hitT, t)) ) );
+            const int hitMask = simdMoveMask(hit);
+            if (hitMask == 0)
+                continue;
+
+            t = simdSelect(hit, hitT, t);
+            u = simdSelect(hit, hitU, u);
+            v = simdSelect(hit, hitV, v);
+            ids = simdSelect(hit, simdSet1(triangle.id), ids);
+
+            if (_anyHit)
+            {
+                t = simdSelect(hit, simdSet1(-std::numeric_limits<float>::infinity()), t);
+                hitLanes |= hitMask;
+                if ((hitLanes & allLanes) == allLanes)
+                    stackSize = 0;
+            }
+        }
+    }
+
+    float lanesT[SIMD_WIDTH], lanesU[SIMD_WIDTH], lanesV[SIMD_WIDTH], lanesIds[SIMD_WIDTH];
+    simdStore(lanesT, t);
+    simdStore(lanesU, u);
+    simdStore(lanesV, v);
+    simdStore(lanesIds, ids);
+    for (size_t k = 0; k < _count; k++)
+    {
+        _hits[k].t = lanesT[k];
+        _hits[k].u = lanesU[k];
+        _hits[k].v = lanesV[k];
+        std::memcpy(&_hits[k].triangle, &lanesIds[k], sizeof(uint32_t));
+    }
+}
+
+#else
+
+void Bvh::traversePacket(const Ray *_rays, size_t _count, RayHit *_hits, bool _anyHit) const
+{
+    for (size_t k = 0; k < _count; k++)
+        traverse(_rays[k], _hits[k], _anyHit);
+}
+
+#endif
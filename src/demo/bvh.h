@@ -0,0 +1,200 @@
+/*********************************************************************************************************************
+ *
+ * bvh.h
+ *
+ * Bounding volume hierarchy of the triangles of a mesh, and ray queries
+ *
+ * QGL_toolkit demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#ifndef BVH_H
+#define BVH_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+
+
+class ThreadPool;
+
+
+// Triangle index of a ray which hits nothing
+const uint32_t NO_HIT = 0xffffffff;
+
+
+/*!
+* \struct BvhNode
+* \brief Node of a Bvh (32 bytes). The two children of an inner node are consecutive in the node array.
+*/
+struct BvhNode
+{
+    glm::vec3 bBoxMin;          /*!< min corner of the bounding box */
+    uint32_t first;             /*!< inner node: index of the first child, leaf: first triangle (in the leaf order) */
+    glm::vec3 bBoxMax;          /*!< max corner of the bounding box */
+    uint32_t count;             /*!< number of triangles of a leaf, 0 for an inner node */
+};
+
+/*!
+* \struct BvhTriangle
+* \brief Triangle of a Bvh, stored in the order of the leaves: first vertex and edges, ready for intersection
+*/
+struct BvhTriangle
+{
+    glm::vec3 v0;               /*!< first vertex */
+    glm::vec3 e1;               /*!< second vertex - first vertex */
+    glm::vec3 e2;               /*!< third vertex - first vertex */
+    uint32_t id;                /*!< index of the triangle in the index buffer (i.e. first index / 3) */
+};
+
+/*!
+* \struct Ray
+* \brief Ray segment origin + t * direction, for t in [tMin, tMax]. The direction does not need to be normalized.
+*/
+struct Ray
+{
+    glm::vec3 origin;           /*!< origin of the ray */
+    float tMin;                 /*!< start of the segment */
+    glm::vec3 direction;        /*!< direction of the ray */
+    float tMax;                 /*!< end of the segment */
+};
+
+/*!
+* \struct RayHit
+* \brief Closest intersection of a ray with the triangles.
+* The hit point is (1 - u - v) * p0 + u * p1 + v * p2, with p0, p1, p2 the vertices of the triangle.
+*/
+struct RayHit
+{
+    float t;                    /*!< parameter of the hit point along the ray (tMax of the ray if there is no hit) */
+    float u;                    /*!< barycentric coordinate of the second vertex */
+    float v;                    /*!< barycentric coordinate of the third vertex */
+    uint32_t triangle;          /*!< index of the triangle in the index buffer, NO_HIT if there is no hit */
+};
+
+
+/*!
+* \class Bvh
+* \brief Bounding volume hierarchy of the triangles of an indexed mesh, for ray queries (picking, occlusion, baking).
+* Nodes are split with the surface area heuristic, evaluated on bins of the triangle centroids.
+* Levels with large nodes are built with every node split in parallel, then the small subtrees are
+* built in parallel, one per task (the tree does not depend on the number of threads).
+* Nodes are stored depth first in a compact array, and triangles are copied in the order of the leaves.
+* Triangles are double sided, and triangles with non finite coordinates are ignored.
+*/
+class Bvh
+{
+    public:
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                        CONSTRUCTORS / DESTRUCTORS                                           |
+        +------------------------------------------------------------------------------------------------------------*/
+
+        /*!
+        * \fn Bvh
+        * \brief Default constructor of Bvh (empty hierarchy)
+        */
+        Bvh() {}
+
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                              GETTERS/SETTERS                                                |
+        +-------------------------------------------------------------------------------------------------------------*/
+
+        /*! \fn nodes \brief Nodes of the hierarchy, the root first (empty if there is no triangle) */
+        const std::vector<BvhNode> &nodes() const { return m_nodes; }
+
+        /*! \fn triangles \brief Triangles, in the order of the leaves */
+        const std::vector<BvhTriangle> &triangles() const { return m_triangles; }
+
+        /*! \fn empty */
+        bool empty() const { return m_nodes.empty(); }
+
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                                   MISC.                                                     |
+        +-------------------------------------------------------------------------------------------------------------*/
+
+        /*!
+        * \fn build
+        * \brief Build the hierarchy of the triangles of an indexed mesh
+        * \param _indices : vertex indices, 3 per triangle
+        * \param _nbIndices : number of indices (lower than 2^32)
+        * \param _vertices : vertex positions
+        * \param _nbVertices : number of vertices
+        * \param _pool : threads used for the construction
+        */
+        void build(const uint32_t *_indices, size_t _nbIndices, const glm::vec3 *_vertices, size_t _nbVertices, ThreadPool &_pool);
+
+        /*! \fn clear \brief Remove all the nodes and triangles */
+        void clear();
+
+        /*!
+        * \fn intersect
+        * \brief Find the closest intersection of a ray with the triangles
+        * \param _ray : ray
+        * \param _hit : output, closest hit
+        * \return true if the ray hits a triangle
+        */
+        bool intersect(const Ray &_ray, RayHit &_hit) const;
+
+        /*!
+        * \fn occluded
+        * \brief Returns true if a ray hits any triangle (stops at the first hit found)
+        */
+        bool occluded(const Ray &_ray) const;
+
+        /*!
+        * \fn intersect
+        * \brief Find the closest intersections of an array of rays.
+        * Rays are traversed by packets of 4 (SSE2) or 8 (AVX), which share the node visits:
+        * coherent rays (e.g. neighbor pixels) are faster than with single ray queries.
+        * \param _rays : rays
+        * \param _count : number of rays
+        * \param _hits : output, closest hit of each ray
+        */
+        void intersect(const Ray *_rays, size_t _count, RayHit *_hits) const;
+
+        /*!
+        * \fn occluded
+        * \brief Find which rays of an array hit any triangle (by packets, see intersect())
+        * \param _rays : rays
+        * \param _count : number of rays
+        * \param _occluded : output, 1 if the ray hits a triangle, 0 otherwise
+        */
+        void occluded(const Ray *_rays, size_t _count, uint8_t *_occluded) const;
+
+
+    protected:
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                                ATTRIBUTES                                                   |
+        +------------------------------------------------------------------------------------------------------------*/
+
+        std::vector<BvhNode> m_nodes;           /*!< nodes, the root first */
+        std::vector<BvhTriangle> m_triangles;   /*!< triangles, in the order of the leaves */
+
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                                    MISC.                                                    |
+        +-------------------------------------------------------------------------------------------------------------*/
+
+        /*!
+        * \fn traverse
+        * \brief Closest hit (or any hit if _anyHit is true) of a single ray
+        */
+        bool traverse(const Ray &_ray, RayHit &_hit, bool _anyHit) const;
+
+        /*!
+        * \fn traversePacket
+        * \brief Closest hits (or any hits) of up to one SIMD register of rays
+        */
+        void traversePacket(const Ray *_rays, size_t _count, RayHit *_hits, bool _anyHit) const;
+};
+
+#endif // BVH_H
@@ -0,0 +1,243 @@
+/*********************************************************************************************************************
+ *
+ * compressedfile.cpp
+ *
+ * Streaming reader for gzip and zstd compressed files
+ *
+ * QGL_toolkit demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#include <algorithm>
+#include <iostream>
+#include <cstring>
+#include <climits>
+
+#ifdef QGL_HAVE_ZLIB
+    #include <zlib.h>
+#endif
+#ifdef QGL_HAVE_ZSTD
+    #include <zstd.h>
+#endif
+
+
+#include "compressedfile.h"
+
+
+namespace
+{
+    /*!
+    * \fn endsWith
+    * \brief Returns true if _str ends with _suffix
+    */
+    bool endsWith(const std::string &_str, const std::string &_suffix)
+    {
+        return _str.size() >= _suffix.size()
+            && _str.compare(_str.size() - _suffix.size(), _suffix.size(), _suffix) == 0;
+    }
+
+    /*!
+    * \fn detectFormat
+    * \brief Detect the compression format from the magic number at the beginning of a file
+    */
+    CompressedFileReader::Format detectFormat(const std::string &_filename)
+    {
+        FILE *file = std::fopen(_filename.c_str(), "rb");
+        if (file == nullptr)
+            return CompressedFileReader::UNKNOWN;
+
+        unsigned char magic[4] = { 0, 0, 0, 0 };
+        size_t nbRead = std::fread(magic, 1, 4, file);
+        std::fclose(file);
+
+        if (nbRead >= 2 && magic[0] == 0x1f && magic[1] == 0x8b)
+            return CompressedFileReader::GZIP;
+        if (nbRead == 4 && magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f && magic[3] == 0xfd)
+            return CompressedFileReader::ZSTD;
+
+        return CompressedFileReader::UNKNOWN;
+    }
+
+} // namespace
+
+
+CompressedFileReader::CompressedFileReader()
+: m_format(UNKNOWN), m_error(false), m_gzFile(nullptr), m_file(nullptr), m_zstdStream(nullptr), m_inSize(0), m_inPos(0), m_frameComplete(true)
+{
+}
+
+
+CompressedFileReader::~CompressedFileReader()
+{
+    close();
+}
+
+
+bool CompressedFileReader::isCompressedFilename(const std::string &_filename)
+{
+    return endsWith(_filename, ".gz") || endsWith(_filename, ".zst");
+}
+
+
+std::string CompressedFileReader::stripCompressedExtension(const std::string &_filename)
+{
+    if (endsWith(_filename, ".gz"))
+        return _filename.substr(0, _filename.size() - 3);
+    if (endsWith(_filename, ".zst"))
+        return _filename.substr(0, _filename.size() - 4);
+    return _filename;
+}
+
+
+bool CompressedFileReader::open(const std::string &_filename)
+{
+    close();
+
+    Format format = detectFormat(_filename);
+
+    if (format == GZIP)
+    {
+#ifdef QGL_HAVE_ZLIB
+        gzFile file = gzopen(_filename.c_str(), "rb");
+        if (file == nullptr)
+            return false;
+        // larger internal buffer than the default 8 KB, to reduce the number of system calls
+        gzbuffer(file, 1 << 18);
+        m_gzFile = file;
+#else
+        std::cerr << "[ERROR] CompressedFileReader::open(): gzip support is not available (built without zlib)" << std::endl;
+        return false;
+#endif
+    }
+    else if (format == ZSTD)
+    {
+#ifdef QGL_HAVE_ZSTD
+        m_file = std::fopen(_filename.c_str(), "rb");
+        if (m_file == nullptr)
+            return false;
+        m_zstdStream = ZSTD_createDStream();
+        ZSTD_initDStream(static_cast<ZSTD_DStream*>(m_zstdStream));
+        m_inBuffer.resize(ZSTD_DStreamInSize());
+        m_inSize = 0;
+        m_inPos = 0;
+        m_frameComplete = true;
+#else
+        std::cerr << "[ERROR] CompressedFileReader::open(): zstd support is not available (built without libzstd)" << std::endl;
+        return false;
+#endif
+    }
+    else
+    {
+        std::cerr << "[ERROR] CompressedFileReader::open(): " << _filename << " is not a gzip or zstd file" << std::endl;
+        return false;
+    }
+
+    m_format = format;
+    m_error = false;
+    return true;
+}
+
+
+size_t CompressedFileReader::read(char *_dst, size_t _maxBytes)
+{
+    if (m_error || _maxBytes == 0)
+        return 0;
+
+#ifdef QGL_HAVE_ZLIB
+    if (m_format == GZIP)
+    {
+        // gzread() takes an unsigned int size
+        unsigned int maxBytes = static_cast<unsigned int>( std::min<size_t>(_maxBytes, INT_MAX) );
+        int nbRead = gzread(static_cast<gzFile>(m_gzFile), _dst, maxBytes);
+        if (nbRead < 0)
+        {
+            int errnum = 0;
+            std::cerr << "[ERROR] CompressedFileReader::read(): " << gzerror(static_cast<gzFile>(m_gzFile), &errnum) << std::endl;
+            m_error = true;
+            return 0;
+        }
+        if (nbRead == 0)
+        {
+            // end of a truncated file is reported as Z_BUF_ERROR
+            int errnum = Z_OK;
+            const char *message = gzerror(static_cast<gzFile>(m_gzFile), &errnum);
+            if (errnum != Z_OK)
+            {
+                std::cerr << "[ERROR] CompressedFileReader::read(): " << message << std::endl;
+                m_error = true;
+            }
+        }
+        return static_cast<size_t>(nbRead);
+    }
+#endif
+
+#ifdef QGL_HAVE_ZSTD
+    if (m_format == ZSTD)
+    {
+        ZSTD_DStream *stream = static_cast<ZSTD_DStream*>(m_zstdStream);
+        ZSTD_outBuffer output = { _dst, _maxBytes, 0 };
+
+        while (output.pos < output.size)
+        {
+            if (m_inPos == m_inSize)
+            {
+                m_inSize = std::fread(m_inBuffer.data(), 1, m_inBuffer.size(), m_file);
+                m_inPos = 0;
+                if (m_inSize == 0)
+                {
+                    if (!m_frameComplete)
+                    {
+                        std::cerr << "[ERROR] CompressedFileReader::read(): Truncated zstd file" << std::endl;
+                        m_error = true;
+                    }
+                    break;
+                }
+            }
+
+            ZSTD_inBuffer input = { m_inBuffer.data(), m_inSize, m_inPos };
+            size_t ret = ZSTD_decompressStream(stream, &output, &input);
+            m_inPos = input.pos;
+            if (ZSTD_isError(ret))
+            {
+                std::cerr << "[ERROR] CompressedFileReader::read(): " << ZSTD_getErrorName(ret) << std::endl;
+                m_error = true;
+                return 0;
+            }
+            // 0 is returned when a frame is fully decoded and flushed
+            m_frameComplete = (ret == 0);
+        }
+        return output.pos;
+    }
+#endif
+
+#if !defined(QGL_HAVE_ZLIB) && !defined(QGL_HAVE_ZSTD)
+    // (open() fails without decompression library)
+    (void)_dst;
+    (void)_maxBytes;
+#endif
+    return 0;
+}
+
+
+void CompressedFileReader::close()
+{
+#ifdef QGL_HAVE_ZLIB
+    if (m_gzFile != nullptr)
+        gzclose(static_cast<gzFile>(m_gzFile));
+#endif
+#ifdef QGL_HAVE_ZSTD
+    if (m_zstdStream != nullptr)
+        ZSTD_freeDStream(static_cast<ZSTD_DStream*>(m_zstdStream));
+#endif
+    if (m_file != nullptr)
+        std::fclose(m_file);
+
+    m_gzFile = nullptr;
+    m_zstdStream = nullptr;
+    m_file = nullptr;
+    m_inBuffer.clear();
+    m_inSize = 0;
+    m_inPos = 0;
+    m_format = UNKNOWN;
+}
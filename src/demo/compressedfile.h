@@ -0,0 +1,121 @@
+/*********************************************************************************************************************
+ *
+ * compressedfile.h
+ *
+ * Streaming reader for gzip and zstd compressed files
+ *
+ * QGL_toolkit demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#ifndef COMPRESSEDFILE_H
+#define COMPRESSEDFILE_H
+
+#include <string>
+#include <cstddef>
+#include <cstdio>
+#include <vector>
+
+
+/*!
+* \class CompressedFileReader
+* \brief Decompress a gzip (.gz) or zstd (.zst) file on the fly, block by block.
+* The compression format is detected from the first bytes of the file.
+* gzip support requires zlib (QGL_HAVE_ZLIB), zstd support requires libzstd (QGL_HAVE_ZSTD).
+*/
+class CompressedFileReader
+{
+    public:
+
+        // Compression formats
+        enum Format { UNKNOWN, GZIP, ZSTD };
+
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                        CONSTRUCTORS / DESTRUCTORS                                           |
+        +------------------------------------------------------------------------------------------------------------*/
+
+        /*!
+        * \fn CompressedFileReader
+        * \brief Default constructor of CompressedFileReader
+        */
+        CompressedFileReader();
+
+        /*!
+        * \fn ~CompressedFileReader
+        * \brief Destructor of CompressedFileReader, closes the file
+        */
+        ~CompressedFileReader();
+
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                                   MISC.                                                     |
+        +-------------------------------------------------------------------------------------------------------------*/
+
+        /*!
+        * \fn isCompressedFilename
+        * \brief Returns true if _filename has a .gz or .zst extension
+        */
+        static bool isCompressedFilename(const std::string &_filename);
+
+        /*!
+        * \fn stripCompressedExtension
+        * \brief Returns _filename without its .gz or .zst extension
+        */
+        static std::string stripCompressedExtension(const std::string &_filename);
+
+        /*!
+        * \fn open
+        * \brief Open a compressed file
+        * \param _filename : name of the file
+        * \return false if the file could not be opened, or if its format is not supported
+        */
+        bool open(const std::string &_filename);
+
+        /*!
+        * \fn read
+        * \brief Decompress the next bytes of the file
+        * \param _dst : output buffer
+        * \param _maxBytes : size of the output buffer
+        * \return number of bytes written in _dst, 0 at the end of the file or on error (see hasError())
+        */
+        size_t read(char *_dst, size_t _maxBytes);
+
+        /*!
+        * \fn close
+        * \brief Close the file
+        */
+        void close();
+
+        /*! \fn format */
+        Format format() const { return m_format; }
+
+        /*! \fn hasError */
+        bool hasError() const { return m_error; }
+
+
+    private:
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                                ATTRIBUTES                                                   |
+        +------------------------------------------------------------------------------------------------------------*/
+
+        Format m_format;                    /*!< compression format of the opened file */
+        bool m_error;                       /*!< true if a read or decompression error occurred */
+
+        void *m_gzFile;                     /*!< zlib file handle (GZIP) */
+
+        FILE *m_file;                       /*!< compressed file (ZSTD) */
+        void *m_zstdStream;                 /*!< zstd decompression context (ZSTD) */
+        std::vector<char> m_inBuffer;       /*!< compressed data read from the file (ZSTD) */
+        size_t m_inSize;                    /*!< number of bytes in m_inBuffer (ZSTD) */
+        size_t m_inPos;                     /*!< number of bytes of m_inBuffer already decompressed (ZSTD) */
+        bool m_frameComplete;               /*!< false while the current frame is not fully decoded (ZSTD) */
+
+        // Copy constructor and operator= are declared private and undefined
+        CompressedFileReader(const CompressedFileReader &);
+        CompressedFileReader &operator=(const CompressedFileReader &);
+};
+
+#endif // COMPRESSEDFILE_H
@@ -0,0 +1,124 @@
+/*********************************************************************************************************************
+ *
+ * glstatecache.h
+ *
+ * Shadow copy of the GL bindings used to draw meshes, to skip redundant state changes
+ *
+ * QGL_toolkit demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#ifndef GLSTATECACHE_H
+#define GLSTATECACHE_H
+
+#include <cstdint>
+
+
+#define QT_NO_OPENGL_ES_2
+#include <GL/glew.h>
+
+
+/*!
+* \class GLStateCache
+* \brief Remembers the program, VAO, uniform buffers and face culling last set through it,
+* and only calls GL when the requested state differs. The GL state must not be changed behind its back:
+* call invalidate() after code which does (e.g. at the start of a frame, after a QPainter or an upload).
+*/
+class GLStateCache
+{
+    public:
+
+        // Number of uniform buffer binding points which are tracked
+        static const GLuint MAX_UNIFORM_BINDINGS = 8;
+
+
+        /*!
+        * \fn GLStateCache
+        * \brief Constructor, the state is unknown until it is set
+        */
+        GLStateCache() : m_nbStateChanges(0) { invalidate(); }
+
+        /*!
+        * \fn invalidate
+        * \brief Forget the cached state: the next calls will set it again
+        */
+        void invalidate()
+        {
+            m_program = UNKNOWN;
+            m_vertexArray = UNKNOWN;
+            m_cullFace = -1;
+            for (GLuint i = 0; i < MAX_UNIFORM_BINDINGS; i++)
+                m_uniformBuffers[i] = UNKNOWN;
+        }
+
+        /*! \fn useProgram */
+        void useProgram(GLuint _program)
+        {
+            if (_program == m_program)
+                return;
+            glUseProgram(_program);
+            m_program = _program;
+            m_nbStateChanges++;
+        }
+
+        /*! \fn bindVertexArray */
+        void bindVertexArray(GLuint _vertexArray)
+        {
+            if (_vertexArray == m_vertexArray)
+                return;
+            glBindVertexArray(_vertexArray);
+            m_vertexArray = _vertexArray;
+            m_nbStateChanges++;
+        }
+
+        /*!
+        * \fn bindUniformBuffer
+        * \brief Bind a buffer to a uniform binding point (glBindBufferBase())
+        */
+        void bindUniformBuffer(GLuint _binding, GLuint _buffer)
+        {
+            if (_binding < MAX_UNIFORM_BINDINGS && _buffer == m_uniformBuffers[_binding])
+                return;
+            glBindBufferBase(GL_UNIFORM_BUFFER, _binding, _buffer);
+            if (_binding < MAX_UNIFORM_BINDINGS)
+                m_uniformBuffers[_binding] = _buffer;
+            m_nbStateChanges++;
+        }
+
+        /*! \fn setCullFace */
+        void setCullFace(bool _enabled)
+        {
+            if (int(_enabled) == m_cullFace)
+                return;
+            if (_enabled)
+                glEnable(GL_CULL_FACE);
+            else
+                glDisable(GL_CULL_FACE);
+            m_cullFace = int(_enabled);
+            m_nbStateChanges++;
+        }
+
+        /*!
+        * \fn numStateChanges
+        * \brief Returns the number of GL calls issued since the last resetStats() (skipped ones are not counted)
+        */
+        uint64_t numStateChanges() const { return m_nbStateChanges; }
+
+        /*! \fn resetStats */
+        void resetStats() { m_nbStateChanges = 0; }
+
+
+    private:
+
+        // Value of a binding which is not known (not a valid GL name)
+        static const GLuint UNKNOWN = 0xFFFFFFFFu;
+
+        GLuint m_program;                                   /*!< current program */
+        GLuint m_vertexArray;                               /*!< current VAO */
+        GLuint m_uniformBuffers[MAX_UNIFORM_BINDINGS];      /*!< buffer bound to each uniform binding point */
+        int m_cullFace;                                     /*!< 1 if GL_CULL_FACE is enabled, 0 if not, -1 if unknown */
+        uint64_t m_nbStateChanges;                          /*!< GL calls issued since the last resetStats() */
+};
+
+#endif // GLSTATECACHE_H
@@ -0,0 +1,822 @@
+/*********************************************************************************************************************
+ *
+ * gltfparser.cpp
+ *
+ * Reader for glTF 2.0 files (.gltf and binary .glb)
+ *
+ * QGL_toolkit demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#include <charconv>
+#include <cstring>
+#include <iostream>
+#include <utility>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+
+#include "gltfparser.h"
+#include "trace.h"
+
+
+namespace
+{
+    // GLB container: 12 bytes header, then chunks (length, type, data padded to 4 bytes)
+    const uint32_t GLB_MAGIC = 0x46546C67;          // "glTF"
+    const uint32_t GLB_CHUNK_JSON = 0x4E4F534A;     // "JSON"
+    const uint32_t GLB_CHUNK_BIN = 0x004E4942;      // "BIN\0"
+
+    const int GLTF_TRIANGLES = 4;
+
+    // Nesting limit of the JSON parser (glTF files are shallow)
+    const int JSON_MAX_DEPTH = 64;
+
+
+    /*!
+    * \struct JsonValue
+    * \brief Node of a parsed JSON document
+    */
+    struct JsonValue
+    {
+        enum Type { JSON_NULL, JSON_BOOL, JSON_NUMBER, JSON_STRING, JSON_ARRAY, JSON_OBJECT };
+
+        Type type = JSON_NULL;
+        bool boolean = false;
+        double number = 0.0;
+        std::string string;
+        std::vector<JsonValue> items;                               // array items
+        std::vector< std::pair<std::string, JsonValue> > members;   // object members
+
+        const JsonValue *get(const char *_key) const
+        {
+            for (size_t i = 0; i < members.size(); i++)
+                if (members[i].first == _key)
+                    return &members[i].second;
+            return nullptr;
+        }
+
+        double getNumber(const char *_key, double _default) const
+        {
+            const JsonValue *value = get(_key);
+            return (value != nullptr && value->type == JSON_NUMBER) ? value->number : _default;
+        }
+
+        // Read a byte offset, length, stride or count (0 if absent), return false if it is negative or not an integer
+        bool getSize(const char *_key, size_t &_value) const
+        {
+            const double number = getNumber(_key, 0.0);
+            if (!(number >= 0.0) || !(number < static_cast<double>(std::numeric_limits<size_t>::max())) || number != std::floor(number))
+                return false;
+            _value = static_cast<size_t>(number);
+            return true;
+        }
+
+        const JsonValue *at(const char *_key, double _index) const
+        {
+            const JsonValue *array = get(_key);
+            if (array == nullptr || array->type != JSON_ARRAY || _index < 0.0 || _index >= static_cast<double>(array->items.size()))
+                return nullptr;
+            return &array->items[static_cast<size_t>(_index)];
+        }
+    };
+
+
+    /*!
+    * \class JsonParser
+    * \brief Recursive descent JSON parser
+    */
+    class JsonParser
+    {
+        public:
+
+            JsonParser(const char *_begin, const char *_end) : m_p(_begin), m_end(_end) {}
+
+            bool parse(JsonValue &_value)
+            {
+                return parseValue(_value, 0) && (skipBlanks(), m_p == m_end);
+            }
+
+        private:
+
+            const char *m_p;
+            const char *m_end;
+
+            void skipBlanks()
+            {
+                while (m_p < m_end && (*m_p == ' ' || *m_p == '\t' || *m_p == '\n' || *m_p == '\r'))
+                    ++m_p;
+            }
+
+            bool match(const char *_literal)
+            {
+                size_t length = std::strlen(_literal);
+                if (static_cast<size_t>(m_end - m_p) < length || std::strncmp(m_p, _literal, length) != 0)
+                    return false;
+                m_p += length;
+                return true;
+            }
+
+            bool parseHex4(uint32_t &_code)
+            {
+                if (m_end - m_p < 4)
+                    return false;
+                std::from_chars_result res = std::from_chars(m_p, m_p + 4, _code, 16);
+                if (res.ptr != m_p + 4)
+                    return false;
+                m_p += 4;
+                return true;
+            }
+
+            static void appendUTF8(std::string &_str, uint32_t _code)
+            {
+                if (_code < 0x80)
+                {
+                    _str += static_cast<char>(_code);
+                }
+                else if (_code < 0x800)
+                {
+                    _str += static_cast<char>(0xC0 | (_code >> 6));
+                    _str += static_cast<char>(0x80 | (_code & 0x3F));
+                }
+                else if (_code < 0x10000)
+                {
+                    _str += static_cast<char>(0xE0 | (_code >> 12));
+                    _str += static_cast<char>(0x80 | ((_code >> 6) & 0x3F));
+                    _str += static_cast<char>(0x80 | (_code & 0x3F));
+                }
+                else
+                {
+                    _str += static_cast<char>(0xF0 | (_code >> 18));
+                    _str += static_cast<char>(0x80 | ((_code >> 12) & 0x3F));
+                    _str += static_cast<char>(0x80 | ((_code >> 6) & 0x3F));
+                    _str += static_cast<char>(0x80 | (_code & 0x3F));
+                }
+            }
+
+            bool parseString(std::string &_str)
+            {
+                // opening quote already checked
+                ++m_p;
+                while (m_p < m_end && *m_p != '"')
+                {
+                    if (*m_p != '\\')
+                    {
+                        _str += *m_p++;
+                        continue;
+                    }
+
+                    if (++m_p == m_end)
+                        return false;
+                    char c = *m_p++;
+                    switch (c)
+                    {
+                        case '"':  _str += '"';  break;
+                        case '\\': _str += '\\'; break;
+                        case '/':  _str += '/';  break;
+                        case 'b':  _str += '\b'; break;
+                        case 'f':  _str += '\f'; break;
+                        case 'n':  _str += '\n'; break;
+                        case 'r':  _str += '\r'; break;
+                        case 't':  _str += '\t'; break;
+                        case 'u':
+                        {
+                            uint32_t code = 0;
+                            if (!parseHex4(code))
+                                return false;
+                            // surrogate pair
+                            uint32_t low = 0;
+                            if (code >= 0xD800 && code < 0xDC00 && match("\\u") && parseHex4(low) && low >= 0xDC00 && low < 0xE000)
+                                code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                            appendUTF8(_str, code);
+                            break;
+                        }
+                        default:
+                            return false;
+                    }
+                }
+                if (m_p == m_end)
+                    return false;
+                ++m_p;
+                return true;
+            }
+
+            bool parseValue(JsonValue &_value, int _depth)
+            {
+                skipBlanks();
+                if (m_p == m_end || _depth > JSON_MAX_DEPTH)
+                    return false;
+
+                switch (*m_p)
+                {
+                    case '{':
+                    {
+                        _value.type = JsonValue::JSON_OBJECT;
+                        ++m_p;
+                        skipBlanks();
+                        if (m_p < m_end && *m_p == '}')
+                        {
+                            ++m_p;
+                            return true;
+                        }
+                        while (true)
+                        {
+                            skipBlanks();
+                            if (m_p == m_end || *m_p != '"')
+                                return false;
+                            _value.members.push_back( std::make_pair(std::string(), JsonValue()) );
+                            if (!parseString(_value.members.back().first))
+                                return false;
+                            skipBlanks();
+                            if (m_p == m_end || *m_p++ != ':')
+                                return false;
+                            if (!parseValue(_value.members.back().second, _depth + 1))
+                                return false;
+                            skipBlanks();
+                            if (m_p == m_end)
+                                return false;
+                            if (*m_p == '}')
+                            {
+                                ++m_p;
+                                return true;
+                            }
+                            if (*m_p++ != ',')
+                                return false;
+                        }
+                    }
+                    case '[':
+                    {
+                        _value.type = JsonValue::JSON_ARRAY;
+                        ++m_p;
+                        skipBlanks();
+                        if (m_p < m_end && *m_p == ']')
+                        {
+                            ++m_p;
+                            return true;
+                        }
+                        while (true)
+                        {
+                            _value.items.push_back( JsonValue() );
+                            if (!parseValue(_value.items.back(), _depth + 1))
+                                return false;
+                            skipBlanks();
+                            if (m_p == m_end)
+                                return false;
+                            if (*m_p == ']')
+                            {
+                                ++m_p;
+                                return true;
+                            }
+                            if (*m_p++ != ',')
+                                return false;
+                        }
+                    }
+                    case '"':
+                        _value.type = JsonValue::JSON_STRING;
+                        return parseString(_value.string);
+                    case 't':
+                        _value.type = JsonValue::JSON_BOOL;
+                        _value.boolean = true;
+                        return match("true");
+                    case 'f':
+                        _value.type = JsonValue::JSON_BOOL;
+                        return match("false");
+                    case 'n':
+                        return match("null");
+                    default:
+                    {
+                        _value.type = JsonValue::JSON_NUMBER;
+                        std::from_chars_result res = std::from_chars(m_p, m_end, _value.number);
+                        if (res.ec != std::errc())
+                            return false;
+                        m_p = res.ptr;
+                        return true;
+                    }
+                }
+            }
+    };
+
+
+    // Range of bytes of a buffer or buffer view
+    struct ByteRange
+    {
+        const char *data;
+        size_t size;
+        size_t stride;      // byteStride of a buffer view, 0 if elements are tightly packed
+    };
+
+    inline uint32_t loadUint32(const char *_p)
+    {
+        uint32_t value;
+        std::memcpy(&value, _p, 4);
+        return value;
+    }
+
+    bool decodeBase64(const char *_begin, const char *_end, std::vector<char> &_out)
+    {
+        _out.clear();
+        _out.reserve((_end - _begin) / 4 * 3);
+
+        uint32_t bits = 0;
+        int nbBits = 0;
+        for (const char *p = _begin; p < _end && *p != '='; ++p)
+        {
+            const char c = *p;
+            int value;
+            if (c >= 'A' && c <= 'Z')      value = c - 'A';
+            else if (c >= 'a' && c <= 'z') value = c - 'a' + 26;
+            else if (c >= '0' && c <= '9') value = c - '0' + 52;
+            else if (c == '+')             value = 62;
+            else if (c == '/')             value = 63;
+            else return false;
+
+            bits = (bits << 6) | static_cast<uint32_t>(value);
+            nbBits += 6;
+            if (nbBits >= 8)
+            {
+                nbBits -= 8;
+                _out.push_back( static_cast<char>((bits >> nbBits) & 0xFF) );
+            }
+        }
+        return true;
+    }
+
+    // Decode %XX escapes of a relative URI
+    std::string decodeURI(const std::string &_uri)
+    {
+        std::string path;
+        for (size_t i = 0; i < _uri.size(); i++)
+        {
+            unsigned int code = 0;
+            if (_uri[i] == '%' && i + 2 < _uri.size() &&
+                std::from_chars(_uri.data() + i + 1, _uri.data() + i + 3, code, 16).ptr == _uri.data() + i + 3)
+            {
+                path += static_cast<char>(code);
+                i += 2;
+            }
+            else
+            {
+                path += _uri[i];
+            }
+        }
+        return path;
+    }
+
+    int numComponentsOfType(const std::string &_type)
+    {
+        if (_type == "SCALAR") return 1;
+        if (_type == "VEC2")   return 2;
+        if (_type == "VEC3")   return 3;
+        if (_type == "VEC4")   return 4;
+        return 0;
+    }
+
+    /*!
+    * \fn resolveAccessor
+    * \brief Get the view on the data of accessor #_index, return false if it is invalid or unsupported
+    */
+    bool resolveAccessor(const JsonValue &_root, double _index, const std::vector<ByteRange> &_views, GltfAccessor &_accessor)
+    {
+        const JsonValue *accessor = _root.at("accessors", _index);
+        if (accessor == nullptr)
+            return false;
+
+        // sparse accessors and accessors without buffer view would have to be unpacked
+        const JsonValue *type = accessor->get("type");
+        const double view = accessor->getNumber("bufferView", -1.0);
+        if (accessor->get("sparse") != nullptr || view < 0.0 || view >= static_cast<double>(_views.size()) || type == nullptr)
+            return false;
+
+        const JsonValue *normalized = accessor->get("normalized");
+        _accessor.componentType = static_cast<int>( accessor->getNumber("componentType", 0.0) );
+        _accessor.numComponents = numComponentsOfType(type->string);
+        _accessor.normalized = (normalized != nullptr && normalized->boolean);
+
+        size_t offset = 0;
+        const size_t elementSize = _accessor.elementSize();
+        if (elementSize == 0 || !accessor->getSize("count", _accessor.count) || !accessor->getSize("byteOffset", offset))
+            return false;
+
+        // elements of a strided view must not overlap
+        const ByteRange &range = _views[static_cast<size_t>(view)];
+        if (range.stride != 0 && range.stride < elementSize)
+            return false;
+        _accessor.stride = (range.stride != 0) ? range.stride : elementSize;
+
+        // the last element must end inside the buffer view
+        if (_accessor.count > 0)
+        {
+            if (offset > range.size || range.size - offset < elementSize)
+                return false;
+            if ((range.size - offset - elementSize) / _accessor.stride < _accessor.count - 1)
+                return false;
+        }
+
+        _accessor.data = range.data + offset;
+        return true;
+    }
+
+    GltfAccessor emptyAccessor()
+    {
+        GltfAccessor accessor;
+        accessor.data = nullptr;
+        accessor.count = 0;
+        accessor.stride = 0;
+        accessor.componentType = 0;
+        accessor.numComponents = 0;
+        accessor.normalized = false;
+        return accessor;
+    }
+
+} // anonymous namespace
+
+
+size_t GltfAccessor::elementSize() const
+{
+    size_t componentSize = 0;
+    switch (componentType)
+    {
+        case GLTF_BYTE: case GLTF_UNSIGNED_BYTE:   componentSize = 1; break;
+        case GLTF_SHORT: case GLTF_UNSIGNED_SHORT: componentSize = 2; break;
+        case GLTF_UNSIGNED_INT: case GLTF_FLOAT:   componentSize = 4; break;
+        default: break;
+    }
+    return componentSize * numComponents;
+}
+
+
+float GltfAccessor::readFloat(size_t _index, int _component) const
+{
+    const char *p = data + _index * stride;
+    switch (componentType)
+    {
+        case GLTF_FLOAT:
+        {
+            float value;
+            std::memcpy(&value, p + 4 * _component, 4);
+            return value;
+        }
+        case GLTF_UNSIGNED_BYTE:
+        {
+            float value = static_cast<uint8_t>(p[_component]);
+            return normalized ? value / 255.0f : value;
+        }
+        case GLTF_BYTE:
+        {
+            float value = static_cast<int8_t>(p[_component]);
+            return normalized ? std::max(value / 127.0f, -1.0f) : value;
+        }
+        case GLTF_UNSIGNED_SHORT:
+        {
+            uint16_t value;
+            std::memcpy(&value, p + 2 * _component, 2);
+            return normalized ? value / 65535.0f : static_cast<float>(value);
+        }
+        case GLTF_SHORT:
+        {
+            int16_t value;
+            std::memcpy(&value, p + 2 * _component, 2);
+            return normalized ? std::max(value / 32767.0f, -1.0f) : static_cast<float>(value);
+        }
+        default:
+            return 0.0f;
+    }
+}
+
+
+uint32_t GltfAccessor::readIndex(size_t _index) const
+{
+    const char *p = data + _index * stride;
+    switch (componentType)
+    {
+        case GLTF_UNSIGNED_BYTE:
+            return static_cast<uint8_t>(*p);
+        case GLTF_UNSIGNED_SHORT:
+        {
+            uint16_t value;
+            std::memcpy(&value, p, 2);
+            return value;
+        }
+        case GLTF_UNSIGNED_INT:
+            return loadUint32(p);
+        default:
+            return 0;
+    }
+}
+
+
+GltfFile::GltfFile()
+{
+}
+
+
+GltfFile::~GltfFile()
+{
+}
+
+
+size_t GltfFile::numVertices() const
+{
+    size_t count = 0;
+    for (size_t i = 0; i < m_primitives.size(); i++)
+        count += m_primitives[i].positions.count;
+    return count;
+}
+
+
+size_t GltfFile::numIndices() const
+{
+    size_t count = 0;
+    for (size_t i = 0; i < m_primitives.size(); i++)
+        count += m_primitives[i].numIndices();
+    return count;
+}
+
+
+size_t GltfFile::computeMissingNormals()
+{
+    QGL_TRACE_SCOPE("GltfFile::computeMissingNormals");
+    size_t nbComputed = 0;
+    for (size_t p = 0; p < m_primitives.size(); p++)
+    {
+        GltfPrimitive &primitive = m_primitives[p];
+        if (primitive.normals.data != nullptr)
+            continue;
+
+        // sum of the unit normals of the faces of each vertex
+        const GltfAccessor &positions = primitive.positions;
+        std::vector<glm::vec3> normals(positions.count, glm::vec3(0.0f));
+        for (size_t f = 0; f < primitive.numIndices() / 3; f++)
+        {
+            uint32_t v[3];
+            glm::vec3 p[3];
+            for (int k = 0; k < 3; k++)
+            {
+                v[k] = primitive.indices.data ? primitive.indices.readIndex(3 * f + k) : static_cast<uint32_t>(3 * f + k);
+                p[k] = glm::vec3(positions.readFloat(v[k], 0), positions.readFloat(v[k], 1), positions.readFloat(v[k], 2));
+            }
+
+            const glm::vec3 normal = glm::cross(p[1] - p[0], p[2] - p[0]);
+            const float length2 = glm::dot(normal, normal);
+            if (length2 > 0.0f)
+                for (int k = 0; k < 3; k++)
+                    normals[v[k]] += normal * (1.0f / std::sqrt(length2));
+        }
+
+        // isolated vertices keep a null normal
+        for (size_t i = 0; i < normals.size(); i++)
+        {
+            const float length2 = glm::dot(normals[i], normals[i]);
+            normals[i] = (length2 > 0.0f) ? normals[i] * (1.0f / std::sqrt(length2)) : glm::vec3(0.0f);
+        }
+
+        // (the storage of a moved vector does not change: accessors of previous buffers stay valid)
+        m_decodedBuffers.push_back( std::vector<char>(normals.size() * sizeof(glm::vec3)) );
+        std::memcpy(m_decodedBuffers.back().data(), normals.data(), normals.size() * sizeof(glm::vec3));
+
+        primitive.normals.data = m_decodedBuffers.back().data();
+        primitive.normals.count = normals.size();
+        primitive.normals.stride = sizeof(glm::vec3);
+        primitive.normals.componentType = GLTF_FLOAT;
+        primitive.normals.numComponents = 3;
+        primitive.normals.normalized = false;
+        nbComputed++;
+    }
+    return nbComputed;
+}
+
+
+bool GltfFile::open(const std::string &_filename)
+{
+    QGL_TRACE_SCOPE("GltfFile::open");
+    m_files.clear();
+    m_decodedBuffers.clear();
+    m_primitives.clear();
+
+    m_files.push_back( std::unique_ptr<MappedFile>(new MappedFile()) );
+    MappedFile &file = *m_files.back();
+    if (!file.open(_filename))
+    {
+        std::cerr << "[ERROR] GltfFile::open(): Could not open " << _filename << std::endl;
+        return false;
+    }
+
+    // 1. Locate the JSON document and the binary chunk of .glb files
+    const char *json = file.data();
+    const char *jsonEnd = file.data() + file.size();
+    ByteRange glbBuffer = { nullptr, 0, 0 };
+
+    if (file.size() >= 12 && loadUint32(file.data()) == GLB_MAGIC)
+    {
+        const uint32_t version = loadUint32(file.data() + 4);
+        const size_t length = std::min<size_t>(loadUint32(file.data() + 8), file.size());
+        if (version != 2 || length < 20 || loadUint32(file.data() + 16) != GLB_CHUNK_JSON)
+        {
+            std::cerr << "[ERROR] GltfFile::open(): Invalid GLB header in " << _filename << std::endl;
+            return false;
+        }
+
+        const size_t jsonLength = loadUint32(file.data() + 12);
+        if (jsonLength > length - 20)
+        {
+            std::cerr << "[ERROR] GltfFile::open(): Truncated GLB file " << _filename << std::endl;
+            return false;
+        }
+        json = file.data() + 20;
+        jsonEnd = json + jsonLength;
+
+        // the binary chunk follows the JSON chunk, padded to 4 bytes
+        const size_t binHeader = 20 + ((jsonLength + 3) & ~size_t(3));
+        if (binHeader + 8 <= length && loadUint32(file.data() + binHeader + 4) == GLB_CHUNK_BIN)
+        {
+            const size_t binLength = loadUint32(file.data() + binHeader);
+            if (binLength > length - binHeader - 8)
+            {
+                std::cerr << "[ERROR] GltfFile::open(): Truncated GLB file " << _filename << std::endl;
+                return false;
+            }
+            glbBuffer.data = file.data() + binHeader + 8;
+            glbBuffer.size = binLength;
+        }
+    }
+
+    JsonValue root;
+    if (!JsonParser(json, jsonEnd).parse(root) || root.type != JsonValue::JSON_OBJECT)
+    {
+        std::cerr << "[ERROR] GltfFile::open(): Invalid JSON in " << _filename << std::endl;
+        return false;
+    }
+
+    // 2. Buffers: GLB binary chunk, external files (mapped) or base64 data URIs (decoded)
+    const std::string directory = _filename.substr(0, _filename.find_last_of("/\\") + 1);
+    std::vector<ByteRange> buffers;
+    const JsonValue *jsonBuffers = root.get("buffers");
+    for (size_t i = 0; jsonBuffers != nullptr && i < jsonBuffers->items.size(); i++)
+    {
+        const JsonValue &buffer = jsonBuffers->items[i];
+        const JsonValue *uri = buffer.get("uri");
+        ByteRange range = { nullptr, 0, 0 };
+
+        if (uri == nullptr)
+        {
+            range = glbBuffer;
+        }
+        else if (uri->string.compare(0, 5, "data:") == 0)
+        {
+            const size_t start = uri->string.find(";base64,");
+            m_decodedBuffers.push_back( std::vector<char>() );
+            if (start == std::string::npos ||
+                !decodeBase64(uri->string.data() + start + 8, uri->string.data() + uri->string.size(), m_decodedBuffers.back()))
+            {
+                std::cerr << "[ERROR] GltfFile::open(): Invalid data URI in " << _filename << std::endl;
+                return false;
+            }
+            range.data = m_decodedBuffers.back().data();
+            range.size = m_decodedBuffers.back().size();
+        }
+        else
+        {
+            m_files.push_back( std::unique_ptr<MappedFile>(new MappedFile()) );
+            const std::string bufferFilename = directory + decodeURI(uri->string);
+            if (!m_files.back()->open(bufferFilename))
+            {
+                std::cerr << "[ERROR] GltfFile::open(): Could not open " << bufferFilename << std::endl;
+                return false;
+            }
+            range.data = m_files.back()->data();
+            range.size = m_files.back()->size();
+        }
+
+        size_t byteLength = 0;
+        if (!buffer.getSize("byteLength", byteLength))
+        {
+            std::cerr << "[ERROR] GltfFile::open(): Invalid buffer in " << _filename << std::endl;
+            return false;
+        }
+        range.size = std::min(range.size, byteLength);
+        buffers.push_back(range);
+    }
+
+    // 3. Buffer views
+    std::vector<ByteRange> views;
+    const JsonValue *jsonViews = root.get("bufferViews");
+    for (size_t i = 0; jsonViews != nullptr && i < jsonViews->items.size(); i++)
+    {
+        const JsonValue &view = jsonViews->items[i];
+        const double buffer = view.getNumber("buffer", -1.0);
+        size_t offset = 0;
+        ByteRange range = { nullptr, 0, 0 };
+
+        if (!view.getSize("byteOffset", offset) || !view.getSize("byteLength", range.size) || !view.getSize("byteStride", range.stride) ||
+            buffer < 0.0 || buffer >= static_cast<double>(buffers.size()) || buffers[static_cast<size_t>(buffer)].data == nullptr ||
+            offset > buffers[static_cast<size_t>(buffer)].size || range.size > buffers[static_cast<size_t>(buffer)].size - offset)
+        {
+            std::cerr << "[ERROR] GltfFile::open(): Invalid buffer view in " << _filename << std::endl;
+            return false;
+        }
+        range.data = buffers[static_cast<size_t>(buffer)].data + offset;
+        views.push_back(range);
+    }
+
+    // 4. Triangle primitives of all the meshes
+    const JsonValue *meshes = root.get("meshes");
+    for (size_t m = 0; meshes != nullptr && m < meshes->items.size(); m++)
+    {
+        const JsonValue *primitives = meshes->items[m].get("primitives");
+        for (size_t p = 0; primitives != nullptr && p < primitives->items.size(); p++)
+        {
+            const JsonValue &jsonPrimitive = primitives->items[p];
+            const JsonValue *attributes = jsonPrimitive.get("attributes");
+            if (jsonPrimitive.getNumber("mode", GLTF_TRIANGLES) != GLTF_TRIANGLES || attributes == nullptr)
+            {
+                std::cout << "[WARNING] GltfFile::open(): Skip non-triangle primitive in " << _filename << std::endl;
+                continue;
+            }
+
+            GltfPrimitive primitive;
+            primitive.positions = emptyAccessor();
+            primitive.normals = emptyAccessor();
+            primitive.texcoords = emptyAccessor();
+            primitive.indices = emptyAccessor();
+
+            if (!resolveAccessor(root, attributes->getNumber("POSITION", -1.0), views, primitive.positions) ||
+                primitive.positions.componentType != GLTF_FLOAT || primitive.positions.numComponents != 3)
+            {
+                std::cerr << "[ERROR] GltfFile::open(): Missing or unsupported POSITION attribute in " << _filename << std::endl;
+                return false;
+            }
+
+            // optional attributes are ignored if they are not usable as is
+            if (attributes->get("NORMAL") != nullptr &&
+                (!resolveAccessor(root, attributes->getNumber("NORMAL", -1.0), views, primitive.normals) ||
+                 primitive.normals.componentType != GLTF_FLOAT || primitive.normals.numComponents != 3 ||
+                 primitive.normals.count != primitive.positions.count))
+            {
+                std::cout << "[WARNING] GltfFile::open(): Ignore unsupported NORMAL attribute in " << _filename << std::endl;
+                primitive.normals = emptyAccessor();
+            }
+
+            if (attributes->get("TEXCOORD_0") != nullptr &&
+                (!resolveAccessor(root, attributes->getNumber("TEXCOORD_0", -1.0), views, primitive.texcoords) ||
+                 primitive.texcoords.numComponents != 2 || primitive.texcoords.count != primitive.positions.count))
+            {
+                std::cout << "[WARNING] GltfFile::open(): Ignore unsupported TEXCOORD_0 attribute in " << _filename << std::endl;
+                primitive.texcoords = emptyAccessor();
+            }
+
+            if (jsonPrimitive.get("indices") != nullptr &&
+                (!resolveAccessor(root, jsonPrimitive.getNumber("indices", -1.0), views, primitive.indices) ||
+                 primitive.indices.numComponents != 1 || !primitive.indices.isPacked() ||
+                 (primitive.indices.componentType != GLTF_UNSIGNED_BYTE && primitive.indices.componentType != GLTF_UNSIGNED_SHORT &&
+                  primitive.indices.componentType != GLTF_UNSIGNED_INT)))
+            {
+                std::cerr << "[ERROR] GltfFile::open(): Invalid indices in " << _filename << std::endl;
+                return false;
+            }
+
+            // indices are uploaded to the GPU as they are: a primitive referencing vertices
+            // beyond its POSITION accessor would make the GPU read outside of the VBOs
+            bool validIndices = true;
+            for (size_t i = 0; primitive.indices.data != nullptr && i < primitive.indices.count && validIndices; i++)
+                validIndices = primitive.indices.readIndex(i) < primitive.positions.count;
+            if (!validIndices)
+            {
+                std::cout << "[WARNING] GltfFile::open(): Skip primitive with out of range indices in " << _filename << std::endl;
+                continue;
+            }
+
+            // AABB: min and max of POSITION accessors are mandatory, but are computed if missing
+            const JsonValue *accessor = root.at("accessors", attributes->getNumber("POSITION", -1.0));
+            const JsonValue *min = accessor->get("min");
+            const JsonValue *max = accessor->get("max");
+            if (min != nullptr && max != nullptr && min->items.size() == 3 && max->items.size() == 3)
+            {
+                for (int c = 0; c < 3; c++)
+                {
+                    primitive.bBoxMin[c] = static_cast<float>(min->items[c].number);
+                    primitive.bBoxMax[c] = static_cast<float>(max->items[c].number);
+                }
+            }
+            else
+            {
+                primitive.bBoxMin = glm::vec3( std::numeric_limits<float>::max() );
+                primitive.bBoxMax = glm::vec3( -std::numeric_limits<float>::max() );
+                for (size_t i = 0; i < primitive.positions.count; i++)
+                {
+                    for (int c = 0; c < 3; c++)
+                    {
+                        float value = primitive.positions.readFloat(i, c);
+                        primitive.bBoxMin[c] = std::min(primitive.bBoxMin[c], value);
+                        primitive.bBoxMax[c] = std::max(primitive.bBoxMax[c], value);
+                    }
+                }
+            }
+
+            m_primitives.push_back(primitive);
+        }
+    }
+
+    return true;
+}
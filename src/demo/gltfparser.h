@@ -0,0 +1,163 @@
+/*********************************************************************************************************************
+ *
+ * gltfparser.h
+ *
+ * Reader for glTF 2.0 files (.gltf and binary .glb)
+ *
+ * QGL_toolkit demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#ifndef GLTFPARSER_H
+#define GLTFPARSER_H
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+
+
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+
+
+#include "mappedfile.h"
+
+
+// glTF accessor component types (same values as the GL enums)
+const int GLTF_BYTE = 5120;
+const int GLTF_UNSIGNED_BYTE = 5121;
+const int GLTF_SHORT = 5122;
+const int GLTF_UNSIGNED_SHORT = 5123;
+const int GLTF_UNSIGNED_INT = 5125;
+const int GLTF_FLOAT = 5126;
+
+
+/*!
+* \struct GltfAccessor
+* \brief Typed view on the data of a glTF buffer.
+* data points into the mapped file (or into a decoded data URI), nothing is copied.
+*/
+struct GltfAccessor
+{
+    const char *data;           /*!< address of the first element, nullptr if the attribute is absent */
+    size_t count;               /*!< number of elements */
+    size_t stride;              /*!< distance between two consecutive elements (in bytes) */
+    int componentType;          /*!< GLTF_FLOAT, GLTF_UNSIGNED_SHORT, ... */
+    int numComponents;          /*!< 1 (SCALAR), 2 (VEC2), 3 (VEC3) or 4 (VEC4) */
+    bool normalized;            /*!< integer components are normalized to [0, 1] (or [-1, 1]) */
+
+    /*! \fn elementSize \brief Size of an element (in bytes) */
+    size_t elementSize() const;
+
+    /*! \fn isPacked \brief Returns true if elements are tightly packed, i.e. the range can be copied as is */
+    bool isPacked() const { return stride == elementSize(); }
+
+    /*! \fn readFloat \brief Read a component as a float (normalized integers are converted) */
+    float readFloat(size_t _index, int _component) const;
+
+    /*! \fn readIndex \brief Read the first component as an unsigned integer */
+    uint32_t readIndex(size_t _index) const;
+};
+
+
+/*!
+* \struct GltfPrimitive
+* \brief Triangle primitive of a glTF mesh
+*/
+struct GltfPrimitive
+{
+    GltfAccessor positions;     /*!< POSITION attribute (float vec3) */
+    GltfAccessor normals;       /*!< NORMAL attribute (float vec3), data is nullptr if absent */
+    GltfAccessor texcoords;     /*!< TEXCOORD_0 attribute (vec2), data is nullptr if absent */
+    GltfAccessor indices;       /*!< indices (unsigned byte, short or int), data is nullptr for non-indexed primitives */
+
+    glm::vec3 bBoxMin;          /*!< min corner of the AABB of the positions */
+    glm::vec3 bBoxMax;          /*!< max corner of the AABB of the positions */
+
+    /*! \fn numIndices \brief Number of indices (of vertices for non-indexed primitives) forming complete triangles */
+    size_t numIndices() const
+    {
+        const size_t count = indices.data ? indices.count : positions.count;
+        return count - count % 3;
+    }
+};
+
+
+/*!
+* \class GltfFile
+* \brief glTF 2.0 file, reduced to the triangle primitives of its meshes.
+* The JSON part is parsed once, then the binary buffers stay mapped in memory
+* and primitives reference them directly: a .glb file (or a .gltf with external .bin files)
+* is never copied, so the buffer views can be uploaded to the GPU as they are.
+* Node transforms are ignored: primitives are in the space of their mesh.
+*/
+class GltfFile
+{
+    public:
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                        CONSTRUCTORS / DESTRUCTORS                                           |
+        +------------------------------------------------------------------------------------------------------------*/
+
+        /*!
+        * \fn GltfFile
+        * \brief Default constructor of GltfFile
+        */
+        GltfFile();
+
+        /*!
+        * \fn ~GltfFile
+        * \brief Destructor of GltfFile, unmaps the buffers
+        */
+        ~GltfFile();
+
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                                   MISC.                                                     |
+        +-------------------------------------------------------------------------------------------------------------*/
+
+        /*!
+        * \fn open
+        * \brief Read a .gltf or .glb file. Primitives whose indices exceed their number of vertices are skipped.
+        * \param _filename : name of the file
+        * \return false if the file could not be read, or if it contains unsupported data
+        */
+        bool open(const std::string &_filename);
+
+        /*! \fn primitives */
+        const std::vector<GltfPrimitive> &primitives() const { return m_primitives; }
+
+        /*! \fn numVertices \brief Total number of vertices of the primitives */
+        size_t numVertices() const;
+
+        /*! \fn numIndices \brief Total number of indices of the primitives (vertices for non-indexed primitives) */
+        size_t numIndices() const;
+
+        /*!
+        * \fn computeMissingNormals
+        * \brief Compute the normals of the primitives without NORMAL attribute (average of the unit face normals,
+        * as TriMesh::computeNormals()). They are stored in buffers owned by the file, other primitives are not modified.
+        * \return the number of primitives whose normals were computed
+        */
+        size_t computeMissingNormals();
+
+
+    private:
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                                ATTRIBUTES                                                   |
+        +------------------------------------------------------------------------------------------------------------*/
+
+        std::vector< std::unique_ptr<MappedFile> > m_files;         /*!< mapped .glb file and external buffers */
+        std::vector< std::vector<char> > m_decodedBuffers;          /*!< buffers decoded from base64 data URIs, and computed normals */
+        std::vector<GltfPrimitive> m_primitives;                    /*!< triangle primitives of all the meshes */
+
+        // Copy constructor and operator= are declared private and undefined
+        GltfFile(const GltfFile &);
+        GltfFile &operator=(const GltfFile &);
+};
+
+#endif // GLTFPARSER_H
@@ -0,0 +1,241 @@
+/*********************************************************************************************************************
+ *
+ * hashmap.h
+ *
+ * Flat open-addressing hash map
+ *
+ * QGL_toolkit demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#ifndef HASHMAP_H
+#define HASHMAP_H
+
+#include <vector>
+#include <cstdint>
+#include <functional>
+#include <utility>
+
+
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+
+
+/*!
+* \fn hashMix
+* \brief Finalization step of splitmix64, spreads the bits of a 64-bit key
+*/
+inline uint64_t hashMix(uint64_t _x)
+{
+    _x ^= _x >> 30;
+    _x *= 0xbf58476d1ce4e5b9ULL;
+    _x ^= _x >> 27;
+    _x *= 0x94d049bb133111ebULL;
+    _x ^= _x >> 31;
+    return _x;
+}
+
+
+/*!
+* \struct UVec3Hash
+* \brief Hash function for glm::uvec3 keys (e.g., OBJ (v, vt, vn) tuples)
+*/
+struct UVec3Hash
+{
+    size_t operator() (const glm::uvec3 &_key) const
+    {
+        return static_cast<size_t>( hashMix( ( static_cast<uint64_t>(_key.x) << 32 | _key.y ) ^ hashMix(_key.z) ) );
+    }
+};
+
+
+/*!
+* \class FlatHashMap
+* \brief Hash map with open addressing and linear probing.
+* All the entries are stored in a single array (no allocation per entry),
+* whose size is a power of two. The map grows when its load factor exceeds 3/4.
+* Use reserve() with the expected number of entries to avoid rehashing.
+* Entries cannot be removed individually (use clear()).
+*/
+template <typename Key, typename Value, typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key> >
+class FlatHashMap
+{
+    public:
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                        CONSTRUCTORS / DESTRUCTORS                                           |
+        +------------------------------------------------------------------------------------------------------------*/
+
+        /*!
+        * \fn FlatHashMap
+        * \brief Constructor of FlatHashMap
+        * \param _expectedSize : expected number of entries
+        */
+        explicit FlatHashMap(size_t _expectedSize = 0)
+        : m_size(0), m_mask(0)
+        {
+            reserve(_expectedSize);
+        }
+
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                              GETTERS/SETTERS                                                |
+        +-------------------------------------------------------------------------------------------------------------*/
+
+        /*! \fn size */
+        size_t size() const { return m_size; }
+
+        /*! \fn empty */
+        bool empty() const { return m_size == 0; }
+
+        /*! \fn capacity */
+        size_t capacity() const { return m_slots.size(); }
+
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                                   MISC.                                                     |
+        +-------------------------------------------------------------------------------------------------------------*/
+
+        /*!
+        * \fn reserve
+        * \brief Allocate enough slots to store _expectedSize entries without rehashing
+        * \param _expectedSize : expected number of entries
+        */
+        void reserve(size_t _expectedSize)
+        {
+            size_t capacity = 16;
+            while (capacity * 3 < _expectedSize * 4)
+                capacity <<= 1;
+
+            if (capacity > m_slots.size())
+                rehash(capacity);
+        }
+
+        /*!
+        * \fn clear
+        * \brief Remove all the entries (capacity is kept)
+        */
+        void clear()
+        {
+            for (size_t i = 0; i < m_slots.size(); i++)
+                m_slots[i].used = false;
+            m_size = 0;
+        }
+
+        /*!
+        * \fn insert
+        * \brief Insert a new entry if _key is not in the map yet.
+        * Only one probe sequence is performed, whether the key exists or not.
+        * \param _key : key to insert
+        * \param _value : value associated to _key if it is inserted
+        * \return reference to the value associated to _key, and true if the entry has been inserted
+        */
+        std::pair<Value&, bool> insert(const Key &_key, const Value &_value)
+        {
+            if ((m_size + 1) * 4 > m_slots.size() * 3)
+                rehash(m_slots.size() * 2);
+
+            size_t i = m_hash(_key) & m_mask;
+            while (m_slots[i].used)
+            {
+                if (m_equal(m_slots[i].key, _key))
+                    return std::pair<Value&, bool>(m_slots[i].value, false);
+                i = (i + 1) & m_mask;
+            }
+
+            m_slots[i].key = _key;
+            m_slots[i].value = _value;
+            m_slots[i].used = true;
+            m_size++;
+
+            return std::pair<Value&, bool>(m_slots[i].value, true);
+        }
+
+        /*!
+        * \fn find
+        * \brief Search for _key in the map
+        * \param _key : key to search for
+        * \return pointer to the associated value, nullptr if _key is not in the map
+        */
+        Value *find(const Key &_key)
+        {
+            if (m_size == 0)
+                return nullptr;
+
+            size_t i = m_hash(_key) & m_mask;
+            while (m_slots[i].used)
+            {
+                if (m_equal(m_slots[i].key, _key))
+                    return &(m_slots[i].value);
+                i = (i + 1) & m_mask;
+            }
+            return nullptr;
+        }
+
+        /*! \fn find */
+        const Value *find(const Key &_key) const { return const_cast<FlatHashMap*>(this)->find(_key); }
+
+        /*!
+        * \fn forEach
+        * \brief Call _func(key, value) on every entry of the map (in storage order)
+        */
+        template <typename Func>
+        void forEach(Func _func) const
+        {
+            for (size_t i = 0; i < m_slots.size(); i++)
+                if (m_slots[i].used)
+                    _func(m_slots[i].key, m_slots[i].value);
+        }
+
+
+    protected:
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                                ATTRIBUTES                                                   |
+        +------------------------------------------------------------------------------------------------------------*/
+
+        struct Slot
+        {
+            Key key;
+            Value value;
+            bool used = false;
+        };
+
+        std::vector<Slot> m_slots;      /*!< array of slots, its size is a power of two */
+        size_t m_size;                  /*!< number of entries */
+        size_t m_mask;                  /*!< m_slots.size() - 1 */
+
+        Hash m_hash;                    /*!< hash function */
+        KeyEqual m_equal;               /*!< key comparison function */
+
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                                    MISC.                                                    |
+        +------------------------------------------------------------------------------------------------------------*/
+
+        /*!
+        * \fn rehash
+        * \brief Move all the entries in a new array of slots
+        * \param _capacity : new number of slots (power of two)
+        */
+        void rehash(size_t _capacity)
+        {
+            std::vector<Slot> oldSlots(_capacity);
+            oldSlots.swap(m_slots);
+            m_mask = _capacity - 1;
+
+            for (size_t j = 0; j < oldSlots.size(); j++)
+            {
+                if (!oldSlots[j].used)
+                    continue;
+
+                size_t i = m_hash(oldSlots[j].key) & m_mask;
+                while (m_slots[i].used)
+                    i = (i + 1) & m_mask;
+                m_slots[i] = oldSlots[j];
+            }
+        }
+};
+
+#endif // HASHMAP_H
@@ -0,0 +1,376 @@
+/*********************************************************************************************************************
+ *
+ * indexoptimizer.cpp
+ *
+ * Reordering of triangle index buffers for the GPU
+ * (post-transform vertex cache, overdraw and vertex fetch)
+ *
+ * QGL_toolkit demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+
+#include "indexoptimizer.h"
+#include "meshadjacency.h"
+#include "threadpool.h"
+#include "trace.h"
+
+
+namespace
+{
+    // Size of the LRU cache simulated by optimizeVertexCache()
+    const unsigned int FORSYTH_CACHE_SIZE = 32;
+    // Size of the FIFO cache used to find the clusters of optimizeOverdraw()
+    const unsigned int OVERDRAW_CACHE_SIZE = 16;
+
+    // Constants of the vertex scores of Forsyth's algorithm
+    const float LAST_TRIANGLE_SCORE = 0.75f;
+    const float CACHE_DECAY_POWER = 1.5f;
+    const float VALENCE_BOOST_SCALE = 2.0f;
+    const float VALENCE_BOOST_POWER = 0.5f;
+    const unsigned int MAX_PRECOMPUTED_VALENCE = 64;
+
+
+    /*!
+    * \class FifoCache
+    * \brief FIFO post-transform cache simulated with timestamps:
+    * a vertex is in the cache if less than _cacheSize vertices were transformed after it
+    */
+    class FifoCache
+    {
+        public:
+
+            FifoCache(size_t _nbVertices, unsigned int _cacheSize)
+            : m_timestamps(_nbVertices, 0), m_timestamp(_cacheSize + 1), m_cacheSize(_cacheSize) {}
+
+            // Returns 1 if vertex _v is transformed (cache miss), 0 otherwise
+            unsigned int access(uint32_t _v)
+            {
+                if (m_timestamp - m_timestamps[_v] > m_cacheSize)
+                {
+                    m_timestamps[_v] = m_timestamp++;
+                    return 1;
+                }
+                return 0;
+            }
+
+            // Empty the cache
+            void flush() { m_timestamp += m_cacheSize + 1; }
+
+        private:
+
+            std::vector<uint32_t> m_timestamps;
+            uint32_t m_timestamp;
+            unsigned int m_cacheSize;
+    };
+
+
+    /*!
+    * \class VertexScores
+    * \brief Vertex scores of Forsyth's algorithm, from the position of the vertex in the LRU cache
+    * and from its number of triangles not emitted yet
+    */
+    class VertexScores
+    {
+        public:
+
+            VertexScores()
+            {
+                for (unsigned int p = 0; p < FORSYTH_CACHE_SIZE; p++)
+                {
+                    // vertices of the last triangle have a fixed score, so that it is not reused right away
+                    m_cacheScores[p] = (p < 3) ? LAST_TRIANGLE_SCORE
+                                               : std::pow(1.0f - float(p - 3) / float(FORSYTH_CACHE_SIZE - 3), CACHE_DECAY_POWER);
+                }
+                m_valenceScores[0] = 0.0f;
+                for (unsigned int v = 1; v < MAX_PRECOMPUTED_VALENCE; v++)
+                    m_valenceScores[v] = valenceScore(v);
+            }
+
+            // Score of a vertex at position _cachePosition in the cache (-1 if not in the cache)
+            float operator()(int _cachePosition, uint32_t _valence) const
+            {
+                // vertices without remaining triangles are not worth anything
+                if (_valence == 0)
+                    return -1.0f;
+
+                const float cacheScore = (_cachePosition >= 0) ? m_cacheScores[_cachePosition] : 0.0f;
+                return cacheScore + ( (_valence < MAX_PRECOMPUTED_VALENCE) ? m_valenceScores[_valence] : valenceScore(_valence) );
+            }
+
+        private:
+
+            float m_cacheScores[FORSYTH_CACHE_SIZE];
+            float m_valenceScores[MAX_PRECOMPUTED_VALENCE];
+
+            // Boost vertices with few remaining triangles, so that lone triangles are not left behind
+            static float valenceScore(uint32_t _valence)
+            {
+                return VALENCE_BOOST_SCALE * std::pow(float(_valence), -VALENCE_BOOST_POWER);
+            }
+    };
+
+} // anonymous namespace
+
+
+VertexCacheStats analyzeVertexCache(const uint32_t *_indices, size_t _nbIndices, size_t _nbVertices, unsigned int _cacheSize)
+{
+    FifoCache cache(_nbVertices, _cacheSize);
+    std::vector<bool> referenced(_nbVertices, false);
+    size_t nbReferenced = 0;
+
+    VertexCacheStats stats;
+    stats.numTransformed = 0;
+    for (size_t i = 0; i < _nbIndices; i++)
+    {
+        stats.numTransformed += cache.access(_indices[i]);
+        if (!referenced[_indices[i]])
+        {
+            referenced[_indices[i]] = true;
+            nbReferenced++;
+        }
+    }
+
+    const size_t nbTriangles = _nbIndices / 3;
+    stats.acmr = (nbTriangles > 0) ? float(stats.numTransformed) / float(nbTriangles) : 0.0f;
+    stats.atvr = (nbReferenced > 0) ? float(stats.numTransformed) / float(nbReferenced) : 0.0f;
+    return stats;
+}
+
+
+void optimizeVertexCache(uint32_t *_indices, size_t _nbIndices, size_t _nbVertices)
+{
+    const size_t nbTriangles = _nbIndices / 3;
+    if (nbTriangles == 0)
+        return;
+
+    const VertexScores score;
+
+    // triangles around each vertex: triangles not emitted yet are the first remaining[v] of the row
+    VertexAdjacency adjacency;
+    buildVertexAdjacency(_indices, 3 * nbTriangles, _nbVertices, adjacency, ThreadPool::global());
+    std::vector<uint32_t> &liveTriangles = adjacency.corners;
+    for (size_t c = 0; c < liveTriangles.size(); c++)
+        liveTriangles[c] /= 3;
+
+    std::vector<uint32_t> remaining(_nbVertices);
+    std::vector<int> cachePositions(_nbVertices, -1);
+    std::vector<float> vertexScores(_nbVertices);
+    for (size_t v = 0; v < _nbVertices; v++)
+    {
+        remaining[v] = adjacency.degree(v);
+        vertexScores[v] = score(-1, remaining[v]);
+    }
+
+    std::vector<bool> emitted(nbTriangles, false);
+    std::vector<uint32_t> output(3 * nbTriangles);
+    std::vector<uint32_t> cache, newCache;
+    cache.reserve(FORSYTH_CACHE_SIZE + 3);
+    newCache.reserve(FORSYTH_CACHE_SIZE + 3);
+
+    size_t bestTriangle = nbTriangles;
+    size_t nextInputTriangle = 0;
+    for (size_t out = 0; out < nbTriangles; out++)
+    {
+        // dead end (no triangle around the cache): restart from the first triangle not emitted yet
+        if (bestTriangle == nbTriangles)
+        {
+            while (emitted[nextInputTriangle])
+                nextInputTriangle++;
+            bestTriangle = nextInputTriangle;
+        }
+
+        // 1. emit the triangle, and remove it from the live triangles of its vertices
+        const uint32_t *triangle = _indices + 3 * bestTriangle;
+        emitted[bestTriangle] = true;
+        for (unsigned int k = 0; k < 3; k++)
+        {
+            const uint32_t v = triangle[k];
+            output[3 * out + k] = v;
+
+            uint32_t *row = liveTriangles.data() + adjacency.offsets[v];
+            uint32_t *last = row + remaining[v] - 1;
+            *std::find(row, last, static_cast<uint32_t>(bestTriangle)) = *last;
+            remaining[v]--;
+        }
+
+        // 2. move its vertices to the front of the LRU cache
+        newCache.clear();
+        for (unsigned int k = 0; k < 3; k++)
+        {
+            if (std::find(newCache.begin(), newCache.end(), triangle[k]) == newCache.end())
+                newCache.push_back(triangle[k]);
+        }
+        for (size_t i = 0; i < cache.size(); i++)
+        {
+            if (cache[i] != triangle[0] && cache[i] != triangle[1] && cache[i] != triangle[2])
+                newCache.push_back(cache[i]);
+        }
+        for (size_t i = FORSYTH_CACHE_SIZE; i < newCache.size(); i++)
+        {
+            cachePositions[newCache[i]] = -1;
+            vertexScores[newCache[i]] = score(-1, remaining[newCache[i]]);
+        }
+        newCache.resize(std::min<size_t>(newCache.size(), FORSYTH_CACHE_SIZE));
+        cache.swap(newCache);
+
+        // 3. update the scores of the vertices in the cache,
+        // then find the best triangle around them (their triangles are the only ones whose score changed)
+        for (size_t i = 0; i < cache.size(); i++)
+        {
+            cachePositions[cache[i]] = static_cast<int>(i);
+            vertexScores[cache[i]] = score(static_cast<int>(i), remaining[cache[i]]);
+        }
+
+        float bestScore = -std::numeric_limits<float>::max();
+        bestTriangle = nbTriangles;
+        for (size_t i = 0; i < cache.size(); i++)
+        {
+            const uint32_t v = cache[i];
+            const uint32_t *row = liveTriangles.data() + adjacency.offsets[v];
+            for (uint32_t j = 0; j < remaining[v]; j++)
+            {
+                const uint32_t *candidate = _indices + 3 * row[j];
+                const float triangleScore = vertexScores[candidate[0]] + vertexScores[candidate[1]] + vertexScores[candidate[2]];
+                if (triangleScore > bestScore)
+                {
+                    bestScore = triangleScore;
+                    bestTriangle = row[j];
+                }
+            }
+        }
+    }
+
+    std::copy(output.begin(), output.end(), _indices);
+}
+
+
+void optimizeOverdraw(uint32_t *_indices, size_t _nbIndices, const glm::vec3 *_vertices, size_t _nbVertices, float _threshold)
+{
+    QGL_TRACE_SCOPE("optimizeOverdraw");
+    const size_t nbTriangles = _nbIndices / 3;
+    if (nbTriangles == 0)
+        return;
+
+    FifoCache cache(_nbVertices, OVERDRAW_CACHE_SIZE);
+    auto triangleMisses = [&](size_t _t)
+    {
+        return cache.access(_indices[3 * _t]) + cache.access(_indices[3 * _t + 1]) + cache.access(_indices[3 * _t + 2]);
+    };
+
+    // 1. hard boundaries: triangles whose 3 vertices are transformed, i.e. where the cache does not help anyway
+    std::vector<size_t> hardStarts;
+    for (size_t t = 0; t < nbTriangles; t++)
+    {
+        if (triangleMisses(t) == 3 || t == 0)
+            hardStarts.push_back(t);
+    }
+    hardStarts.push_back(nbTriangles);
+
+    // 2. soft boundaries: split a cluster as soon as the ACMR of its first part is not much higher than the ACMR of the whole cluster
+    std::vector<size_t> clusterStarts;
+    for (size_t h = 0; h + 1 < hardStarts.size(); h++)
+    {
+        const size_t begin = hardStarts[h];
+        const size_t end = hardStarts[h + 1];
+
+        cache.flush();
+        size_t clusterMisses = 0;
+        for (size_t t = begin; t < end; t++)
+            clusterMisses += triangleMisses(t);
+        const float maxMissRatio = _threshold * float(clusterMisses) / float(end - begin);
+
+        cache.flush();
+        size_t start = begin;
+        size_t misses = 0;
+        clusterStarts.push_back(begin);
+        for (size_t t = begin; t + 1 < end; t++)
+        {
+            misses += triangleMisses(t);
+            if (float(misses) <= maxMissRatio * float(t + 1 - start))
+            {
+                start = t + 1;
+                misses = 0;
+                clusterStarts.push_back(start);
+                cache.flush();
+            }
+        }
+    }
+    clusterStarts.push_back(nbTriangles);
+    const size_t nbClusters = clusterStarts.size() - 1;
+
+    // 3. area weighted centroid and normal of the clusters and of the mesh
+    std::vector<glm::vec3> centroids(nbClusters, glm::vec3(0.0f));
+    std::vector<glm::vec3> normals(nbClusters, glm::vec3(0.0f));
+    std::vector<float> areas(nbClusters, 0.0f);
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+    for (size_t c = 0; c < nbClusters; c++)
+    {
+        for (size_t t = clusterStarts[c]; t < clusterStarts[c + 1]; t++)
+        {
+            const glm::vec3 &p0 = _vertices[_indices[3 * t]];
+            const glm::vec3 &p1 = _vertices[_indices[3 * t + 1]];
+            const glm::vec3 &p2 = _vertices[_indices[3 * t + 2]];
+            const glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+            const float area = glm::length(normal);
+
+            centroids[c] += (p0 + p1 + p2) * (area / 3.0f);
+            normals[c] += normal;
+            areas[c] += area;
+        }
+        meshCentroid += centroids[c];
+        meshArea += areas[c];
+    }
+    if (meshArea > 0.0f)
+        meshCentroid /= meshArea;
+
+    // 4. sort the clusters: the more a cluster faces away from the center, the more it occludes the others
+    std::vector<float> keys(nbClusters, 0.0f);
+    for (size_t c = 0; c < nbClusters; c++)
+    {
+        const float normalLength = glm::length(normals[c]);
+        if (areas[c] > 0.0f && normalLength > 0.0f)
+            keys[c] = glm::dot(centroids[c] / areas[c] - meshCentroid, normals[c] / normalLength);
+    }
+
+    std::vector<size_t> order(nbClusters);
+    for (size_t c = 0; c < nbClusters; c++)
+        order[c] = c;
+    std::stable_sort(order.begin(), order.end(), [&](size_t _a, size_t _b) { return keys[_a] > keys[_b]; });
+
+    std::vector<uint32_t> output;
+    output.reserve(3 * nbTriangles);
+    for (size_t i = 0; i < nbClusters; i++)
+        output.insert(output.end(), _indices + 3 * clusterStarts[order[i]], _indices + 3 * clusterStarts[order[i] + 1]);
+    std::copy(output.begin(), output.end(), _indices);
+}
+
+
+void optimizeVertexFetch(uint32_t *_indices, size_t _nbIndices, size_t _nbVertices, std::vector<uint32_t> &_remap)
+{
+    QGL_TRACE_SCOPE("optimizeVertexFetch");
+    const uint32_t UNUSED = std::numeric_limits<uint32_t>::max();
+    _remap.assign(_nbVertices, UNUSED);
+
+    uint32_t nextVertex = 0;
+    for (size_t i = 0; i < _nbIndices; i++)
+    {
+        uint32_t &newIndex = _remap[_indices[i]];
+        if (newIndex == UNUSED)
+            newIndex = nextVertex++;
+        _indices[i] = newIndex;
+    }
+
+    // unreferenced vertices are kept, after the others
+    for (size_t v = 0; v < _nbVertices; v++)
+    {
+        if (_remap[v] == UNUSED)
+            _remap[v] = nextVertex++;
+    }
+}
@@ -0,0 +1,100 @@
+/*********************************************************************************************************************
+ *
+ * indexoptimizer.h
+ *
+ * Reordering of triangle index buffers for the GPU
+ * (post-transform vertex cache, overdraw and vertex fetch)
+ *
+ * QGL_toolkit demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#ifndef INDEXOPTIMIZER_H
+#define INDEXOPTIMIZER_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+
+
+/*!
+* \struct VertexCacheStats
+* \brief Efficiency of an index buffer, measured with a simulated FIFO post-transform cache
+*/
+struct VertexCacheStats
+{
+    size_t numTransformed;      /*!< number of vertex shader invocations (cache misses) */
+    float acmr;                 /*!< average cache miss ratio: transformed vertices per triangle (0.5 at best, 3 at worst) */
+    float atvr;                 /*!< average transformed vertex ratio: transformed vertices per referenced vertex (1 at best) */
+};
+
+
+/*!
+* \fn analyzeVertexCache
+* \brief Simulate a FIFO post-transform vertex cache on an index buffer
+* \param _indices : vertex indices, 3 per triangle
+* \param _nbIndices : number of indices
+* \param _nbVertices : number of vertices
+* \param _cacheSize : number of entries of the cache (16 is close to most GPUs)
+*/
+VertexCacheStats analyzeVertexCache(const uint32_t *_indices, size_t _nbIndices, size_t _nbVertices, unsigned int _cacheSize = 16);
+
+/*!
+* \fn optimizeVertexCache
+* \brief Reorder triangles to reuse the post-transform vertex cache (Tom Forsyth's linear-speed algorithm).
+* Triangles are emitted greedily: the next one is the best scored triangle around the vertices
+* of a simulated LRU cache, vertex scores favoring recently used vertices and vertices with few remaining triangles.
+* \param _indices : vertex indices, 3 per triangle, reordered in place
+* \param _nbIndices : number of indices
+* \param _nbVertices : number of vertices
+*/
+void optimizeVertexCache(uint32_t *_indices, size_t _nbIndices, size_t _nbVertices);
+
+/*!
+* \fn optimizeOverdraw
+* \brief Reorder clusters of triangles so that outer, outward facing clusters are drawn first
+* (Sander et al., "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw").
+* Must be called after optimizeVertexCache(): clusters are split where the vertex cache is flushed anyway,
+* or where splitting increases the ACMR of a cluster by less than _threshold.
+* \param _indices : vertex indices, 3 per triangle, reordered in place
+* \param _nbIndices : number of indices
+* \param _vertices : vertex positions
+* \param _nbVertices : number of vertices
+* \param _threshold : max increase of the ACMR (1.05: 5% more cache misses)
+*/
+void optimizeOverdraw(uint32_t *_indices, size_t _nbIndices, const glm::vec3 *_vertices, size_t _nbVertices, float _threshold = 1.05f);
+
+/*!
+* \fn optimizeVertexFetch
+* \brief Number vertices in the order of their first use in the index buffer (unreferenced vertices come last),
+* so that vertex fetches read memory sequentially. Indices are rewritten, vertex arrays must be reordered with remapVertices().
+* \param _indices : vertex indices, rewritten in place
+* \param _nbIndices : number of indices
+* \param _nbVertices : number of vertices
+* \param _remap : output, new index of each vertex
+*/
+void optimizeVertexFetch(uint32_t *_indices, size_t _nbIndices, size_t _nbVertices, std::vector<uint32_t> &_remap);
+
+/*!
+* \fn remapVertices
+* \brief Reorder an array of vertex attributes with the remap table of optimizeVertexFetch()
+* (arrays whose size is not the number of vertices, e.g. empty arrays, are not modified)
+*/
+template <typename T>
+void remapVertices(std::vector<T> &_attributes, const std::vector<uint32_t> &_remap)
+{
+    if (_attributes.size() != _remap.size())
+        return;
+
+    std::vector<T> remapped(_attributes.size());
+    for (size_t v = 0; v < _remap.size(); v++)
+        remapped[_remap[v]] = _attributes[v];
+    _attributes.swap(remapped);
+}
+
+#endif // INDEXOPTIMIZER_H
@@ -0,0 +1,93 @@
+/*********************************************************************************************************************
+ *
+ * instancing.cpp
+ *
+ * Transforms of the instances of a mesh drawn several times, and their culling
+ *
+ * QGL_toolkit demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+
+#include "instancing.h"
+#include "trace.h"
+#include "QGLtoolkit/frustum.h"
+
+
+namespace
+{
+
+// Number of instances transformed and tested at once by cullInstances()
+const size_t INSTANCE_BLOCK_SIZE = 256;
+
+} // namespace
+
+
+void computeInstancesBoundingSphere(const InstanceTransform *_instances, size_t _count, const glm::vec3 &_center, float _radius,
+                                    glm::vec3 &_instancesCenter, float &_instancesRadius)
+{
+    _instancesCenter = _center;
+    _instancesRadius = 0.0f;
+    if(_count == 0)
+        return;
+
+    // center of the box of the instance centers, then farthest instance
+    glm::vec3 bBoxMin = transformInstancePoint(_instances[0], _center);
+    glm::vec3 bBoxMax = bBoxMin;
+    for(size_t i = 1; i < _count; i++)
+    {
+        const glm::vec3 center = transformInstancePoint(_instances[i], _center);
+        bBoxMin = glm::min(bBoxMin, center);
+        bBoxMax = glm::max(bBoxMax, center);
+    }
+    _instancesCenter = 0.5f * (bBoxMin + bBoxMax);
+
+    float maxSqDistance = 0.0f;
+    for(size_t i = 0; i < _count; i++)
+    {
+        const glm::vec3 offset = transformInstancePoint(_instances[i], _center) - _instancesCenter;
+        maxSqDistance = std::max(maxSqDistance, glm::dot(offset, offset));
+    }
+    _instancesRadius = std::sqrt(maxSqDistance) + _radius;
+}
+
+
+void cullInstances(const InstanceTransform *_instances, size_t _count, const glm::vec3 &_center, float _radius,
+                   const glm::mat4 &_viewProjection, std::vector<InstanceTransform> &_visible)
+{
+    QGL_TRACE_SCOPE("cullInstances");
+    _visible.clear();
+
+    const qgltoolkit::Frustum frustum(_viewProjection);
+
+    // rigid transforms: the radius of the spheres does not change
+    float x[INSTANCE_BLOCK_SIZE];
+    float y[INSTANCE_BLOCK_SIZE];
+    float z[INSTANCE_BLOCK_SIZE];
+    float radius[INSTANCE_BLOCK_SIZE];
+    uint8_t visibility[INSTANCE_BLOCK_SIZE];
+    std::fill(radius, radius + INSTANCE_BLOCK_SIZE, _radius);
+
+    for(size_t first = 0; first < _count; first += INSTANCE_BLOCK_SIZE)
+    {
+        const size_t count = std::min(INSTANCE_BLOCK_SIZE, _count - first);
+        for(size_t i = 0; i < count; i++)
+        {
+            const glm::vec3 center = transformInstancePoint(_instances[first + i], _center);
+            x[i] = center.x;
+            y[i] = center.y;
+            z[i] = center.z;
+        }
+
+        frustum.classifySpheres(x, y, z, radius, count, visibility);
+
+        for(size_t i = 0; i < count; i++)
+            if(visibility[i] != qgltoolkit::Frustum::OUTSIDE)
+                _visible.push_back(_instances[first + i]);
+    }
+}
@@ -0,0 +1,90 @@
+/*********************************************************************************************************************
+ *
+ * instancing.h
+ *
+ * Transforms of the instances of a mesh drawn several times, and their culling
+ *
+ * QGL_toolkit demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#ifndef INSTANCING_H
+#define INSTANCING_H
+
+#include <vector>
+#include <cstddef>
+
+
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+
+
+/*!
+* \struct InstanceTransform
+* \brief Rigid transform of an instance, as read by the vertex shader (8 floats per instance instead of a mat4):
+* p' = rotate(rotation, p) + translation
+*/
+struct InstanceTransform
+{
+    glm::vec4 rotation;         /*!< unit quaternion (x, y, z, w), as in qgltoolkit::Quaternion */
+    glm::vec4 translation;      /*!< xyz: translation, w unused */
+};
+
+
+/*!
+* \fn makeInstanceTransform
+* \brief Returns the transform of a qgltoolkit::Frame, from its position() and orientation().
+* (templated on the quaternion type, so that the Qt free code does not depend on QGLtoolkit)
+* \param _position : position of the frame
+* \param _orientation : orientation of the frame (qgltoolkit::Quaternion, [0..3] are x, y, z and w)
+*/
+template<typename QuaternionType>
+inline InstanceTransform makeInstanceTransform(const glm::vec3 &_position, const QuaternionType &_orientation)
+{
+    InstanceTransform transform;
+    transform.rotation = glm::vec4((float)_orientation[0], (float)_orientation[1], (float)_orientation[2], (float)_orientation[3]);
+    transform.translation = glm::vec4(_position, 0.0f);
+    return transform;
+}
+
+/*!
+* \fn transformInstancePoint
+* \brief Returns the image of a point of the mesh by the transform of an instance
+*/
+inline glm::vec3 transformInstancePoint(const InstanceTransform &_transform, const glm::vec3 &_point)
+{
+    // v + 2 q.xyz x (q.xyz x v + w v), as in the vertex shader
+    const glm::vec3 q(_transform.rotation.x, _transform.rotation.y, _transform.rotation.z);
+    return _point + 2.0f * glm::cross(q, glm::cross(q, _point) + _transform.rotation.w * _point) + glm::vec3(_transform.translation);
+}
+
+
+/*!
+* \fn computeInstancesBoundingSphere
+* \brief Compute a sphere containing all the instances of a mesh
+* \param _instances : transforms of the instances
+* \param _count : number of instances
+* \param _center : center of the bounding sphere of the mesh
+* \param _radius : radius of the bounding sphere of the mesh
+* \param _instancesCenter : output center of the sphere of the instances
+* \param _instancesRadius : output radius of the sphere of the instances (0 if there is no instance)
+*/
+void computeInstancesBoundingSphere(const InstanceTransform *_instances, size_t _count, const glm::vec3 &_center, float _radius,
+                                    glm::vec3 &_instancesCenter, float &_instancesRadius);
+
+/*!
+* \fn cullInstances
+* \brief Copy the transforms of the instances whose bounding sphere is in the view frustum.
+* Spheres are transformed and tested by blocks (see Frustum::classifySpheres()).
+* \param _instances : transforms of the instances
+* \param _count : number of instances
+* \param _center : center of the bounding sphere of the mesh
+* \param _radius : radius of the bounding sphere of the mesh
+* \param _viewProjection : view-projection matrix
+* \param _visible : output transforms of the visible instances, in the order of _instances
+*/
+void cullInstances(const InstanceTransform *_instances, size_t _count, const glm::vec3 &_center, float _radius,
+                   const glm::mat4 &_viewProjection, std::vector<InstanceTransform> &_visible);
+
+#endif // INSTANCING_H
@@ -0,0 +1,98 @@
+/*********************************************************************************************************************
+ *
+ * mappedfile.h
+ *
+ * Read-only memory-mapped file
+ *
+ * QGL_toolkit demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <string>
+#include <cstddef>
+
+
+/*!
+* \class MappedFile
+* \brief Maps the whole content of a file in memory (read-only).
+* Pages are loaded by the OS on first access, so reading a mapped file
+* does not copy it into an intermediate buffer.
+*/
+class MappedFile
+{
+    public:
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                        CONSTRUCTORS / DESTRUCTORS                                           |
+        +------------------------------------------------------------------------------------------------------------*/
+
+        /*!
+        * \fn MappedFile
+        * \brief Default constructor of MappedFile
+        */
+        MappedFile();
+
+        /*!
+        * \fn ~MappedFile
+        * \brief Destructor of MappedFile, unmaps the file
+        */
+        ~MappedFile();
+
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                              GETTERS/SETTERS                                                |
+        +-------------------------------------------------------------------------------------------------------------*/
+
+        /*! \fn isOpen */
+        bool isOpen() const { return m_data != nullptr; }
+
+        /*! \fn data */
+        const char *data() const { return m_data; }
+
+        /*! \fn size */
+        size_t size() const { return m_size; }
+
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                                   MISC.                                                     |
+        +-------------------------------------------------------------------------------------------------------------*/
+
+        /*!
+        * \fn open
+        * \brief Map a file in memory (a previously mapped file is unmapped)
+        * \param _filename : name of the file to map
+        * \return false if the file could not be mapped (empty files cannot be mapped)
+        */
+        bool open(const std::string &_filename);
+
+        /*!
+        * \fn close
+        * \brief Unmap the file
+        */
+        void close();
+
+
+    private:
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                                ATTRIBUTES                                                   |
+        +------------------------------------------------------------------------------------------------------------*/
+
+        const char *m_data;             /*!< address of the mapped file, nullptr if not mapped */
+        size_t m_size;                  /*!< size of the mapped file (in bytes) */
+
+#ifdef _WIN32
+        void *m_file;                   /*!< file handle */
+        void *m_mapping;                /*!< file mapping handle */
+#endif
+
+        // Copy constructor and operator= are declared private and undefined
+        MappedFile(const MappedFile &);
+        MappedFile &operator=(const MappedFile &);
+};
+
+#endif // MAPPEDFILE_H
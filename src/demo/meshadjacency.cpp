@@ -0,0 +1,141 @@
+/*********************************************************************************************************************
+ *
+ * meshadjacency.cpp
+ *
+ * Vertex to face adjacency of indexed triangle meshes (compressed sparse row)
+ *
+ * QGL_toolkit demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#include <algorithm>
+#include <atomic>
+
+
+#include "meshadjacency.h"
+#include "threadpool.h"
+
+
+namespace
+{
+    // Number of elements processed by a task of the parallel loops
+    const size_t BLOCK_SIZE = 1 << 16;
+
+    inline size_t numBlocks(size_t _size)
+    {
+        return (_size + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    }
+
+    /*!
+    * \struct SerialCounter
+    * \brief Counter with the interface of std::atomic<uint32_t>, used when the adjacency is built 
+    * by a single thread (atomic increments are several times slower than plain ones)
+    */
+    struct SerialCounter
+    {
+        uint32_t value = 0;
+
+        uint32_t fetch_add(uint32_t _n, std::memory_order) { uint32_t old = value; value += _n; return old; }
+        uint32_t load(std::memory_order) const { return value; }
+        void store(uint32_t _value, std::memory_order) { value = _value; }
+    };
+
+    /*!
+    * \fn buildRows
+    * \brief Build the adjacency using a counter of type Counter per vertex
+    */
+    template <typename Counter>
+    void buildRows(const uint32_t *_indices, size_t _nbIndices, size_t _nbVertices,
+                   VertexAdjacency &_adjacency, ThreadPool &_pool)
+    {
+        // 1. Count the corners of each vertex
+        // (value-initialized counters are zero)
+        std::vector<Counter> cursors(_nbVertices);
+        _pool.run(numBlocks(_nbIndices), [&](size_t b)
+        {
+            const size_t end = std::min(_nbIndices, (b + 1) * BLOCK_SIZE);
+            for (size_t c = b * BLOCK_SIZE; c < end; c++)
+                cursors[_indices[c]].fetch_add(1, std::memory_order_relaxed);
+        });
+
+        // 2. Exclusive prefix sum of the counts: sums of the blocks, then local sums shifted by the previous blocks
+        const size_t nbVertexBlocks = numBlocks(_nbVertices);
+        std::vector<uint32_t> blockOffsets(nbVertexBlocks + 1, 0);
+        _pool.run(nbVertexBlocks, [&](size_t b)
+        {
+            const size_t end = std::min(_nbVertices, (b + 1) * BLOCK_SIZE);
+            uint32_t sum = 0;
+            for (size_t v = b * BLOCK_SIZE; v < end; v++)
+                sum += cursors[v].load(std::memory_order_relaxed);
+            blockOffsets[b + 1] = sum;
+        });
+        for (size_t b = 0; b < nbVertexBlocks; b++)
+            blockOffsets[b + 1] += blockOffsets[b];
+
+        _pool.run(nbVertexBlocks, [&](size_t b)
+        {
+            const size_t end = std::min(_nbVertices, (b + 1) * BLOCK_SIZE);
+            uint32_t offset = blockOffsets[b];
+            for (size_t v = b * BLOCK_SIZE; v < end; v++)
+            {
+                _adjacency.offsets[v] = offset;
+                offset += cursors[v].load(std::memory_order_relaxed);
+                // the counter becomes the insertion cursor of the vertex
+                cursors[v].store(_adjacency.offsets[v], std::memory_order_relaxed);
+            }
+        });
+        _adjacency.offsets[_nbVertices] = static_cast<uint32_t>(_nbIndices);
+
+        // 3. Fill the rows (in any order, threads compete for the slots)
+        _pool.run(numBlocks(_nbIndices), [&](size_t b)
+        {
+            const size_t end = std::min(_nbIndices, (b + 1) * BLOCK_SIZE);
+            for (size_t c = b * BLOCK_SIZE; c < end; c++)
+                _adjacency.corners[ cursors[_indices[c]].fetch_add(1, std::memory_order_relaxed) ] = static_cast<uint32_t>(c);
+        });
+
+        // 4. Sort each row, so that the adjacency is deterministic
+        // (rows are short: insertion sort, except for high valence vertices).
+        // Rows filled by a single thread are already sorted.
+        if (_pool.size() == 1)
+            return;
+
+        _pool.run(nbVertexBlocks, [&](size_t b)
+        {
+            const size_t end = std::min(_nbVertices, (b + 1) * BLOCK_SIZE);
+            for (size_t v = b * BLOCK_SIZE; v < end; v++)
+            {
+                uint32_t *first = _adjacency.corners.data() + _adjacency.offsets[v];
+                uint32_t *last = _adjacency.corners.data() + _adjacency.offsets[v + 1];
+                if (last - first > 32)
+                {
+                    std::sort(first, last);
+                    continue;
+                }
+                for (uint32_t *i = first + 1; i < last; i++)
+                {
+                    const uint32_t corner = *i;
+                    uint32_t *j = i;
+                    for (; j > first && *(j - 1) > corner; j--)
+                        *j = *(j - 1);
+                    *j = corner;
+                }
+            }
+        });
+    }
+
+} // anonymous namespace
+
+
+void buildVertexAdjacency(const uint32_t *_indices, size_t _nbIndices, size_t _nbVertices,
+                          VertexAdjacency &_adjacency, ThreadPool &_pool)
+{
+    _adjacency.offsets.assign(_nbVertices + 1, 0);
+    _adjacency.corners.resize(_nbIndices);
+
+    if (_pool.size() == 1)
+        buildRows<SerialCounter>(_indices, _nbIndices, _nbVertices, _adjacency, _pool);
+    else
+        buildRows< std::atomic<uint32_t> >(_indices, _nbIndices, _nbVertices, _adjacency, _pool);
+}
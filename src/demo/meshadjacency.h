@@ -0,0 +1,62 @@
+/*********************************************************************************************************************
+ *
+ * meshadjacency.h
+ *
+ * Vertex to face adjacency of indexed triangle meshes (compressed sparse row)
+ *
+ * QGL_toolkit demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#ifndef MESHADJACENCY_H
+#define MESHADJACENCY_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+
+class ThreadPool;
+
+
+/*!
+* \struct VertexAdjacency
+* \brief Faces around each vertex, stored as compressed sparse rows:
+* the corners of vertex v are corners[offsets[v]] ... corners[offsets[v + 1] - 1].
+* A corner c is the position c in the index array, i.e. vertex (c % 3) of face (c / 3).
+* Corners of a vertex are sorted in increasing order, so results do not depend on the build threads.
+*/
+struct VertexAdjacency
+{
+    std::vector<uint32_t> offsets;      /*!< first corner of each vertex (size: number of vertices + 1) */
+    std::vector<uint32_t> corners;      /*!< corners of all vertices (size: number of indices) */
+
+    /*! \fn numVertices */
+    size_t numVertices() const { return offsets.empty() ? 0 : offsets.size() - 1; }
+
+    /*! \fn degree \brief Number of faces around vertex _v */
+    uint32_t degree(size_t _v) const { return offsets[_v + 1] - offsets[_v]; }
+
+    /*! \fn begin \brief First corner of vertex _v */
+    const uint32_t *begin(size_t _v) const { return corners.data() + offsets[_v]; }
+
+    /*! \fn end \brief Past the last corner of vertex _v */
+    const uint32_t *end(size_t _v) const { return corners.data() + offsets[_v + 1]; }
+};
+
+
+/*!
+* \fn buildVertexAdjacency
+* \brief Build the vertex to face adjacency of a triangle mesh, in parallel
+* (counting, prefix sum and fill steps, each one split over the threads of _pool)
+* \param _indices : vertex indices, 3 per face (must all be lower than _nbVertices)
+* \param _nbIndices : number of indices (multiple of 3, lower than 2^32)
+* \param _nbVertices : number of vertices
+* \param _adjacency : output adjacency
+* \param _pool : threads used to build the adjacency
+*/
+void buildVertexAdjacency(const uint32_t *_indices, size_t _nbIndices, size_t _nbVertices,
+                          VertexAdjacency &_adjacency, ThreadPool &_pool);
+
+#endif // MESHADJACENCY_H
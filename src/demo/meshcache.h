@@ -0,0 +1,87 @@
+/*********************************************************************************************************************
+ *
+ * meshcache.h
+ *
+ * Binary mesh cache file format
+ *
+ * QGL_toolkit demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#ifndef MESHCACHE_H
+#define MESHCACHE_H
+
+#include <cstdint>
+#include <cstddef>
+
+
+// Extension appended to the name of the source file to get the name of its cache
+#define MESH_CACHE_EXTENSION ".qglmesh"
+
+// Magic number at the beginning of cache files
+#define MESH_CACHE_MAGIC "QGLMESH"
+
+// Version of the format, to increment when the layout changes
+const uint32_t MESH_CACHE_VERSION = 4;
+
+// Value written in the header to detect files written with a different endianness
+const uint32_t MESH_CACHE_ENDIAN_TAG = 0x01020304;
+
+// Flags of MeshCacheHeader::flags
+const uint32_t MESH_CACHE_OPTIMIZED_INDICES = 1;    // indices and vertices were reordered by TriMesh::optimizeIndexOrder()
+const uint32_t MESH_CACHE_VALIDATED_INDICES = 2;    // all the indices were checked to be less than numVertices when the cache was written
+
+// Alignment (in bytes) of the data sections in the file
+const uint64_t MESH_CACHE_ALIGNMENT = 64;
+
+
+/*!
+* \struct MeshCacheHeader
+* \brief Header of a binary mesh cache file.
+* The header is followed by the positions (glm::vec3), normals (glm::vec3),
+* texcoords (glm::vec2), indices (uint32_t) and meshlets (Meshlet) sections, each of them starting
+* at an offset aligned on MESH_CACHE_ALIGNMENT bytes, so they can be used
+* directly from a memory-mapped file.
+* The size and modification time of the source file are stored to detect outdated caches,
+* and the flags to detect caches written with other import options.
+* Indices are checked once by TriMesh::writeMeshCache(), not each time the cache is read.
+*/
+struct MeshCacheHeader
+{
+    char magic[8];                  /*!< MESH_CACHE_MAGIC */
+    uint32_t version;               /*!< MESH_CACHE_VERSION */
+    uint32_t endianTag;             /*!< MESH_CACHE_ENDIAN_TAG */
+    uint32_t flags;                 /*!< MESH_CACHE_OPTIMIZED_INDICES, MESH_CACHE_VALIDATED_INDICES */
+    uint32_t padding;               /*!< unused, 0 */
+
+    uint64_t sourceSize;            /*!< size of the source file (in bytes) */
+    int64_t sourceTime;             /*!< modification time of the source file */
+
+    uint64_t numVertices;           /*!< number of positions */
+    uint64_t numNormals;            /*!< number of normals */
+    uint64_t numTexcoords;          /*!< number of texcoords */
+    uint64_t numIndices;            /*!< number of indices */
+    uint64_t numMeshlets;           /*!< number of meshlets (0 if the indices are not grouped in meshlets) */
+
+    uint64_t verticesOffset;        /*!< offset of the positions section (in bytes, from the beginning of the file) */
+    uint64_t normalsOffset;         /*!< offset of the normals section */
+    uint64_t texcoordsOffset;       /*!< offset of the texcoords section */
+    uint64_t indicesOffset;         /*!< offset of the indices section */
+    uint64_t meshletsOffset;        /*!< offset of the meshlets section */
+
+    float bBoxMin[3];               /*!< min corner of the AABB */
+    float bBoxMax[3];               /*!< max corner of the AABB */
+};
+
+
+/*!
+* \fn alignMeshCacheOffset
+* \brief Round up an offset to the next multiple of MESH_CACHE_ALIGNMENT
+*/
+inline uint64_t alignMeshCacheOffset(uint64_t _offset)
+{
+    return (_offset + MESH_CACHE_ALIGNMENT - 1) / MESH_CACHE_ALIGNMENT * MESH_CACHE_ALIGNMENT;
+}
+
+#endif // MESHCACHE_H
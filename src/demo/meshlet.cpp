@@ -0,0 +1,400 @@
+/*********************************************************************************************************************
+ *
+ * meshlet.cpp
+ *
+ * Clusters of triangles (meshlets) with bounding sphere and normal cone, and their culling
+ *
+ * QGL_toolkit demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+
+#include "meshlet.h"
+#include "meshadjacency.h"
+#include "indexoptimizer.h"
+#include "threadpool.h"
+#include "trace.h"
+#include "QGLtoolkit/frustum.h"
+
+
+namespace
+{
+    // Number of triangles processed by a task (meshlets do not cross blocks)
+    const size_t BLOCK_SIZE = 1 << 16;
+
+    const uint32_t NO_VERTEX = 0xffffffff;
+    const uint32_t NO_MESHLET = 0xffffffff;
+
+    // Number of slots of the vertex set of a meshlet (power of 2, at least twice MESHLET_MAX_VERTICES)
+    const uint32_t VERTEX_SET_SIZE = 128;
+    const unsigned int VERTEX_SET_SHIFT = 25;
+
+    // Number of bounding spheres copied on the stack and tested at once by cullMeshlets()
+    const size_t CULL_CHUNK_SIZE = 256;
+
+
+    // Number of tasks needed to process _nbTriangles
+    inline size_t numBlocks(size_t _nbTriangles)
+    {
+        return (_nbTriangles + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    }
+
+
+    /*!
+    * \class VertexSet
+    * \brief Vertices of the meshlet being built (open addressing hash set, cleared for each meshlet)
+    */
+    class VertexSet
+    {
+        public:
+
+            VertexSet() { clear(); }
+
+            void clear()
+            {
+                std::fill(m_slots, m_slots + VERTEX_SET_SIZE, NO_VERTEX);
+                m_size = 0;
+            }
+
+            size_t size() const { return m_size; }
+
+            bool contains(uint32_t _v) const { return m_slots[slot(_v)] == _v; }
+
+            // Local index of _v (lower than VERTEX_SET_SIZE), _v must be in the set
+            uint32_t localIndex(uint32_t _v) const { return slot(_v); }
+
+            // Vertex of a local index
+            uint32_t vertex(uint32_t _localIndex) const { return m_slots[_localIndex]; }
+
+            // Returns true if _v was not in the set
+            bool insert(uint32_t _v)
+            {
+                const uint32_t s = slot(_v);
+                if(m_slots[s] == _v)
+                    return false;
+
+                m_slots[s] = _v;
+                m_size++;
+                return true;
+            }
+
+        private:
+
+            // Slot of _v, or first empty slot after its hash
+            uint32_t slot(uint32_t _v) const
+            {
+                uint32_t s = (_v * 2654435761u) >> VERTEX_SET_SHIFT;
+                while(m_slots[s] != _v && m_slots[s] != NO_VERTEX)
+                    s = (s + 1) & (VERTEX_SET_SIZE - 1);
+                return s;
+            }
+
+            uint32_t m_slots[VERTEX_SET_SIZE];
+            size_t m_size;
+    };
+
+
+    // Bounding sphere and normal cone of the triangles _indices[0 .. _count - 1]
+    void computeMeshletBounds(const uint32_t *_indices, size_t _count, const glm::vec3 *_vertices, Meshlet &_meshlet)
+    {
+        // sphere around the bounding box
+        glm::vec3 bBoxMin(std::numeric_limits<float>::max());
+        glm::vec3 bBoxMax(-std::numeric_limits<float>::max());
+        for(size_t i = 0; i < _count; i++)
+        {
+            bBoxMin = glm::min(bBoxMin, _vertices[_indices[i]]);
+            bBoxMax = glm::max(bBoxMax, _vertices[_indices[i]]);
+        }
+
+        _meshlet.center = 0.5f * (bBoxMin + bBoxMax);
+        float radius2 = 0.0f;
+        for(size_t i = 0; i < _count; i++)
+        {
+            const glm::vec3 d = _vertices[_indices[i]] - _meshlet.center;
+            radius2 = std::max(radius2, glm::dot(d, d));
+        }
+        _meshlet.radius = std::sqrt(radius2);
+
+        // cone around the average of the unit normals (degenerate triangles are never visible)
+        glm::vec3 axis(0.0f);
+        for(size_t i = 0; i + 2 < _count; i += 3)
+        {
+            const glm::vec3 &a = _vertices[_indices[i]];
+            const glm::vec3 n = glm::cross(_vertices[_indices[i + 1]] - a, _vertices[_indices[i + 2]] - a);
+            const float length = glm::length(n);
+            if(length > 0.0f)
+                axis += n / length;
+        }
+
+        const float axisLength = glm::length(axis);
+        _meshlet.coneAxis = (axisLength > 0.0f) ? axis / axisLength : glm::vec3(0.0f, 0.0f, 1.0f);
+        _meshlet.coneCutoff = 1.0f;
+        if(!(axisLength > 0.0f))
+            return;
+
+        float minDot = 1.0f;
+        for(size_t i = 0; i + 2 < _count; i += 3)
+        {
+            const glm::vec3 &a = _vertices[_indices[i]];
+            const glm::vec3 n = glm::cross(_vertices[_indices[i + 1]] - a, _vertices[_indices[i + 2]] - a);
+            const float length = glm::length(n);
+            if(length > 0.0f)
+                minDot = std::min(minDot, glm::dot(n, _meshlet.coneAxis) / length);
+        }
+
+        // normals spread over more than a hemisphere: some triangles always face the camera
+        if(minDot > 0.0f)
+            _meshlet.coneCutoff = std::sqrt(std::max(0.0f, 1.0f - minDot * minDot));
+    }
+
+} // anonymous namespace
+
+
+void buildMeshlets(uint32_t *_indices, size_t _nbIndices, const glm::vec3 *_vertices, size_t _nbVertices,
+                   std::vector<Meshlet> &_meshlets, ThreadPool &_pool)
+{
+    QGL_TRACE_SCOPE("buildMeshlets");
+    _meshlets.clear();
+
+    const size_t nbTriangles = _nbIndices / 3;
+    if(nbTriangles == 0)
+        return;
+
+    VertexAdjacency adjacency;
+    buildVertexAdjacency(_indices, nbTriangles * 3, _nbVertices, adjacency, _pool);
+
+    std::vector<uint32_t> reordered(nbTriangles * 3);
+    std::vector< std::vector<Meshlet> > blockMeshlets(numBlocks(nbTriangles));
+
+    _pool.run(blockMeshlets.size(), [&](size_t _b)
+    {
+        const size_t f0 = _b * BLOCK_SIZE;
+        const size_t f1 = std::min(nbTriangles, f0 + BLOCK_SIZE);
+
+        std::vector<uint8_t> emitted(f1 - f0, 0);
+        std::vector<uint32_t> queued(f1 - f0, NO_MESHLET);     // last meshlet which had the triangle as candidate
+        std::vector<uint32_t> candidates;
+        VertexSet meshletVertices;
+
+        uint32_t *out = reordered.data() + f0 * 3;
+        size_t nbWritten = 0;
+        size_t seed = f0;
+        uint32_t meshletId = 0;
+
+        while(true)
+        {
+            // 1. next seed: among the triangles left around the previous meshlet, the one with the fewest
+            // free neighbors (so that fewer small islands are left behind), or the first triangle not emitted yet
+            size_t f = f1;
+            size_t fewestNeighbors = std::numeric_limits<size_t>::max();
+            for(size_t i = 0; i < candidates.size(); i++)
+            {
+                const size_t g = candidates[i];
+                if(emitted[g - f0])
+                    continue;
+
+                size_t nbNeighbors = 0;
+                for(unsigned int k = 0; k < 3; k++)
+                {
+                    const uint32_t v = _indices[3 * g + k];
+                    for(const uint32_t *c = adjacency.begin(v); c != adjacency.end(v); c++)
+                    {
+                        const size_t h = *c / 3;
+                        nbNeighbors += (h >= f0 && h < f1 && !emitted[h - f0]) ? 1 : 0;
+                    }
+                }
+                if(nbNeighbors < fewestNeighbors)
+                {
+                    f = g;
+                    fewestNeighbors = nbNeighbors;
+                }
+            }
+
+            while(seed < f1 && emitted[seed - f0])
+                seed++;
+            if(f == f1)
+                f = seed;
+            if(f == f1)
+                break;
+
+            meshletId++;
+            const size_t first = nbWritten;
+            meshletVertices.clear();
+            candidates.clear();
+            glm::vec3 centroidSum(0.0f);
+
+            while(true)
+            {
+                // 2. emit the triangle, its new vertices bring their triangles as candidates
+                emitted[f - f0] = 1;
+                for(unsigned int k = 0; k < 3; k++)
+                {
+                    const uint32_t v = _indices[3 * f + k];
+                    out[nbWritten++] = v;
+                    centroidSum += _vertices[v];
+
+                    if(!meshletVertices.insert(v))
+                        continue;
+
+                    for(const uint32_t *c = adjacency.begin(v); c != adjacency.end(v); c++)
+                    {
+                        const size_t g = *c / 3;
+                        if(g >= f0 && g < f1 && !emitted[g - f0] && queued[g - f0] != meshletId)
+                        {
+                            queued[g - f0] = meshletId;
+                            candidates.push_back(static_cast<uint32_t>(g));
+                        }
+                    }
+                }
+
+                if(nbWritten - first == 3 * MESHLET_MAX_TRIANGLES)
+                    break;
+
+                // 3. next triangle: fewest new vertices, then closest to the centroid of the meshlet
+                const glm::vec3 centroid = centroidSum / static_cast<float>(nbWritten - first);
+                size_t best = candidates.size();
+                unsigned int bestNew = 4;
+                float bestDistance = std::numeric_limits<float>::max();
+
+                size_t i = 0;
+                while(i < candidates.size())
+                {
+                    const size_t g = candidates[i];
+                    if(emitted[g - f0])
+                    {
+                        candidates[i] = candidates.back();
+                        candidates.pop_back();
+                        continue;
+                    }
+
+                    const uint32_t *tri = _indices + 3 * g;
+                    const unsigned int nbNew = (meshletVertices.contains(tri[0]) ? 0 : 1) +
+                                               (meshletVertices.contains(tri[1]) ? 0 : 1) +
+                                               (meshletVertices.contains(tri[2]) ? 0 : 1);
+                    if(meshletVertices.size() + nbNew > MESHLET_MAX_VERTICES || nbNew > bestNew)
+                    {
+                        i++;
+                        continue;
+                    }
+
+                    // closes a fan: cannot be beaten
+                    if(nbNew == 0)
+                    {
+                        best = i;
+                        break;
+                    }
+
+                    const glm::vec3 d = (_vertices[tri[0]] + _vertices[tri[1]] + _vertices[tri[2]]) * (1.0f / 3.0f) - centroid;
+                    const float distance = glm::dot(d, d);
+                    if(nbNew < bestNew || distance < bestDistance)
+                    {
+                        best = i;
+                        bestNew = nbNew;
+                        bestDistance = distance;
+                    }
+                    i++;
+                }
+
+                // no neighbor left (e.g. end of a connected component): the meshlet is done
+                if(best == candidates.size())
+                    break;
+
+                f = candidates[best];
+                candidates[best] = candidates.back();
+                candidates.pop_back();
+            }
+
+            // 4. triangle order of the meshlet for the vertex cache, with local vertex indices
+            const size_t count = nbWritten - first;
+            for(size_t i = first; i < nbWritten; i++)
+                out[i] = meshletVertices.localIndex(out[i]);
+            optimizeVertexCache(out + first, count, VERTEX_SET_SIZE);
+            for(size_t i = first; i < nbWritten; i++)
+                out[i] = meshletVertices.vertex(out[i]);
+
+            Meshlet meshlet;
+            meshlet.indexOffset = static_cast<uint32_t>(f0 * 3 + first);
+            meshlet.count = static_cast<uint32_t>(count);
+            computeMeshletBounds(out + first, count, _vertices, meshlet);
+            blockMeshlets[_b].push_back(meshlet);
+        }
+    });
+
+    std::memcpy(_indices, reordered.data(), reordered.size() * sizeof(uint32_t));
+
+    size_t nbMeshlets = 0;
+    for(size_t b = 0; b < blockMeshlets.size(); b++)
+        nbMeshlets += blockMeshlets[b].size();
+
+    _meshlets.reserve(nbMeshlets);
+    for(size_t b = 0; b < blockMeshlets.size(); b++)
+        _meshlets.insert(_meshlets.end(), blockMeshlets[b].begin(), blockMeshlets[b].end());
+}
+
+
+void cullMeshlets(const Meshlet *_meshlets, size_t _nbMeshlets, const glm::mat4 &_mvp, const glm::mat4 &_mv,
+                  bool _backfaceCulling, std::vector<uint32_t> &_visible)
+{
+    QGL_TRACE_SCOPE("cullMeshlets");
+    _visible.clear();
+
+    // planes of the frustum, in the coordinates of the mesh
+    const qgltoolkit::Frustum frustum(_mvp);
+
+    // camera position (perspective) or view direction (orthographic), in the coordinates of the mesh
+    const glm::mat4 view = glm::inverse(_mv);
+    const glm::vec3 eye(view[3]);
+    const glm::vec3 forward = -glm::normalize(glm::vec3(view[2]));
+    // the clip w of orthographic projections does not depend on the position
+    const bool perspective = (_mvp[0][3] != 0.0f || _mvp[1][3] != 0.0f || _mvp[2][3] != 0.0f);
+
+    // bounding spheres are copied in SoA layout by chunks, to be tested several at a time
+    float x[CULL_CHUNK_SIZE], y[CULL_CHUNK_SIZE], z[CULL_CHUNK_SIZE], radius[CULL_CHUNK_SIZE];
+    uint8_t visibility[CULL_CHUNK_SIZE];
+
+    for(size_t first = 0; first < _nbMeshlets; first += CULL_CHUNK_SIZE)
+    {
+        const size_t count = std::min(CULL_CHUNK_SIZE, _nbMeshlets - first);
+        for(size_t i = 0; i < count; i++)
+        {
+            const Meshlet &meshlet = _meshlets[first + i];
+            x[i] = meshlet.center.x;
+            y[i] = meshlet.center.y;
+            z[i] = meshlet.center.z;
+            radius[i] = meshlet.radius;
+        }
+        frustum.classifySpheres(x, y, z, radius, count, visibility);
+
+        for(size_t i = 0; i < count; i++)
+        {
+            if(visibility[i] == qgltoolkit::Frustum::OUTSIDE)
+                continue;
+
+            const size_t m = first + i;
+            const Meshlet &meshlet = _meshlets[m];
+
+            // all the normals of the cone point away from every point of the sphere seen from the camera
+            if(_backfaceCulling && meshlet.coneCutoff < 1.0f)
+            {
+                if(perspective)
+                {
+                    const glm::vec3 d = meshlet.center - eye;
+                    if(glm::dot(d, meshlet.coneAxis) >= meshlet.coneCutoff * glm::length(d) + meshlet.radius)
+                        continue;
+                }
+                else if(glm::dot(forward, meshlet.coneAxis) > meshlet.coneCutoff)
+                {
+                    continue;
+                }
+            }
+
+            _visible.push_back(static_cast<uint32_t>(m));
+        }
+    }
+}
@@ -0,0 +1,81 @@
+/*********************************************************************************************************************
+ *
+ * meshlet.h
+ *
+ * Clusters of triangles (meshlets) with bounding sphere and normal cone, and their culling
+ *
+ * QGL_toolkit demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#ifndef MESHLET_H
+#define MESHLET_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+
+
+class ThreadPool;
+
+
+// Max number of vertices and triangles of a meshlet
+const size_t MESHLET_MAX_VERTICES = 64;
+const size_t MESHLET_MAX_TRIANGLES = 124;
+
+
+/*!
+* \struct Meshlet
+* \brief Range of consecutive triangles of an index buffer, with the bounds used to cull it.
+* The layout is fixed: meshlets are stored as is in the mesh cache (see meshcache.h).
+*/
+struct Meshlet
+{
+    uint32_t indexOffset;       /*!< first index of the meshlet in the index buffer */
+    uint32_t count;             /*!< number of indices */
+    glm::vec3 center;           /*!< center of the bounding sphere */
+    float radius;               /*!< radius of the bounding sphere */
+    glm::vec3 coneAxis;         /*!< axis of the cone containing the normals of the triangles */
+    float coneCutoff;           /*!< sine of the half angle of the cone, 1 if the triangles cannot all be back facing */
+};
+
+
+/*!
+* \fn buildMeshlets
+* \brief Group the triangles of an index buffer into meshlets of at most MESHLET_MAX_VERTICES vertices
+* and MESHLET_MAX_TRIANGLES triangles, and reorder the triangles so that each meshlet is a range of the buffer.
+* A meshlet grows from a seed triangle, adding the neighbor triangle which brings the fewest new vertices
+* (then the closest one), so that meshlets are compact and keep the vertex cache locality of the buffer.
+* Seeds are taken around the previous meshlet, or in the order of the buffer, which is kept at a larger scale
+* (e.g. the order of optimizeOverdraw()). Then the triangles of each meshlet are reordered by optimizeVertexCache().
+* The buffer is split in blocks of triangles processed in parallel (the result does not depend on the threads).
+* \param _indices : vertex indices, 3 per triangle, reordered in place
+* \param _nbIndices : number of indices (lower than 2^32)
+* \param _vertices : vertex positions
+* \param _nbVertices : number of vertices
+* \param _meshlets : output meshlets, in the order of the buffer
+* \param _pool : threads used to build the meshlets
+*/
+void buildMeshlets(uint32_t *_indices, size_t _nbIndices, const glm::vec3 *_vertices, size_t _nbVertices,
+                   std::vector<Meshlet> &_meshlets, ThreadPool &_pool);
+
+/*!
+* \fn cullMeshlets
+* \brief Select the meshlets which intersect the view frustum (bounding sphere against the 6 planes),
+* and, if _backfaceCulling is true, which have at least one triangle facing the camera (normal cone).
+* \param _meshlets : meshlets
+* \param _nbMeshlets : number of meshlets
+* \param _mvp : modelview-projection matrix (perspective or orthographic projection)
+* \param _mv : modelview matrix (gives the position and direction of the camera)
+* \param _backfaceCulling : cull the meshlets whose triangles are all back facing
+* \param _visible : output, indices of the visible meshlets (in increasing order)
+*/
+void cullMeshlets(const Meshlet *_meshlets, size_t _nbMeshlets, const glm::mat4 &_mvp, const glm::mat4 &_mv,
+                  bool _backfaceCulling, std::vector<uint32_t> &_visible);
+
+#endif // MESHLET_H
@@ -0,0 +1,366 @@
+/*********************************************************************************************************************
+ *
+ * objparser.cpp
+ *
+ * Low-level tokenizer for Wavefront OBJ files
+ *
+ * QGL_toolkit demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <filesystem>
+
+
+#include "objparser.h"
+#include "compressedfile.h"
+#include "trace.h"
+
+
+namespace
+{
+    // Average size (in bytes) of the text of a vertex and of a face record, used to pre-size the arrays.
+    // A closed triangle mesh has about twice as many faces as vertices.
+    const size_t BYTES_PER_VERTEX = 80;
+    const size_t BYTES_PER_TRIANGLE = 40;
+
+    // Typical compression ratio of OBJ text, used to pre-size the arrays from the size of a compressed file
+    const size_t OBJ_COMPRESSION_RATIO = 4;
+
+    // Size of the blocks of decompressed text handed over from the decompression thread to the parser,
+    // and number of blocks in flight (memory use is bounded by their product)
+    const size_t DECOMPRESSED_BLOCK_SIZE = 4 << 20;
+    const size_t NB_DECOMPRESSED_BLOCKS = 3;
+
+
+    inline bool isBlank(char _c) { return _c == ' ' || _c == '\t' || _c == '\r'; }
+
+    inline const char *skipBlanks(const char *_p, const char *_end)
+    {
+        while (_p < _end && isBlank(*_p))
+            ++_p;
+        return _p;
+    }
+
+    // Parse a float and move _p after it. Missing or invalid values are read as 0,
+    // which is what the former std::istringstream based loader produced.
+    inline float parseFloat(const char *&_p, const char *_end)
+    {
+        _p = skipBlanks(_p, _end);
+        if (_p < _end && *_p == '+')
+            ++_p;
+
+        float value = 0.0f;
+        std::from_chars_result res = std::from_chars(_p, _end, value);
+        if (res.ec != std::errc())
+            return 0.0f;
+        _p = res.ptr;
+        return value;
+    }
+
+    // Parse an (optionally signed) integer and move _p after it, return false if there is none.
+    inline bool parseInt(const char *&_p, const char *_end, int &_value)
+    {
+        if (_p < _end && *_p == '+')
+            ++_p;
+
+        std::from_chars_result res = std::from_chars(_p, _end, _value);
+        if (res.ec != std::errc())
+            return false;
+        _p = res.ptr;
+        return true;
+    }
+
+    // Convert a relative OBJ index into a biased chunk-local one, given the number of records read so far in the chunk
+    inline int localIndex(int _index, size_t _count)
+    {
+        if (_index < 0)
+            return static_cast<int>(_count) + _index - OBJ_RELATIVE_INDEX_BIAS;
+        return _index;
+    }
+
+    // Parse a face corner "v", "v/t", "v//n" or "v/t/n" and return its syntax
+    // as a bit mask (1: texcoord, 2: normal), or -1 if it is invalid.
+    inline int parseCorner(const char *&_p, const char *_end, glm::ivec3 &_corner)
+    {
+        int syntax = 0;
+        _corner = glm::ivec3(0, 0, 0);
+
+        if (!parseInt(_p, _end, _corner.x) || _corner.x == 0)
+            return -1;
+
+        if (_p < _end && *_p == '/')
+        {
+            ++_p;
+            if (_p < _end && *_p != '/')
+            {
+                if (!parseInt(_p, _end, _corner.y) || _corner.y == 0)
+                    return -1;
+                syntax |= 1;
+            }
+            if (_p < _end && *_p == '/')
+            {
+                ++_p;
+                if (!parseInt(_p, _end, _corner.z) || _corner.z == 0)
+                    return -1;
+                syntax |= 2;
+            }
+            else if (syntax == 0)
+            {
+                return -1;
+            }
+        }
+
+        // a corner must be followed by a blank or by the end of the line
+        if (_p < _end && !isBlank(*_p))
+            return -1;
+
+        return syntax;
+    }
+
+
+    /*!
+    * \class BlockQueue
+    * \brief FIFO of text blocks exchanged between the decompression thread and the parser
+    */
+    class BlockQueue
+    {
+        public:
+
+            void push(std::vector<char> &&_block)
+            {
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    m_blocks.push_back( std::move(_block) );
+                }
+                m_notEmpty.notify_one();
+            }
+
+            std::vector<char> pop()
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_notEmpty.wait(lock, [this]() { return !m_blocks.empty(); });
+                std::vector<char> block = std::move( m_blocks.front() );
+                m_blocks.pop_front();
+                return block;
+            }
+
+        private:
+
+            std::mutex m_mutex;
+            std::condition_variable m_notEmpty;
+            std::deque< std::vector<char> > m_blocks;
+    };
+
+} // anonymous namespace
+
+
+void ObjChunk::reserve(size_t _nbBytes)
+{
+    positions.reserve(_nbBytes / BYTES_PER_VERTEX);
+    corners.reserve(3 * (_nbBytes / BYTES_PER_TRIANGLE));
+}
+
+
+void ObjChunk::clear()
+{
+    positions.clear();
+    normals.clear();
+    texcoords.clear();
+    corners.clear();
+}
+
+
+bool readOBJFile(const std::string &_filename, std::vector<char> &_buffer)
+{
+    QGL_TRACE_SCOPE("readOBJFile");
+    std::ifstream f(_filename.c_str(), std::ios::in | std::ios::binary | std::ios::ate);
+    if (!f.is_open())
+        return false;
+
+    const std::streamsize size = f.tellg();
+    if (size < 0)
+        return false;
+
+    _buffer.resize(static_cast<size_t>(size));
+    f.seekg(0, std::ios::beg);
+    if (size > 0 && !f.read(_buffer.data(), size))
+        return false;
+
+    return true;
+}
+
+
+void parseOBJChunk(const char *_begin, const char *_end, ObjChunk &_chunk)
+{
+    QGL_TRACE_SCOPE("parseOBJChunk");
+    glm::ivec3 corners[3];
+
+    const char *p = _begin;
+    while (p < _end)
+    {
+        const char *lineEnd = static_cast<const char*>( std::memchr(p, '\n', _end - p) );
+        if (lineEnd == nullptr)
+            lineEnd = _end;
+
+        const char *c = p;
+        p = lineEnd + 1;
+
+        if (lineEnd - c < 2)
+            continue;
+
+        if (c[0] == 'v')
+        {
+            if (isBlank(c[1]))
+            {
+                c += 2;
+                glm::vec3 vertex;
+                vertex.x = parseFloat(c, lineEnd);
+                vertex.y = parseFloat(c, lineEnd);
+                vertex.z = parseFloat(c, lineEnd);
+                _chunk.positions.push_back(vertex);
+            }
+            else if (c[1] == 't' && lineEnd - c > 2 && isBlank(c[2]))
+            {
+                if (_chunk.texcoords.capacity() == 0)
+                    _chunk.texcoords.reserve(_chunk.positions.capacity());
+
+                c += 3;
+                glm::vec2 texcoord;
+                texcoord.x = parseFloat(c, lineEnd);
+                texcoord.y = parseFloat(c, lineEnd);
+                _chunk.texcoords.push_back(texcoord);
+            }
+            else if (c[1] == 'n' && lineEnd - c > 2 && isBlank(c[2]))
+            {
+                if (_chunk.normals.capacity() == 0)
+                    _chunk.normals.reserve(_chunk.positions.capacity());
+
+                c += 3;
+                glm::vec3 normal;
+                normal.x = parseFloat(c, lineEnd);
+                normal.y = parseFloat(c, lineEnd);
+                normal.z = parseFloat(c, lineEnd);
+                _chunk.normals.push_back(normal);
+            }
+        }
+        else if (c[0] == 'f' && isBlank(c[1]))
+        {
+            c += 2;
+
+            int syntax = -1;
+            bool valid = true;
+            for (unsigned int i = 0; i < 3 && valid; ++i)
+            {
+                c = skipBlanks(c, lineEnd);
+                int cornerSyntax = parseCorner(c, lineEnd, corners[i]);
+                valid = (cornerSyntax >= 0) && (i == 0 || cornerSyntax == syntax);
+                syntax = cornerSyntax;
+            }
+            if (!valid)
+                continue;
+
+            for (unsigned int i = 0; i < 3; ++i)
+            {
+                _chunk.corners.push_back( glm::ivec3( localIndex(corners[i].x, _chunk.positions.size()),
+                                                      localIndex(corners[i].y, _chunk.texcoords.size()),
+                                                      localIndex(corners[i].z, _chunk.normals.size()) ) );
+            }
+        }
+    }
+}
+
+
+bool parseCompressedOBJFile(const std::string &_filename, ObjChunk &_chunk)
+{
+    QGL_TRACE_SCOPE("parseCompressedOBJFile");
+    CompressedFileReader reader;
+    if (!reader.open(_filename))
+        return false;
+
+    std::error_code ec;
+    const uintmax_t compressedSize = std::filesystem::file_size(_filename, ec);
+    if (!ec)
+        _chunk.reserve( static_cast<size_t>(compressedSize) * OBJ_COMPRESSION_RATIO );
+
+    // blocks circulate between the two threads: freeBlocks -> decompression -> fullBlocks -> parsing -> freeBlocks
+    BlockQueue freeBlocks, fullBlocks;
+    for (size_t i = 0; i < NB_DECOMPRESSED_BLOCKS; i++)
+        freeBlocks.push( std::vector<char>() );
+
+    // producer: decompress the file into blocks ending on a line break
+    std::thread decompression([&]()
+    {
+        std::vector<char> tail;     // incomplete line at the end of the previous block
+        bool eof = false;
+        while (!eof)
+        {
+            std::vector<char> block = freeBlocks.pop();
+            block.assign(tail.begin(), tail.end());
+            size_t used = tail.size();
+            block.resize( std::max(DECOMPRESSED_BLOCK_SIZE, 2 * used) );
+
+            size_t lineEnd = 0;
+            while (true)
+            {
+                while (used < block.size())
+                {
+                    size_t nbRead = reader.read(block.data() + used, block.size() - used);
+                    if (nbRead == 0)
+                    {
+                        eof = true;
+                        break;
+                    }
+                    used += nbRead;
+                }
+
+                if (eof)
+                {
+                    lineEnd = used;
+                    break;
+                }
+
+                lineEnd = used;
+                while (lineEnd > 0 && block[lineEnd - 1] != '\n')
+                    lineEnd--;
+                if (lineEnd > 0)
+                    break;
+
+                // no line break in the whole block: the line is longer than a block
+                block.resize(2 * block.size());
+            }
+
+            tail.assign(block.begin() + lineEnd, block.begin() + used);
+            block.resize(lineEnd);
+            if (!block.empty())
+                fullBlocks.push( std::move(block) );
+        }
+
+        // empty block: end of file
+        fullBlocks.push( std::vector<char>() );
+    });
+
+    // consumer: parse the blocks in order, in a single ObjChunk so relative indices span block boundaries
+    while (true)
+    {
+        std::vector<char> block = fullBlocks.pop();
+        if (block.empty())
+            break;
+
+        parseOBJChunk(block.data(), block.data() + block.size(), _chunk);
+        freeBlocks.push( std::move(block) );
+    }
+
+    decompression.join();
+
+    return !reader.hasError();
+}
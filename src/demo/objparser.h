@@ -0,0 +1,106 @@
+/*********************************************************************************************************************
+ *
+ * objparser.h
+ *
+ * Low-level tokenizer for Wavefront OBJ files
+ *
+ * QGL_toolkit demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#ifndef OBJPARSER_H
+#define OBJPARSER_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+
+
+// Offset applied to chunk-local indices coming from relative OBJ indices
+const int OBJ_RELATIVE_INDEX_BIAS = 1 << 30;
+
+
+/*!
+* \struct ObjChunk
+* \brief Raw records read from a range of an OBJ file.
+* Face corners are stored as (v, vt, vn) OBJ indices, with 0 for a missing attribute.
+* Positive indices are absolute (1-based, as in the file). Relative (negative) indices
+* are resolved against the records of the chunk and stored as (local index - OBJ_RELATIVE_INDEX_BIAS),
+* so that they can be made absolute once the number of records preceding the chunk is known
+* (see resolveOBJIndex()).
+*/
+struct ObjChunk
+{
+    std::vector<glm::vec3> positions;       /*!< "v" records */
+    std::vector<glm::vec3> normals;         /*!< "vn" records */
+    std::vector<glm::vec2> texcoords;       /*!< "vt" records */
+    std::vector<glm::ivec3> corners;        /*!< face corners, 3 per triangle */
+
+    /*!
+    * \fn reserve
+    * \brief Pre-allocate arrays from the size of the text to parse
+    * \param _nbBytes : size of the text (in bytes)
+    */
+    void reserve(size_t _nbBytes);
+
+    /*!
+    * \fn clear
+    * \brief Clear all the arrays
+    */
+    void clear();
+};
+
+
+/*!
+* \fn readOBJFile
+* \brief Read the whole content of a file in a buffer, with a single read
+* \param _filename : name of the file to read
+* \param _buffer : buffer to fill
+* \return false if the file could not be read
+*/
+bool readOBJFile(const std::string &_filename, std::vector<char> &_buffer);
+
+/*!
+* \fn parseOBJChunk
+* \brief Tokenize the OBJ records contained in [_begin, _end) and append them to _chunk.
+* Only "v", "vt", "vn" and triangular "f" records are read (in all four face syntaxes
+* "f v", "f v/t", "f v//n" and "f v/t/n"), other lines are ignored.
+* Same as the former loader, only the first three corners of a polygon are kept,
+* and faces whose corners do not share the same syntax are skipped.
+* \param _begin, _end : range of text to parse
+* \param _chunk : output records
+*/
+void parseOBJChunk(const char *_begin, const char *_end, ObjChunk &_chunk);
+
+/*!
+* \fn parseCompressedOBJFile
+* \brief Read and tokenize a gzip or zstd compressed OBJ file without decompressing it entirely in memory.
+* A producer thread decompresses the file into blocks of whole lines, which are
+* parsed by the calling thread while the next block is being decompressed.
+* \param _filename : name of the compressed file (.obj.gz or .obj.zst)
+* \param _chunk : output records (relative indices are resolved against the whole file)
+* \return false if the file could not be read or decompressed
+*/
+bool parseCompressedOBJFile(const std::string &_filename, ObjChunk &_chunk);
+
+/*!
+* \fn resolveOBJIndex
+* \brief Convert an index stored in ObjChunk::corners into an absolute 0-based index
+* \param _index : index read by parseOBJChunk() (must not be 0)
+* \param _offset : number of records (of the same type) preceding the chunk in the file
+* \return absolute 0-based index
+*/
+inline int64_t resolveOBJIndex(int _index, size_t _offset)
+{
+    if (_index < 0)
+        return static_cast<int64_t>(_offset) + (static_cast<int64_t>(_index) + OBJ_RELATIVE_INDEX_BIAS);
+    return static_cast<int64_t>(_index) - 1;
+}
+
+
+#endif // OBJPARSER_H
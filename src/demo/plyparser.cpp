@@ -0,0 +1,406 @@
+/*********************************************************************************************************************
+ *
+ * plyparser.cpp
+ *
+ * Reader for binary Stanford PLY files
+ *
+ * QGL_toolkit demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#include <cstring>
+#include <sstream>
+
+
+#include "plyparser.h"
+
+
+namespace
+{
+    // Property names recognized for each vertex attribute
+    const char * const PLY_X[] = { "x", nullptr };
+    const char * const PLY_Y[] = { "y", nullptr };
+    const char * const PLY_Z[] = { "z", nullptr };
+    const char * const PLY_NX[] = { "nx", "normal_x", nullptr };
+    const char * const PLY_NY[] = { "ny", "normal_y", nullptr };
+    const char * const PLY_NZ[] = { "nz", "normal_z", nullptr };
+    const char * const PLY_U[] = { "u", "s", "texture_u", "texture_s", nullptr };
+    const char * const PLY_V[] = { "v", "t", "texture_v", "texture_t", nullptr };
+    const char * const PLY_FACE_INDICES[] = { "vertex_indices", "vertex_index", nullptr };
+
+
+    PlyType parseType(const std::string &_name)
+    {
+        if (_name == "char"   || _name == "int8")    return PLY_INT8;
+        if (_name == "uchar"  || _name == "uint8")   return PLY_UINT8;
+        if (_name == "short"  || _name == "int16")   return PLY_INT16;
+        if (_name == "ushort" || _name == "uint16")  return PLY_UINT16;
+        if (_name == "int"    || _name == "int32")   return PLY_INT32;
+        if (_name == "uint"   || _name == "uint32")  return PLY_UINT32;
+        if (_name == "float"  || _name == "float32") return PLY_FLOAT32;
+        if (_name == "double" || _name == "float64") return PLY_FLOAT64;
+        return PLY_INVALID;
+    }
+
+    // Load a scalar of type T, reversing its bytes if _swap is true
+    template <typename T>
+    inline T load(const char *_p, bool _swap)
+    {
+        T value;
+        if (_swap)
+        {
+            char bytes[sizeof(T)];
+            for (size_t i = 0; i < sizeof(T); i++)
+                bytes[i] = _p[sizeof(T) - 1 - i];
+            std::memcpy(&value, bytes, sizeof(T));
+        }
+        else
+        {
+            std::memcpy(&value, _p, sizeof(T));
+        }
+        return value;
+    }
+
+    inline double readValue(const char *_p, PlyType _type, bool _swap)
+    {
+        switch (_type)
+        {
+            case PLY_INT8:    return static_cast<int8_t>(*_p);
+            case PLY_UINT8:   return static_cast<uint8_t>(*_p);
+            case PLY_INT16:   return load<int16_t>(_p, _swap);
+            case PLY_UINT16:  return load<uint16_t>(_p, _swap);
+            case PLY_INT32:   return load<int32_t>(_p, _swap);
+            case PLY_UINT32:  return load<uint32_t>(_p, _swap);
+            case PLY_FLOAT32: return load<float>(_p, _swap);
+            case PLY_FLOAT64: return load<double>(_p, _swap);
+            default:          return 0.0;
+        }
+    }
+
+    // Read a list count or a vertex index (negative values become invalid indices)
+    inline uint32_t readIndex(const char *_p, PlyType _type, bool _swap)
+    {
+        switch (_type)
+        {
+            case PLY_INT8:    return static_cast<uint32_t>( static_cast<int8_t>(*_p) );
+            case PLY_UINT8:   return static_cast<uint8_t>(*_p);
+            case PLY_INT16:   return static_cast<uint32_t>( load<int16_t>(_p, _swap) );
+            case PLY_UINT16:  return load<uint16_t>(_p, _swap);
+            case PLY_INT32:   return static_cast<uint32_t>( load<int32_t>(_p, _swap) );
+            case PLY_UINT32:  return load<uint32_t>(_p, _swap);
+            default:          return static_cast<uint32_t>( readValue(_p, _type, _swap) );
+        }
+    }
+
+    /*!
+    * \fn readAttribute
+    * \brief Read _nbComponents properties of _count records into a packed float array.
+    * Consecutive float32 properties with the host endianness are copied with memcpy.
+    */
+    void readAttribute(const char *_data, size_t _count, size_t _stride, const PlyProperty * const *_properties,
+                       size_t _nbComponents, bool _swap, float *_dst)
+    {
+        const size_t offset = _properties[0]->offset;
+
+        bool packed = !_swap;
+        for (size_t c = 0; c < _nbComponents; c++)
+            packed = packed && _properties[c]->type == PLY_FLOAT32 && _properties[c]->offset == offset + 4 * c;
+
+        if (packed && _stride == 4 * _nbComponents)
+        {
+            // the element contains only this attribute
+            std::memcpy(_dst, _data, _count * _stride);
+        }
+        else if (packed)
+        {
+            for (size_t i = 0; i < _count; i++)
+                std::memcpy(_dst + i * _nbComponents, _data + i * _stride + offset, 4 * _nbComponents);
+        }
+        else
+        {
+            for (size_t i = 0; i < _count; i++)
+                for (size_t c = 0; c < _nbComponents; c++)
+                    _dst[i * _nbComponents + c] = static_cast<float>( readValue(_data + i * _stride + _properties[c]->offset, _properties[c]->type, _swap) );
+        }
+    }
+
+    // Skip one record of an element containing lists, return nullptr if the data is truncated
+    inline const char *skipRecord(const PlyElement &_element, const char *_p, const char *_end, bool _swap)
+    {
+        for (size_t k = 0; k < _element.properties.size(); k++)
+        {
+            const PlyProperty &property = _element.properties[k];
+            size_t nbBytes = plyTypeSize(property.type);
+            if (property.countType != PLY_INVALID)
+            {
+                const size_t countSize = plyTypeSize(property.countType);
+                if (static_cast<size_t>(_end - _p) < countSize)
+                    return nullptr;
+                const size_t count = readIndex(_p, property.countType, _swap);
+                _p += countSize;
+                nbBytes *= count;
+            }
+            if (static_cast<size_t>(_end - _p) < nbBytes)
+                return nullptr;
+            _p += nbBytes;
+        }
+        return _p;
+    }
+
+} // anonymous namespace
+
+
+const PlyProperty *PlyElement::findProperty(const char * const *_names) const
+{
+    for (const char * const *name = _names; *name != nullptr; name++)
+        for (size_t k = 0; k < properties.size(); k++)
+            if (properties[k].name == *name)
+                return &properties[k];
+    return nullptr;
+}
+
+
+size_t plyTypeSize(PlyType _type)
+{
+    switch (_type)
+    {
+        case PLY_INT8:    case PLY_UINT8:   return 1;
+        case PLY_INT16:   case PLY_UINT16:  return 2;
+        case PLY_INT32:   case PLY_UINT32:  case PLY_FLOAT32: return 4;
+        case PLY_FLOAT64: return 8;
+        default:          return 0;
+    }
+}
+
+
+bool parsePLYHeader(const char *_data, size_t _size, PlyHeader &_header)
+{
+    _header.format = PlyHeader::ASCII;
+    _header.elements.clear();
+    _header.size = 0;
+
+    if (_size < 4 || std::strncmp(_data, "ply", 3) != 0)
+        return false;
+
+    bool hasFormat = false;
+    const char *p = _data;
+    const char *end = _data + _size;
+    while (p < end)
+    {
+        const char *lineEnd = static_cast<const char*>( std::memchr(p, '\n', end - p) );
+        if (lineEnd == nullptr)
+            return false;
+
+        std::istringstream line( std::string(p, lineEnd) );
+        p = lineEnd + 1;
+
+        std::string keyword;
+        line >> keyword;
+
+        if (keyword == "format")
+        {
+            std::string format;
+            line >> format;
+            if (format == "ascii")
+                _header.format = PlyHeader::ASCII;
+            else if (format == "binary_little_endian")
+                _header.format = PlyHeader::BINARY_LITTLE_ENDIAN;
+            else if (format == "binary_big_endian")
+                _header.format = PlyHeader::BINARY_BIG_ENDIAN;
+            else
+                return false;
+            hasFormat = true;
+        }
+        else if (keyword == "element")
+        {
+            PlyElement element;
+            if (!(line >> element.name >> element.count))
+                return false;
+            element.stride = 0;
+            _header.elements.push_back(element);
+        }
+        else if (keyword == "property")
+        {
+            if (_header.elements.empty())
+                return false;
+
+            PlyProperty property;
+            std::string type;
+            line >> type;
+            if (type == "list")
+            {
+                std::string countType;
+                line >> countType >> type;
+                property.countType = parseType(countType);
+                if (property.countType == PLY_INVALID || property.countType == PLY_FLOAT32 || property.countType == PLY_FLOAT64)
+                    return false;
+            }
+            else
+            {
+                property.countType = PLY_INVALID;
+            }
+            property.type = parseType(type);
+            if (property.type == PLY_INVALID || !(line >> property.name))
+                return false;
+            property.offset = 0;
+            _header.elements.back().properties.push_back(property);
+        }
+        else if (keyword == "end_header")
+        {
+            _header.size = static_cast<size_t>(p - _data);
+            break;
+        }
+        // "ply", "comment", "obj_info" and unknown lines are ignored
+    }
+
+    if (!hasFormat || _header.size == 0)
+        return false;
+
+    // record sizes and property offsets of elements without lists
+    for (size_t e = 0; e < _header.elements.size(); e++)
+    {
+        PlyElement &element = _header.elements[e];
+        size_t offset = 0;
+        bool hasList = false;
+        for (size_t k = 0; k < element.properties.size(); k++)
+        {
+            element.properties[k].offset = offset;
+            offset += plyTypeSize(element.properties[k].type);
+            hasList = hasList || element.properties[k].countType != PLY_INVALID;
+        }
+        element.stride = hasList ? 0 : offset;
+    }
+
+    return true;
+}
+
+
+const char *readPLYVertices(const PlyElement &_element, const char *_begin, const char *_end, bool _swap,
+                            std::vector<glm::vec3> &_positions, std::vector<glm::vec3> &_normals, std::vector<glm::vec2> &_texcoords)
+{
+    const PlyProperty *position[3] = { _element.findProperty(PLY_X), _element.findProperty(PLY_Y), _element.findProperty(PLY_Z) };
+    const PlyProperty *normal[3] = { _element.findProperty(PLY_NX), _element.findProperty(PLY_NY), _element.findProperty(PLY_NZ) };
+    const PlyProperty *texcoord[2] = { _element.findProperty(PLY_U), _element.findProperty(PLY_V) };
+
+    if (_element.stride == 0 || position[0] == nullptr || position[1] == nullptr || position[2] == nullptr)
+        return nullptr;
+
+    if (_element.count > static_cast<size_t>(_end - _begin) / _element.stride)
+        return nullptr;
+    if (_element.count == 0)
+        return _begin;
+
+    _positions.resize(_element.count);
+    readAttribute(_begin, _element.count, _element.stride, position, 3, _swap, &_positions.data()->x);
+
+    if (normal[0] != nullptr && normal[1] != nullptr && normal[2] != nullptr)
+    {
+        _normals.resize(_element.count);
+        readAttribute(_begin, _element.count, _element.stride, normal, 3, _swap, &_normals.data()->x);
+    }
+
+    if (texcoord[0] != nullptr && texcoord[1] != nullptr)
+    {
+        _texcoords.resize(_element.count);
+        readAttribute(_begin, _element.count, _element.stride, texcoord, 2, _swap, &_texcoords.data()->x);
+    }
+
+    return _begin + _element.count * _element.stride;
+}
+
+
+const char *readPLYFaces(const PlyElement &_element, const char *_begin, const char *_end, bool _swap, std::vector<uint32_t> &_indices)
+{
+    const PlyProperty *list = _element.findProperty(PLY_FACE_INDICES);
+    if (list == nullptr || list->countType == PLY_INVALID)
+        return nullptr;
+
+    const PlyType type = list->type;
+    const size_t typeSize = plyTypeSize(type);
+    const size_t countSize = plyTypeSize(list->countType);
+
+    _indices.reserve(_indices.size() + 3 * _element.count);
+
+    const char *p = _begin;
+
+    if (_element.properties.size() == 1 && countSize == 1 && (type == PLY_INT32 || type == PLY_UINT32) && !_swap)
+    {
+        // common layout (uchar count, int indices): indices are copied without conversion
+        uint32_t corner0, corner1, corner2;
+        for (size_t f = 0; f < _element.count; f++)
+        {
+            if (p == _end)
+                return nullptr;
+            const size_t count = static_cast<uint8_t>(*p++);
+            if (static_cast<size_t>(_end - p) < 4 * count)
+                return nullptr;
+
+            if (count >= 3)
+            {
+                std::memcpy(&corner0, p, 4);
+                std::memcpy(&corner2, p + 4, 4);
+                for (size_t k = 2; k < count; k++)
+                {
+                    corner1 = corner2;
+                    std::memcpy(&corner2, p + 4 * k, 4);
+                    _indices.push_back(corner0);
+                    _indices.push_back(corner1);
+                    _indices.push_back(corner2);
+                }
+            }
+            p += 4 * count;
+        }
+        return p;
+    }
+
+    // generic layout: walk through all the properties of each face
+    for (size_t f = 0; f < _element.count; f++)
+    {
+        for (size_t k = 0; k < _element.properties.size(); k++)
+        {
+            const PlyProperty &property = _element.properties[k];
+            size_t nbBytes = plyTypeSize(property.type);
+            size_t count = 1;
+            if (property.countType != PLY_INVALID)
+            {
+                const size_t size = plyTypeSize(property.countType);
+                if (static_cast<size_t>(_end - p) < size)
+                    return nullptr;
+                count = readIndex(p, property.countType, _swap);
+                p += size;
+            }
+            if (static_cast<size_t>(_end - p) / nbBytes < count)
+                return nullptr;
+
+            if (&property == list && count >= 3)
+            {
+                const uint32_t corner0 = readIndex(p, type, _swap);
+                for (size_t c = 2; c < count; c++)
+                {
+                    _indices.push_back(corner0);
+                    _indices.push_back( readIndex(p + (c - 1) * typeSize, type, _swap) );
+                    _indices.push_back( readIndex(p + c * typeSize, type, _swap) );
+                }
+            }
+            p += count * nbBytes;
+        }
+    }
+    return p;
+}
+
+
+const char *skipPLYElement(const PlyElement &_element, const char *_begin, const char *_end, bool _swap)
+{
+    if (_element.stride > 0)
+    {
+        if (_element.count > static_cast<size_t>(_end - _begin) / _element.stride)
+            return nullptr;
+        return _begin + _element.count * _element.stride;
+    }
+
+    const char *p = _begin;
+    for (size_t i = 0; i < _element.count && p != nullptr; i++)
+        p = skipRecord(_element, p, _end, _swap);
+    return p;
+}
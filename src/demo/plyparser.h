@@ -0,0 +1,132 @@
+/*********************************************************************************************************************
+ *
+ * plyparser.h
+ *
+ * Reader for binary Stanford PLY files
+ *
+ * QGL_toolkit demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#ifndef PLYPARSER_H
+#define PLYPARSER_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+
+
+// Scalar types of PLY properties
+enum PlyType { PLY_INVALID, PLY_INT8, PLY_UINT8, PLY_INT16, PLY_UINT16, PLY_INT32, PLY_UINT32, PLY_FLOAT32, PLY_FLOAT64 };
+
+
+/*!
+* \struct PlyProperty
+* \brief Property of a PLY element (scalar or list)
+*/
+struct PlyProperty
+{
+    std::string name;               /*!< name of the property */
+    PlyType type;                   /*!< type of the value (of the items for a list) */
+    PlyType countType;              /*!< type of the item count of a list, PLY_INVALID for a scalar */
+    size_t offset;                  /*!< offset in the element (in bytes), only valid if the element has no list */
+};
+
+
+/*!
+* \struct PlyElement
+* \brief Element of a PLY file (e.g., "vertex", "face"), stored as count consecutive records
+*/
+struct PlyElement
+{
+    std::string name;                           /*!< name of the element */
+    size_t count;                               /*!< number of records */
+    std::vector<PlyProperty> properties;        /*!< properties of a record */
+    size_t stride;                              /*!< size of a record (in bytes), 0 if it contains lists */
+
+    /*!
+    * \fn findProperty
+    * \brief Returns the first property named after one of _names (nullptr-terminated), nullptr if there is none
+    */
+    const PlyProperty *findProperty(const char * const *_names) const;
+};
+
+
+/*!
+* \struct PlyHeader
+* \brief Header of a PLY file
+*/
+struct PlyHeader
+{
+    enum Format { ASCII, BINARY_LITTLE_ENDIAN, BINARY_BIG_ENDIAN };
+
+    Format format;                              /*!< encoding of the data */
+    std::vector<PlyElement> elements;           /*!< elements, in file order */
+    size_t size;                                /*!< size of the header (in bytes), i.e. offset of the data */
+};
+
+
+/*!
+* \fn plyTypeSize
+* \brief Returns the size (in bytes) of a PLY type
+*/
+size_t plyTypeSize(PlyType _type);
+
+/*!
+* \fn parsePLYHeader
+* \brief Parse the header at the beginning of a PLY file
+* \param _data, _size : content of the file
+* \param _header : output header
+* \return false if the header is invalid
+*/
+bool parsePLYHeader(const char *_data, size_t _size, PlyHeader &_header);
+
+/*!
+* \fn readPLYVertices
+* \brief Read positions, and normals and texcoords if present, from the records of a vertex element.
+* Tightly packed float properties are copied with a strided memcpy, other types are converted.
+* \param _element : vertex element (must not contain lists)
+* \param _begin, _end : binary data of the element
+* \param _swap : true if the data has not the endianness of the host
+* \param _positions, _normals, _texcoords : output arrays (normals and texcoords are left empty if absent)
+* \return pointer after the element data, nullptr if the data is truncated or if positions are missing
+*/
+const char *readPLYVertices(const PlyElement &_element, const char *_begin, const char *_end, bool _swap,
+                            std::vector<glm::vec3> &_positions, std::vector<glm::vec3> &_normals, std::vector<glm::vec2> &_texcoords);
+
+/*!
+* \fn readPLYFaces
+* \brief Read the vertex indices of a face element, polygons are triangulated as fans.
+* \param _element : face element (with a "vertex_indices" or "vertex_index" list)
+* \param _begin, _end : binary data of the element
+* \param _swap : true if the data has not the endianness of the host
+* \param _indices : output indices, 3 per triangle
+* \return pointer after the element data, nullptr if the data is truncated or if the index list is missing
+*/
+const char *readPLYFaces(const PlyElement &_element, const char *_begin, const char *_end, bool _swap, std::vector<uint32_t> &_indices);
+
+/*!
+* \fn skipPLYElement
+* \brief Skip the records of an element
+* \return pointer after the element data, nullptr if the data is truncated
+*/
+const char *skipPLYElement(const PlyElement &_element, const char *_begin, const char *_end, bool _swap);
+
+/*!
+* \fn hostIsLittleEndian
+* \brief Returns true if the host is little-endian
+*/
+inline bool hostIsLittleEndian()
+{
+    const uint16_t one = 1;
+    return *reinterpret_cast<const uint8_t*>(&one) == 1;
+}
+
+
+#endif // PLYPARSER_H
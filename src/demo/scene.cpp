@@ -0,0 +1,176 @@
+/*********************************************************************************************************************
+ *
+ * scene.cpp
+ *
+ * Set of meshes drawn through a render queue sorted by GL state
+ *
+ * QGL_toolkit demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#include <algorithm>
+
+
+#include "scene.h"
+#include "trimesh.h"
+#include "glstatecache.h"
+#include "trace.h"
+#include "QGLtoolkit/frustum.h"
+
+
+Scene::Scene()
+: m_version(1), m_queueVersion(0), m_queueCameraVersion(0), m_numDrawnIndices(0), m_numDrawCalls(0)
+{
+}
+
+
+Scene::~Scene()
+{
+    clear();
+}
+
+
+TriMesh *Scene::addMesh(TriMesh *_mesh)
+{
+    m_meshes.push_back( std::unique_ptr<TriMesh>(_mesh) );
+    m_meshVersions.push_back(_mesh->version());
+    m_version++;
+    return _mesh;
+}
+
+
+void Scene::clear()
+{
+    // (the destructors of the meshes wait for their loading thread, if any)
+    m_meshes.clear();
+    m_meshVersions.clear();
+    m_queue.clear();
+    m_version++;
+}
+
+
+bool Scene::isLoading() const
+{
+    for(size_t i = 0; i < m_meshes.size(); i++)
+        if(m_meshes[i]->isLoading())
+            return true;
+    return false;
+}
+
+
+bool Scene::isUploading() const
+{
+    for(size_t i = 0; i < m_meshes.size(); i++)
+        if(!m_meshes[i]->isLoading() && m_meshes[i]->isUploading())
+            return true;
+    return false;
+}
+
+
+uint64_t Scene::version() const
+{
+    // a single counter, increased once if any mesh changed since the last call
+    // (so that the version never goes back to a former value, e.g. when a mesh is removed)
+    bool modified = false;
+    for(size_t i = 0; i < m_meshes.size(); i++)
+    {
+        const uint64_t meshVersion = m_meshes[i]->version();
+        if(meshVersion != m_meshVersions[i])
+        {
+            m_meshVersions[i] = meshVersion;
+            modified = true;
+        }
+    }
+    if(modified)
+        m_version++;
+    return m_version;
+}
+
+
+void Scene::buildQueue(const glm::mat4 &_mv, const glm::mat4 &_mvp)
+{
+    QGL_TRACE_SCOPE("Scene::buildQueue");
+
+    // meshes read by a worker thread are not touched, empty meshes are not drawn
+    m_candidates.clear();
+    m_sphereX.clear();
+    m_sphereY.clear();
+    m_sphereZ.clear();
+    m_sphereRadius.clear();
+    for(size_t i = 0; i < m_meshes.size(); i++)
+    {
+        TriMesh &mesh = *m_meshes[i];
+        if(mesh.isLoading() || !mesh.hasVAO())
+            continue;
+
+        // (instanced meshes are culled as a whole here, then instance by instance by TriMesh::draw())
+        const glm::vec3 center = mesh.hasInstances() ? mesh.getInstancesBSphereCenter() : mesh.getBSphereCenter();
+        m_candidates.push_back((uint32_t)i);
+        m_sphereX.push_back(center.x);
+        m_sphereY.push_back(center.y);
+        m_sphereZ.push_back(center.z);
+        m_sphereRadius.push_back(mesh.hasInstances() ? mesh.getInstancesBSphereRadius() : mesh.getBSphereRadius());
+    }
+
+    m_visibility.resize(m_candidates.size());
+    const qgltoolkit::Frustum frustum(_mvp);
+    frustum.classifySpheres(m_sphereX.data(), m_sphereY.data(), m_sphereZ.data(), m_sphereRadius.data(),
+                            m_candidates.size(), m_visibility.data());
+
+    // depth of the closest point of the sphere (the view looks down -z)
+    const glm::vec3 depthAxis(-_mv[0][2], -_mv[1][2], -_mv[2][2]);
+    const float depthOffset = -_mv[3][2];
+
+    m_queue.clear();
+    for(size_t i = 0; i < m_candidates.size(); i++)
+    {
+        if(m_visibility[i] == qgltoolkit::Frustum::OUTSIDE)
+            continue;
+
+        const TriMesh &mesh = *m_meshes[m_candidates[i]];
+        RenderItem item;
+        item.program = mesh.program();
+        item.material = mesh.materialBuffer();
+        item.depth = depthAxis.x * m_sphereX[i] + depthAxis.y * m_sphereY[i] + depthAxis.z * m_sphereZ[i] + depthOffset - m_sphereRadius[i];
+        item.mesh = m_candidates[i];
+        m_queue.push_back(item);
+    }
+
+    std::sort(m_queue.begin(), m_queue.end(), [](const RenderItem &_a, const RenderItem &_b)
+    {
+        if(_a.program != _b.program)
+            return _a.program < _b.program;
+        if(_a.material != _b.material)
+            return _a.material < _b.material;
+        if(_a.depth != _b.depth)
+            return _a.depth < _b.depth;
+        return _a.mesh < _b.mesh;
+    });
+}
+
+
+void Scene::draw(const glm::mat4 &_mv, const glm::mat4 &_mvp, const glm::mat4 &_projection,
+                 int _screenHeight, uint64_t _cameraVersion, GLStateCache &_state)
+{
+    QGL_TRACE_SCOPE("Scene::draw");
+
+    // the queue only depends on the camera and on the meshes
+    const uint64_t version = this->version();
+    if(_cameraVersion == 0 || _cameraVersion != m_queueCameraVersion || version != m_queueVersion)
+    {
+        buildQueue(_mv, _mvp);
+        m_queueCameraVersion = _cameraVersion;
+        m_queueVersion = version;
+    }
+
+    m_numDrawnIndices = 0;
+    m_numDrawCalls = 0;
+    for(size_t i = 0; i < m_queue.size(); i++)
+    {
+        TriMesh &mesh = *m_meshes[m_queue[i].mesh];
+        mesh.draw(_mv, _mvp, _projection, _screenHeight, _cameraVersion, &_state);
+        m_numDrawnIndices += mesh.numDrawnIndices();
+        m_numDrawCalls += mesh.numDrawCalls();
+    }
+}
@@ -0,0 +1,167 @@
+/*********************************************************************************************************************
+ *
+ * scene.h
+ *
+ * Set of meshes drawn through a render queue sorted by GL state
+ *
+ * QGL_toolkit demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#ifndef SCENE_H
+#define SCENE_H
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+
+
+#define QT_NO_OPENGL_ES_2
+#include <GL/glew.h>
+
+
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+
+
+class TriMesh;
+class GLStateCache;
+
+
+/*!
+* \class Scene
+* \brief Owns the meshes of the viewer and draws them in an order which minimizes the state changes.
+* The visible meshes (bounding sphere in the view frustum) are sorted by program, then by material,
+* then from front to back (to reject occluded fragments early), and drawn through a GLStateCache:
+* a program is bound once per group of meshes instead of once per mesh, and nothing is reset between meshes.
+* The queue is only rebuilt when the camera or the scene changed.
+*/
+class Scene
+{
+    public:
+
+        /*!
+        * \fn Scene
+        * \brief Constructor of an empty scene
+        */
+        Scene();
+
+        /*!
+        * \fn ~Scene
+        * \brief Destructor, deletes the meshes (the GL context must be current)
+        */
+        ~Scene();
+
+        /*!
+        * \fn addMesh
+        * \brief Add a mesh to the scene, which takes its ownership
+        * \return the mesh
+        */
+        TriMesh *addMesh(TriMesh *_mesh);
+
+        /*!
+        * \fn clear
+        * \brief Delete all the meshes (the GL context must be current)
+        */
+        void clear();
+
+        /*! \fn numMeshes */
+        size_t numMeshes() const { return m_meshes.size(); }
+
+        /*! \fn mesh */
+        TriMesh *mesh(size_t _index) const { return m_meshes[_index].get(); }
+
+        /*!
+        * \fn isLoading
+        * \brief Returns true if a mesh is being read asynchronously (see TriMesh::readFileAsync())
+        */
+        bool isLoading() const;
+
+        /*!
+        * \fn isUploading
+        * \brief Returns true if a mesh is being uploaded progressively (see TriMesh::setStreamingUpload())
+        */
+        bool isUploading() const;
+
+        /*!
+        * \fn version
+        * \brief Returns a counter increased each time a mesh is added or removed, or what a mesh displays
+        * is modified (see TriMesh::version())
+        */
+        uint64_t version() const;
+
+        /*!
+        * \fn buildQueue
+        * \brief Cull the meshes against the view frustum and sort the visible ones (no GL call).
+        * Called by draw() when the camera or the scene changed.
+        * \param _mv : view matrix
+        * \param _mvp : view-projection matrix
+        */
+        void buildQueue(const glm::mat4 &_mv, const glm::mat4 &_mvp);
+
+        /*!
+        * \fn draw
+        * \brief Draw the visible meshes, sorted by state. The camera uniform block must be bound by the caller.
+        * Meshes which are still loading are skipped. The state is left as set by the last mesh.
+        * \param _mv : view matrix
+        * \param _mvp : view-projection matrix
+        * \param _projection : projection matrix (levels of detail of the meshes)
+        * \param _screenHeight : height of the viewport (in pixels)
+        * \param _cameraVersion : version of the camera which gives the matrices (see Camera::version()), 0 if unknown
+        * \param _state : cache of the GL bindings of the frame
+        */
+        void draw(const glm::mat4 &_mv, const glm::mat4 &_mvp, const glm::mat4 &_projection,
+                  int _screenHeight, uint64_t _cameraVersion, GLStateCache &_state);
+
+        /*!
+        * \fn queueSize
+        * \brief Returns the number of meshes in the render queue (visible meshes)
+        */
+        size_t queueSize() const { return m_queue.size(); }
+
+        /*! \fn numDrawnIndices : number of indices submitted by the last draw() */
+        size_t numDrawnIndices() const { return m_numDrawnIndices; }
+        /*! \fn numDrawCalls : number of draw calls submitted by the last draw() */
+        size_t numDrawCalls() const { return m_numDrawCalls; }
+
+
+    private:
+
+        /*!
+        * \struct RenderItem
+        * \brief Mesh of the render queue, with its sort keys
+        */
+        struct RenderItem
+        {
+            GLuint program;         /*!< program of the mesh */
+            GLuint material;        /*!< buffer of the material uniform block of the mesh */
+            float depth;            /*!< view space depth of the front of the bounding sphere */
+            uint32_t mesh;          /*!< index of the mesh */
+        };
+
+        std::vector<std::unique_ptr<TriMesh> > m_meshes;    /*!< meshes of the scene */
+        mutable uint64_t m_version;                         /*!< increased when a mesh is added, removed or modified */
+        mutable std::vector<uint64_t> m_meshVersions;       /*!< versions of the meshes at the last version() call */
+
+        std::vector<RenderItem> m_queue;                    /*!< visible meshes, in drawing order */
+        uint64_t m_queueVersion;                            /*!< version of the scene when m_queue was built */
+        uint64_t m_queueCameraVersion;                      /*!< version of the camera when m_queue was built, 0 if unknown */
+
+        std::vector<uint32_t> m_candidates;                 /*!< meshes tested by buildQueue() */
+        std::vector<float> m_sphereX;                       /*!< bounding spheres of the candidates (SoA, for Frustum::classifySpheres()) */
+        std::vector<float> m_sphereY;
+        std::vector<float> m_sphereZ;
+        std::vector<float> m_sphereRadius;
+        std::vector<uint8_t> m_visibility;                  /*!< Frustum::Visibility of the candidates */
+
+        size_t m_numDrawnIndices;                           /*!< number of indices submitted by the last draw() */
+        size_t m_numDrawCalls;                              /*!< number of draw calls submitted by the last draw() */
+
+        // Copy constructor and operator= are declared private and undefined
+        Scene(const Scene &);
+        Scene &operator=(const Scene &);
+};
+
+#endif // SCENE_H
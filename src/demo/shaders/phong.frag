@@ -1,13 +1,21 @@
 // Fragment shader
 #version 150
 
-// UNIFORMS
-uniform vec3 u_lightColor;
+// UNIFORMS (std140 blocks, see uniformbuffer.h)
+layout(std140) uniform Camera
+{
+	mat4 u_mv;
+	mat4 u_mvp;
+	vec4 u_lightPosition;
+	vec4 u_lightColor;
+};
 
-uniform vec3 u_ambientColor;
-uniform vec3 u_diffuseColor;
-uniform vec3 u_specularColor;
-uniform float u_specularPower;
+layout(std140) uniform Material
+{
+	vec4 u_ambientColor;
+	vec4 u_diffuseColor;
+	vec4 u_specularColor;	// w: specular power
+};
 
 
 // INPUT	
@@ -56,7 +64,7 @@ void main()
 	// final color
 	vec4 color = vec4(0.0f, 0.0f, 0.0f, 1.0f);
 	
-	vec3 diff_col = u_diffuseColor;
+	vec3 diff_col = u_diffuseColor.rgb;
 	
 
 	// -- Render Blinn-Phong shading --
@@ -64,16 +72,16 @@ void main()
 
 	//DIFFUSE
 	float diffuse = compDiff(l_vecN, l_vecL);
-	color.rgb += diff_col * u_lightColor * diffuse;
+	color.rgb += diff_col * u_lightColor.rgb * diffuse;
 
 
 	//SPECULAR
-	float specular = specular_normalized(l_vecN, l_vecH, u_specularPower);
-	color.rgb += u_specularColor * u_lightColor * specular;
+	float specular = specular_normalized(l_vecN, l_vecH, u_specularColor.w);
+	color.rgb += u_specularColor.rgb * u_lightColor.rgb * specular;
 
 
 	//AMBIENT
-	color.rgb += u_ambientColor;
+	color.rgb += u_ambientColor.rgb;
 
 	//GAMMA CORRECTION
 	color.rgb = linear_to_gamma(color.rgb);
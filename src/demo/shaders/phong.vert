@@ -5,11 +5,19 @@
 layout(location = 0) in vec4 a_position;
 layout(location = 1) in vec3 a_normal;
 layout(location = 2) in vec3 a_color;
+// transform of the instance (see InstanceTransform in instancing.h), identity for non-instanced draws
+layout(location = 3) in vec4 a_instanceRotation;
+layout(location = 4) in vec4 a_instanceTranslation;
 
 
-uniform mat4 u_mvp;
-uniform mat4 u_mv;
-uniform vec3 u_lightPosition;
+// UNIFORMS (std140 blocks, see uniformbuffer.h)
+layout(std140) uniform Camera
+{
+	mat4 u_mv;
+	mat4 u_mvp;
+	vec4 u_lightPosition;
+	vec4 u_lightColor;
+};
 
 out vec3 vecN;
 out vec3 vecL;
@@ -17,19 +25,27 @@ out vec3 vecV;
 out vec3 col;
 
 
+// Rotate a vector by a unit quaternion (x, y, z, w)
+vec3 rotate(vec4 q, vec3 v)
+{
+	return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
+
+
 void main()
 {
-	vec3 v_eye = vec3(u_mv * a_position);
+	vec4 position = vec4(rotate(a_instanceRotation, a_position.xyz) + a_instanceTranslation.xyz, 1.0);
+	vec3 v_eye = vec3(u_mv * position);
 
-	vecN = normalize(mat3(u_mv) * a_normal);
+	vecN = normalize(mat3(u_mv) * rotate(a_instanceRotation, a_normal));
 
 	// Calculate the view-space light direction
-	vec3 l_vecLight = vec3(mat3(u_mv) * u_lightPosition) ;
+	vec3 l_vecLight = vec3(mat3(u_mv) * u_lightPosition.xyz) ;
 	vecL = normalize(normalize(l_vecLight) - v_eye);
 	vecV = -normalize(v_eye);
 	
 
 	col = a_color;
 	
-	gl_Position = u_mvp * a_position;
+	gl_Position = u_mvp * position;
 }
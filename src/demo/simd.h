@@ -0,0 +1,29 @@
+/*********************************************************************************************************************
+ *
+ * simd.h
+ *
+ * Detection of the SIMD instruction sets enabled by the compiler
+ *
+ * QGL_toolkit demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#ifndef SIMD_H
+#define SIMD_H
+
+// SSE2 is always available on x86-64.
+// AVX must be enabled when compiling (e.g. with the QGL_ENABLE_AVX2 CMake option);
+// code using it must keep an SSE2 and a scalar path.
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define QGL_USE_SSE2
+#endif
+
+#if defined(__AVX__)
+    #include <immintrin.h>
+    #define QGL_USE_AVX
+#endif
+
+#endif // SIMD_H
@@ -0,0 +1,602 @@
+/*********************************************************************************************************************
+ *
+ * simplifier.cpp
+ *
+ * Triangle mesh simplification with the quadric error metric
+ *
+ * QGL_toolkit demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+
+#include "simplifier.h"
+#include "boundingvolume.h"
+#include "hashmap.h"
+#include "threadpool.h"
+#include "trace.h"
+
+
+namespace
+{
+    // Number of elements processed by a task of the parallel loops
+    const size_t BLOCK_SIZE = 1 << 14;
+
+    inline size_t numBlocks(size_t _size)
+    {
+        return (_size + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    }
+
+    // Invalid vertex index (e.g. no open edge)
+    const uint32_t NO_VERTEX = 0xffffffffu;
+
+    // Weight of the planes orthogonal to open borders, relative to the planes of the faces
+    const float BORDER_WEIGHT = 10.0f;
+
+    // Max number of collapse passes of simplify()
+    const unsigned int MAX_PASSES = 256;
+
+    // simplify() stops when a pass removes less than 1 / MIN_PASS_REDUCTION of the triangles
+    const size_t MIN_PASS_REDUCTION = 200;
+
+    // Locks of the vertices during a collapse pass
+    const uint8_t UNLOCKED = 0;
+    const uint8_t LOCKED_NEIGHBOR = 1;      // neighbor of a collapsed vertex, can only be collapsed onto
+    const uint8_t LOCKED_COLLAPSED = 2;     // collapsed vertex
+
+    // Max error of the collapses of a pass, relative to the error of the collapse reaching the goal of the pass
+    const float PASS_ERROR_BOUND = 1.5f;
+
+    // Collapses allowed for a vertex (see MeshSimplifier::classifyVertices())
+    enum VertexKind : uint8_t
+    {
+        KIND_MANIFOLD = 0,      // collapses along any edge
+        KIND_BORDER = 1,        // collapses along its open border only
+        KIND_SEAM = 2,          // collapses along the seam only, with the other vertex of its position
+        KIND_LOCKED = 3         // never collapses
+    };
+
+    /*!
+    * \struct Collapse
+    * \brief Candidate collapse of vertex from onto vertex to
+    */
+    struct Collapse
+    {
+        uint32_t from;
+        uint32_t to;
+        float error;
+    };
+
+    // Next and previous corners of the face of corner _c
+    inline uint32_t nextCorner(uint32_t _c) { return (_c % 3 == 2) ? _c - 2 : _c + 1; }
+    inline uint32_t prevCorner(uint32_t _c) { return (_c % 3 == 0) ? _c + 2 : _c - 1; }
+
+
+    // Quadrics are expressed relative to the position of their vertex: the errors of short collapses
+    // are small differences of large terms in absolute coordinates, and would be lost in floats.
+
+    // Add the squared distance to the plane of normal _n through the vertex, weighted by _weight
+    void addPlane(Quadric &_q, const glm::vec3 &_n, float _weight)
+    {
+        _q.a00 += _weight * _n.x * _n.x;
+        _q.a11 += _weight * _n.y * _n.y;
+        _q.a22 += _weight * _n.z * _n.z;
+        _q.a01 += _weight * _n.x * _n.y;
+        _q.a02 += _weight * _n.x * _n.z;
+        _q.a12 += _weight * _n.y * _n.z;
+    }
+
+    // Value of the quadric at _x (relative to the vertex)
+    float quadricValue(const Quadric &_q, const glm::vec3 &_x)
+    {
+        const float rx = _q.a00 * _x.x + _q.a01 * _x.y + _q.a02 * _x.z;
+        const float ry = _q.a01 * _x.x + _q.a11 * _x.y + _q.a12 * _x.z;
+        const float rz = _q.a02 * _x.x + _q.a12 * _x.y + _q.a22 * _x.z;
+        return _x.x * rx + _x.y * ry + _x.z * rz + 2.0f * (_q.b0 * _x.x + _q.b1 * _x.y + _q.b2 * _x.z) + _q.c;
+    }
+
+    // Mean squared distance to the planes of the quadric of a point at _x (relative to the vertex)
+    float quadricError(const Quadric &_q, const glm::vec3 &_x)
+    {
+        // (rounding errors)
+        const float error = std::max(0.0f, quadricValue(_q, _x));
+        return (_q.area > 0.0f) ? error / _q.area : error;
+    }
+
+    // Add quadric _r of a vertex at _t from the vertex of _q: _q(x) += _r(x + _t)
+    void addQuadric(Quadric &_q, const Quadric &_r, const glm::vec3 &_t)
+    {
+        _q.a00 += _r.a00;  _q.a11 += _r.a11;  _q.a22 += _r.a22;
+        _q.a01 += _r.a01;  _q.a02 += _r.a02;  _q.a12 += _r.a12;
+        _q.b0 += _r.b0 + _r.a00 * _t.x + _r.a01 * _t.y + _r.a02 * _t.z;
+        _q.b1 += _r.b1 + _r.a01 * _t.x + _r.a11 * _t.y + _r.a12 * _t.z;
+        _q.b2 += _r.b2 + _r.a02 * _t.x + _r.a12 * _t.y + _r.a22 * _t.z;
+        _q.c += std::max(0.0f, quadricValue(_r, _t));
+        _q.area += _r.area;
+    }
+
+} // anonymous namespace
+
+
+MeshSimplifier::MeshSimplifier(const uint32_t *_indices, size_t _nbIndices, const glm::vec3 *_vertices, size_t _nbVertices, ThreadPool &_pool)
+: m_pool(_pool), m_indices(_indices, _indices + (_nbIndices - _nbIndices % 3)), m_scale(1.0f), m_error(0.0f)
+{
+    // 1. positions scaled into the unit cube, so that the quadrics keep their precision in floats
+    glm::vec3 bBoxMin(0.0f), bBoxMax(0.0f);
+    std::vector<PointArray> arrays(1);
+    arrays[0].data = reinterpret_cast<const char*>(_vertices);
+    arrays[0].count = _nbVertices;
+    arrays[0].stride = sizeof(glm::vec3);
+    computeBoundingBox(arrays, bBoxMin, bBoxMax, m_pool);
+
+    const glm::vec3 extent = bBoxMax - bBoxMin;
+    m_scale = std::max(extent.x, std::max(extent.y, extent.z));
+    if (!(m_scale > 0.0f))
+        m_scale = 1.0f;
+
+    m_positions.resize(_nbVertices);
+    const float invScale = 1.0f / m_scale;
+    m_pool.run(numBlocks(_nbVertices), [&](size_t b)
+    {
+        const size_t end = std::min(_nbVertices, (b + 1) * BLOCK_SIZE);
+        for (size_t v = b * BLOCK_SIZE; v < end; v++)
+        {
+            // + 0.0f turns -0.0f into 0.0f, so that equal positions have the same bits
+            m_positions[v] = (_vertices[v] - bBoxMin) * invScale + glm::vec3(0.0f);
+        }
+    });
+
+    // 2. circular lists of the vertices (used by faces) sharing a position
+    std::vector<uint8_t> used(_nbVertices, 0);
+    for (size_t i = 0; i < m_indices.size(); i++)
+        used[m_indices[i]] = 1;
+
+    m_wedges.resize(_nbVertices);
+    FlatHashMap<glm::uvec3, uint32_t, UVec3Hash> firstVertex(_nbVertices);
+    for (size_t v = 0; v < _nbVertices; v++)
+    {
+        m_wedges[v] = static_cast<uint32_t>(v);
+        if (!used[v])
+            continue;
+
+        glm::uvec3 key;
+        std::memcpy(&key[0], &m_positions[v][0], sizeof(glm::vec3));
+        std::pair<uint32_t&, bool> first = firstVertex.insert(key, static_cast<uint32_t>(v));
+        if (!first.second)
+        {
+            m_wedges[v] = m_wedges[first.first];
+            m_wedges[first.first] = static_cast<uint32_t>(v);
+        }
+    }
+
+    // 3. quadrics of the original faces (borders are found among the open edges)
+    buildVertexAdjacency(m_indices.data(), m_indices.size(), _nbVertices, m_adjacency, m_pool);
+    classifyVertices();
+    computeQuadrics();
+}
+
+
+float MeshSimplifier::error() const
+{
+    return std::sqrt(m_error) * m_scale;
+}
+
+
+size_t MeshSimplifier::simplify(size_t _targetIndexCount)
+{
+    QGL_TRACE_SCOPE("MeshSimplifier::simplify");
+    for (unsigned int pass = 0; pass < MAX_PASSES && m_indices.size() > _targetIndexCount; pass++)
+    {
+        // stop when locked vertices, seams or flips prevent most of the collapses
+        const size_t nbIndices = m_indices.size();
+        if (collapsePass((nbIndices - _targetIndexCount) / 3) == 0 || (nbIndices - m_indices.size()) * MIN_PASS_REDUCTION < nbIndices)
+            break;
+    }
+    return m_indices.size();
+}
+
+
+bool MeshSimplifier::hasEdge(uint32_t _a, uint32_t _b) const
+{
+    for (const uint32_t *c = m_adjacency.begin(_a); c != m_adjacency.end(_a); c++)
+    {
+        if (m_indices[nextCorner(*c)] == _b)
+            return true;
+    }
+    return false;
+}
+
+
+bool MeshSimplifier::hasPositionEdge(uint32_t _a, uint32_t _b) const
+{
+    uint32_t w = _a;
+    do
+    {
+        for (const uint32_t *c = m_adjacency.begin(w); c != m_adjacency.end(w); c++)
+        {
+            if (samePosition(m_indices[nextCorner(*c)], _b))
+                return true;
+        }
+        w = m_wedges[w];
+    } while (w != _a);
+
+    return false;
+}
+
+
+bool MeshSimplifier::samePosition(uint32_t _a, uint32_t _b) const
+{
+    const glm::vec3 &a = m_positions[_a];
+    const glm::vec3 &b = m_positions[_b];
+    return a.x == b.x && a.y == b.y && a.z == b.z;
+}
+
+
+void MeshSimplifier::classifyVertices()
+{
+    const size_t nbVertices = m_positions.size();
+    const size_t nbIndices = m_indices.size();
+    m_openEdges.resize(nbIndices);
+    m_openIn.resize(nbVertices);
+    m_openOut.resize(nbVertices);
+    m_kinds.resize(nbVertices);
+
+    // 1. open edges, starting at each corner
+    m_pool.run(numBlocks(nbIndices), [&](size_t b)
+    {
+        const size_t end = std::min(nbIndices, (b + 1) * BLOCK_SIZE);
+        for (size_t c = b * BLOCK_SIZE; c < end; c++)
+            m_openEdges[c] = !hasEdge(m_indices[nextCorner(static_cast<uint32_t>(c))], m_indices[c]);
+    });
+
+    // 2. open edges of each vertex: the vertex itself marks vertices with several open edges
+    m_pool.run(numBlocks(nbVertices), [&](size_t b)
+    {
+        const size_t end = std::min(nbVertices, (b + 1) * BLOCK_SIZE);
+        for (size_t i = b * BLOCK_SIZE; i < end; i++)
+        {
+            const uint32_t v = static_cast<uint32_t>(i);
+            uint32_t openIn = NO_VERTEX, openOut = NO_VERTEX;
+            for (const uint32_t *c = m_adjacency.begin(v); c != m_adjacency.end(v); c++)
+            {
+                if (m_openEdges[*c])
+                    openOut = (openOut == NO_VERTEX) ? m_indices[nextCorner(*c)] : v;
+                if (m_openEdges[prevCorner(*c)])
+                    openIn = (openIn == NO_VERTEX) ? m_indices[prevCorner(*c)] : v;
+            }
+            m_openIn[v] = openIn;
+            m_openOut[v] = openOut;
+        }
+    });
+
+    // 3. kinds, from the open edges of the vertices of each position
+    m_pool.run(numBlocks(nbVertices), [&](size_t b)
+    {
+        const size_t end = std::min(nbVertices, (b + 1) * BLOCK_SIZE);
+        for (size_t i = b * BLOCK_SIZE; i < end; i++)
+        {
+            const uint32_t v = static_cast<uint32_t>(i);
+            const uint32_t w = m_wedges[v];
+
+            // exactly one open edge in and one out
+            auto isChain = [this](uint32_t _v)
+            {
+                return m_openIn[_v] != NO_VERTEX && m_openIn[_v] != _v && m_openOut[_v] != NO_VERTEX && m_openOut[_v] != _v;
+            };
+
+            uint8_t kind = KIND_LOCKED;
+            if (m_adjacency.degree(v) == 0)
+            {
+                kind = KIND_LOCKED;
+            }
+            else if (w == v)
+            {
+                if (m_openIn[v] == NO_VERTEX && m_openOut[v] == NO_VERTEX)
+                    kind = KIND_MANIFOLD;
+                // the open edges of the end of a seam have the same position
+                else if (isChain(v) && !samePosition(m_openIn[v], m_openOut[v]))
+                    kind = KIND_BORDER;
+            }
+            else if (m_wedges[w] == v && isChain(v) && isChain(w))
+            {
+                // the open edges of both sides are the same edges, in opposite directions
+                if (samePosition(m_openOut[v], m_openIn[w]) && samePosition(m_openIn[v], m_openOut[w]))
+                    kind = KIND_SEAM;
+            }
+            m_kinds[v] = kind;
+        }
+    });
+}
+
+
+void MeshSimplifier::computeQuadrics()
+{
+    const size_t nbVertices = m_positions.size();
+    m_quadrics.resize(nbVertices);
+
+    // each vertex gathers the faces around its position (all the vertices of a position get the same quadric)
+    m_pool.run(numBlocks(nbVertices), [&](size_t b)
+    {
+        const size_t end = std::min(nbVertices, (b + 1) * BLOCK_SIZE);
+        for (size_t i = b * BLOCK_SIZE; i < end; i++)
+        {
+            const uint32_t v = static_cast<uint32_t>(i);
+            Quadric quadric;
+            std::memset(&quadric, 0, sizeof(quadric));
+
+            uint32_t w = v;
+            do
+            {
+                for (const uint32_t *c = m_adjacency.begin(w); c != m_adjacency.end(w); c++)
+                {
+                    const uint32_t next = m_indices[nextCorner(*c)];
+                    const uint32_t prev = m_indices[prevCorner(*c)];
+                    const glm::vec3 &p = m_positions[w];
+
+                    const glm::vec3 normal = glm::cross(m_positions[next] - p, m_positions[prev] - p);
+                    const float length = glm::length(normal);
+                    if (!(length > 0.0f))
+                        continue;
+
+                    // plane of the face, weighted by its area
+                    const glm::vec3 n = normal / length;
+                    addPlane(quadric, n, 0.5f * length);
+                    quadric.area += 0.5f * length;
+
+                    // planes orthogonal to the face along its open borders (seams are not borders)
+                    const uint32_t ends[2] = { next, prev };
+                    for (unsigned int k = 0; k < 2; k++)
+                    {
+                        const bool open = (k == 0) ? m_openEdges[*c] && !hasPositionEdge(next, w)
+                                                   : m_openEdges[prevCorner(*c)] && !hasPositionEdge(w, prev);
+                        if (!open)
+                            continue;
+
+                        const glm::vec3 edge = m_positions[ends[k]] - p;
+                        const glm::vec3 borderNormal = glm::cross(edge, n);
+                        const float borderLength = glm::length(borderNormal);
+                        if (borderLength > 0.0f)
+                        {
+                            const glm::vec3 m = borderNormal / borderLength;
+                            addPlane(quadric, m, BORDER_WEIGHT * glm::dot(edge, edge));
+                        }
+                    }
+                }
+                w = m_wedges[w];
+            } while (w != v);
+
+            m_quadrics[v] = quadric;
+        }
+    });
+}
+
+
+bool MeshSimplifier::canCollapse(uint32_t _from, uint32_t _to, uint32_t &_wedgeFrom, uint32_t &_wedgeTo) const
+{
+    _wedgeFrom = NO_VERTEX;
+    _wedgeTo = NO_VERTEX;
+
+    const bool alongOpenEdge = (m_openOut[_from] == _to || m_openIn[_from] == _to);
+    switch (m_kinds[_from])
+    {
+        case KIND_MANIFOLD:
+            return true;
+
+        case KIND_BORDER:
+            return alongOpenEdge && (m_kinds[_to] == KIND_BORDER || m_kinds[_to] == KIND_LOCKED);
+
+        case KIND_SEAM:
+        {
+            if (!alongOpenEdge || !(m_kinds[_to] == KIND_SEAM || m_kinds[_to] == KIND_LOCKED))
+                return false;
+
+            // the other vertex of the position collapses along the same edge, on the other side of the seam
+            _wedgeFrom = m_wedges[_from];
+            _wedgeTo = (m_openOut[_from] == _to) ? m_openIn[_wedgeFrom] : m_openOut[_wedgeFrom];
+            return _wedgeTo != _to && samePosition(_wedgeTo, _to);
+        }
+
+        default:
+            return false;
+    }
+}
+
+
+bool MeshSimplifier::flipsFaces(uint32_t _from, uint32_t _to) const
+{
+    const glm::vec3 &p = m_positions[_from];
+    const glm::vec3 &q = m_positions[_to];
+
+    for (const uint32_t *c = m_adjacency.begin(_from); c != m_adjacency.end(_from); c++)
+    {
+        const uint32_t a = m_indices[nextCorner(*c)];
+        const uint32_t b = m_indices[prevCorner(*c)];
+
+        // faces of the collapsed edge are removed
+        if (samePosition(a, _to) || samePosition(b, _to))
+            continue;
+
+        // degenerate faces (e.g. at the poles of a sphere) have no orientation to flip
+        const glm::vec3 &pa = m_positions[a];
+        const glm::vec3 &pb = m_positions[b];
+        const glm::vec3 normal = glm::cross(pa - p, pb - p);
+        if (normal.x == 0.0f && normal.y == 0.0f && normal.z == 0.0f)
+            continue;
+
+        if (glm::dot( normal, glm::cross(pa - q, pb - q) ) <= 0.0f)
+            return true;
+    }
+    return false;
+}
+
+
+size_t MeshSimplifier::collapsePass(size_t _nbTriangles)
+{
+    if (_nbTriangles == 0)
+        return 0;
+
+    const size_t nbIndices = m_indices.size();
+    const size_t nbVertices = m_positions.size();
+    const float inf = std::numeric_limits<float>::infinity();
+
+    classifyVertices();
+
+    // 1. cheapest valid collapse of each edge, considered once: from the face where
+    // it goes to a higher index, or from its only face (open edge)
+    std::vector<Collapse> candidates(nbIndices);
+    m_pool.run(numBlocks(nbIndices), [&](size_t b)
+    {
+        const size_t end = std::min(nbIndices, (b + 1) * BLOCK_SIZE);
+        for (size_t c = b * BLOCK_SIZE; c < end; c++)
+        {
+            Collapse &candidate = candidates[c];
+            candidate.from = NO_VERTEX;
+
+            const uint32_t v0 = m_indices[c];
+            const uint32_t v1 = m_indices[nextCorner(static_cast<uint32_t>(c))];
+            if ((v0 > v1 && !m_openEdges[c]) || samePosition(v0, v1))
+                continue;
+
+            uint32_t wedgeFrom, wedgeTo;
+            const float error01 = canCollapse(v0, v1, wedgeFrom, wedgeTo) ? quadricError(m_quadrics[v0], m_positions[v1] - m_positions[v0]) : inf;
+            const float error10 = canCollapse(v1, v0, wedgeFrom, wedgeTo) ? quadricError(m_quadrics[v1], m_positions[v0] - m_positions[v1]) : inf;
+
+            // (also discards NaN errors)
+            if (error01 <= error10 && error01 < inf)
+            {
+                candidate.from = v0;
+                candidate.to = v1;
+                candidate.error = error01;
+            }
+            else if (error10 < inf)
+            {
+                candidate.from = v1;
+                candidate.to = v0;
+                candidate.error = error10;
+            }
+        }
+    });
+
+    candidates.erase(std::remove_if(candidates.begin(), candidates.end(), [](const Collapse &_c) { return _c.from == NO_VERTEX; }), candidates.end());
+    if (candidates.empty())
+        return 0;
+
+    // 2. the pass is limited to PASS_ERROR_BOUND times the error of the collapse which would reach
+    // the goal (most collapses remove 2 triangles): only the candidates below are sorted
+    auto cheaper = [](const Collapse &_a, const Collapse &_b)
+    {
+        return _a.error < _b.error || (_a.error == _b.error && _a.from < _b.from);
+    };
+    const size_t goal = std::min(candidates.size() - 1, _nbTriangles / 2);
+    std::nth_element(candidates.begin(), candidates.begin() + goal, candidates.end(), cheaper);
+    const float errorBound = candidates[goal].error * PASS_ERROR_BOUND;
+    candidates.erase(std::partition(candidates.begin() + goal + 1, candidates.end(), [errorBound](const Collapse &_c) { return _c.error <= errorBound; }), candidates.end());
+    std::sort(candidates.begin(), candidates.end(), cheaper);
+
+    // 3. cheapest collapses first. Faces are only rewritten at the end of the pass: the vertices around
+    // a collapsed vertex do not move until then, so that flip tests see the current positions of their faces
+    // (they can still receive collapses, as the vertices collapsed onto, which do not move)
+    std::vector<uint8_t> locks(nbVertices, UNLOCKED);
+    std::vector<uint32_t> remap(nbVertices);
+    for (size_t v = 0; v < nbVertices; v++)
+        remap[v] = static_cast<uint32_t>(v);
+
+    auto lockPosition = [&](uint32_t _v, uint8_t _lock)
+    {
+        uint32_t w = _v;
+        do
+        {
+            locks[w] = std::max(locks[w], _lock);
+            w = m_wedges[w];
+        } while (w != _v);
+    };
+
+    size_t nbCollapses = 0;
+    size_t nbRemoved = 0;
+    for (size_t i = 0; i < candidates.size() && nbRemoved < _nbTriangles; i++)
+    {
+        const uint32_t from = candidates[i].from;
+        const uint32_t to = candidates[i].to;
+        if (locks[from] != UNLOCKED || locks[to] == LOCKED_COLLAPSED)
+            continue;
+
+        uint32_t wedgeFrom, wedgeTo;
+        canCollapse(from, to, wedgeFrom, wedgeTo);
+        if (flipsFaces(from, to) || (wedgeFrom != NO_VERTEX && flipsFaces(wedgeFrom, wedgeTo)))
+            continue;
+
+        remap[from] = to;
+        if (wedgeFrom != NO_VERTEX)
+            remap[wedgeFrom] = wedgeTo;
+
+        // the vertices of the position of _to inherit the planes of _from
+        const glm::vec3 offset = m_positions[to] - m_positions[from];
+        uint32_t w = to;
+        do
+        {
+            addQuadric(m_quadrics[w], m_quadrics[from], offset);
+            w = m_wedges[w];
+        } while (w != to);
+
+        m_error = std::max(m_error, candidates[i].error);
+        w = from;
+        do
+        {
+            for (const uint32_t *c = m_adjacency.begin(w); c != m_adjacency.end(w); c++)
+            {
+                lockPosition(m_indices[nextCorner(*c)], LOCKED_NEIGHBOR);
+                lockPosition(m_indices[prevCorner(*c)], LOCKED_NEIGHBOR);
+            }
+            w = m_wedges[w];
+        } while (w != from);
+        lockPosition(from, LOCKED_COLLAPSED);
+
+        nbCollapses++;
+        nbRemoved += (m_kinds[from] == KIND_BORDER) ? 1 : 2;
+    }
+
+    if (nbCollapses == 0)
+        return 0;
+
+    // 4. rewrite the faces, and remove the degenerate ones (compacted in each block, then between blocks)
+    const size_t nbFaces = nbIndices / 3;
+    std::vector<size_t> blockFaces(numBlocks(nbFaces));
+    m_pool.run(blockFaces.size(), [&](size_t b)
+    {
+        const size_t begin = b * BLOCK_SIZE;
+        const size_t end = std::min(nbFaces, begin + BLOCK_SIZE);
+        size_t kept = begin;
+        for (size_t f = begin; f < end; f++)
+        {
+            const uint32_t v0 = remap[m_indices[3 * f]];
+            const uint32_t v1 = remap[m_indices[3 * f + 1]];
+            const uint32_t v2 = remap[m_indices[3 * f + 2]];
+            if (samePosition(v0, v1) || samePosition(v1, v2) || samePosition(v2, v0))
+                continue;
+
+            m_indices[3 * kept] = v0;
+            m_indices[3 * kept + 1] = v1;
+            m_indices[3 * kept + 2] = v2;
+            kept++;
+        }
+        blockFaces[b] = kept - begin;
+    });
+
+    size_t nbKept = 0;
+    for (size_t b = 0; b < blockFaces.size(); b++)
+    {
+        if (nbKept != b * BLOCK_SIZE)
+            std::copy(m_indices.begin() + 3 * b * BLOCK_SIZE, m_indices.begin() + 3 * (b * BLOCK_SIZE + blockFaces[b]), m_indices.begin() + 3 * nbKept);
+        nbKept += blockFaces[b];
+    }
+    m_indices.resize(3 * nbKept);
+
+    buildVertexAdjacency(m_indices.data(), m_indices.size(), nbVertices, m_adjacency, m_pool);
+
+    return nbCollapses;
+}
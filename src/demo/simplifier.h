@@ -0,0 +1,190 @@
+/*********************************************************************************************************************
+ *
+ * simplifier.h
+ *
+ * Triangle mesh simplification with the quadric error metric
+ *
+ * QGL_toolkit demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#ifndef SIMPLIFIER_H
+#define SIMPLIFIER_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+
+
+#include "meshadjacency.h"
+
+
+class ThreadPool;
+
+
+/*!
+* \struct Quadric
+* \brief Sum of squared distances to planes, p^T A p + 2 b.p + c (A symmetric),
+* and sum of the areas of the faces (to normalize the error)
+*/
+struct Quadric
+{
+    float a00, a11, a22, a01, a02, a12;
+    float b0, b1, b2;
+    float c;
+    float area;
+};
+
+
+/*!
+* \class MeshSimplifier
+* \brief Simplification of an indexed triangle mesh by edge collapses, ordered by
+* the quadric error metric (Garland and Heckbert, "Surface Simplification Using Quadric Error Metrics").
+* Edges collapse onto one of their vertices (half edge collapses): simplified meshes only
+* rewrite the indices, and reference the vertices of the original mesh (e.g. its VBOs).
+* Vertices sharing a position with different attributes (normal or uv seams) only collapse along
+* the seam, with the vertices of both sides, so that seams are preserved. Open borders are kept as well.
+* Collapses are done in passes: candidates are computed and sorted in parallel, then the cheapest
+* ones which do not touch each other nor flip triangles are applied.
+* simplify() can be called with decreasing targets to build a chain of levels of detail.
+*/
+class MeshSimplifier
+{
+    public:
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                        CONSTRUCTORS / DESTRUCTORS                                           |
+        +------------------------------------------------------------------------------------------------------------*/
+
+        /*!
+        * \fn MeshSimplifier
+        * \brief Constructor of MeshSimplifier: copy the indices, and compute the quadrics of the vertices
+        * \param _indices : vertex indices, 3 per triangle
+        * \param _nbIndices : number of indices
+        * \param _vertices : vertex positions
+        * \param _nbVertices : number of vertices
+        * \param _pool : threads used by the simplification
+        */
+        MeshSimplifier(const uint32_t *_indices, size_t _nbIndices, const glm::vec3 *_vertices, size_t _nbVertices, ThreadPool &_pool);
+
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                              GETTERS/SETTERS                                                |
+        +-------------------------------------------------------------------------------------------------------------*/
+
+        /*! \fn indices \brief Indices of the simplified mesh */
+        const std::vector<uint32_t> &indices() const { return m_indices; }
+
+        /*!
+        * \fn error
+        * \brief Geometric error of the simplified mesh: max distance of the collapsed vertices
+        * to the planes of their original faces (in the units of the vertices)
+        */
+        float error() const;
+
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                                   MISC.                                                     |
+        +-------------------------------------------------------------------------------------------------------------*/
+
+        /*!
+        * \fn simplify
+        * \brief Collapse edges until the mesh has at most _targetIndexCount indices,
+        * or until no edge can be collapsed without breaking a seam, a border or flipping a triangle
+        * \param _targetIndexCount : target number of indices
+        * \return number of indices of the simplified mesh
+        */
+        size_t simplify(size_t _targetIndexCount);
+
+
+    protected:
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                                ATTRIBUTES                                                   |
+        +-------------------------------------------------------------------------------------------------------------*/
+
+        ThreadPool &m_pool;                     /*!< threads used by the simplification */
+
+        std::vector<uint32_t> m_indices;        /*!< indices of the simplified mesh */
+        std::vector<glm::vec3> m_positions;     /*!< vertex positions, scaled into the unit cube */
+        float m_scale;                          /*!< size of the bounding box (i.e. scale of m_positions) */
+
+        std::vector<uint32_t> m_wedges;         /*!< next vertex with the same position (circular list) */
+        std::vector<Quadric> m_quadrics;        /*!< quadric of each vertex (the same for the vertices of a position) */
+        float m_error;                          /*!< max error of the collapses (squared, in the unit cube) */
+
+        VertexAdjacency m_adjacency;            /*!< faces around each vertex, rebuilt by each pass */
+        std::vector<uint8_t> m_openEdges;       /*!< 1 if the edge starting at each corner has no opposite edge */
+        std::vector<uint32_t> m_openIn;         /*!< origin of the open edge ending at each vertex (see classifyVertices()) */
+        std::vector<uint32_t> m_openOut;        /*!< end of the open edge starting at each vertex */
+        std::vector<uint8_t> m_kinds;           /*!< collapses allowed for each vertex (see classifyVertices()) */
+
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                                    MISC.                                                    |
+        +-------------------------------------------------------------------------------------------------------------*/
+
+        /*!
+        * \fn hasEdge
+        * \brief Returns true if a face of the current mesh has the oriented edge (_a, _b)
+        */
+        bool hasEdge(uint32_t _a, uint32_t _b) const;
+
+        /*!
+        * \fn hasPositionEdge
+        * \brief Returns true if a face of the current mesh has an oriented edge from the position of _a to the position of _b
+        */
+        bool hasPositionEdge(uint32_t _a, uint32_t _b) const;
+
+        /*! \fn samePosition */
+        bool samePosition(uint32_t _a, uint32_t _b) const;
+
+        /*!
+        * \fn canCollapse
+        * \brief Returns true if the kinds of the vertices allow to collapse _from onto _to.
+        * For a seam, _wedgeFrom and _wedgeTo receive the edge collapsed on the other side (NO_VERTEX otherwise).
+        */
+        bool canCollapse(uint32_t _from, uint32_t _to, uint32_t &_wedgeFrom, uint32_t &_wedgeTo) const;
+
+        /*!
+        * \fn flipsFaces
+        * \brief Returns true if moving _from to the position of _to flips one of the faces around _from
+        */
+        bool flipsFaces(uint32_t _from, uint32_t _to) const;
+
+        /*!
+        * \fn classifyVertices
+        * \brief Find the open edges (without opposite edge) around each vertex, and classify the vertices:
+        * manifold (no open edge), border (one open edge in and out), seam (two vertices with the same position
+        * whose open edges match) or locked (anything else: never collapsed)
+        */
+        void classifyVertices();
+
+        /*!
+        * \fn computeQuadrics
+        * \brief Sum the quadrics of the faces around each position,
+        * and of planes orthogonal to the open borders (which keep borders in place).
+        * classifyVertices() must be called before.
+        */
+        void computeQuadrics();
+
+        /*!
+        * \fn collapsePass
+        * \brief Apply the cheapest valid collapses (at most one per vertex), until _nbTriangles are removed
+        * \return number of collapses
+        */
+        size_t collapsePass(size_t _nbTriangles);
+
+
+    private:
+
+        MeshSimplifier(const MeshSimplifier&);
+        MeshSimplifier &operator=(const MeshSimplifier&);
+};
+
+#endif // SIMPLIFIER_H
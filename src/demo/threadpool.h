@@ -0,0 +1,221 @@
+/*********************************************************************************************************************
+ *
+ * threadpool.h
+ *
+ * Minimal thread pool for data-parallel loops
+ *
+ * QGL_toolkit demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <cstdint>
+#include <string>
+
+#include "trace.h"
+
+
+/*!
+* \class ThreadPool
+* \brief Fixed set of worker threads executing data-parallel loops.
+* run() distributes the iterations of a loop over the workers and the calling
+* thread, and returns when all of them are done. Iterations are handed out
+* dynamically, so a loop should have a few times more iterations than threads.
+* Calls to run() from inside a task are executed serially by the calling thread.
+*/
+class ThreadPool
+{
+    public:
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                        CONSTRUCTORS / DESTRUCTORS                                           |
+        +------------------------------------------------------------------------------------------------------------*/
+
+        /*!
+        * \fn ThreadPool
+        * \brief Constructor of ThreadPool, starts the worker threads
+        * \param _nbThreads : total number of threads, including the calling thread (0: one per hardware thread)
+        */
+        explicit ThreadPool(unsigned int _nbThreads = 0)
+        : m_task(nullptr), m_nbTasks(0), m_nextTask(0), m_nbBusy(0), m_generation(0), m_stop(false)
+        {
+            if (_nbThreads == 0)
+                _nbThreads = std::max(1u, std::thread::hardware_concurrency());
+
+            for (unsigned int i = 1; i < _nbThreads; i++)
+                m_workers.push_back( std::thread(&ThreadPool::workerLoop, this, i) );
+        }
+
+        /*!
+        * \fn ~ThreadPool
+        * \brief Destructor of ThreadPool, joins the worker threads
+        */
+        ~ThreadPool()
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_stop = true;
+            }
+            m_wakeUp.notify_all();
+            for (size_t i = 0; i < m_workers.size(); i++)
+                m_workers[i].join();
+        }
+
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                                   MISC.                                                     |
+        +-------------------------------------------------------------------------------------------------------------*/
+
+        /*!
+        * \fn size
+        * \brief Returns the number of threads, including the calling thread
+        */
+        unsigned int size() const { return static_cast<unsigned int>(m_workers.size()) + 1; }
+
+        /*!
+        * \fn run
+        * \brief Execute _task(i) for every i in [0, _nbTasks), and wait for completion
+        * \param _nbTasks : number of iterations
+        * \param _task : loop body
+        */
+        void run(size_t _nbTasks, const std::function<void(size_t)> &_task)
+        {
+            if (_nbTasks == 0)
+                return;
+
+            if (m_workers.empty() || _nbTasks == 1 || insideTask())
+            {
+                for (size_t i = 0; i < _nbTasks; i++)
+                    _task(i);
+                return;
+            }
+
+            std::lock_guard<std::mutex> runLock(m_runMutex);
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_task = &_task;
+                m_nbTasks = _nbTasks;
+                m_nextTask = 0;
+                m_nbBusy = m_workers.size();
+                m_generation++;
+            }
+            m_wakeUp.notify_all();
+
+            // the calling thread takes part in the loop
+            insideTask() = true;
+            processTasks();
+            insideTask() = false;
+
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_done.wait(lock, [this]() { return m_nbBusy == 0; });
+            m_task = nullptr;
+        }
+
+        /*!
+        * \fn global
+        * \brief Returns a pool shared by the whole application, with one thread per hardware thread
+        */
+        static ThreadPool &global()
+        {
+            static ThreadPool pool;
+            return pool;
+        }
+
+
+    protected:
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                                ATTRIBUTES                                                   |
+        +------------------------------------------------------------------------------------------------------------*/
+
+        std::vector<std::thread> m_workers;                 /*!< worker threads */
+
+        std::mutex m_runMutex;                              /*!< serializes concurrent calls to run() */
+        std::mutex m_mutex;                                 /*!< protects the state of the current loop */
+        std::condition_variable m_wakeUp;                   /*!< wakes workers up when a loop starts */
+        std::condition_variable m_done;                     /*!< signaled when all workers are done */
+
+        const std::function<void(size_t)> *m_task;          /*!< current loop body */
+        size_t m_nbTasks;                                   /*!< number of iterations of the current loop */
+        std::atomic<size_t> m_nextTask;                     /*!< next iteration to execute */
+        size_t m_nbBusy;                                    /*!< number of workers still running the current loop */
+        uint64_t m_generation;                              /*!< incremented at every loop */
+        bool m_stop;                                        /*!< true when the workers must exit */
+
+
+        /*------------------------------------------------------------------------------------------------------------+
+        |                                                    MISC.                                                    |
+        +------------------------------------------------------------------------------------------------------------*/
+
+        /*!
+        * \fn insideTask
+        * \brief Returns true if the current thread is executing a task (used to serialize nested loops)
+        */
+        static bool &insideTask()
+        {
+            thread_local bool inside = false;
+            return inside;
+        }
+
+        /*!
+        * \fn processTasks
+        * \brief Execute iterations of the current loop until there is none left
+        */
+        void processTasks()
+        {
+            for (size_t i = m_nextTask++; i < m_nbTasks; i = m_nextTask++)
+                (*m_task)(i);
+        }
+
+        /*!
+        * \fn workerLoop
+        * \brief Main function of the worker threads
+        * \param _index : index of the worker (from 1), to name it in traces
+        */
+        void workerLoop(unsigned int _index)
+        {
+            QGL_TRACE_THREAD_NAME("worker " + std::to_string(_index));
+            insideTask() = true;
+
+            uint64_t generation = 0;
+            while (true)
+            {
+                {
+                    std::unique_lock<std::mutex> lock(m_mutex);
+                    m_wakeUp.wait(lock, [&]() { return m_stop || m_generation != generation; });
+                    if (m_stop)
+                        return;
+                    generation = m_generation;
+                }
+
+                {
+                    QGL_TRACE_SCOPE("ThreadPool::worker");
+                    processTasks();
+                }
+
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    if (--m_nbBusy == 0)
+                        m_done.notify_one();
+                }
+            }
+        }
+
+
+    private:
+
+        // Copy constructor and operator= are declared private and undefined
+        ThreadPool(const ThreadPool &);
+        ThreadPool &operator=(const ThreadPool &);
+};
+
+#endif // THREADPOOL_H
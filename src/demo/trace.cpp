@@ -0,0 +1,253 @@
+/*********************************************************************************************************************
+ *
+ * trace.cpp
+ *
+ * Scoped profiling zones, exported as a Chrome trace (JSON) to be opened in Perfetto or chrome://tracing
+ *
+ * QGL_toolkit demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+
+
+#include "trace.h"
+
+
+namespace
+{
+
+// Number of zones of a chunk of a thread buffer
+const size_t TRACE_CHUNK_SIZE = 4096;
+
+// Max number of chunks of a thread buffer (about 100 MB of zones), later zones are dropped
+const size_t TRACE_MAX_CHUNKS = 1024;
+
+
+struct TraceZone
+{
+    const char *name;
+    uint64_t start;
+    uint64_t end;
+};
+
+
+/*
+* Fixed-size block of zones. Only the owner thread writes: it fills a zone, then publishes it
+* by increasing count (release), so that the exporter can read the first count zones at any time.
+*/
+struct TraceChunk
+{
+    TraceZone zones[TRACE_CHUNK_SIZE];
+    std::atomic<size_t> count;
+    std::atomic<TraceChunk*> next;
+
+    TraceChunk() : count(0), next(nullptr) {}
+};
+
+
+/*
+* Zones of one thread: a list of chunks which only grows, chunks are never moved or freed
+* while the program runs, so the exporter does not need to lock the writer.
+*/
+struct TraceThread
+{
+    uint32_t id;
+    std::string name;           // protected by the mutex of the registry
+    TraceChunk *first;
+    TraceChunk *last;           // only used by the owner thread
+    size_t nbChunks;            // only used by the owner thread
+    std::atomic<uint64_t> nbDropped;
+
+    explicit TraceThread(uint32_t _id) : id(_id), first(new TraceChunk()), nbChunks(1), nbDropped(0)
+    {
+        last = first;
+    }
+};
+
+
+struct TraceRegistry
+{
+    std::mutex mutex;
+    std::vector<std::unique_ptr<TraceThread> > threads;
+};
+
+
+// Never destroyed: threads may record zones while static objects are destroyed at exit
+TraceRegistry &traceRegistry()
+{
+    static TraceRegistry *registry = new TraceRegistry();
+    return *registry;
+}
+
+
+// Buffer of the calling thread, registered on its first zone
+TraceThread &currentTraceThread()
+{
+    thread_local TraceThread *thread = nullptr;
+    if(!thread)
+    {
+        TraceRegistry &registry = traceRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        registry.threads.push_back( std::unique_ptr<TraceThread>( new TraceThread((uint32_t)registry.threads.size() + 1) ) );
+        thread = registry.threads.back().get();
+    }
+    return *thread;
+}
+
+
+// Start of the trace clock (first zone)
+std::chrono::steady_clock::time_point traceEpoch()
+{
+    static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+    return epoch;
+}
+
+
+#ifdef QGL_ENABLE_TRACING
+// Write a JSON string (names are literals, but may contain quotes or backslashes)
+void writeJSONString(std::ostream &_out, const char *_text)
+{
+    _out << '"';
+    for(const char *c = _text; *c; c++)
+    {
+        if(*c == '"' || *c == '\\')
+            _out << '\\' << *c;
+        else if((unsigned char)*c >= 0x20)
+            _out << *c;
+    }
+    _out << '"';
+}
+#endif
+
+} // namespace
+
+
+uint64_t traceTime()
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - traceEpoch()).count();
+}
+
+
+void recordTraceZone(const char *_name, uint64_t _start, uint64_t _end)
+{
+    TraceThread &thread = currentTraceThread();
+
+    TraceChunk *chunk = thread.last;
+    size_t count = chunk->count.load(std::memory_order_relaxed);
+    if(count == TRACE_CHUNK_SIZE)
+    {
+        if(thread.nbChunks == TRACE_MAX_CHUNKS)
+        {
+            thread.nbDropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        TraceChunk *next = new TraceChunk();
+        chunk->next.store(next, std::memory_order_release);
+        thread.last = next;
+        thread.nbChunks++;
+        chunk = next;
+        count = 0;
+    }
+
+    TraceZone &zone = chunk->zones[count];
+    zone.name = _name;
+    zone.start = _start;
+    zone.end = _end;
+    chunk->count.store(count + 1, std::memory_order_release);
+}
+
+
+void setTraceThreadName(const std::string &_name)
+{
+    TraceThread &thread = currentTraceThread();
+
+    std::lock_guard<std::mutex> lock(traceRegistry().mutex);
+    thread.name = _name;
+}
+
+
+bool writeChromeTrace(const std::string &_filename)
+{
+#ifndef QGL_ENABLE_TRACING
+    (void)_filename;
+    std::cerr << "[WARNING] writeChromeTrace(): tracing is disabled, enable the QGL_ENABLE_TRACING CMake option" << std::endl;
+    return false;
+#else
+    std::ofstream f(_filename.c_str(), std::ios::out | std::ios::trunc);
+    if(!f.is_open())
+    {
+        std::cerr << "[ERROR] writeChromeTrace(): Could not open " << _filename << std::endl;
+        return false;
+    }
+
+    // snapshot of the registered threads (their buffers are read without lock)
+    std::vector<TraceThread*> threads;
+    {
+        TraceRegistry &registry = traceRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        for(size_t i = 0; i < registry.threads.size(); i++)
+        {
+            TraceThread *thread = registry.threads[i].get();
+            threads.push_back(thread);
+
+            // thread names are metadata events
+            f << (i == 0 ? "{\"traceEvents\":[\n" : ",\n");
+            f << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread->id << ",\"args\":{\"name\":";
+            writeJSONString(f, thread->name.empty() ? ("thread " + std::to_string(thread->id)).c_str() : thread->name.c_str());
+            f << "}}";
+        }
+    }
+    if(threads.empty())
+        f << "{\"traceEvents\":[\n";
+
+    uint64_t nbZones = 0;
+    uint64_t nbDropped = 0;
+    char times[64];
+    for(size_t i = 0; i < threads.size(); i++)
+    {
+        const TraceThread &thread = *threads[i];
+        for(const TraceChunk *chunk = thread.first; chunk; chunk = chunk->next.load(std::memory_order_acquire))
+        {
+            const size_t count = chunk->count.load(std::memory_order_acquire);
+            for(size_t z = 0; z < count; z++)
+            {
+                const TraceZone &zone = chunk->zones[z];
+
+                // complete event, times in microseconds
+                std::snprintf(times, sizeof(times), "\"ts\":%.3f,\"dur\":%.3f", double(zone.start) * 1e-3, double(zone.end - zone.start) * 1e-3);
+                // (after the metadata events of the threads)
+                f << ",\n{\"name\":";
+                writeJSONString(f, zone.name);
+                f << ",\"cat\":\"qgl\",\"ph\":\"X\"," << times << ",\"pid\":1,\"tid\":" << thread.id << "}";
+                nbZones++;
+            }
+        }
+        nbDropped += thread.nbDropped.load(std::memory_order_relaxed);
+    }
+    f << "\n],\"displayTimeUnit\":\"ms\"}\n";
+    f.close();
+
+    if(f.fail())
+    {
+        std::cerr << "[ERROR] writeChromeTrace(): Could not write " << _filename << std::endl;
+        return false;
+    }
+
+    std::cout << "[INFO] writeChromeTrace(): " << nbZones << " zones of " << threads.size() << " threads written to " << _filename << std::endl;
+    if(nbDropped > 0)
+        std::cerr << "[WARNING] writeChromeTrace(): " << nbDropped << " zones were dropped (buffers full)" << std::endl;
+
+    return true;
+#endif
+}
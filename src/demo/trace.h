@@ -0,0 +1,102 @@
+/*********************************************************************************************************************
+ *
+ * trace.h
+ *
+ * Scoped profiling zones, exported as a Chrome trace (JSON) to be opened in Perfetto or chrome://tracing
+ *
+ * QGL_toolkit demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <string>
+#include <cstdint>
+
+
+/*
+* Zones are only recorded if QGL_ENABLE_TRACING is defined (CMake option of the same name),
+* otherwise the macros compile to nothing.
+*
+*   void TriMesh::computeNormals(...)
+*   {
+*       QGL_TRACE_SCOPE("TriMesh::computeNormals");
+*       ...
+*   }
+*
+* Each thread records its zones in its own buffer, without lock: a zone costs two clock reads.
+* Names must be string literals (only their address is recorded).
+*/
+#ifdef QGL_ENABLE_TRACING
+
+#define QGL_TRACE_CONCAT_(_a, _b) _a##_b
+#define QGL_TRACE_CONCAT(_a, _b) QGL_TRACE_CONCAT_(_a, _b)
+
+#define QGL_TRACE_SCOPE(_name) TraceScope QGL_TRACE_CONCAT(traceScope_, __LINE__)(_name)
+#define QGL_TRACE_THREAD_NAME(_name) setTraceThreadName(_name)
+
+#else
+
+// (the arguments are not evaluated, but their variables are still used)
+#define QGL_TRACE_SCOPE(_name) ((void)sizeof(_name))
+#define QGL_TRACE_THREAD_NAME(_name) ((void)sizeof(_name))
+
+#endif
+
+
+/*!
+* \fn traceTime
+* \brief Returns the time of the trace clock, in nanoseconds since the first call
+*/
+uint64_t traceTime();
+
+/*!
+* \fn recordTraceZone
+* \brief Add a zone to the buffer of the calling thread (see QGL_TRACE_SCOPE)
+* \param _name : name of the zone, string literal
+* \param _start : start time (see traceTime())
+* \param _end : end time
+*/
+void recordTraceZone(const char *_name, uint64_t _start, uint64_t _end);
+
+/*!
+* \fn setTraceThreadName
+* \brief Name of the calling thread in the trace (default: "thread <n>")
+*/
+void setTraceThreadName(const std::string &_name);
+
+/*!
+* \fn writeChromeTrace
+* \brief Write the zones recorded so far by all the threads to a Chrome trace JSON file
+* (complete events "ph":"X", times in microseconds). Can be called while other threads record zones.
+* \param _filename : path of the JSON file
+* \return false if tracing is disabled or if the file could not be written
+*/
+bool writeChromeTrace(const std::string &_filename);
+
+
+/*!
+* \class TraceScope
+* \brief Records a zone from its construction to its destruction (see QGL_TRACE_SCOPE)
+*/
+class TraceScope
+{
+    public:
+
+        explicit TraceScope(const char *_name) : m_name(_name), m_start(traceTime()) {}
+
+        ~TraceScope() { recordTraceZone(m_name, m_start, traceTime()); }
+
+    private:
+
+        const char *m_name;     /*!< name of the zone */
+        uint64_t m_start;       /*!< start time of the zone */
+
+        // Copy constructor and operator= are declared private and undefined
+        TraceScope(const TraceScope &);
+        TraceScope &operator=(const TraceScope &);
+};
+
+#endif // TRACE_H
@@ -10,143 +10,928 @@
  *********************************************************************************************************************/
 
 #include <algorithm>
+#include <cctype>
 #include <functional>
 #include <ios>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <filesystem>
+#include <cmath>
+#include <cstddef>
 	
 
 #include "trimesh.h"
+#include "objparser.h"
+#include "hashmap.h"
+#include "threadpool.h"
+#include "meshcache.h"
+#include "compressedfile.h"
+#include "plyparser.h"
+#include "gltfparser.h"
+#include "meshadjacency.h"
+#include "boundingvolume.h"
+#include "simplifier.h"
+#include "meshlet.h"
+#include "simd.h"
+#include "trace.h"
+
+
+namespace
+{
+    // Fractions of the triangles kept by the levels of detail of generateLODs()
+    const float LOD_RATIOS[] = { 0.5f, 0.25f, 0.1f, 0.02f };
+    // Meshes with fewer triangles have no levels of detail
+    const size_t LOD_MIN_TRIANGLES = 1 << 14;
+
+    // Get size and modification time of a file, used to detect outdated mesh caches
+    bool getFileStamp(const std::string &_filename, uint64_t &_size, int64_t &_time)
+    {
+        std::error_code ec;
+        const std::filesystem::path path(_filename);
+
+        _size = static_cast<uint64_t>( std::filesystem::file_size(path, ec) );
+        if (ec)
+            return false;
+
+        _time = static_cast<int64_t>( std::filesystem::last_write_time(path, ec).time_since_epoch().count() );
+        return !ec;
+    }
+
+    // Reverse the byte order of a 32-bit word
+    inline uint32_t byteSwap32(uint32_t _word)
+    {
+        return (_word >> 24) | ((_word >> 8) & 0xff00) | ((_word << 8) & 0xff0000) | (_word << 24);
+    }
+
+    // Copy the elements of a glTF accessor into the buffer bound to _target, at _offset.
+    // Tightly packed accessors are uploaded directly from the mapped file.
+    void uploadAccessor(GLenum _target, size_t _offset, const GltfAccessor &_accessor)
+    {
+        const size_t elementSize = _accessor.elementSize();
+        if (_accessor.count == 0)
+            return;
+
+        if (_accessor.isPacked())
+        {
+            glBufferSubData(_target, _offset, _accessor.count * elementSize, _accessor.data);
+            return;
+        }
+
+        // interleaved attributes are gathered first
+        std::vector<char> packed(_accessor.count * elementSize);
+        for (size_t i = 0; i < _accessor.count; i++)
+            std::memcpy(packed.data() + i * elementSize, _accessor.data + i * _accessor.stride, elementSize);
+        glBufferSubData(_target, _offset, packed.size(), packed.data());
+    }
+
+    // Per-instance attributes (glVertexAttribDivisor) are core in GL 3.3, the demo only requires GL 3.2
+    bool instancedArraysSupported()
+    {
+        return GLEW_VERSION_3_3 || GLEW_ARB_instanced_arrays;
+    }
+
+    // Set the divisor of an attribute with the entry point available (see instancedArraysSupported())
+    void vertexAttribDivisor(GLuint _index, GLuint _divisor)
+    {
+        if (GLEW_VERSION_3_3)
+            glVertexAttribDivisor(_index, _divisor);
+        else
+            glVertexAttribDivisorARB(_index, _divisor);
+    }
+
+    // Copy data into a range of the buffer bound to _target.
+    // The range is not in use by the GPU yet, so it is mapped without synchronization.
+    void uploadBufferRange(GLenum _target, size_t _offset, size_t _nbBytes, const void *_data)
+    {
+        if (_nbBytes == 0)
+            return;
+
+        void *dst = glMapBufferRange(_target, _offset, _nbBytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+        if (dst != nullptr)
+        {
+            std::memcpy(dst, _data, _nbBytes);
+            glUnmapBuffer(_target);
+        }
+        else
+        {
+            glBufferSubData(_target, _offset, _nbBytes, _data);
+        }
+    }
+
+    // Compute the normals of faces [_begin, _end): unit normals if _normalize is true
+    // (degenerate faces get a null normal), cross products of the edges (2 * area * unit normal) otherwise.
+    // With SSE2, 4 faces are processed at once, using the same operations as glm::cross and glm::normalize.
+    void computeFaceNormals(const glm::vec3 *_vertices, const uint32_t *_indices, size_t _begin, size_t _end,
+                            bool _normalize, glm::vec3 *_faceNormals)
+    {
+        size_t f = _begin;
+#ifdef QGL_USE_SSE2
+        for (; f + 4 <= _end; f += 4)
+        {
+            const uint32_t *face = _indices + 3 * f;
+            const glm::vec3 *p0[4] = { &_vertices[face[0]], &_vertices[face[3]], &_vertices[face[6]], &_vertices[face[9]] };
+            const glm::vec3 *p1[4] = { &_vertices[face[1]], &_vertices[face[4]], &_vertices[face[7]], &_vertices[face[10]] };
+            const glm::vec3 *p2[4] = { &_vertices[face[2]], &_vertices[face[5]], &_vertices[face[8]], &_vertices[face[11]] };
+
+            // transposed positions (one face per lane)
+            const __m128 x0 = _mm_setr_ps(p0[0]->x, p0[1]->x, p0[2]->x, p0[3]->x);
+            const __m128 y0 = _mm_setr_ps(p0[0]->y, p0[1]->y, p0[2]->y, p0[3]->y);
+            const __m128 z0 = _mm_setr_ps(p0[0]->z, p0[1]->z, p0[2]->z, p0[3]->z);
+            const __m128 ex = _mm_sub_ps(_mm_setr_ps(p1[0]->x, p1[1]->x, p1[2]->x, p1[3]->x), x0);
+            const __m128 ey = _mm_sub_ps(_mm_setr_ps(p1[0]->y, p1[1]->y, p1[2]->y, p1[3]->y), y0);
+            const __m128 ez = _mm_sub_ps(_mm_setr_ps(p1[0]->z, p1[1]->z, p1[2]->z, p1[3]->z), z0);
+            const __m128 fx = _mm_sub_ps(_mm_setr_ps(p2[0]->x, p2[1]->x, p2[2]->x, p2[3]->x), x0);
+            const __m128 fy = _mm_sub_ps(_mm_setr_ps(p2[0]->y, p2[1]->y, p2[2]->y, p2[3]->y), y0);
+            const __m128 fz = _mm_sub_ps(_mm_setr_ps(p2[0]->z, p2[1]->z, p2[2]->z, p2[3]->z), z0);
+
+            __m128 nx = _mm_sub_ps(_mm_mul_ps(ey, fz), _mm_mul_ps(fy, ez));
+            __m128 ny = _mm_sub_ps(_mm_mul_ps(ez, fx), _mm_mul_ps(fz, ex));
+            __m128 nz = _mm_sub_ps(_mm_mul_ps(ex, fy), _mm_mul_ps(fx, ey));
+
+            if (_normalize)
+            {
+                const __m128 length2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, nx), _mm_mul_ps(ny, ny)), _mm_mul_ps(nz, nz));
+                const __m128 valid = _mm_cmpgt_ps(length2, _mm_setzero_ps());
+                const __m128 invLength = _mm_and_ps(valid, _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(length2)));
+                nx = _mm_mul_ps(nx, invLength);
+                ny = _mm_mul_ps(ny, invLength);
+                nz = _mm_mul_ps(nz, invLength);
+            }
+
+            alignas(16) float outX[4], outY[4], outZ[4];
+            _mm_store_ps(outX, nx);
+            _mm_store_ps(outY, ny);
+            _mm_store_ps(outZ, nz);
+            for (unsigned int k = 0; k < 4; k++)
+                _faceNormals[f + k] = glm::vec3(outX[k], outY[k], outZ[k]);
+        }
+#endif
+        for (; f < _end; f++)
+        {
+            const glm::vec3 &p0 = _vertices[_indices[3 * f]];
+            glm::vec3 normal = glm::cross(_vertices[_indices[3 * f + 1]] - p0, _vertices[_indices[3 * f + 2]] - p0);
+            if (_normalize)
+            {
+                const float length2 = glm::dot(normal, normal);
+                normal = (length2 > 0.0f) ? normal * (1.0f / std::sqrt(length2)) : glm::vec3(0.0f);
+            }
+            _faceNormals[f] = normal;
+        }
+    }
+
+} // anonymous namespace
+
 
 TriMesh::TriMesh()
 {
     m_bBoxMin = glm::vec3(0.0f, 0.0f, 0.0f);
     m_bBoxMax = glm::vec3(0.0f, 0.0f, 0.0f);
+    m_bSphereCenter = glm::vec3(0.0f, 0.0f, 0.0f);
+    m_bSphereRadius = 0.0f;
 
     m_ambientColor = glm::vec3(0.04f, 0.04f, 0.06f);
     m_diffuseColor = glm::vec3(0.82f, 0.66f, 0.43f);
     m_specularColor = glm::vec3(0.9f, 0.9f, 0.9f);
 
     m_specPow = 128.0f;
+    m_materialIsModified = true;
+
+    m_meshCacheEnabled = true;
+    m_indexOptimizationEnabled = true;
+    m_meshCacheHeader = nullptr;
+    m_indicesAreOptimized = false;
+    m_isLoading = false;
+
+    m_program = 0;
+    m_meshVAO = 0;
+    m_defaultVAO = 0;
+    m_vertexVBO = 0;
+    m_normalVBO = 0;
+    m_texcoordVBO = 0;
+    m_colorVBO = 0;
+    m_indexVBO = 0;
+    m_instanceVBO = 0;
+    m_numVertices = 0;
+    m_numIndices = 0;
+
+    m_streamingUpload = false;
+    m_uploadBudget = 16 * 1024 * 1024;
+    m_numUploadedVertices = 0;
+    m_numUploadedIndices = 0;
+    m_numDrawableIndices = 0;
+
+    m_lodEnabled = true;
+    m_lodPixelError = 1.0f;
+
+    m_meshletCullingEnabled = true;
+    m_backfaceCulling = false;
+    m_numDrawnIndices = 0;
+    m_numDrawCalls = 0;
+    m_drawnLevel = 0;
+    m_numCulledIndices = 0;
+
+    m_instancesBSphereCenter = glm::vec3(0.0f, 0.0f, 0.0f);
+    m_instancesBSphereRadius = 0.0f;
+    m_instanceCapacity = 0;
+    m_instancesAreUploaded = false;
+
+    m_version = 1;
+    m_drawnVersion = 0;
+    m_drawnCameraVersion = 0;
 }
 
 
 TriMesh::~TriMesh()
 {
+    // the worker thread of readFileAsync() accesses the mesh
+    if(m_loading.valid())
+        m_loading.wait();
+
     clear();
 
+    // GL resources only exist once createVAO() has been called
+    // (meshes used without GL context, e.g. by benchmarks, must not call GL)
+    if(!hasVAO())
+        return;
+
     glDeleteBuffers(1, &(m_vertexVBO));
     glDeleteBuffers(1, &(m_normalVBO));
+    glDeleteBuffers(1, &(m_texcoordVBO));
     glDeleteBuffers(1, &(m_colorVBO));
     glDeleteBuffers(1, &(m_indexVBO));
+    glDeleteBuffers(1, &(m_instanceVBO));
     glDeleteVertexArrays(1, &(m_meshVAO));
 }
 
 
-bool TriMesh::readFile(std::string _filename)
+bool TriMesh::readFile(std::string _filename, unsigned int _nbThreads)
 {
-    if(_filename.substr(_filename.find_last_of(".") + 1) == "obj")
+    QGL_TRACE_SCOPE("TriMesh::readFile");
+    return loadFile(_filename, _nbThreads, false);
+}
+
+
+bool TriMesh::loadFile(const std::string &_filename, unsigned int _nbThreads, bool _prepareForDrawing)
+{
+    clear();
+
+    // compressed files (.obj.gz, .obj.zst) are identified by the extension of the uncompressed file
+    const bool compressed = CompressedFileReader::isCompressedFilename(_filename);
+    const std::string uncompressedFilename = CompressedFileReader::stripCompressedExtension(_filename);
+
+    std::string extension = uncompressedFilename.substr(uncompressedFilename.find_last_of(".") + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char _c) { return static_cast<char>(std::tolower(_c)); });
+
+    if(extension != "obj" && (compressed || (extension != "ply" && extension != "stl" && extension != "gltf" && extension != "glb")))
     {
-        importOBJ(_filename);
-        return true;
+        std::cerr << "[ERROR] TriMesh::readFile(): Invalid file extension: only .obj (optionally .gz or .zst compressed), .ply, .stl, .gltf and .glb are supported" << std::endl;
+        return false;
+    }
+
+    // glTF buffers are used directly from the mapped file, a mesh cache would not be faster
+    const bool gltf = (extension == "gltf" || extension == "glb");
+    const std::string cacheFilename = _filename + MESH_CACHE_EXTENSION;
+    const bool fromCache = !gltf && m_meshCacheEnabled && readMeshCache(cacheFilename, _filename);
+
+    bool imported = false;
+    if(gltf)
+    {
+        imported = importGLTF(_filename);
+    }
+    else if(fromCache)
+    {
+        imported = true;
+    }
+    else if(extension == "obj")
+    {
+        // compressed files are always read by importOBJ(), which parses them while they are decompressed
+        const bool serial = _nbThreads == 1 || compressed || (_nbThreads == 0 && ThreadPool::global().size() == 1);
+        imported = serial ? importOBJ(_filename) : importOBJParallel(_filename, _nbThreads);
+    }
+    else if(extension == "ply")
+    {
+        imported = importPLY(_filename);
     }
     else
     {
-        std::cerr << "[ERROR] TriMesh::readFile(): Invalid file extension: only .obj are supported" << std::endl;
+        imported = importSTL(_filename);
     }
-    return false;
+
+    if(!imported)
+        return false;
+
+    // the mesh cache stores the optimized order and the AABB (parsed meshes only)
+    const bool parsed = !gltf && !fromCache;
+    if(parsed && m_indexOptimizationEnabled)
+        optimizeIndexOrder();
+
+    computeAABB();
+
+    if(parsed && m_meshCacheEnabled)
+        writeMeshCache(cacheFilename, _filename);
+
+    if(_prepareForDrawing)
+    {
+        computeBoundingSphere();
+        if(m_lodEnabled)
+            generateLODs();
+        computeBVH();
+        computeVertexClusters();
+    }
+    return true;
 }
 
 
-void TriMesh::computeAABB()
+std::shared_future<bool> TriMesh::readFileAsync(const std::string &_filename, unsigned int _nbThreads, std::function<void(bool)> _onDone)
+{
+    if(m_loading.valid())
+        m_loading.wait();
+
+    m_isLoading = true;
+    m_loading = std::async(std::launch::async, [this, _filename, _nbThreads, _onDone]() 
+    {
+        QGL_TRACE_THREAD_NAME("loader");
+        QGL_TRACE_SCOPE("TriMesh::readFileAsync");
+        const bool loaded = loadFile(_filename, _nbThreads, true);
+
+        // the mesh is complete: the callback (and the GL thread it notifies) can use it
+        // even though the future is not ready until the callback returns
+        m_isLoading.store(false, std::memory_order_release);
+
+        if(_onDone)
+            _onDone(loaded);
+
+        return loaded;
+    }).share();
+
+    return m_loading;
+}
+
+
+bool TriMesh::isLoading() const
+{
+    return m_isLoading.load(std::memory_order_acquire);
+}
+
+
+bool TriMesh::writeMeshCache(const std::string &_cacheFilename, const std::string &_sourceFilename)
 {
-    if(m_vertices.size() != 0)
+    QGL_TRACE_SCOPE("TriMesh::writeMeshCache");
+    MeshCacheHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, MESH_CACHE_MAGIC, sizeof(MESH_CACHE_MAGIC));
+    header.version = MESH_CACHE_VERSION;
+    header.endianTag = MESH_CACHE_ENDIAN_TAG;
+    header.flags = MESH_CACHE_VALIDATED_INDICES | (m_indicesAreOptimized ? MESH_CACHE_OPTIMIZED_INDICES : 0);
+
+    if(!_sourceFilename.empty() && !getFileStamp(_sourceFilename, header.sourceSize, header.sourceTime))
+    {
+        std::cerr << "[WARNING] TriMesh::writeMeshCache(): Could not stat " << _sourceFilename << std::endl;
+        return false;
+    }
+
+    header.numVertices = numVertexData();
+    header.numNormals = numNormalData();
+    header.numTexcoords = numTexcoordData();
+    header.numIndices = numIndexData();
+    header.numMeshlets = m_meshlets.size();
+
+    // Indices are checked here once, so that readMeshCache() does not scan them at each cache hit
+    // (the data is used without further checks by the simplifier, the normals computation and the GPU upload)
+    const uint32_t *indices = indexData();
+    uint32_t maxIndex = 0;
+    for(uint64_t i = 0; i < header.numIndices; i++)
+        maxIndex = std::max(maxIndex, indices[i]);
+    if( (header.numIndices != 0 && maxIndex >= header.numVertices) ||
+        (header.numNormals != 0 && header.numNormals != header.numVertices) ||
+        (header.numTexcoords != 0 && header.numTexcoords != header.numVertices) )
     {
-        // init values
-        glm::vec3 min = m_vertices[0];
-        glm::vec3 max = m_vertices[0];
+        std::cerr << "[WARNING] TriMesh::writeMeshCache(): Invalid mesh, no cache written for " << _sourceFilename << std::endl;
+        return false;
+    }
+
+    header.verticesOffset = alignMeshCacheOffset(sizeof(MeshCacheHeader));
+    header.normalsOffset = alignMeshCacheOffset(header.verticesOffset + header.numVertices * sizeof(glm::vec3));
+    header.texcoordsOffset = alignMeshCacheOffset(header.normalsOffset + header.numNormals * sizeof(glm::vec3));
+    header.indicesOffset = alignMeshCacheOffset(header.texcoordsOffset + header.numTexcoords * sizeof(glm::vec2));
+    header.meshletsOffset = alignMeshCacheOffset(header.indicesOffset + header.numIndices * sizeof(uint32_t));
 
-        for (unsigned int i = 0; i <m_vertices.size(); i++) 
+    for(unsigned int i = 0; i < 3; i++)
+    {
+        header.bBoxMin[i] = m_bBoxMin[i];
+        header.bBoxMax[i] = m_bBoxMax[i];
+    }
+
+    // Write in a temporary file first, so that a partially written cache is never read
+    const std::string tmpFilename = _cacheFilename + ".tmp";
+    {
+        std::ofstream f(tmpFilename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+        if(!f.is_open())
         {
-            if(m_vertices[i].x < min.x) { min.x = m_vertices[i].x; }
-            if(m_vertices[i].y < min.y) { min.y = m_vertices[i].y; }
-            if(m_vertices[i].z < min.z) { min.z = m_vertices[i].z; }
-            if(m_vertices[i].x > max.x) { max.x = m_vertices[i].x; }
-            if(m_vertices[i].y > max.y) { max.y = m_vertices[i].y; }
-            if(m_vertices[i].z > max.z) { max.z = m_vertices[i].z; }
+            std::cerr << "[WARNING] TriMesh::writeMeshCache(): Could not open " << tmpFilename << std::endl;
+            return false;
+        }
+
+        const char padding[MESH_CACHE_ALIGNMENT] = { 0 };
+        uint64_t offset = 0;
+        auto writeSection = [&](uint64_t _offset, const void *_data, uint64_t _nbBytes) 
+        {
+            f.write(padding, _offset - offset);
+            f.write(static_cast<const char*>(_data), _nbBytes);
+            offset = _offset + _nbBytes;
+        };
+
+        writeSection(0, &header, sizeof(header));
+        writeSection(header.verticesOffset, vertexData(), header.numVertices * sizeof(glm::vec3));
+        writeSection(header.normalsOffset, normalData(), header.numNormals * sizeof(glm::vec3));
+        writeSection(header.texcoordsOffset, texcoordData(), header.numTexcoords * sizeof(glm::vec2));
+        writeSection(header.indicesOffset, indexData(), header.numIndices * sizeof(uint32_t));
+        writeSection(header.meshletsOffset, m_meshlets.data(), header.numMeshlets * sizeof(Meshlet));
+
+        if(!f.good())
+        {
+            std::cerr << "[WARNING] TriMesh::writeMeshCache(): Could not write " << tmpFilename << std::endl;
+            f.close();
+            std::remove(tmpFilename.c_str());
+            return false;
         }
-        m_bBoxMin = min;
-        m_bBoxMax = max;
     }
-    else
+
+    std::error_code ec;
+    std::filesystem::rename(tmpFilename, _cacheFilename, ec);
+    if(ec)
+    {
+        std::cerr << "[WARNING] TriMesh::writeMeshCache(): Could not write " << _cacheFilename << std::endl;
+        std::remove(tmpFilename.c_str());
+        return false;
+    }
+
+    std::cout << "[INFO] TriMesh::writeMeshCache(): Mesh cache written in " << _cacheFilename << std::endl;
+    return true;
+}
+
+
+bool TriMesh::readMeshCache(const std::string &_cacheFilename, const std::string &_sourceFilename)
+{
+    QGL_TRACE_SCOPE("TriMesh::readMeshCache");
+    clear();
+
+    if(!m_meshCache.open(_cacheFilename))
+        return false;
+
+    const MeshCacheHeader *header = reinterpret_cast<const MeshCacheHeader*>(m_meshCache.data());
+    const uint64_t fileSize = m_meshCache.size();
+
+    // Check format
+    bool valid = fileSize >= sizeof(MeshCacheHeader) &&
+                 std::memcmp(header->magic, MESH_CACHE_MAGIC, sizeof(MESH_CACHE_MAGIC)) == 0 &&
+                 header->version == MESH_CACHE_VERSION &&
+                 header->endianTag == MESH_CACHE_ENDIAN_TAG;
+
+    // Check that all sections are inside the file
+    valid = valid &&
+            header->verticesOffset <= fileSize && header->numVertices <= (fileSize - header->verticesOffset) / sizeof(glm::vec3) &&
+            header->normalsOffset <= fileSize && header->numNormals <= (fileSize - header->normalsOffset) / sizeof(glm::vec3) &&
+            header->texcoordsOffset <= fileSize && header->numTexcoords <= (fileSize - header->texcoordsOffset) / sizeof(glm::vec2) &&
+            header->indicesOffset <= fileSize && header->numIndices <= (fileSize - header->indicesOffset) / sizeof(uint32_t) &&
+            header->meshletsOffset <= fileSize && header->numMeshlets <= (fileSize - header->meshletsOffset) / sizeof(Meshlet);
+
+    // Check that the meshlets are inside the index buffer
+    const Meshlet *meshlets = valid ? reinterpret_cast<const Meshlet*>(m_meshCache.data() + header->meshletsOffset) : nullptr;
+    for(uint64_t m = 0; valid && m < header->numMeshlets; m++)
+        valid = meshlets[m].indexOffset <= header->numIndices && meshlets[m].count <= header->numIndices - meshlets[m].indexOffset;
+
+    // Check that attributes are given for all the vertices or for none, and that the indices
+    // were checked by writeMeshCache() (they are not scanned again here)
+    valid = valid &&
+            (header->numNormals == 0 || header->numNormals == header->numVertices) &&
+            (header->numTexcoords == 0 || header->numTexcoords == header->numVertices) &&
+            (header->flags & MESH_CACHE_VALIDATED_INDICES) != 0;
+
+    if(!valid)
+    {
+        std::cerr << "[WARNING] TriMesh::readMeshCache(): Invalid mesh cache " << _cacheFilename << std::endl;
+        m_meshCache.close();
+        return false;
+    }
+
+    // Check that the source file did not change since the cache was written
+    if(!_sourceFilename.empty())
     {
+        uint64_t sourceSize = 0;
+        int64_t sourceTime = 0;
+        if(!getFileStamp(_sourceFilename, sourceSize, sourceTime) || sourceSize != header->sourceSize || sourceTime != header->sourceTime)
+        {
+            std::cout << "[INFO] TriMesh::readMeshCache(): Mesh cache " << _cacheFilename << " is outdated" << std::endl;
+            m_meshCache.close();
+            return false;
+        }
+    }
+
+    // Check that the cache was written with the same index order option
+    const bool optimized = (header->flags & MESH_CACHE_OPTIMIZED_INDICES) != 0;
+    if(optimized != m_indexOptimizationEnabled)
+    {
+        std::cout << "[INFO] TriMesh::readMeshCache(): Mesh cache " << _cacheFilename << " was written with another index order" << std::endl;
+        m_meshCache.close();
+        return false;
+    }
+
+    m_meshCacheHeader = header;
+    m_indicesAreOptimized = optimized;
+    // meshlets are small, and read by draw() at each frame
+    m_meshlets.assign(meshlets, meshlets + header->numMeshlets);
+    m_bBoxMin = glm::vec3(header->bBoxMin[0], header->bBoxMin[1], header->bBoxMin[2]);
+    m_bBoxMax = glm::vec3(header->bBoxMax[0], header->bBoxMax[1], header->bBoxMax[2]);
+
+    std::cout << "[INFO] TriMesh::readMeshCache(): Mesh read from cache " << _cacheFilename << std::endl;
+    return true;
+}
+
+
+const glm::vec3 *TriMesh::vertexData() const
+{
+    if(m_meshCacheHeader)
+        return reinterpret_cast<const glm::vec3*>(m_meshCache.data() + m_meshCacheHeader->verticesOffset);
+    return m_vertices.data();
+}
+
+
+size_t TriMesh::numVertexData() const
+{
+    return m_meshCacheHeader ? static_cast<size_t>(m_meshCacheHeader->numVertices) : m_vertices.size();
+}
+
+
+const glm::vec3 *TriMesh::normalData() const
+{
+    if(m_meshCacheHeader)
+        return reinterpret_cast<const glm::vec3*>(m_meshCache.data() + m_meshCacheHeader->normalsOffset);
+    return m_normals.data();
+}
+
+
+size_t TriMesh::numNormalData() const
+{
+    return m_meshCacheHeader ? static_cast<size_t>(m_meshCacheHeader->numNormals) : m_normals.size();
+}
+
+
+const glm::vec2 *TriMesh::texcoordData() const
+{
+    if(m_meshCacheHeader)
+        return reinterpret_cast<const glm::vec2*>(m_meshCache.data() + m_meshCacheHeader->texcoordsOffset);
+    return m_texcoords.data();
+}
+
+
+size_t TriMesh::numTexcoordData() const
+{
+    return m_meshCacheHeader ? static_cast<size_t>(m_meshCacheHeader->numTexcoords) : m_texcoords.size();
+}
+
+
+const uint32_t *TriMesh::indexData() const
+{
+    if(m_meshCacheHeader)
+        return reinterpret_cast<const uint32_t*>(m_meshCache.data() + m_meshCacheHeader->indicesOffset);
+    return m_indices.data();
+}
+
+
+size_t TriMesh::numIndexData() const
+{
+    return m_meshCacheHeader ? static_cast<size_t>(m_meshCacheHeader->numIndices) : m_indices.size();
+}
+
+
+void TriMesh::computeAABB()
+{
+    QGL_TRACE_SCOPE("TriMesh::computeAABB");
+    // AABB is precomputed in mesh caches, and read from the accessors of glTF files
+    if(m_meshCacheHeader || m_gltf)
+        return;
+
+    std::vector<PointArray> arrays(1);
+    arrays[0].data = reinterpret_cast<const char*>(m_vertices.data());
+    arrays[0].count = m_vertices.size();
+    arrays[0].stride = sizeof(glm::vec3);
+
+    if(!computeBoundingBox(arrays, m_bBoxMin, m_bBoxMax, ThreadPool::global()))
         std::cerr << "[WARNING] TriMesh::computeAABB: Empty vertices array" << std::endl;
-        m_bBoxMin = glm::vec3(0.0f, 0.0f, 0.0f);
-        m_bBoxMax = glm::vec3(0.0f, 0.0f, 0.0f);
+}
+
+
+void TriMesh::computeBoundingSphere()
+{
+    QGL_TRACE_SCOPE("TriMesh::computeBoundingSphere");
+    // vertices are read from the mapped file for mesh caches and glTF files
+    std::vector<PointArray> arrays;
+    if(m_gltf)
+    {
+        const std::vector<GltfPrimitive> &primitives = m_gltf->primitives();
+        for(size_t p = 0; p < primitives.size(); p++)
+        {
+            PointArray array;
+            array.data = primitives[p].positions.data;
+            array.count = primitives[p].positions.count;
+            array.stride = primitives[p].positions.stride;
+            arrays.push_back(array);
+        }
     }
+    else
+    {
+        PointArray array;
+        array.data = reinterpret_cast<const char*>(vertexData());
+        array.count = numVertexData();
+        array.stride = sizeof(glm::vec3);
+        arrays.push_back(array);
+    }
+
+    if(!::computeBoundingSphere(arrays, m_bBoxMin, m_bBoxMax, m_bSphereCenter, m_bSphereRadius, ThreadPool::global()))
+        std::cerr << "[WARNING] TriMesh::computeBoundingSphere: Empty vertices array" << std::endl;
 }
 
 
-void TriMesh::computeNormals()
+void TriMesh::computeNormals(NormalWeighting _weighting)
 {
-    std::int32_t vertexIndex0, vertexIndex1, vertexIndex2;
-    glm::vec3 normal;
+    QGL_TRACE_SCOPE("TriMesh::computeNormals");
+    // Number of faces (or vertices) processed by a task
+    const size_t BLOCK_SIZE = 1 << 14;
 
-    m_normals.clear();
-    m_normals.resize(m_vertices.size(), glm::vec3(0.0f, 0.0f, 0.0f));
+    detachMeshCache();
+
+    const size_t nbVertices = m_vertices.size();
+    const size_t nbFaces = m_indices.size() / 3;
+    ThreadPool &pool = ThreadPool::global();
 
-    // 1. compute per-vertex normals by averaging the unnormalized face normals
-    for (unsigned int i = 0; i < m_indices.size(); i += 3) 
+    // 1. face normals (unit normals, or scaled by twice the area for NORMALS_AREA),
+    // and angles of the faces at their corners for NORMALS_ANGLE
+    std::vector<glm::vec3> faceNormals(nbFaces);
+    std::vector<float> cornerAngles( (_weighting == NORMALS_ANGLE) ? 3 * nbFaces : 0 );
+    pool.run((nbFaces + BLOCK_SIZE - 1) / BLOCK_SIZE, [&](size_t b)
     {
-        vertexIndex0 = m_indices[i];
-        vertexIndex1 = m_indices[i + 1];
-        vertexIndex2 = m_indices[i + 2];
+        const size_t begin = b * BLOCK_SIZE;
+        const size_t end = std::min(nbFaces, begin + BLOCK_SIZE);
+        computeFaceNormals(m_vertices.data(), m_indices.data(), begin, end, (_weighting != NORMALS_AREA), faceNormals.data());
 
-        //compute current face normal
-        glm::vec3 faceNormal = glm::cross(m_vertices[vertexIndex1] - m_vertices[vertexIndex0],  m_vertices[vertexIndex2] - m_vertices[vertexIndex0]);
-        if( faceNormal != glm::vec3(0.0f) )
-            faceNormal = glm::normalize(faceNormal);
+        if (_weighting == NORMALS_ANGLE)
+        {
+            for (size_t f = begin; f < end; f++)
+            {
+                const glm::vec3 p[3] = { m_vertices[m_indices[3 * f]], m_vertices[m_indices[3 * f + 1]], m_vertices[m_indices[3 * f + 2]] };
+                // the norm of the cross product of the edges is the same at the 3 corners
+                const float crossNorm = glm::length( glm::cross(p[1] - p[0], p[2] - p[0]) );
+                for (unsigned int k = 0; k < 3; k++)
+                    cornerAngles[3 * f + k] = std::atan2(crossNorm, glm::dot(p[(k + 1) % 3] - p[k], p[(k + 2) % 3] - p[k]));
+            }
+        }
+    });
 
-        // add current face normal to adjacent vertices
-        m_normals[vertexIndex0] += faceNormal;
-        m_normals[vertexIndex1] += faceNormal;
-        m_normals[vertexIndex2] += faceNormal;
+    // 2. each vertex normal is the normalized sum of the normals of its faces
+    // (faces are summed in increasing order in both cases, so results do not depend on the number of threads)
+    m_normals.clear();
+    m_normals.resize(nbVertices, glm::vec3(0.0f));
+    if (pool.size() == 1)
+    {
+        // a single thread scatters the face normals, no need for the adjacency
+        for (size_t c = 0; c < 3 * nbFaces; c++)
+            m_normals[m_indices[c]] += (_weighting == NORMALS_ANGLE) ? faceNormals[c / 3] * cornerAngles[c] : faceNormals[c / 3];
     }
-    for (unsigned int i = 0; i < m_normals.size(); i++) 
+    else
     {
-        // vertex normal is avg of adjacent faces' normals
-        m_normals[i] = glm::normalize(m_normals[i]);
+        // vertices gather the normals of their faces in parallel, through the vertex to face adjacency
+        VertexAdjacency adjacency;
+        buildVertexAdjacency(m_indices.data(), 3 * nbFaces, nbVertices, adjacency, pool);
+
+        pool.run((nbVertices + BLOCK_SIZE - 1) / BLOCK_SIZE, [&](size_t b)
+        {
+            const size_t end = std::min(nbVertices, (b + 1) * BLOCK_SIZE);
+            for (size_t v = b * BLOCK_SIZE; v < end; v++)
+            {
+                glm::vec3 normal(0.0f);
+                if (_weighting == NORMALS_ANGLE)
+                {
+                    for (const uint32_t *c = adjacency.begin(v); c != adjacency.end(v); c++)
+                        normal += faceNormals[*c / 3] * cornerAngles[*c];
+                }
+                else
+                {
+                    for (const uint32_t *c = adjacency.begin(v); c != adjacency.end(v); c++)
+                        normal += faceNormals[*c / 3];
+                }
+                m_normals[v] = normal;
+            }
+        });
     }
 
+    // 3. normalization (isolated vertices keep a null normal)
+    pool.run((nbVertices + BLOCK_SIZE - 1) / BLOCK_SIZE, [&](size_t b)
+    {
+        const size_t end = std::min(nbVertices, (b + 1) * BLOCK_SIZE);
+        for (size_t v = b * BLOCK_SIZE; v < end; v++)
+        {
+            const float length2 = glm::dot(m_normals[v], m_normals[v]);
+            m_normals[v] = (length2 > 0.0f) ? m_normals[v] * (1.0f / std::sqrt(length2)) : glm::vec3(0.0f);
+        }
+    });
+
     std::cout << "[INFO] TriMesh::computeNormals(): Normals computed" << std::endl;
 }
 
 
-void TriMesh::createVAO()
+void TriMesh::computeBVH()
 {
-        
-    if(m_vertices.size() == 0)
-        std::cerr << "[WARNING] DrawableMesh::createVAO(): No vertex provided" << std::endl;
-    if(m_normals.size() == 0)
-        std::cerr << "[WARNING] DrawableMesh::createVAO(): No normal provided" << std::endl;
-    if(m_indices.size() == 0)
-        std::cerr << "[WARNING] DrawableMesh::createVAO(): No index provided" << std::endl;
+    QGL_TRACE_SCOPE("TriMesh::computeBVH");
+    m_bvh.clear();
 
-    // Generates and populates a VBO for vertex coords
-    glGenBuffers(1, &(m_vertexVBO));
-    glBindBuffer(GL_ARRAY_BUFFER, m_vertexVBO);
-    size_t verticesNBytes = m_vertices.size() * sizeof(m_vertices[0]);
-    glBufferData(GL_ARRAY_BUFFER, verticesNBytes, m_vertices.data(), GL_STATIC_DRAW);
+    // (for glTF data, the positions and indices copied by importGLTF())
+    m_bvh.build(indexData(), numIndexData(), vertexData(), numVertexData(), ThreadPool::global());
 
-    // Generates and populates a VBO for vertex normals
-    glGenBuffers(1, &(m_normalVBO));
-    glBindBuffer(GL_ARRAY_BUFFER, m_normalVBO);
-    size_t normalsNBytes = m_normals.size() * sizeof(m_normals[0]);
-    glBufferData(GL_ARRAY_BUFFER, normalsNBytes, m_normals.data(), GL_STATIC_DRAW);
+    std::cout << "[INFO] TriMesh::computeBVH(): " << m_bvh.nodes().size() << " nodes for "
+              << m_bvh.triangles().size() << " triangles" << std::endl;
+}
 
-    // Generates and populates a VBO for the element indices
-    glGenBuffers(1, &(m_indexVBO));
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexVBO);
-    auto indicesNBytes = m_indices.size() * sizeof(m_indices[0]);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indicesNBytes, m_indices.data(), GL_STATIC_DRAW);
+
+void TriMesh::computeVertexClusters()
+{
+    QGL_TRACE_SCOPE("TriMesh::computeVertexClusters");
+    buildVertexClusters(vertexData(), numVertexData(), m_vertexClusters, ThreadPool::global());
+}
+
+
+void TriMesh::optimizeIndexOrder()
+{
+    QGL_TRACE_SCOPE("TriMesh::optimizeIndexOrder");
+    detachMeshCache();
+
+    // levels of detail reference the vertices in their previous order
+    m_lods.clear();
+    m_lodIndices.clear();
+    m_indicesAreOptimized = true;
+
+    if(m_indices.empty())
+        return;
+
+    const VertexCacheStats before = analyzeVertexCache();
+
+    // 1. triangle order for the post-transform vertex cache
+    optimizeVertexCache(m_indices.data(), m_indices.size(), m_vertices.size());
+
+    // 2. clusters of triangles facing outwards first, to reduce overdraw
+    optimizeOverdraw(m_indices.data(), m_indices.size(), m_vertices.data(), m_vertices.size());
+
+    // 3. triangles grouped in meshlets culled by draw(), keeping the order of the clusters
+    buildMeshlets(m_indices.data(), m_indices.size(), m_vertices.data(), m_vertices.size(), m_meshlets, ThreadPool::global());
+
+    // 4. vertices in order of first use (meshlet bounds do not change)
+    std::vector<uint32_t> remap;
+    optimizeVertexFetch(m_indices.data(), m_indices.size(), m_vertices.size(), remap);
+    remapVertices(m_vertices, remap);
+    remapVertices(m_normals, remap);
+    remapVertices(m_texcoords, remap);
+    remapVertices(m_colors, remap);
+
+    const VertexCacheStats after = analyzeVertexCache();
+    std::cout << "[INFO] TriMesh::optimizeIndexOrder(): ACMR " << before.acmr << " -> " << after.acmr
+              << ", ATVR " << before.atvr << " -> " << after.atvr << ", " << m_meshlets.size() << " meshlets" << std::endl;
+}
+
+
+VertexCacheStats TriMesh::analyzeVertexCache(unsigned int _cacheSize) const
+{
+    return ::analyzeVertexCache(indexData(), numIndexData(), numVertexData(), _cacheSize);
+}
+
+
+void TriMesh::generateLODs()
+{
+    QGL_TRACE_SCOPE("TriMesh::generateLODs");
+    m_lods.clear();
+    m_lodIndices.clear();
+
+    // glTF primitives are drawn with their own index type and base vertex
+    const size_t numIndices = numIndexData();
+    const size_t numVertices = numVertexData();
+    if(m_gltf || numIndices / 3 < LOD_MIN_TRIANGLES)
+        return;
+
+    ThreadPool &pool = ThreadPool::global();
+
+    // 1. each level is simplified from the previous one (the quadrics keep the error to the full mesh)
+    MeshSimplifier simplifier(indexData(), numIndices, vertexData(), numVertices, pool);
+
+    LevelOfDetail fullMesh;
+    fullMesh.indexOffset = 0;
+    fullMesh.count = numIndices;
+    fullMesh.error = 0.0f;
+    m_lods.push_back(fullMesh);
+
+    for(size_t l = 0; l < sizeof(LOD_RATIOS) / sizeof(LOD_RATIOS[0]); l++)
+    {
+        const size_t count = simplifier.simplify( 3 * static_cast<size_t>(LOD_RATIOS[l] * (numIndices / 3)) );
+
+        // stop when seams and borders prevent further simplification
+        if(count == 0 || count * 10 > m_lods.back().count * 9)
+            break;
+
+        LevelOfDetail lod;
+        lod.indexOffset = numIndices + m_lodIndices.size();
+        lod.count = count;
+        lod.error = simplifier.error();
+        m_lods.push_back(lod);
+        m_lodIndices.insert(m_lodIndices.end(), simplifier.indices().begin(), simplifier.indices().end());
+    }
+
+    if(m_lods.size() == 1)
+    {
+        m_lods.clear();
+        return;
+    }
+
+    // 2. triangle order of each level for the post-transform vertex cache (levels in parallel)
+    pool.run(m_lods.size() - 1, [&](size_t l)
+    {
+        const LevelOfDetail &lod = m_lods[l + 1];
+        optimizeVertexCache(m_lodIndices.data() + (lod.indexOffset - numIndices), lod.count, numVertices);
+    });
+
+    std::cout << "[INFO] TriMesh::generateLODs(): " << m_lods.size() - 1 << " levels of detail:";
+    for(size_t l = 1; l < m_lods.size(); l++)
+        std::cout << " " << m_lods[l].count / 3 << " triangles (error " << m_lods[l].error << ")";
+    std::cout << std::endl;
+}
+
+
+size_t TriMesh::selectLOD(const glm::mat4 &_mv, const glm::mat4 &_projection, int _screenHeight) const
+{
+    if(m_lods.empty() || _screenHeight <= 0)
+        return 0;
+
+    // size of one unit of length on the screen (in pixels), at distance 1 for perspective projections
+    float pixelsPerUnit = 0.5f * static_cast<float>(_screenHeight) * std::abs(_projection[1][1]);
+
+    const bool perspective = (_projection[2][3] != 0.0f);
+    if(perspective)
+    {
+        // the closest point of the bounding sphere has the largest projected error
+        const glm::vec4 center = _mv * glm::vec4(m_bSphereCenter, 1.0f);
+        const float distance = std::sqrt(center.x * center.x + center.y * center.y + center.z * center.z) - m_bSphereRadius;
+        if(!(distance > 0.0f))
+            return 0;
+
+        pixelsPerUnit /= distance;
+    }
+
+    // errors increase with the levels
+    size_t level = 0;
+    for(size_t l = 1; l < m_lods.size(); l++)
+    {
+        if(m_lods[l].error * pixelsPerUnit <= m_lodPixelError)
+            level = l;
+    }
+    return level;
+}
+
+
+void TriMesh::setInstances(const std::vector<InstanceTransform> &_instances)
+{
+    m_instances = _instances;
+    m_visibleInstances.clear();
+    computeInstancesBoundingSphere(m_instances.data(), m_instances.size(), m_bSphereCenter, m_bSphereRadius,
+                                   m_instancesBSphereCenter, m_instancesBSphereRadius);
+    // (the instances are culled and uploaded by the next draw())
+    m_version++;
+}
+
+
+void TriMesh::clearInstances()
+{
+    if(!hasInstances())
+        return;
+
+    m_instances.clear();
+    m_visibleInstances.clear();
+    m_instancesBSphereCenter = glm::vec3(0.0f, 0.0f, 0.0f);
+    m_instancesBSphereRadius = 0.0f;
+    m_version++;
+}
+
+
+void TriMesh::createVAO()
+{
+    QGL_TRACE_SCOPE("TriMesh::createVAO");
+    if(m_gltf)
+    {
+        createGLTFBuffers();
+    }
+    else
+    {
+        createBuffers();
+    }
 
 
     // Generates and populates a VBO for vertex colors
@@ -163,6 +948,18 @@ void TriMesh::createVAO()
         glBufferData(GL_ARRAY_BUFFER, colorsNBytes, nullptr, GL_STATIC_DRAW);
     }
 
+    // Generates a VBO for the instance transforms, filled by draw()
+    // (a single identity transform as long as the mesh has no instances)
+    m_instanceCapacity = 0;
+    if(instancedArraysSupported())
+    {
+        glGenBuffers(1, &(m_instanceVBO));
+        uploadInstances();
+    }
+
+    // The material buffer exists from now on: its name is a sort key of the render queue (see Scene)
+    uploadMaterial();
+
 
     // Creates a vertex array object (VAO) for drawing the mesh
     glGenVertexArrays(1, &(m_meshVAO));
@@ -180,43 +977,495 @@ void TriMesh::createVAO()
     glEnableVertexAttribArray(COLOR);
     glVertexAttribPointer(COLOR, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
 
+    if(m_texcoordVBO != 0)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, m_texcoordVBO);
+        glEnableVertexAttribArray(TEXCOORD);
+        glVertexAttribPointer(TEXCOORD, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
+    }
+
+    // per-instance attributes: non-instanced draws read the first transform.
+    // Without instanced arrays, they stay disabled and read the default (0, 0, 0, 1): the identity transform
+    if(m_instanceVBO != 0)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, m_instanceVBO);
+        glEnableVertexAttribArray(INSTANCE_ROTATION);
+        glVertexAttribPointer(INSTANCE_ROTATION, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceTransform), 
+                              reinterpret_cast<const void*>(offsetof(InstanceTransform, rotation)));
+        vertexAttribDivisor(INSTANCE_ROTATION, 1);
+        glEnableVertexAttribArray(INSTANCE_TRANSLATION);
+        glVertexAttribPointer(INSTANCE_TRANSLATION, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceTransform), 
+                              reinterpret_cast<const void*>(offsetof(InstanceTransform, translation)));
+        vertexAttribDivisor(INSTANCE_TRANSLATION, 1);
+    }
+
 
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexVBO);
     glBindVertexArray(m_defaultVAO); // unbinds the VAO
 
+    m_version++;
+}
+
+
+void TriMesh::createBuffers()
+{
+    QGL_TRACE_SCOPE("TriMesh::createBuffers");
+    // Mesh data is read from the arrays, or directly from the pages of the mapped mesh cache
+    size_t numVertices = numVertexData();
+    size_t numNormals = numNormalData();
+    size_t numTexcoords = numTexcoordData();
+    size_t numIndices = numIndexData();
+
+    if(numVertices == 0)
+        std::cerr << "[WARNING] DrawableMesh::createVAO(): No vertex provided" << std::endl;
+    if(numNormals == 0)
+        std::cerr << "[WARNING] DrawableMesh::createVAO(): No normal provided" << std::endl;
+    if(numIndices == 0)
+        std::cerr << "[WARNING] DrawableMesh::createVAO(): No index provided" << std::endl;
+
+    // The GPU (and uploadStep()) reads the data without checks: normals which do not match
+    // the vertices are computed again, and a mesh with out of range indices is rejected
+    // (mesh caches are checked by readMeshCache())
+    bool valid = true;
+    if(!m_meshCacheHeader && numIndices != 0)
+    {
+        const uint32_t *indices = indexData();
+        uint32_t maxIndex = 0;
+        for(size_t i = 0; i < numIndices; i++)
+            maxIndex = std::max(maxIndex, indices[i]);
+        valid = maxIndex < numVertices;
+    }
+    if(valid && numNormals != 0 && numNormals != numVertices)
+    {
+        std::cerr << "[WARNING] TriMesh::createVAO(): " << numNormals << " normals for " << numVertices << " vertices, compute them" << std::endl;
+        computeNormals();
+        numNormals = numNormalData();
+    }
+    if(numTexcoords != 0 && numTexcoords != numVertices)
+    {
+        std::cerr << "[WARNING] TriMesh::createVAO(): " << numTexcoords << " texcoords for " << numVertices << " vertices, ignore them" << std::endl;
+        numTexcoords = 0;
+    }
+    if(!valid)
+    {
+        std::cerr << "[ERROR] TriMesh::createVAO(): Out of range indices, the mesh is not drawn" << std::endl;
+        numVertices = 0;
+        numNormals = 0;
+        numTexcoords = 0;
+        numIndices = 0;
+        m_lods.clear();
+        m_lodIndices.clear();
+        m_meshlets.clear();
+    }
+
+    // In streaming mode, buffers storage is only allocated here, and filled by uploadStep()
+    const bool streaming = m_streamingUpload;
+
+    // Generates and populates a VBO for vertex coords
+    glGenBuffers(1, &(m_vertexVBO));
+    glBindBuffer(GL_ARRAY_BUFFER, m_vertexVBO);
+    size_t verticesNBytes = numVertices * sizeof(glm::vec3);
+    glBufferData(GL_ARRAY_BUFFER, verticesNBytes, streaming ? nullptr : vertexData(), GL_STATIC_DRAW);
+
+    // Generates and populates a VBO for vertex normals
+    glGenBuffers(1, &(m_normalVBO));
+    glBindBuffer(GL_ARRAY_BUFFER, m_normalVBO);
+    size_t normalsNBytes = numNormals * sizeof(glm::vec3);
+    glBufferData(GL_ARRAY_BUFFER, normalsNBytes, streaming ? nullptr : normalData(), GL_STATIC_DRAW);
+
+    // Generates and populates a VBO for vertex texcoords, if any
+    if(numTexcoords != 0)
+    {
+        glGenBuffers(1, &(m_texcoordVBO));
+        glBindBuffer(GL_ARRAY_BUFFER, m_texcoordVBO);
+        size_t texcoordsNBytes = numTexcoords * sizeof(glm::vec2);
+        glBufferData(GL_ARRAY_BUFFER, texcoordsNBytes, streaming ? nullptr : texcoordData(), GL_STATIC_DRAW);
+    }
+
+    // Generates and populates a VBO for the element indices,
+    // followed by the indices of the levels of detail (which are not streamed)
+    glGenBuffers(1, &(m_indexVBO));
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexVBO);
+    auto indicesNBytes = numIndices * sizeof(uint32_t);
+    auto lodIndicesNBytes = m_lodIndices.size() * sizeof(uint32_t);
+    if(lodIndicesNBytes == 0)
+    {
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indicesNBytes, streaming ? nullptr : indexData(), GL_STATIC_DRAW);
+    }
+    else
+    {
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indicesNBytes + lodIndicesNBytes, nullptr, GL_STATIC_DRAW);
+        if(!streaming)
+            uploadBufferRange(GL_ELEMENT_ARRAY_BUFFER, 0, indicesNBytes, indexData());
+        uploadBufferRange(GL_ELEMENT_ARRAY_BUFFER, indicesNBytes, lodIndicesNBytes, m_lodIndices.data());
+    }
+
+    // draw all the indices at once
+    m_drawRanges.clear();
+
     // Additional information required by draw calls
-    m_numVertices = m_vertices.size();
-    m_numIndices = m_indices.size();
+    m_numVertices = numVertices;
+    m_numIndices = numIndices;
+
+    m_numUploadedVertices = streaming ? 0 : numVertices;
+    m_numUploadedIndices = streaming ? 0 : numIndices;
+    m_numDrawableIndices = streaming ? 0 : numIndices;
+}
+
+
+void TriMesh::createGLTFBuffers()
+{
+    QGL_TRACE_SCOPE("TriMesh::createGLTFBuffers");
+    const std::vector<GltfPrimitive> &primitives = m_gltf->primitives();
+    const size_t numVertices = m_gltf->numVertices();
+
+    // Primitives are concatenated in the VBOs, and drawn with their own base vertex.
+    // Index ranges keep their type (8, 16 or 32 bits), and start on 4-byte boundaries.
+    m_drawRanges.clear();
+    size_t baseVertex = 0;
+    size_t indicesNBytes = 0;
+    for(size_t p = 0; p < primitives.size(); p++)
+    {
+        const GltfAccessor &indices = primitives[p].indices;
+
+        DrawRange range;
+        range.baseVertex = static_cast<GLint>(baseVertex);
+        range.indexOffset = indicesNBytes;
+        range.count = primitives[p].numIndices();
+        range.indexType = indices.data ? static_cast<GLenum>(indices.componentType) : GL_NONE;
+        m_drawRanges.push_back(range);
+
+        baseVertex += primitives[p].positions.count;
+        if(indices.data)
+            indicesNBytes += (indices.count * indices.elementSize() + 3) & ~size_t(3);
+    }
+
+    // Generates VBOs, and fills them with the accessor ranges of the mapped file
+    glGenBuffers(1, &(m_vertexVBO));
+    glBindBuffer(GL_ARRAY_BUFFER, m_vertexVBO);
+    glBufferData(GL_ARRAY_BUFFER, numVertices * sizeof(glm::vec3), nullptr, GL_STATIC_DRAW);
+    for(size_t p = 0; p < primitives.size(); p++)
+        uploadAccessor(GL_ARRAY_BUFFER, m_drawRanges[p].baseVertex * sizeof(glm::vec3), primitives[p].positions);
+
+    glGenBuffers(1, &(m_normalVBO));
+    glBindBuffer(GL_ARRAY_BUFFER, m_normalVBO);
+    glBufferData(GL_ARRAY_BUFFER, numVertices * sizeof(glm::vec3), nullptr, GL_STATIC_DRAW);
+    for(size_t p = 0; p < primitives.size(); p++)
+        uploadAccessor(GL_ARRAY_BUFFER, m_drawRanges[p].baseVertex * sizeof(glm::vec3), primitives[p].normals);
+
+    // Texcoords, if a primitive has some: integer texcoords are converted to floats,
+    // and primitives without texcoords get null ones
+    bool hasTexcoords = false;
+    for(size_t p = 0; p < primitives.size(); p++)
+        hasTexcoords = hasTexcoords || primitives[p].texcoords.data != nullptr;
+    if(hasTexcoords)
+    {
+        glGenBuffers(1, &(m_texcoordVBO));
+        glBindBuffer(GL_ARRAY_BUFFER, m_texcoordVBO);
+        glBufferData(GL_ARRAY_BUFFER, numVertices * sizeof(glm::vec2), nullptr, GL_STATIC_DRAW);
+        for(size_t p = 0; p < primitives.size(); p++)
+        {
+            const GltfAccessor &texcoords = primitives[p].texcoords;
+            const size_t offset = m_drawRanges[p].baseVertex * sizeof(glm::vec2);
+            if(texcoords.data && texcoords.componentType == GLTF_FLOAT)
+            {
+                uploadAccessor(GL_ARRAY_BUFFER, offset, texcoords);
+                continue;
+            }
+
+            std::vector<glm::vec2> values(primitives[p].positions.count, glm::vec2(0.0f));
+            for(size_t i = 0; texcoords.data && i < texcoords.count; i++)
+                values[i] = glm::vec2(texcoords.readFloat(i, 0), texcoords.readFloat(i, 1));
+            uploadBufferRange(GL_ARRAY_BUFFER, offset, values.size() * sizeof(glm::vec2), values.data());
+        }
+    }
+
+    glGenBuffers(1, &(m_indexVBO));
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexVBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indicesNBytes, nullptr, GL_STATIC_DRAW);
+    for(size_t p = 0; p < primitives.size(); p++)
+        uploadAccessor(GL_ELEMENT_ARRAY_BUFFER, m_drawRanges[p].indexOffset, primitives[p].indices);
+
+    // Additional information required by draw calls (no streaming upload)
+    m_numVertices = numVertices;
+    m_numIndices = m_gltf->numIndices();
+
+    m_numUploadedVertices = m_numVertices;
+    m_numUploadedIndices = m_numIndices;
+    m_numDrawableIndices = m_numIndices;
 }
 
 
-void TriMesh::draw(glm::mat4 _mv, glm::mat4 _mvp, glm::vec3 _lightPos, glm::vec3 _lightCol)
+void TriMesh::uploadMaterial()
 {
+    if(!m_materialIsModified)
+        return;
+
+    MaterialUniforms material;
+    material.ambientColor = glm::vec4(m_ambientColor, 0.0f);
+    material.diffuseColor = glm::vec4(m_diffuseColor, 0.0f);
+    material.specularColor = glm::vec4(m_specularColor, m_specPow);
+    m_materialUniforms.upload(&material, sizeof(material));
+    m_materialIsModified = false;
+}
+
+
+void TriMesh::uploadInstances()
+{
+    QGL_TRACE_SCOPE("TriMesh::uploadInstances");
+    InstanceTransform identity;
+    identity.rotation = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    identity.translation = glm::vec4(0.0f, 0.0f, 0.0f, 0.0f);
+
+    const InstanceTransform *transforms = hasInstances() ? m_visibleInstances.data() : &identity;
+    const size_t count = hasInstances() ? m_visibleInstances.size() : 1;
+
+    // The buffer is orphaned before being filled: the GPU may still read the transforms of the previous frame
+    m_instanceCapacity = std::max(m_instanceCapacity, std::max<size_t>(count, 1));
+    glBindBuffer(GL_ARRAY_BUFFER, m_instanceVBO);
+    glBufferData(GL_ARRAY_BUFFER, m_instanceCapacity * sizeof(InstanceTransform), nullptr, GL_STREAM_DRAW);
+    if(count != 0)
+        glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(InstanceTransform), transforms);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    m_instancesAreUploaded = hasInstances();
+}
+
+
+void TriMesh::uploadStep()
+{
+    QGL_TRACE_SCOPE("TriMesh::uploadStep");
+    if(!isUploading())
+        return;
+
+    const uint32_t *indices = indexData();
+    const size_t numNormals = numNormalData();
+    const bool hasTexcoords = (m_texcoordVBO != 0);
+    const size_t vertexNBytes = sizeof(glm::vec3) * (numNormals != 0 ? 2 : 1) + (hasTexcoords ? sizeof(glm::vec2) : 0);
+
+    size_t budget = m_uploadBudget;
+
+    // The VAO references the index buffer, keep it bound while uploading
+    // so that the element array binding of another VAO is not modified
+    glBindVertexArray(m_meshVAO);
+
+    while(budget > 0 && isUploading())
+    {
+        // 1. Upload the next indices whose vertices are already resident
+        size_t end = m_numUploadedIndices;
+        const size_t maxEnd = std::min(m_numIndices, m_numUploadedIndices + std::max<size_t>(3, budget / sizeof(uint32_t)));
+        while(end < maxEnd && indices[end] < m_numUploadedVertices)
+            end++;
+
+        if(end > m_numUploadedIndices)
+        {
+            const size_t nbBytes = (end - m_numUploadedIndices) * sizeof(uint32_t);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexVBO);
+            uploadBufferRange(GL_ELEMENT_ARRAY_BUFFER, m_numUploadedIndices * sizeof(uint32_t), nbBytes, indices + m_numUploadedIndices);
+
+            m_numUploadedIndices = end;
+            budget -= std::min(budget, nbBytes);
+            continue;
+        }
+
+        // 2. Otherwise, upload the next vertices (positions, normals and texcoords)
+        if(m_numUploadedVertices < m_numVertices)
+        {
+            const size_t count = std::min(m_numVertices - m_numUploadedVertices, std::max<size_t>(1, budget / vertexNBytes));
+            const size_t offset = m_numUploadedVertices * sizeof(glm::vec3);
+
+            glBindBuffer(GL_ARRAY_BUFFER, m_vertexVBO);
+            uploadBufferRange(GL_ARRAY_BUFFER, offset, count * sizeof(glm::vec3), vertexData() + m_numUploadedVertices);
+            if(numNormals != 0)
+            {
+                glBindBuffer(GL_ARRAY_BUFFER, m_normalVBO);
+                uploadBufferRange(GL_ARRAY_BUFFER, offset, count * sizeof(glm::vec3), normalData() + m_numUploadedVertices);
+            }
+            if(hasTexcoords)
+            {
+                glBindBuffer(GL_ARRAY_BUFFER, m_texcoordVBO);
+                uploadBufferRange(GL_ARRAY_BUFFER, m_numUploadedVertices * sizeof(glm::vec2), count * sizeof(glm::vec2), texcoordData() + m_numUploadedVertices);
+            }
+
+            m_numUploadedVertices += count;
+            budget -= std::min(budget, count * vertexNBytes);
+            continue;
+        }
+
+        // (not reached: indices are checked by createBuffers(), so step 1 progresses once all vertices are resident)
+        break;
+    }
+
+    glBindVertexArray(m_defaultVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // only draw complete triangles
+    m_numDrawableIndices = m_numUploadedIndices - m_numUploadedIndices % 3;
+    m_version++;
+}
+
+
+void TriMesh::draw(const glm::mat4 &_mv, const glm::mat4 &_mvp, const glm::mat4 &_projection, 
+                   int _screenHeight, uint64_t _cameraVersion, GLStateCache *_state)
+{
+    QGL_TRACE_SCOPE("TriMesh::draw");
+    // mesh is not uploaded yet (e.g., still loading)
+    if(!hasVAO())
+        return;
+
+    // streaming upload: upload the next slices, and only draw resident triangles
+    m_numDrawnIndices = 0;
+    m_numDrawCalls = 0;
+    if(isUploading())
+    {
+        uploadStep();
+        // (uploadStep() binds the VAO and the buffers directly)
+        if(_state)
+            _state->invalidate();
+    }
+    if(m_numDrawableIndices == 0)
+        return;
+
+    // without cache, the state is set unconditionally, and reset at the end
+    GLStateCache localState;
+    GLStateCache &state = _state ? *_state : localState;
+
+    // the culling only depends on the camera:
+    // nothing to recompute if neither the camera nor the mesh changed since the last draw
+    const bool cameraUnchanged = (_cameraVersion != 0 && _cameraVersion == m_drawnCameraVersion && m_version == m_drawnVersion);
+    m_drawnCameraVersion = _cameraVersion;
+    m_drawnVersion = m_version;
 
     // Activate program
-    glUseProgram(m_program);
+    state.useProgram(m_program);
+
+    // Material uniforms, only uploaded after a change (the camera block is bound by the caller)
+    uploadMaterial();
+    state.bindUniformBuffer(MATERIAL_UNIFORM_BINDING, m_materialUniforms.name());
+
 
-    // Pass uniforms
-    glUniformMatrix4fv(glGetUniformLocation(m_program, "u_mv"), 1, GL_FALSE, &_mv[0][0]);
-    glUniformMatrix4fv(glGetUniformLocation(m_program, "u_mvp"), 1, GL_FALSE, &_mvp[0][0]);
-    glUniform3fv(glGetUniformLocation(m_program, "u_lightPosition"), 1, &_lightPos[0]);
+    // Draw!
+    state.bindVertexArray(m_meshVAO);                   // bind the VAO (the index buffer is part of its state, see createVAO())
+    state.setCullFace(m_backfaceCulling);
 
-    glUniform3fv(glGetUniformLocation(m_program, "u_lightColor"), 1, &_lightCol[0]);
+    // instances were removed: restore the identity transform read by non-instanced draws
+    if(!hasInstances() && m_instancesAreUploaded)
+        uploadInstances();
 
-    glUniform3fv(glGetUniformLocation(m_program, "u_ambientColor"), 1, &m_ambientColor[0]);
-    glUniform3fv(glGetUniformLocation(m_program, "u_diffuseColor"), 1, &m_diffuseColor[0]);
-    glUniform3fv(glGetUniformLocation(m_program, "u_specularColor"), 1, &m_specularColor[0]);
-    glUniform1f(glGetUniformLocation(m_program, "u_specularPower"), m_specPow);
- 
+    // (without instanced arrays, the mesh is drawn once)
+    if(hasInstances() && instancingSupported())
+    {
+        // the visible instances are packed at the beginning of the instance VBO,
+        // and the full mesh is drawn for all of them at once
+        if(!cameraUnchanged)
+        {
+            cullInstances(m_instances.data(), m_instances.size(), m_bSphereCenter, m_bSphereRadius, _mvp, m_visibleInstances);
+            m_instancesAreUploaded = false;
+        }
+        if(!m_instancesAreUploaded)
+            uploadInstances();
+
+        const GLsizei numInstances = (GLsizei)m_visibleInstances.size();
+        if(numInstances != 0 && m_drawRanges.empty())
+        {
+            glDrawElementsInstanced(GL_TRIANGLES, (GLsizei)m_numDrawableIndices, GL_UNSIGNED_INT, 0, numInstances);
+            m_numDrawnIndices = m_numDrawableIndices * numInstances;
+            m_numDrawCalls++;
+        }
+        else if(numInstances != 0)
+        {
+            for(size_t i = 0; i < m_drawRanges.size(); i++)
+            {
+                const DrawRange &range = m_drawRanges[i];
+                if(range.indexType == GL_NONE)
+                    glDrawArraysInstanced(GL_TRIANGLES, range.baseVertex, (GLsizei)range.count, numInstances);
+                else
+                    glDrawElementsInstancedBaseVertex(GL_TRIANGLES, (GLsizei)range.count, range.indexType, 
+                                                      reinterpret_cast<const void*>(range.indexOffset), numInstances, range.baseVertex);
+                m_numDrawnIndices += range.count * numInstances;
+                m_numDrawCalls++;
+            }
+        }
+    }
+    else if(m_drawRanges.empty())
+    {
+        // levels of detail and meshlets are drawn once all the vertices are resident
+        if(!cameraUnchanged)
+            m_drawnLevel = isUploading() ? 0 : selectLOD(_mv, _projection, _screenHeight);
+
+        const size_t level = m_drawnLevel;
+        if(level != 0)
+        {
+            glDrawElements(GL_TRIANGLES, (GLsizei)m_lods[level].count, GL_UNSIGNED_INT, 
+                           reinterpret_cast<const void*>(m_lods[level].indexOffset * sizeof(uint32_t)));
+            m_numDrawnIndices = m_lods[level].count;
+            m_numDrawCalls++;
+        }
+        else if(isUploading() || !m_meshletCullingEnabled || m_meshlets.empty())
+        {
+            glDrawElements(GL_TRIANGLES, (GLsizei)m_numDrawableIndices, GL_UNSIGNED_INT, 0);
+            m_numDrawnIndices = m_numDrawableIndices;
+            m_numDrawCalls++;
+        }
+        else
+        {
+            if(!cameraUnchanged)
+            {
+                cullMeshlets(m_meshlets.data(), m_meshlets.size(), _mvp, _mv, m_backfaceCulling, m_visibleMeshlets);
+
+                // consecutive visible meshlets are merged into one range
+                m_drawCounts.clear();
+                m_drawOffsets.clear();
+                m_numCulledIndices = 0;
+                size_t rangeEnd = 0;
+                for(size_t i = 0; i < m_visibleMeshlets.size(); i++)
+                {
+                    const Meshlet &meshlet = m_meshlets[m_visibleMeshlets[i]];
+                    if(!m_drawCounts.empty() && meshlet.indexOffset == rangeEnd)
+                    {
+                        m_drawCounts.back() += (GLsizei)meshlet.count;
+                    }
+                    else
+                    {
+                        m_drawCounts.push_back((GLsizei)meshlet.count);
+                        m_drawOffsets.push_back(reinterpret_cast<const void*>(meshlet.indexOffset * sizeof(uint32_t)));
+                    }
+                    rangeEnd = meshlet.indexOffset + meshlet.count;
+                    m_numCulledIndices += meshlet.count;
+                }
+            }
+            m_numDrawnIndices = m_numCulledIndices;
 
-    // Draw!
-    glBindVertexArray(m_meshVAO);                       // bind the VAO
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexVBO);  // do not forget to bind the index buffer AFTER !
+            if(!m_drawCounts.empty())
+            {
+                glMultiDrawElements(GL_TRIANGLES, m_drawCounts.data(), GL_UNSIGNED_INT, m_drawOffsets.data(), (GLsizei)m_drawCounts.size());
+                m_numDrawCalls++;
+            }
+        }
+    }
+    else
+    {
+        // one draw call per glTF primitive
+        for(size_t i = 0; i < m_drawRanges.size(); i++)
+        {
+            const DrawRange &range = m_drawRanges[i];
+            if(range.indexType == GL_NONE)
+                glDrawArrays(GL_TRIANGLES, range.baseVertex, (GLsizei)range.count);
+            else
+                glDrawElementsBaseVertex(GL_TRIANGLES, (GLsizei)range.count, range.indexType, reinterpret_cast<const void*>(range.indexOffset), range.baseVertex);
+            m_numDrawnIndices += range.count;
+            m_numDrawCalls++;
+        }
+    }
 
-    glDrawElements(GL_TRIANGLES, m_numIndices, GL_UNSIGNED_INT, 0);
+    if(_state)
+        return;
 
     glBindVertexArray(m_defaultVAO);
 
+    if(m_backfaceCulling)
+        glDisable(GL_CULL_FACE);
+
 
     glUseProgram(0);
 }
@@ -224,6 +1473,7 @@ void TriMesh::draw(glm::mat4 _mv, glm::mat4 _mvp, glm::vec3 _lightPos, glm::vec3
 
 GLuint TriMesh::loadShaderProgram(const std::string& _vertShaderFilename, const std::string& _fragShaderFilename)
 {
+    QGL_TRACE_SCOPE("TriMesh::loadShaderProgram");
     // Load and compile vertex shader
     GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
     std::string vertexShaderSource = readShaderSource(_vertShaderFilename);
@@ -286,6 +1536,9 @@ GLuint TriMesh::loadShaderProgram(const std::string& _vertShaderFilename, const
     glDetachShader(program, vertexShader);
     glDetachShader(program, fragmentShader);
 
+    // uniforms are in blocks, assigned to their binding points once for all
+    bindUniformBlocks(program);
+
     return program;
 }
 
@@ -294,157 +1547,417 @@ GLuint TriMesh::loadShaderProgram(const std::string& _vertShaderFilename, const
 // coordinates and/or normals, in addition to vertex positions.
 bool TriMesh::importOBJ(const std::string &_filename)
 {
-    struct uvec3Less 
+    QGL_TRACE_SCOPE("TriMesh::importOBJ");
+    ObjChunk obj;
+    if(CompressedFileReader::isCompressedFilename(_filename))
     {
-        bool operator() (const glm::uvec3 &a, const glm::uvec3 &b) const
+        // Decompress and tokenize the file block by block, on two threads
+        if(!parseCompressedOBJFile(_filename, obj))
         {
-            return (a.x < b.x) |
-                    ((a.x == b.x) & (a.y < b.y)) |
-                    ((a.x == b.x) & (a.y == b.y) & (a.z < b.z));
+            std::cerr << "[ERROR] TriMesh::importOBJ(): Could not read " << _filename << std::endl;
+            return false;
+        }
+    }
+    else
+    {
+        // Read the whole OBJ file with a single read
+        std::vector<char> buffer;
+        if(!readOBJFile(_filename, buffer)) 
+        {
+            std::cerr << "[ERROR] TriMesh::importOBJ(): Could not open " << _filename << std::endl;
+            return false;
         }
-    };
 
-    const std::string VERTEX_LINE("v ");
-    const std::string TEXCOORD_LINE("vt ");
-    const std::string NORMAL_LINE("vn ");
-    const std::string FACE_LINE("f ");
+        // Single pass: tokenize vertex data and faces into temporary arrays,
+        // pre-sized from the file size
+        obj.reserve(buffer.size());
+        parseOBJChunk(buffer.data(), buffer.data() + buffer.size(), obj);
+    }
 
-    std::string line;
-    glm::vec3 vertex;
-    glm::vec3 normal;
-    glm::vec3 texcoord;
-    std::uint32_t vindex[3];
-    std::uint32_t tindex[3];
-    std::uint32_t nindex[3];
+    // Clear old mesh and pre-allocate space for new mesh data
+    m_vertices.clear();
+    m_vertices.reserve(obj.positions.size());
+    m_texcoords.clear();
+    m_texcoords.reserve(obj.texcoords.size());
+    m_normals.clear();
+    m_normals.reserve(obj.normals.size());
+    m_indices.clear();
+    m_indices.reserve(obj.corners.size());
+
+    unsigned next_index = 0;
+
+    // if the file has texcoords or normals, every vertex gets one, so that the arrays stay aligned
+    // (corners without normal get a null one, and normals are then computed)
+    const bool hasTexcoords = !obj.texcoords.empty();
+    const bool hasNormals = !obj.normals.empty();
+    bool missingNormals = false;
+
+    // Without texcoords and normals, the tuples are the positions: a remap table
+    // replaces the dictionary (vertices are still numbered in the order of their first use)
+    if (!hasTexcoords && !hasNormals)
+    {
+        std::vector<unsigned> remap(obj.positions.size(), std::numeric_limits<unsigned>::max());
+        for (size_t c = 0; c < obj.corners.size(); ++c) 
+        {
+            const int64_t vindex = resolveOBJIndex(obj.corners[c].x, 0);
+            if ( vindex < 0 || vindex >= (int64_t)obj.positions.size() || obj.corners[c].y != 0 || obj.corners[c].z != 0 )
+            {
+                std::cerr << "[ERROR] TriMesh::importOBJ(): Invalid face index in " << _filename << std::endl;
+                clear();
+                return false;
+            }
+
+            unsigned &index = remap[vindex];
+            if (index == std::numeric_limits<unsigned>::max())
+            {
+                index = next_index++;
+                m_vertices.push_back(obj.positions[vindex]);
+            }
+            m_indices.push_back(index);
+        }
+
+        std::cout << "[INFO] TriMesh::importOBJ(): Normals not provided, compute them " << std::endl;
+        computeNormals();
+        return true;
+    }
+
+    // Set up dictionary for mapping unique tuples to indices,
+    // sized from the face count (a closed mesh has about half as many vertices as faces)
+    FlatHashMap<glm::uvec3, unsigned, UVec3Hash> visited( std::max(obj.positions.size(), obj.corners.size() / 6) );
+    glm::uvec3 key;
+
+    // Construct per-vertex texcoords/normals from the face corners.
+    // Note: OBJ-indices start at one, resolveOBJIndex() makes them start at zero.
+    for (size_t c = 0; c < obj.corners.size(); ++c) 
+    {
+        const glm::ivec3 &corner = obj.corners[c];
+        int64_t vindex = resolveOBJIndex(corner.x, 0);
+        int64_t tindex = (corner.y != 0) ? resolveOBJIndex(corner.y, 0) : -1;
+        int64_t nindex = (corner.z != 0) ? resolveOBJIndex(corner.z, 0) : -1;
+
+        if ( vindex < 0 || vindex >= (int64_t)obj.positions.size() ||
+             tindex >= (int64_t)obj.texcoords.size() || (corner.y != 0 && tindex < 0) ||
+             nindex >= (int64_t)obj.normals.size() || (corner.z != 0 && nindex < 0) )
+        {
+            std::cerr << "[ERROR] TriMesh::importOBJ(): Invalid face index in " << _filename << std::endl;
+            clear();
+            return false;
+        }
+
+        key = glm::uvec3(vindex + 1, tindex + 1, nindex + 1);
+        std::pair<unsigned&, bool> entry = visited.insert(key, next_index);
+        if (entry.second) 
+        {
+            next_index++;
+            m_vertices.push_back(obj.positions[vindex]);
+            if (hasTexcoords)
+                m_texcoords.push_back( (tindex >= 0) ? obj.texcoords[tindex] : glm::vec2(0.0f) );
+            if (hasNormals)
+                m_normals.push_back( (nindex >= 0) ? obj.normals[nindex] : glm::vec3(0.0f) );
+            missingNormals = missingNormals || nindex < 0;
+        }
+        m_indices.push_back(entry.first);
+    }
+
+    // Compute normals (if OBJ-file did not contain normals for all the corners)
+    if(missingNormals) 
+    {
+        std::cout << "[INFO] TriMesh::importOBJ(): Normals not provided, compute them " << std::endl;
+        computeNormals();
+    }
+
+    return true;
+}
+
+
+bool TriMesh::importOBJParallel(const std::string &_filename, unsigned int _nbThreads)
+{
+    QGL_TRACE_SCOPE("TriMesh::importOBJParallel");
+    // Minimum size of a chunk of text (in bytes), so that small files are not split too much
+    const size_t MIN_CHUNK_SIZE = 1 << 16;
+    // Number of hash shards used to build the unique-corner index (power of two)
+    const unsigned int SHARD_BITS = 6;
+    const size_t NB_SHARDS = size_t(1) << SHARD_BITS;
+
+    // Read the whole OBJ file with a single read
+    std::vector<char> buffer;
+    if(!readOBJFile(_filename, buffer)) 
+    {
+        std::cerr << "[ERROR] TriMesh::importOBJParallel(): Could not open " << _filename << std::endl;
+        return false;
+    }
+
+    // (0: the threads of the shared pool are used instead of new ones)
+    std::unique_ptr<ThreadPool> ownPool;
+    if (_nbThreads != 0)
+        ownPool.reset( new ThreadPool(_nbThreads) );
+    ThreadPool &pool = ownPool ? *ownPool : ThreadPool::global();
+
+    // 1. Split the file into newline-aligned chunks
+    const size_t nbChunks = std::max<size_t>(1, std::min<size_t>(4 * pool.size(), buffer.size() / MIN_CHUNK_SIZE));
+    std::vector<size_t> bounds(nbChunks + 1, buffer.size());
+    bounds[0] = 0;
+    for (size_t k = 1; k < nbChunks; k++) 
+    {
+        size_t start = std::max(bounds[k - 1], (buffer.size() / nbChunks) * k);
+        const char *eol = static_cast<const char*>( std::memchr(buffer.data() + start, '\n', buffer.size() - start) );
+        bounds[k] = (eol != nullptr) ? (eol - buffer.data()) + 1 : buffer.size();
+    }
 
-    // Open OBJ file
-    std::ifstream f(_filename.c_str());
-    if(!f.is_open()) 
+    // 2. Tokenize the chunks in parallel
+    std::vector<ObjChunk> chunks(nbChunks);
+    pool.run(nbChunks, [&](size_t k) 
     {
-        std::cerr << "[ERROR] TriMesh::importOBJ(): Could not open " << _filename << std::endl;
+        chunks[k].reserve(bounds[k + 1] - bounds[k]);
+        parseOBJChunk(buffer.data() + bounds[k], buffer.data() + bounds[k + 1], chunks[k]);
+    });
+
+    // 3. Prefix sums of the number of records per chunk
+    std::vector<size_t> positionOffsets(nbChunks + 1, 0);
+    std::vector<size_t> texcoordOffsets(nbChunks + 1, 0);
+    std::vector<size_t> normalOffsets(nbChunks + 1, 0);
+    std::vector<size_t> cornerOffsets(nbChunks + 1, 0);
+    for (size_t k = 0; k < nbChunks; k++) 
+    {
+        positionOffsets[k + 1] = positionOffsets[k] + chunks[k].positions.size();
+        texcoordOffsets[k + 1] = texcoordOffsets[k] + chunks[k].texcoords.size();
+        normalOffsets[k + 1] = normalOffsets[k] + chunks[k].normals.size();
+        cornerOffsets[k + 1] = cornerOffsets[k] + chunks[k].corners.size();
+    }
+    const size_t nbPositions = positionOffsets[nbChunks];
+    const size_t nbTexcoords = texcoordOffsets[nbChunks];
+    const size_t nbNormals = normalOffsets[nbChunks];
+    const size_t nbCorners = cornerOffsets[nbChunks];
+
+    if (nbCorners > std::numeric_limits<uint32_t>::max()) 
+    {
+        std::cerr << "[ERROR] TriMesh::importOBJParallel(): Too many faces in " << _filename << std::endl;
         return false;
     }
 
-    // First pass: read vertex data into temporary mesh
-    std::vector<glm::vec3> vertices;
-    std::vector<glm::vec3> normals;
-    std::vector<uint32_t> indices;
-    std::vector<glm::vec3> texcoords;
-    while(!f.eof()) 
+    // 4. Stitch the records of all chunks, and resolve face corners into global (v, vt, vn) tuples
+    // (1-based, 0 for a missing attribute, as in importOBJ())
+    std::vector<glm::vec3> positions(nbPositions);
+    std::vector<glm::vec2> texcoords(nbTexcoords);
+    std::vector<glm::vec3> normals(nbNormals);
+    std::vector<glm::uvec3> keys(nbCorners);
+    std::atomic<bool> valid(true);
+
+    pool.run(nbChunks, [&](size_t k) 
     {
-        std::getline(f, line);
-        if (line.substr(0, 2) == VERTEX_LINE) 
+        ObjChunk &chunk = chunks[k];
+        std::copy(chunk.positions.begin(), chunk.positions.end(), positions.begin() + positionOffsets[k]);
+        std::copy(chunk.texcoords.begin(), chunk.texcoords.end(), texcoords.begin() + texcoordOffsets[k]);
+        std::copy(chunk.normals.begin(), chunk.normals.end(), normals.begin() + normalOffsets[k]);
+
+        for (size_t j = 0; j < chunk.corners.size(); j++) 
         {
-            std::istringstream ss(line.substr(2));
-            ss >> vertex.x >> vertex.y >> vertex.z;
-            vertices.push_back(vertex);
+            const glm::ivec3 &corner = chunk.corners[j];
+            int64_t vindex = resolveOBJIndex(corner.x, positionOffsets[k]);
+            int64_t tindex = (corner.y != 0) ? resolveOBJIndex(corner.y, texcoordOffsets[k]) : -1;
+            int64_t nindex = (corner.z != 0) ? resolveOBJIndex(corner.z, normalOffsets[k]) : -1;
+
+            if ( vindex < 0 || vindex >= (int64_t)nbPositions ||
+                 tindex >= (int64_t)nbTexcoords || (corner.y != 0 && tindex < 0) ||
+                 nindex >= (int64_t)nbNormals || (corner.z != 0 && nindex < 0) )
+            {
+                valid = false;
+                break;
+            }
+            keys[cornerOffsets[k] + j] = glm::uvec3(vindex + 1, tindex + 1, nindex + 1);
         }
-        else if (line.substr(0, 3) == TEXCOORD_LINE) 
+
+        // release chunk memory as soon as possible
+        chunk = ObjChunk();
+    });
+    std::vector<char>().swap(buffer);
+
+    if (!valid) 
+    {
+        std::cerr << "[ERROR] TriMesh::importOBJParallel(): Invalid face index in " << _filename << std::endl;
+        clear();
+        return false;
+    }
+
+    // 5. Find the first occurrence of each tuple.
+    // Corners are dispatched into hash shards (keeping their order), then each shard is 
+    // deduplicated independently, so that firstCorner[c] is the first corner with the same tuple as c.
+    UVec3Hash hash;
+    std::vector< std::vector<uint32_t> > buckets(nbChunks * NB_SHARDS);
+    pool.run(nbChunks, [&](size_t k) 
+    {
+        for (size_t c = cornerOffsets[k]; c < cornerOffsets[k + 1]; c++) 
         {
-            std::istringstream ss(line.substr(3));
-            ss >> texcoord.x >> texcoord.y;// >> texcoord.z;
-            texcoords.push_back(texcoord);
+            // use the high bits of the hash for sharding, the map uses the low bits
+            size_t shard = static_cast<size_t>( (static_cast<uint64_t>(hash(keys[c])) * 0x9e3779b97f4a7c15ULL) >> (64 - SHARD_BITS) );
+            buckets[k * NB_SHARDS + shard].push_back(static_cast<uint32_t>(c));
         }
-        else if (line.substr(0, 3) == NORMAL_LINE) 
+    });
+
+    std::vector<uint32_t> firstCorner(nbCorners);
+    pool.run(NB_SHARDS, [&](size_t s) 
+    {
+        size_t count = 0;
+        for (size_t k = 0; k < nbChunks; k++)
+            count += buckets[k * NB_SHARDS + s].size();
+
+        FlatHashMap<glm::uvec3, uint32_t, UVec3Hash> visited( std::max(nbPositions / NB_SHARDS, count / 6) );
+        for (size_t k = 0; k < nbChunks; k++) 
         {
-            std::istringstream ss(line.substr(3));
-            ss >> normal.x >> normal.y >> normal.z;
-            normals.push_back(normal);
+            std::vector<uint32_t> &bucket = buckets[k * NB_SHARDS + s];
+            for (size_t i = 0; i < bucket.size(); i++)
+                firstCorner[bucket[i]] = visited.insert(keys[bucket[i]], bucket[i]).first;
+            std::vector<uint32_t>().swap(bucket);
         }
-        else 
+    });
+
+    // 6. Number unique tuples in order of first occurrence (prefix sums per chunk),
+    // which gives the same vertex order as importOBJ()
+    std::vector<size_t> vertexOffsets(nbChunks + 1, 0);
+    std::vector<size_t> uniqueTexcoordOffsets(nbChunks + 1, 0);
+    std::vector<size_t> uniqueNormalOffsets(nbChunks + 1, 0);
+    // as in importOBJ(), all the vertices get a texcoord and a normal if the file has some
+    const bool hasTexcoords = !texcoords.empty();
+    const bool hasNormals = !normals.empty();
+    std::atomic<bool> missingNormals(false);
+    pool.run(nbChunks, [&](size_t k) 
+    {
+        for (size_t c = cornerOffsets[k]; c < cornerOffsets[k + 1]; c++) 
         {
-            // Ignore line
+            if (firstCorner[c] == c) 
+            {
+                vertexOffsets[k + 1]++;
+                if (hasTexcoords)
+                    uniqueTexcoordOffsets[k + 1]++;
+                if (hasNormals)
+                    uniqueNormalOffsets[k + 1]++;
+                if (keys[c].z == 0)
+                    missingNormals.store(true, std::memory_order_relaxed);
+            }
         }
+    });
+    for (size_t k = 0; k < nbChunks; k++) 
+    {
+        vertexOffsets[k + 1] += vertexOffsets[k];
+        uniqueTexcoordOffsets[k + 1] += uniqueTexcoordOffsets[k];
+        uniqueNormalOffsets[k + 1] += uniqueNormalOffsets[k];
     }
 
-    // Rewind file
-    f.clear();
-    f.seekg(0);
-
-    // Clear old mesh and pre-allocate space for new mesh data
     m_vertices.clear();
-    m_vertices.reserve(vertices.size());
+    m_vertices.resize(vertexOffsets[nbChunks]);
     m_texcoords.clear();
-    m_texcoords.reserve(texcoords.size());
+    m_texcoords.resize(uniqueTexcoordOffsets[nbChunks]);
     m_normals.clear();
-    m_normals.reserve(normals.size());
+    m_normals.resize(uniqueNormalOffsets[nbChunks]);
     m_indices.clear();
+    m_indices.resize(nbCorners);
 
-    // Set up dictionary for mapping unique tuples to indices
-    std::map<glm::uvec3, unsigned, uvec3Less> visited;
-    unsigned next_index = 0;
-    glm::uvec3 key;
+    // 7. Write unique vertices, then indices of the other corners
+    pool.run(nbChunks, [&](size_t k) 
+    {
+        uint32_t v = static_cast<uint32_t>(vertexOffsets[k]);
+        size_t t = uniqueTexcoordOffsets[k];
+        size_t n = uniqueNormalOffsets[k];
+        for (size_t c = cornerOffsets[k]; c < cornerOffsets[k + 1]; c++) 
+        {
+            if (firstCorner[c] != c)
+                continue;
+
+            const glm::uvec3 &key = keys[c];
+            m_vertices[v] = positions[key.x - 1];
+            if (hasTexcoords)
+                m_texcoords[t++] = (key.y != 0) ? texcoords[key.y - 1] : glm::vec2(0.0f);
+            if (hasNormals)
+                m_normals[n++] = (key.z != 0) ? normals[key.z - 1] : glm::vec3(0.0f);
+            m_indices[c] = v++;
+        }
+    });
+    pool.run(nbChunks, [&](size_t k) 
+    {
+        for (size_t c = cornerOffsets[k]; c < cornerOffsets[k + 1]; c++)
+            if (firstCorner[c] != c)
+                m_indices[c] = m_indices[firstCorner[c]];
+    });
+
+    // Compute normals (if OBJ-file did not contain normals for all the corners)
+    if(missingNormals) 
+    {
+        std::cout << "[INFO] TriMesh::importOBJParallel(): Normals not provided, compute them " << std::endl;
+        computeNormals();
+    }
+
+    return true;
+}
+
+
+// Read a mesh from a binary .ply file. Vertex and face records
+// are read directly from the mapped file, without parsing.
+bool TriMesh::importPLY(const std::string &_filename)
+{
+    QGL_TRACE_SCOPE("TriMesh::importPLY");
+    MappedFile file;
+    if(!file.open(_filename))
+    {
+        std::cerr << "[ERROR] TriMesh::importPLY(): Could not open " << _filename << std::endl;
+        return false;
+    }
+
+    PlyHeader header;
+    if(!parsePLYHeader(file.data(), file.size(), header))
+    {
+        std::cerr << "[ERROR] TriMesh::importPLY(): Invalid header in " << _filename << std::endl;
+        return false;
+    }
+    if(header.format == PlyHeader::ASCII)
+    {
+        std::cerr << "[ERROR] TriMesh::importPLY(): ASCII PLY files are not supported: " << _filename << std::endl;
+        return false;
+    }
 
-    // Second pass: read faces and construct per-vertex texcoords/normals.
-    // Note: OBJ-indices start at one, so we need to subtract indices by one.
-    while (!f.eof()) 
+    const bool swap = (header.format == PlyHeader::BINARY_LITTLE_ENDIAN) != hostIsLittleEndian();
+
+    const char *p = file.data() + header.size;
+    const char *end = file.data() + file.size();
+    bool hasVertices = false;
+    for(size_t e = 0; e < header.elements.size() && p != nullptr; e++)
     {
-        std::getline(f, line);
-        if (line.substr(0, 2) == FACE_LINE) 
+        const PlyElement &element = header.elements[e];
+        if(element.name == "vertex" && !hasVertices)
         {
-            if (std::sscanf(line.c_str(), "f %d %d %d", &vindex[0], &vindex[1], &vindex[2]) == 3) 
-            {
-                for (unsigned i = 0; i < 3; ++i) 
-                {
-                    key = glm::uvec3(vindex[i], 0, 0);
-                    if (visited.count(key) == 0) 
-                    {
-                        visited[key] = next_index++;
-                        m_vertices.push_back(vertices[vindex[i] - 1]);
-                    }
-                    m_indices.push_back(visited[key]);
-                }
-            }
-            else if (std::sscanf(line.c_str(), "f %d/%d %d/%d %d/%d", &vindex[0], &tindex[0], &vindex[1], &tindex[1], &vindex[2], &tindex[2]) == 6) 
-            {
-                for (unsigned i = 0; i < 3; ++i) 
-                {
-                    key = glm::uvec3(vindex[i], tindex[i], 0);
-                    if (visited.count(key) == 0) 
-                    {
-                        visited[key] = next_index++;
-                        m_vertices.push_back(vertices[vindex[i] - 1]);
-                        m_texcoords.push_back( glm::vec2(texcoords[tindex[i] - 1].x, texcoords[tindex[i] - 1].y) );
-                    }
-                    m_indices.push_back(visited[key]);
-                }
-            }
-            else if (std::sscanf(line.c_str(), "f %d//%d %d//%d %d//%d", &vindex[0], &nindex[0], &vindex[1], &nindex[1], &vindex[2], &nindex[2]) == 6) 
-            {
-                for (unsigned i = 0; i < 3; ++i) 
-                {
-                    key = glm::uvec3(vindex[i], nindex[i], 0);
-                    if (visited.count(key) == 0) 
-                    {
-                        visited[key] = next_index++;
-                        m_vertices.push_back(vertices[vindex[i] - 1]);
-                        m_normals.push_back(normals[nindex[i] - 1]);
-                    }
-                    m_indices.push_back(visited[key]);
-                }
-            }
-            else if(std::sscanf(line.c_str(), "f %d/%d/%d %d/%d/%d %d/%d/%d", &vindex[0], &tindex[0], &nindex[0], &vindex[1], &tindex[1], &nindex[1], &vindex[2], &tindex[2], &nindex[2]) == 9) 
-            {
-                for(unsigned i = 0; i < 3; ++i) 
-                {
-                    key = glm::uvec3(vindex[i], tindex[i], nindex[i]);
-                    if (visited.count(key) == 0) 
-                    {
-                        visited[key] = next_index++;
-                        m_vertices.push_back(vertices[vindex[i] - 1]);
-                        m_texcoords.push_back( glm::vec2(texcoords[tindex[i] - 1].x, texcoords[tindex[i] - 1].y) );
-                        m_normals.push_back(normals[nindex[i] - 1]);
-                    }
-                    m_indices.push_back(visited[key]);
-                }
-            }
+            p = readPLYVertices(element, p, end, swap, m_vertices, m_normals, m_texcoords);
+            hasVertices = true;
+        }
+        else if(element.name == "face")
+        {
+            p = readPLYFaces(element, p, end, swap, m_indices);
+        }
+        else
+        {
+            p = skipPLYElement(element, p, end, swap);
+        }
+    }
+
+    if(p == nullptr || !hasVertices)
+    {
+        std::cerr << "[ERROR] TriMesh::importPLY(): Invalid or truncated data in " << _filename << std::endl;
+        clear();
+        return false;
+    }
+
+    const uint32_t numVertices = static_cast<uint32_t>(m_vertices.size());
+    for(size_t i = 0; i < m_indices.size(); i++)
+    {
+        if(m_indices[i] >= numVertices)
+        {
+            std::cerr << "[ERROR] TriMesh::importPLY(): Invalid face index in " << _filename << std::endl;
+            clear();
+            return false;
         }
     }
 
-    // Compute normals (if OBJ-file did not contain normals)
     if(m_normals.size() == 0) 
     {
-        std::cout << "[INFO] TriMesh::importOBJ(): Normals not provided, compute them " << std::endl;
+        std::cout << "[INFO] TriMesh::importPLY(): Normals not provided, compute them " << std::endl;
         computeNormals();
     }
 
@@ -452,13 +1965,226 @@ bool TriMesh::importOBJ(const std::string &_filename)
 }
 
 
+// Read a mesh from a binary .stl file. STL stores 3 vertices per facet,
+// shared vertices are merged with a hash map on their coordinates.
+bool TriMesh::importSTL(const std::string &_filename)
+{
+    QGL_TRACE_SCOPE("TriMesh::importSTL");
+    // 80 bytes header, facet count, then 50 bytes per facet (normal, 3 vertices, attribute)
+    const size_t STL_HEADER_SIZE = 84;
+    const size_t STL_FACET_SIZE = 50;
+
+    MappedFile file;
+    if(!file.open(_filename))
+    {
+        std::cerr << "[ERROR] TriMesh::importSTL(): Could not open " << _filename << std::endl;
+        return false;
+    }
+
+    uint32_t numFacets = 0;
+    if(file.size() >= STL_HEADER_SIZE)
+    {
+        std::memcpy(&numFacets, file.data() + 80, 4);
+        if(!hostIsLittleEndian())
+            numFacets = byteSwap32(numFacets);
+    }
+
+    // (some exporters append data after the facets, which is ignored)
+    if(file.size() < STL_HEADER_SIZE + STL_FACET_SIZE * static_cast<size_t>(numFacets))
+    {
+        // ASCII files start with "solid" (binary files may too, so the size is checked first)
+        if(std::strncmp(file.data(), "solid", 5) == 0)
+            std::cerr << "[ERROR] TriMesh::importSTL(): ASCII STL files are not supported: " << _filename << std::endl;
+        else
+            std::cerr << "[ERROR] TriMesh::importSTL(): Invalid size of " << _filename << std::endl;
+        return false;
+    }
+
+    // a closed mesh has about half as many vertices as facets
+    m_vertices.reserve(numFacets / 2 + 3);
+    m_indices.resize(3 * static_cast<size_t>(numFacets));
+    FlatHashMap<glm::uvec3, unsigned, UVec3Hash> visited(numFacets / 2 + 3);
+
+    const bool swap = !hostIsLittleEndian();
+    const char *facet = file.data() + STL_HEADER_SIZE;
+    glm::vec3 vertex;
+    uint32_t bits[3];
+    for(size_t f = 0; f < numFacets; f++, facet += STL_FACET_SIZE)
+    {
+        // skip the facet normal, normals are computed from the merged vertices
+        for(unsigned int k = 0; k < 3; k++)
+        {
+            std::memcpy(bits, facet + 12 * (k + 1), 12);
+            for(unsigned int c = 0; c < 3; c++)
+            {
+                if(swap)
+                    bits[c] = byteSwap32(bits[c]);
+                std::memcpy(&vertex[c], &bits[c], 4);
+                // hash the bit patterns of the coordinates (adding 0 turns -0 into +0)
+                vertex[c] += 0.0f;
+                std::memcpy(&bits[c], &vertex[c], 4);
+            }
+
+            std::pair<unsigned&, bool> entry = visited.insert(glm::uvec3(bits[0], bits[1], bits[2]), static_cast<unsigned>(m_vertices.size()));
+            if(entry.second)
+                m_vertices.push_back(vertex);
+            m_indices[3 * f + k] = entry.first;
+        }
+    }
+
+    computeNormals();
+
+    return true;
+}
+
+
+// Read a mesh from a .gltf or .glb file. The file stays mapped, 
+// and its buffer views are uploaded as they are by createVAO().
+bool TriMesh::importGLTF(const std::string &_filename)
+{
+    QGL_TRACE_SCOPE("TriMesh::importGLTF");
+    std::unique_ptr<GltfFile> gltf(new GltfFile());
+    if(!gltf->open(_filename))
+        return false;
+
+    const std::vector<GltfPrimitive> &primitives = gltf->primitives();
+    if(primitives.empty())
+    {
+        std::cerr << "[ERROR] TriMesh::importGLTF(): No triangle primitive in " << _filename << std::endl;
+        return false;
+    }
+
+    // AABB of the mesh, from the AABBs of the primitives
+    m_bBoxMin = primitives[0].bBoxMin;
+    m_bBoxMax = primitives[0].bBoxMax;
+    for(size_t p = 0; p < primitives.size(); p++)
+    {
+        m_bBoxMin = glm::min(m_bBoxMin, primitives[p].bBoxMin);
+        m_bBoxMax = glm::max(m_bBoxMax, primitives[p].bBoxMax);
+    }
+
+    // Compute normals of the primitives which have none (the others stay mapped)
+    const size_t nbComputed = gltf->computeMissingNormals();
+    if(nbComputed != 0) 
+        std::cout << "[INFO] TriMesh::importGLTF(): Normals not provided for " << nbComputed << " primitives, compute them " << std::endl;
+
+    m_gltf = std::move(gltf);
+
+    // Positions and indices are needed on the CPU by the BVH, the vertex clusters and the selection
+    copyGLTFGeometry();
+
+    return true;
+}
+
+
 void TriMesh::clear()
 {
     m_vertices.clear();
     m_normals.clear();
     m_indices.clear();
+    m_texcoords.clear();
 
     m_colors.clear();
+
+    m_lods.clear();
+    m_lodIndices.clear();
+    m_meshlets.clear();
+    m_bvh.clear();
+    m_vertexClusters.clear();
+
+    m_meshCache.close();
+    m_meshCacheHeader = nullptr;
+    m_indicesAreOptimized = false;
+    m_gltf.reset();
+}
+
+
+void TriMesh::detachMeshCache()
+{
+    if(m_gltf)
+    {
+        unpackGLTF();
+        return;
+    }
+
+    if(!m_meshCacheHeader)
+        return;
+
+    m_vertices.assign(vertexData(), vertexData() + numVertexData());
+    m_normals.assign(normalData(), normalData() + numNormalData());
+    m_texcoords.assign(texcoordData(), texcoordData() + numTexcoordData());
+    m_indices.assign(indexData(), indexData() + numIndexData());
+
+    m_meshCache.close();
+    m_meshCacheHeader = nullptr;
+}
+
+
+void TriMesh::unpackGLTF()
+{
+    QGL_TRACE_SCOPE("TriMesh::unpackGLTF");
+    const std::vector<GltfPrimitive> &primitives = m_gltf->primitives();
+
+    bool hasTexcoords = false;
+    for(size_t p = 0; p < primitives.size(); p++)
+        hasTexcoords = hasTexcoords || primitives[p].texcoords.data != nullptr;
+
+    // (positions and indices were copied by importGLTF())
+    m_normals.clear();
+    m_texcoords.clear();
+    m_normals.reserve(m_gltf->numVertices());
+
+    for(size_t p = 0; p < primitives.size(); p++)
+    {
+        const GltfPrimitive &primitive = primitives[p];
+        for(size_t i = 0; i < primitive.positions.count; i++)
+        {
+            if(primitive.normals.data)
+                m_normals.push_back( glm::vec3(primitive.normals.readFloat(i, 0), primitive.normals.readFloat(i, 1), primitive.normals.readFloat(i, 2)) );
+            else
+                m_normals.push_back( glm::vec3(0.0f) );
+
+            if(primitive.texcoords.data)
+                m_texcoords.push_back( glm::vec2(primitive.texcoords.readFloat(i, 0), primitive.texcoords.readFloat(i, 1)) );
+            else if(hasTexcoords)
+                m_texcoords.push_back( glm::vec2(0.0f) );
+        }
+    }
+
+    m_gltf.reset();
+}
+
+
+void TriMesh::copyGLTFGeometry()
+{
+    QGL_TRACE_SCOPE("TriMesh::copyGLTFGeometry");
+    const std::vector<GltfPrimitive> &primitives = m_gltf->primitives();
+
+    m_vertices.clear();
+    m_indices.clear();
+    m_vertices.reserve(m_gltf->numVertices());
+    m_indices.reserve(m_gltf->numIndices());
+
+    for(size_t p = 0; p < primitives.size(); p++)
+    {
+        const GltfPrimitive &primitive = primitives[p];
+        const uint32_t baseVertex = static_cast<uint32_t>(m_vertices.size());
+
+        for(size_t i = 0; i < primitive.positions.count; i++)
+            m_vertices.push_back( glm::vec3(primitive.positions.readFloat(i, 0), primitive.positions.readFloat(i, 1), primitive.positions.readFloat(i, 2)) );
+
+        if(primitive.indices.data)
+        {
+            // (indices are below the number of vertices of the primitive, see GltfFile::open())
+            for(size_t i = 0; i < primitive.numIndices(); i++)
+                m_indices.push_back(baseVertex + primitive.indices.readIndex(i));
+        }
+        else
+        {
+            for(size_t i = 0; i < primitive.numIndices(); i++)
+                m_indices.push_back(baseVertex + static_cast<uint32_t>(i));
+        }
+    }
 }
 
 
@@ -16,6 +16,10 @@
 #include <vector>
 #include <fstream>
 #include <sstream>
+#include <future>
+#include <functional>
+#include <memory>
+#include <atomic>
 
 
 #define QT_NO_OPENGL_ES_2
@@ -26,7 +30,18 @@
 #include <glm/glm.hpp>
 
 
-#include <map>
+#include "mappedfile.h"
+#include "indexoptimizer.h"
+#include "meshlet.h"
+#include "bvh.h"
+#include "vertexselection.h"
+#include "uniformbuffer.h"
+#include "glstatecache.h"
+#include "instancing.h"
+
+
+struct MeshCacheHeader;
+class GltfFile;
 
 
 // The attribute locations we will use in the vertex shader
@@ -34,7 +49,31 @@ enum AttributeLocation
 {
     POSITION = 0,
     NORMAL = 1,
-    COLOR = 2
+    COLOR = 2,
+    INSTANCE_ROTATION = 3,      // per-instance attributes (divisor 1), see InstanceTransform
+    INSTANCE_TRANSLATION = 4,
+    TEXCOORD = 5
+};
+
+
+// Weighting of the face normals averaged into vertex normals
+enum NormalWeighting
+{
+    NORMALS_UNIFORM = 0,        // average of the unit face normals
+    NORMALS_AREA = 1,           // face normals weighted by the area of the faces
+    NORMALS_ANGLE = 2           // face normals weighted by the angle of the faces at the vertex
+};
+
+
+/*!
+* \struct LevelOfDetail
+* \brief Range of the index VBO drawing the mesh at a level of detail (see TriMesh::generateLODs())
+*/
+struct LevelOfDetail
+{
+    size_t indexOffset;         /*!< first index of the level in the index VBO */
+    size_t count;               /*!< number of indices */
+    float error;                /*!< geometric error, in the units of the vertices (0 for the full mesh) */
 };
 
 
@@ -80,21 +119,213 @@ class TriMesh
         * \return 3D coords of the max point of the BBox
         */
         glm::vec3 getBBoxMax() { return m_bBoxMax; }
+        /*!
+        * \fn getBSphereCenter
+        * \brief get center of the bounding sphere (see computeBoundingSphere())
+        */
+        glm::vec3 getBSphereCenter() { return m_bSphereCenter; }
+        /*!
+        * \fn getBSphereRadius
+        * \brief get radius of the bounding sphere (see computeBoundingSphere())
+        */
+        float getBSphereRadius() { return m_bSphereRadius; }
 
 
 
         /*! \fn setProgram */
-        inline void setProgram(const std::string& _vertShaderFilename, const std::string& _fragShaderFilename) { m_program = loadShaderProgram(_vertShaderFilename, _fragShaderFilename); }
+        inline void setProgram(const std::string& _vertShaderFilename, const std::string& _fragShaderFilename) { m_program = loadShaderProgram(_vertShaderFilename, _fragShaderFilename); m_version++; }
+
+        /*! \fn program */
+        inline GLuint program() const { return m_program; }
+        /*! \fn materialBuffer 
+        * \brief name of the buffer of the material uniform block (0 before createVAO())
+        */
+        inline GLuint materialBuffer() const { return m_materialUniforms.name(); }
 
         /*! \fn setSpeculatPower */
-        inline void setSpeculatPower(float _specPow) { m_specPow = _specPow; }
+        inline void setSpeculatPower(float _specPow) { m_specPow = _specPow; m_materialIsModified = true; m_version++; }
 
         /*! \fn setAmbientColor */
-        inline void setAmbientColor(int _r, int _g, int _b) { m_ambientColor = glm::vec3( (float)_r/255.0f, (float)_g/255.0f, (float)_b/255.0f ); }
+        inline void setAmbientColor(int _r, int _g, int _b) { m_ambientColor = glm::vec3( (float)_r/255.0f, (float)_g/255.0f, (float)_b/255.0f ); m_materialIsModified = true; m_version++; }
         /*! \fn setDiffuseColor */
-        inline void setDiffuseColor(int _r, int _g, int _b) { m_diffuseColor = glm::vec3( (float)_r/255.0f, (float)_g/255.0f, (float)_b/255.0f ); }
+        inline void setDiffuseColor(int _r, int _g, int _b) { m_diffuseColor = glm::vec3( (float)_r/255.0f, (float)_g/255.0f, (float)_b/255.0f ); m_materialIsModified = true; m_version++; }
         /*! \fn setSpecularColor */
-        inline void setSpecularColor(int _r, int _g, int _b) { m_specularColor = glm::vec3( (float)_r/255.0f, (float)_g/255.0f, (float)_b/255.0f ); }
+        inline void setSpecularColor(int _r, int _g, int _b) { m_specularColor = glm::vec3( (float)_r/255.0f, (float)_g/255.0f, (float)_b/255.0f ); m_materialIsModified = true; m_version++; }
+
+        /*! \fn setStreamingUpload 
+        * \brief if enabled, createVAO() only allocates VBOs, which are then filled 
+        * over several frames by uploadStep() (see setUploadBudget())
+        */
+        inline void setStreamingUpload(bool _enabled) { m_streamingUpload = _enabled; }
+        /*! \fn streamingUpload */
+        inline bool streamingUpload() const { return m_streamingUpload; }
+
+        /*! \fn setUploadBudget 
+        * \brief set the max number of bytes uploaded per frame in streaming mode
+        */
+        inline void setUploadBudget(size_t _bytesPerFrame) { m_uploadBudget = _bytesPerFrame; }
+        /*! \fn uploadBudget */
+        inline size_t uploadBudget() const { return m_uploadBudget; }
+
+        /*! \fn setMeshCacheEnabled */
+        inline void setMeshCacheEnabled(bool _enabled) { m_meshCacheEnabled = _enabled; }
+        /*! \fn meshCacheEnabled */
+        inline bool meshCacheEnabled() const { return m_meshCacheEnabled; }
+
+        /*! \fn setIndexOptimizationEnabled 
+        * \brief if enabled (default), readFile() calls optimizeIndexOrder() after importing a file
+        */
+        inline void setIndexOptimizationEnabled(bool _enabled) { m_indexOptimizationEnabled = _enabled; }
+        /*! \fn indexOptimizationEnabled */
+        inline bool indexOptimizationEnabled() const { return m_indexOptimizationEnabled; }
+
+        /*! \fn setLODEnabled 
+        * \brief if enabled (default), readFileAsync() calls generateLODs() after loading a file
+        */
+        inline void setLODEnabled(bool _enabled) { m_lodEnabled = _enabled; }
+        /*! \fn lodEnabled */
+        inline bool lodEnabled() const { return m_lodEnabled; }
+
+        /*! \fn setLODPixelError 
+        * \brief set the max projected error (in pixels) of the levels of detail drawn by draw()
+        */
+        inline void setLODPixelError(float _pixels) { m_lodPixelError = _pixels; m_version++; }
+        /*! \fn lodPixelError */
+        inline float lodPixelError() const { return m_lodPixelError; }
+
+        /*!
+        * \fn levelsOfDetail
+        * \brief get the levels of detail generated by generateLODs(), from the full mesh to the coarsest level
+        * (empty if there is none)
+        */
+        const std::vector<LevelOfDetail> &levelsOfDetail() const { return m_lods; }
+
+        /*! \fn setMeshletCullingEnabled 
+        * \brief if enabled (default), draw() only submits the meshlets inside the view frustum (see optimizeIndexOrder())
+        */
+        inline void setMeshletCullingEnabled(bool _enabled) { m_meshletCullingEnabled = _enabled; m_version++; }
+        /*! \fn meshletCullingEnabled */
+        inline bool meshletCullingEnabled() const { return m_meshletCullingEnabled; }
+
+        /*! \fn setBackfaceCulling 
+        * \brief if enabled, back faces are culled by the GPU, and draw() does not submit the meshlets
+        * whose triangles are all back facing. Disabled by default: meshes must be closed and consistently oriented.
+        */
+        inline void setBackfaceCulling(bool _enabled) { m_backfaceCulling = _enabled; m_version++; }
+        /*! \fn backfaceCulling */
+        inline bool backfaceCulling() const { return m_backfaceCulling; }
+
+        /*!
+        * \fn meshlets
+        * \brief get the meshlets of the index buffer built by optimizeIndexOrder() (empty if there is none)
+        */
+        const std::vector<Meshlet> &meshlets() const { return m_meshlets; }
+
+        /*!
+        * \fn numDrawnIndices
+        * \brief get the number of indices submitted by the last call to draw() (after level of detail selection and culling)
+        */
+        size_t numDrawnIndices() const { return m_numDrawnIndices; }
+
+        /*!
+        * \fn numDrawCalls
+        * \brief get the number of draw calls submitted by the last call to draw() (glMultiDrawElements() counts as one)
+        */
+        size_t numDrawCalls() const { return m_numDrawCalls; }
+
+        /*!
+        * \fn version
+        * \brief get a counter increased each time what draw() displays is modified (GL buffers, material, 
+        * drawing options): the mesh does not need to be drawn again as long as it is the same (and the camera as well).
+        */
+        uint64_t version() const { return m_version; }
+
+        /*!
+        * \fn setInstances
+        * \brief draw the mesh once per transform with a single instanced draw call (see draw()).
+        * The bounding sphere of the mesh must be computed before (e.g., once loading is done).
+        * \param _instances : transforms of the instances (see makeInstanceTransform())
+        */
+        void setInstances(const std::vector<InstanceTransform> &_instances);
+        /*!
+        * \fn clearInstances
+        * \brief draw the mesh once again, with its own coords
+        */
+        void clearInstances();
+        /*! \fn hasInstances */
+        bool hasInstances() const { return !m_instances.empty(); }
+        /*!
+        * \fn instancingSupported
+        * \brief Returns true if the instances can be drawn, i.e. if createVAO() found GL 3.3 or ARB_instanced_arrays.
+        * Otherwise draw() ignores the instances and draws the mesh once.
+        */
+        bool instancingSupported() const { return m_instanceVBO != 0; }
+        /*! \fn numInstances */
+        size_t numInstances() const { return m_instances.size(); }
+        /*!
+        * \fn numVisibleInstances
+        * \brief get the number of instances which passed the culling of the last draw()
+        */
+        size_t numVisibleInstances() const { return m_visibleInstances.size(); }
+        /*!
+        * \fn getInstancesBSphereCenter
+        * \brief get center of the sphere bounding all the instances (see setInstances())
+        */
+        glm::vec3 getInstancesBSphereCenter() const { return m_instancesBSphereCenter; }
+        /*!
+        * \fn getInstancesBSphereRadius
+        * \brief get radius of the sphere bounding all the instances (see setInstances())
+        */
+        float getInstancesBSphereRadius() const { return m_instancesBSphereRadius; }
+
+        /*!
+        * \fn bvh
+        * \brief get the bounding volume hierarchy of the triangles built by computeBVH() (empty if there is none)
+        */
+        const Bvh &bvh() const { return m_bvh; }
+
+        /*!
+        * \fn vertexClusters
+        * \brief get the bounding boxes of the clusters of consecutive vertices built by computeVertexClusters(), used by selectVertices()
+        */
+        const std::vector<VertexCluster> &vertexClusters() const { return m_vertexClusters; }
+
+
+        /*!
+        * \fn vertexData
+        * \brief get vertices positions, from the arrays or from the mapped mesh cache
+        * (for glTF data, positions of the primitives copied by importGLTF(), one after the other)
+        */
+        const glm::vec3 *vertexData() const;
+        /*! \fn numVertexData */
+        size_t numVertexData() const;
+
+        /*!
+        * \fn normalData
+        * \brief get vertices normals, from the arrays or from the mapped mesh cache
+        * (empty for glTF data, until detachMeshCache() is called)
+        */
+        const glm::vec3 *normalData() const;
+        /*! \fn numNormalData */
+        size_t numNormalData() const;
+
+        /*!
+        * \fn texcoordData
+        * \brief get vertices uvs, from the arrays or from the mapped mesh cache
+        * (empty for glTF data, until detachMeshCache() is called)
+        */
+        const glm::vec2 *texcoordData() const;
+        /*! \fn numTexcoordData */
+        size_t numTexcoordData() const;
+
+        /*!
+        * \fn indexData
+        * \brief get vertices indices, from the arrays or from the mapped mesh cache
+        * (for glTF data, indices of the primitives copied by importGLTF(), offset by the first vertex of their primitive)
+        */
+        const uint32_t *indexData() const;
+        /*! \fn numIndexData */
+        size_t numIndexData() const;
 
         /*------------------------------------------------------------------------------------------------------------+
         |                                                   MISC.                                                     |
@@ -102,42 +333,200 @@ class TriMesh
 
         /*!
         * \fn readFile
-        * \brief read a mesh from a file
+        * \brief read a mesh from a file.
+        * Supported formats: .obj, gzip or zstd compressed .obj (.obj.gz, .obj.zst), binary .ply and binary .stl.
+        * If the mesh cache is enabled, a binary cache is written next to the file (_filename + MESH_CACHE_EXTENSION),
+        * and is used instead of the file as long as the file size and modification time do not change.
+        * The index order is optimized if enabled (see optimizeIndexOrder()), and the AABB is computed.
         * \param _filename : name of the file to read
-        * \return false if file extension is not supported, true if it is
+        * \param _nbThreads : number of threads used for the import (1: serial import, 0: threads of ThreadPool::global())
+        * \return false if file extension is not supported or if the file could not be read, true otherwise
+        */
+        bool readFile(std::string _filename, unsigned int _nbThreads = 0);
+
+
+        /*!
+        * \fn readFileAsync
+        * \brief read a mesh from a file on a worker thread.
+        * readFile(), computeBoundingSphere(), generateLODs() (if enabled), computeBVH() and computeVertexClusters() are executed asynchronously, GL resources are not touched:
+        * createVAO() must be called from the GL thread once loading is done.
+        * The mesh must not be used (except isLoading()) until then.
+        * \param _filename : name of the file to read
+        * \param _nbThreads : number of threads used for the import (see readFile())
+        * \param _onDone : optional callback, called from the worker thread with the result of readFile() when loading is done
+        * \return future holding the result of readFile()
+        */
+        std::shared_future<bool> readFileAsync(const std::string &_filename, unsigned int _nbThreads = 0, std::function<void(bool)> _onDone = nullptr);
+
+        /*!
+        * \fn isLoading
+        * \brief Returns true if an asynchronous loading started by readFileAsync() is not done yet
+        * (false as soon as the mesh is read, before the callback of readFileAsync() is called)
         */
-        bool readFile(std::string _filename);
+        bool isLoading() const;
+
+        /*!
+        * \fn hasVAO
+        * \brief Returns true if createVAO() has been called (i.e. if the mesh can be drawn)
+        */
+        bool hasVAO() const { return m_meshVAO != 0; }
+
+
+        /*!
+        * \fn writeMeshCache
+        * \brief write mesh data and AABB in a binary cache file (see meshcache.h).
+        * The indices are checked here, once, instead of each time the cache is read.
+        * \param _cacheFilename : name of the cache file to write
+        * \param _sourceFilename : name of the file the mesh has been read from, used to detect outdated caches (optional)
+        * \return false if the file could not be written, or if the mesh is invalid (e.g., out of range indices)
+        */
+        bool writeMeshCache(const std::string &_cacheFilename, const std::string &_sourceFilename = "");
+
+        /*!
+        * \fn readMeshCache
+        * \brief map a binary cache file in memory. 
+        * Mesh data is not copied in the arrays: it is read from the mapped file by createVAO().
+        * \param _cacheFilename : name of the cache file to read
+        * \param _sourceFilename : if not empty, the cache is rejected if it does not match the size and modification time of this file
+        * \return false if the file could not be read, is invalid (e.g., its indices were not checked) or is outdated,
+        * or if its index order does not match indexOptimizationEnabled()
+        */
+        bool readMeshCache(const std::string &_cacheFilename, const std::string &_sourceFilename = "");
 
 
         /*!
         * \fn computeAABB
-        * \brief compute Axis Oriented Bounding Box
+        * \brief compute Axis Oriented Bounding Box (parallel SIMD min/max reduction)
         */
         void computeAABB();
 
+        /*!
+        * \fn computeBoundingSphere
+        * \brief compute a tight bounding sphere of the vertices (Ritter's algorithm), 
+        * which can be used as scene center and radius. computeAABB() must be called before.
+        */
+        void computeBoundingSphere();
+
         /*!
         * \fn computeNormals
-        * \brief recompute the triangle normals and update vertex normals
+        * \brief recompute the triangle normals and update vertex normals.
+        * Each vertex gathers the normals of its faces through a vertex to face adjacency,
+        * so that vertices (and faces) are processed in parallel.
+        * \param _weighting : weighting of the face normals (NORMALS_UNIFORM by default)
+        */
+        void computeNormals(NormalWeighting _weighting = NORMALS_UNIFORM);
+
+        /*!
+        * \fn computeBVH
+        * \brief build the bounding volume hierarchy of the triangles (see Bvh), used for ray queries.
+        * Triangles are identified by their index in indexData(): it must be built again if the indices change.
+        */
+        void computeBVH();
+
+        /*!
+        * \fn computeVertexClusters
+        * \brief compute the bounding boxes of the clusters of consecutive vertices (see buildVertexClusters()),
+        * which select or reject whole clusters of vertices in a region of the screen.
+        * They must be computed again if the vertices change.
+        */
+        void computeVertexClusters();
+
+
+        /*!
+        * \fn optimizeIndexOrder
+        * \brief reorder triangles and vertices for the GPU, before createVAO():
+        * post-transform vertex cache optimization (Forsyth), then overdraw reduction 
+        * (outer clusters of triangles first), then triangles are grouped in meshlets culled by draw() 
+        * (see buildMeshlets()), then vertices are sorted by first use (vertex fetch).
+        * ACMR and ATVR before and after are printed.
+        */
+        void optimizeIndexOrder();
+
+        /*!
+        * \fn analyzeVertexCache
+        * \brief measure the efficiency of the index buffer with a simulated FIFO post-transform cache
+        * \param _cacheSize : number of entries of the cache
+        * \return ACMR (transformed vertices per triangle) and ATVR (transformed vertices per vertex)
+        */
+        VertexCacheStats analyzeVertexCache(unsigned int _cacheSize = 16) const;
+
+
+        /*!
+        * \fn generateLODs
+        * \brief generate a chain of levels of detail (50%, 25%, 10% and 2% of the triangles) by
+        * quadric error edge collapses (see MeshSimplifier), which preserve normal and uv seams.
+        * Levels only have their own indices: they share the vertices (and the VBOs) of the mesh.
+        * Small meshes and glTF meshes have no levels of detail. Must be called before createVAO().
+        */
+        void generateLODs();
+
+        /*!
+        * \fn selectLOD
+        * \brief select the coarsest level of detail whose error, projected on the screen 
+        * at the distance of the bounding sphere, is smaller than lodPixelError()
+        * \param _mv : modelview matrix
+        * \param _projection : projection matrix
+        * \param _screenHeight : height of the viewport (in pixels)
+        * \return index of the level in levelsOfDetail() (0: full mesh)
+        */
+        size_t selectLOD(const glm::mat4 &_mv, const glm::mat4 &_projection, int _screenHeight) const;
+
+
+        /*!
+        * \fn detachMeshCache
+        * \brief If mesh data comes from a mapped mesh cache or glTF file, copy it into the 
+        * attribute vectors and unmap the file (e.g., before modifying the mesh or reading it on the CPU).
         */
-        void computeNormals();
+        void detachMeshCache();
 
 
         /*!
         * \fn createVAO
         * \brief Create mesh VAO and VBOs.
+        * A mesh whose indices exceed its number of vertices is left empty, normals which do not match the vertices are computed again.
         */
         void createVAO();
 
 
+        /*!
+        * \fn uploadStep
+        * \brief In streaming mode, upload the next slices of the VBOs, within the upload budget.
+        * Indices are uploaded as soon as the vertices they use are resident, so that the
+        * mesh fills in progressively. Called by draw().
+        */
+        void uploadStep();
+
+        /*!
+        * \fn isUploading
+        * \brief Returns true if the VBOs are not completely uploaded yet (streaming mode)
+        */
+        bool isUploading() const { return hasVAO() && (m_numUploadedVertices < m_numVertices || m_numUploadedIndices < m_numIndices); }
+
+
         /*!
         * \fn draw
-        * \brief Draw the content of the mesh VAO
+        * \brief Draw the content of the mesh VAO.
+        * In streaming mode, only the triangles already uploaded are drawn.
+        * If the projection and the screen height are given, the level of detail is chosen by selectLOD().
+        * The full mesh is drawn with one glMultiDrawElements() of the meshlets which pass cullMeshlets().
+        * If the mesh has instances (see setInstances()), the instances whose bounding sphere is in the view frustum
+        * are packed in the instance VBO and the full mesh is drawn with one glDrawElementsInstanced()
+        * (no level of detail nor meshlet culling).
+        * The camera uniform block must be bound by the caller (see CameraUniforms), the material block
+        * is only uploaded again after a change of the material.
+        * Without state cache, the program, VAO and face culling are reset after drawing. With a state cache,
+        * they are left as is and only the bindings which differ from the cached ones are set: consecutive
+        * meshes with the same program do not switch it (see Scene).
         * \param _mv : modelview matrix
         * \param _mvp : modelview-projection matrix
-        * \param _lightPos : 3D coords of light position
-        * \param _lightCol : RGB color of the light
+        * \param _projection : projection matrix
+        * \param _screenHeight : height of the viewport (in pixels), 0 to draw the full mesh
+        * \param _cameraVersion : version of the camera which gives the matrices (see Camera::version()), 0 if unknown.
+        * If neither the camera nor the mesh changed since the last draw, the culled meshlets (or instances) and the level of detail are reused.
+        * \param _state : cache of the GL bindings shared by the draws of a frame, nullptr to reset them
         */
-        void draw(glm::mat4 _mv, glm::mat4 _mvp, glm::vec3 _lightPos, glm::vec3 _lightCol);
+        void draw(const glm::mat4 &_mv, const glm::mat4 &_mvp, const glm::mat4 &_projection = glm::mat4(1.0f), 
+                  int _screenHeight = 0, uint64_t _cameraVersion = 0, GLStateCache *_state = nullptr);
 
  
         /*!
@@ -165,6 +554,8 @@ class TriMesh
 
         glm::vec3 m_bBoxMin;                    /*!< 3D coordinates of the min corner of the bounding box */
         glm::vec3 m_bBoxMax;                    /*!< 3D coordinates of the max corner of the bounding box */
+        glm::vec3 m_bSphereCenter;              /*!< 3D coordinates of the center of the bounding sphere */
+        float m_bSphereRadius;                  /*!< radius of the bounding sphere */
 
 
         GLuint m_program;                       /*!< handle of the program object (i.e. shaders) for shaded surface rendering */
@@ -174,17 +565,79 @@ class TriMesh
 
         GLuint m_vertexVBO;                     /*!< name of vertex 3D coords VBO */
         GLuint m_normalVBO;                     /*!< name of normal vector VBO */
+        GLuint m_texcoordVBO;                   /*!< name of texcoord VBO, 0 if the mesh has no texcoords */
         GLuint m_colorVBO;                      /*!< name of rgb color VBO */
         GLuint m_indexVBO;                      /*!< name of index VBO */
+        GLuint m_instanceVBO;                   /*!< name of instance transforms VBO (one identity transform if the mesh has no instances), 0 without instanced arrays */
+
+        size_t m_numVertices;                   /*!< number of vertices in the VBOs */
+        size_t m_numIndices;                    /*!< number of indices in the index VBO */
 
-        int m_numVertices;                      /*!< number of vertices in the VBOs */
-        int m_numIndices;                       /*!< number of indices in the index VBO */
+        bool m_streamingUpload;                 /*!< if true, VBOs are filled progressively by uploadStep() */
+        size_t m_uploadBudget;                  /*!< max number of bytes uploaded per call to uploadStep() */
+        size_t m_numUploadedVertices;           /*!< number of vertices (positions and normals) already in the VBOs */
+        size_t m_numUploadedIndices;            /*!< number of indices already in the index VBO */
+        size_t m_numDrawableIndices;            /*!< number of indices drawn (complete triangles whose vertices are resident) */
 
         float m_specPow;                        /*!< specular power */
 
+        bool m_meshCacheEnabled;                /*!< read and write binary mesh cache in readFile() */
+        bool m_indexOptimizationEnabled;        /*!< reorder triangles and vertices in readFile() */
+        MappedFile m_meshCache;                 /*!< mapped mesh cache file, if mesh data comes from a cache */
+        std::shared_future<bool> m_loading;     /*!< result of the asynchronous loading started by readFileAsync() */
+        std::atomic<bool> m_isLoading;          /*!< true from readFileAsync() until the mesh is read (cleared before the callback is called) */
+        const MeshCacheHeader *m_meshCacheHeader; /*!< header of the mapped mesh cache, nullptr if none */
+        bool m_indicesAreOptimized;             /*!< optimizeIndexOrder() has been applied to the current data */
+        std::unique_ptr<GltfFile> m_gltf;       /*!< mapped glTF file, if mesh data is read directly from it */
+
+        /*!
+        * \struct DrawRange
+        * \brief Range of the index VBO drawn with its own index type and base vertex (one per glTF primitive)
+        */
+        struct DrawRange
+        {
+            size_t indexOffset;                 /*!< offset of the first index (in bytes) */
+            size_t count;                       /*!< number of indices (of vertices if indexType is GL_NONE) */
+            GLenum indexType;                   /*!< GL_UNSIGNED_BYTE/SHORT/INT, or GL_NONE for non-indexed primitives */
+            GLint baseVertex;                   /*!< index of the first vertex of the range in the VBOs */
+        };
+        std::vector<DrawRange> m_drawRanges;    /*!< draw calls issued by draw(), empty to draw the whole index VBO */
+
+        bool m_lodEnabled;                      /*!< generate levels of detail in readFileAsync() */
+        float m_lodPixelError;                  /*!< max projected error of the level of detail drawn (in pixels) */
+        std::vector<LevelOfDetail> m_lods;      /*!< levels of detail, m_lods[0] is the full mesh */
+        std::vector<uint32_t> m_lodIndices;     /*!< indices of the levels of detail (except the full mesh), after the mesh indices in the index VBO */
+
+        std::vector<Meshlet> m_meshlets;        /*!< meshlets of the mesh indices, empty if they are not grouped in meshlets */
+        bool m_meshletCullingEnabled;           /*!< cull the meshlets in draw() */
+        bool m_backfaceCulling;                 /*!< cull back faces (GL and meshlet normal cones) */
+        std::vector<uint32_t> m_visibleMeshlets; /*!< meshlets which passed the culling in draw() */
+        std::vector<GLsizei> m_drawCounts;      /*!< counts of the ranges of visible meshlets drawn by glMultiDrawElements() */
+        std::vector<const void*> m_drawOffsets; /*!< offsets of the ranges of visible meshlets */
+        size_t m_numDrawnIndices;               /*!< number of indices submitted by the last draw() */
+        size_t m_numDrawCalls;                  /*!< number of draw calls submitted by the last draw() */
+        size_t m_drawnLevel;                    /*!< level of detail drawn by the last draw() */
+        size_t m_numCulledIndices;              /*!< number of indices of the visible meshlets of the last draw() */
+
+        std::vector<InstanceTransform> m_instances;         /*!< transforms of the instances, empty if the mesh is drawn once */
+        std::vector<InstanceTransform> m_visibleInstances;  /*!< instances which passed the culling in draw() */
+        glm::vec3 m_instancesBSphereCenter;     /*!< center of the sphere bounding the instances */
+        float m_instancesBSphereRadius;         /*!< radius of the sphere bounding the instances */
+        size_t m_instanceCapacity;              /*!< number of transforms allocated in the instance VBO */
+        bool m_instancesAreUploaded;            /*!< the instance VBO holds m_visibleInstances (identity transform otherwise) */
+
+        uint64_t m_version;                     /*!< increased each time what draw() displays is modified */
+        uint64_t m_drawnVersion;                /*!< version of the mesh at the last draw() */
+        uint64_t m_drawnCameraVersion;          /*!< version of the camera at the last draw(), 0 if unknown */
+
+        Bvh m_bvh;                              /*!< bounding volume hierarchy of the triangles, for ray queries */
+        std::vector<VertexCluster> m_vertexClusters; /*!< bounding boxes of the clusters of consecutive vertices, for selections */
+
         glm::vec3 m_ambientColor;               /*!< ambient color */
         glm::vec3 m_diffuseColor;               /*!< diffuse color */
         glm::vec3 m_specularColor;              /*!< specular color */
+        UniformBuffer m_materialUniforms;       /*!< material uniform block (colors and specular power) */
+        bool m_materialIsModified;              /*!< the material changed since the last upload of m_materialUniforms */
 
 
         /*------------------------------------------------------------------------------------------------------------+
@@ -192,16 +645,99 @@ class TriMesh
         +-------------------------------------------------------------------------------------------------------------*/
 
 
+        /*!
+        * \fn loadFile
+        * \brief read a mesh from a file (see readFile()), then run the steps which follow the import,
+        * shared by readFile() and readFileAsync()
+        * \param _filename : name of the file to read
+        * \param _nbThreads : number of threads used for the import
+        * \param _prepareForDrawing : also compute the bounding sphere, levels of detail, BVH and vertex clusters (see readFileAsync())
+        * \return false if the file could not be read
+        */
+        bool loadFile(const std::string &_filename, unsigned int _nbThreads, bool _prepareForDrawing);
+
         /*!
         * \fn importOBJ
-        * \brief read OBJ file
+        * \brief read OBJ file (gzip or zstd compressed files are decompressed on the fly)
         * \param _filename: name of file
         */
         bool importOBJ(const std::string &_filename);
 
+        /*!
+        * \fn importOBJParallel
+        * \brief read OBJ file using several threads.
+        * The file is split into newline-aligned chunks which are tokenized in parallel,
+        * then stitched with prefix sums. Produces the same arrays as importOBJ().
+        * \param _filename: name of file
+        * \param _nbThreads: number of threads (0: threads of ThreadPool::global())
+        */
+        bool importOBJParallel(const std::string &_filename, unsigned int _nbThreads);
+
+        /*!
+        * \fn importPLY
+        * \brief read binary PLY file (little or big endian).
+        * Reads positions, and normals and texcoords if present. Polygons are triangulated as fans.
+        * \param _filename: name of file
+        */
+        bool importPLY(const std::string &_filename);
+
+        /*!
+        * \fn importSTL
+        * \brief read binary STL file. Vertices of adjacent facets are merged,
+        * and normals are computed (facet normals are ignored).
+        * \param _filename: name of file
+        */
+        bool importSTL(const std::string &_filename);
+
+        /*!
+        * \fn importGLTF
+        * \brief read glTF 2.0 file (.gltf or .glb). The triangle primitives of all the meshes are
+        * read (node transforms are ignored). The file stays mapped, and createVAO() uploads the buffer views
+        * directly to the VBOs. Normals are only computed for the primitives which have none, and the positions
+        * and indices are copied in the arrays for the queries on the CPU (BVH, vertex clusters, selection).
+        * \param _filename: name of file
+        */
+        bool importGLTF(const std::string &_filename);
+
+        /*!
+        * \fn unpackGLTF
+        * \brief Copy the primitives of the mapped glTF file into the attribute vectors, and release the file
+        */
+        void unpackGLTF();
+
+        /*!
+        * \fn copyGLTFGeometry
+        * \brief Copy the positions and the indices of the primitives of the mapped glTF file into m_vertices and m_indices
+        */
+        void copyGLTFGeometry();
+
+        /*!
+        * \fn createBuffers
+        * \brief Create and fill the vertex, normal, texcoord and index VBOs from the attribute vectors (or the mesh cache)
+        */
+        void createBuffers();
+
+        /*!
+        * \fn createGLTFBuffers
+        * \brief Create the vertex, normal, texcoord and index VBOs, and fill them with the accessor ranges of the glTF file
+        */
+        void createGLTFBuffers();
+
+        /*!
+        * \fn uploadMaterial
+        * \brief Upload the material to its uniform buffer (created at the first call), if it changed since the last upload
+        */
+        void uploadMaterial();
+
+        /*!
+        * \fn uploadInstances
+        * \brief Copy the visible instances to the instance VBO, or the identity transform if the mesh has no instances
+        */
+        void uploadInstances();
+
         /*!
         * \fn clear
-        * \brief Clear the content of all the attribute vectors
+        * \brief Clear the content of all the attribute vectors, and unmap the mesh cache
         */
         void clear();
 
@@ -0,0 +1,77 @@
+/*********************************************************************************************************************
+ *
+ * uniformbuffer.cpp
+ *
+ * Uniform buffer objects (UBO) of the camera and of the materials, shared by the shaders
+ *
+ * QGL_toolkit demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#include <iostream>
+
+
+#include "uniformbuffer.h"
+
+
+// the blocks are copied as is into std140 buffers: vec4 and mat4 members only, no padding
+static_assert(sizeof(CameraUniforms) == 2 * 64 + 2 * 16, "CameraUniforms does not match the std140 layout");
+static_assert(sizeof(MaterialUniforms) == 3 * 16, "MaterialUniforms does not match the std140 layout");
+
+
+UniformBuffer::UniformBuffer()
+: m_buffer(0), m_size(0)
+{
+}
+
+
+UniformBuffer::~UniformBuffer()
+{
+    if(m_buffer != 0)
+        glDeleteBuffers(1, &m_buffer);
+}
+
+
+void UniformBuffer::upload(const void *_data, size_t _size)
+{
+    if(m_buffer == 0)
+        glGenBuffers(1, &m_buffer);
+
+    glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+    if(_size != m_size)
+    {
+        glBufferData(GL_UNIFORM_BUFFER, (GLsizeiptr)_size, _data, GL_DYNAMIC_DRAW);
+        m_size = _size;
+    }
+    else
+    {
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, (GLsizeiptr)_size, _data);
+    }
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+
+void UniformBuffer::bind(GLuint _binding) const
+{
+    glBindBufferBase(GL_UNIFORM_BUFFER, _binding, m_buffer);
+}
+
+
+bool bindUniformBlocks(GLuint _program)
+{
+    const GLuint cameraBlock = glGetUniformBlockIndex(_program, "Camera");
+    const GLuint materialBlock = glGetUniformBlockIndex(_program, "Material");
+
+    if(cameraBlock != GL_INVALID_INDEX)
+        glUniformBlockBinding(_program, cameraBlock, CAMERA_UNIFORM_BINDING);
+    if(materialBlock != GL_INVALID_INDEX)
+        glUniformBlockBinding(_program, materialBlock, MATERIAL_UNIFORM_BINDING);
+
+    if(cameraBlock == GL_INVALID_INDEX && materialBlock == GL_INVALID_INDEX)
+    {
+        std::cerr << "[WARNING] bindUniformBlocks(): the program has no Camera or Material uniform block" << std::endl;
+        return false;
+    }
+    return true;
+}
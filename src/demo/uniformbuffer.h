@@ -0,0 +1,116 @@
+/*********************************************************************************************************************
+ *
+ * uniformbuffer.h
+ *
+ * Uniform buffer objects (UBO) of the camera and of the materials, shared by the shaders
+ *
+ * QGL_toolkit demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#ifndef UNIFORMBUFFER_H
+#define UNIFORMBUFFER_H
+
+#include <cstddef>
+
+
+#define QT_NO_OPENGL_ES_2
+#include <GL/glew.h>
+
+
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+
+
+// Binding points of the uniform blocks, set once per program by bindUniformBlocks()
+const GLuint CAMERA_UNIFORM_BINDING = 0;
+const GLuint MATERIAL_UNIFORM_BINDING = 1;
+
+
+/*!
+* \struct CameraUniforms
+* \brief Content of the "Camera" uniform block of the shaders (std140 layout), updated once per frame
+*/
+struct CameraUniforms
+{
+    glm::mat4 mv;               /*!< view matrix (meshes are drawn in world coords) */
+    glm::mat4 mvp;              /*!< projection * view matrix */
+    glm::vec4 lightPosition;    /*!< xyz: position of the light, w unused */
+    glm::vec4 lightColor;       /*!< rgb: color of the light, w unused */
+};
+
+
+/*!
+* \struct MaterialUniforms
+* \brief Content of the "Material" uniform block of the shaders (std140 layout), uploaded when the material changes
+*/
+struct MaterialUniforms
+{
+    glm::vec4 ambientColor;     /*!< rgb: ambient color, w unused */
+    glm::vec4 diffuseColor;     /*!< rgb: diffuse color, w unused */
+    glm::vec4 specularColor;    /*!< rgb: specular color, w: specular power */
+};
+
+
+/*!
+* \class UniformBuffer
+* \brief Buffer object holding the content of a uniform block.
+* GL functions are only called by upload(), bind() and the destructor, with the GL context current.
+*/
+class UniformBuffer
+{
+    public:
+
+        /*!
+        * \fn UniformBuffer
+        * \brief Constructor, the buffer is created by the first upload()
+        */
+        UniformBuffer();
+
+        /*!
+        * \fn ~UniformBuffer
+        * \brief Destructor, deletes the buffer if it was created
+        */
+        ~UniformBuffer();
+
+        /*!
+        * \fn upload
+        * \brief Copy the content of the uniform block to the buffer (allocated by the first call)
+        * \param _data : content of the block
+        * \param _size : size of the block (constant over the calls)
+        */
+        void upload(const void *_data, size_t _size);
+
+        /*!
+        * \fn bind
+        * \brief Bind the buffer to a uniform binding point (see CAMERA_UNIFORM_BINDING and MATERIAL_UNIFORM_BINDING)
+        */
+        void bind(GLuint _binding) const;
+
+        /*! \fn isCreated */
+        bool isCreated() const { return m_buffer != 0; }
+
+        /*! \fn name */
+        GLuint name() const { return m_buffer; }
+
+    private:
+
+        GLuint m_buffer;        /*!< name of the buffer object, 0 before the first upload() */
+        size_t m_size;          /*!< allocated size of the buffer */
+
+        // Copy constructor and operator= are declared private and undefined
+        UniformBuffer(const UniformBuffer &);
+        UniformBuffer &operator=(const UniformBuffer &);
+};
+
+
+/*!
+* \fn bindUniformBlocks
+* \brief Assign the "Camera" and "Material" uniform blocks of a program to their binding points.
+* Called once when the program is linked: draws only bind buffers, no uniform is looked up by name.
+* \return false if the program has none of the blocks
+*/
+bool bindUniformBlocks(GLuint _program);
+
+#endif // UNIFORMBUFFER_H
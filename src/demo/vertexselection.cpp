@@ -0,0 +1,437 @@
+/*********************************************************************************************************************
+ *
+ * vertexselection.cpp
+ *
+ * Selection of the vertices and faces of a mesh inside a region of the screen
+ *
+ * QGL_toolkit demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#include <algorithm>
+#include <bitset>
+#include <cmath>
+#include <limits>
+
+
+#include "vertexselection.h"
+#include "bvh.h"
+#include "threadpool.h"
+#include "simd.h"
+#include "trace.h"
+
+
+namespace
+{
+    // Number of clusters processed by a task
+    const size_t CLUSTERS_PER_TASK = 64;
+
+    // Number of selection words processed by a task (of faces, or of vertices tested for occlusion)
+    const size_t WORDS_PER_TASK = 256;
+
+    // Number of rays tested for occlusion at once
+    const size_t RAY_BATCH_SIZE = 256;
+
+
+#if defined(QGL_USE_AVX)
+    typedef __m256 SimdFloat;
+    const size_t SIMD_WIDTH = 8;
+    inline SimdFloat simdLoad(const float *_p) { return _mm256_loadu_ps(_p); }
+    inline SimdFloat simdSet1(float _value) { return _mm256_set1_ps(_value); }
+    inline SimdFloat simdAdd(SimdFloat _a, SimdFloat _b) { return _mm256_add_ps(_a, _b); }
+    inline SimdFloat simdMul(SimdFloat _a, SimdFloat _b) { return _mm256_mul_ps(_a, _b); }
+    inline SimdFloat simdDiv(SimdFloat _a, SimdFloat _b) { return _mm256_div_ps(_a, _b); }
+    inline SimdFloat simdNeg(SimdFloat _a) { return _mm256_xor_ps(_a, _mm256_set1_ps(-0.0f)); }
+    inline SimdFloat simdLessEqual(SimdFloat _a, SimdFloat _b) { return _mm256_cmp_ps(_a, _b, _CMP_LE_OQ); }
+    inline SimdFloat simdAnd(SimdFloat _a, SimdFloat _b) { return _mm256_and_ps(_a, _b); }
+    inline int simdMoveMask(SimdFloat _a) { return _mm256_movemask_ps(_a); }
+    inline void simdStore(float *_p, SimdFloat _a) { _mm256_storeu_ps(_p, _a); }
+#elif defined(QGL_USE_SSE2)
+    typedef __m128 SimdFloat;
+    const size_t SIMD_WIDTH = 4;
+    inline SimdFloat simdLoad(const float *_p) { return _mm_loadu_ps(_p); }
+    inline SimdFloat simdSet1(float _value) { return _mm_set1_ps(_value); }
+    inline SimdFloat simdAdd(SimdFloat _a, SimdFloat _b) { return _mm_add_ps(_a, _b); }
+    inline SimdFloat simdMul(SimdFloat _a, SimdFloat _b) { return _mm_mul_ps(_a, _b); }
+    inline SimdFloat simdDiv(SimdFloat _a, SimdFloat _b) { return _mm_div_ps(_a, _b); }
+    inline SimdFloat simdNeg(SimdFloat _a) { return _mm_xor_ps(_a, _mm_set1_ps(-0.0f)); }
+    inline SimdFloat simdLessEqual(SimdFloat _a, SimdFloat _b) { return _mm_cmple_ps(_a, _b); }
+    inline SimdFloat simdAnd(SimdFloat _a, SimdFloat _b) { return _mm_and_ps(_a, _b); }
+    inline int simdMoveMask(SimdFloat _a) { return _mm_movemask_ps(_a); }
+    inline void simdStore(float *_p, SimdFloat _a) { _mm_storeu_ps(_p, _a); }
+#else
+    const size_t SIMD_WIDTH = 1;
+#endif
+
+
+    /*!
+    * \struct ScreenProjection
+    * \brief Projection of points to pixel coords: clip coords by the view-projection matrix,
+    * then px = x / w * scaleX + offsetX, py = y / w * scaleY + offsetY (y pointing down)
+    */
+    struct ScreenProjection
+    {
+        glm::mat4 viewProjection;
+        float scaleX, offsetX;
+        float scaleY, offsetY;
+
+        // clip coords of a point, and true if it is between the near and far planes
+        bool clip(const glm::vec3 &_p, glm::vec4 &_clip) const
+        {
+            _clip = viewProjection * glm::vec4(_p, 1.0f);
+            return _clip.z >= -_clip.w && _clip.z <= _clip.w;
+        }
+
+        glm::vec2 pixel(const glm::vec4 &_clip) const
+        {
+            return glm::vec2(_clip.x / _clip.w * scaleX + offsetX, _clip.y / _clip.w * scaleY + offsetY);
+        }
+    };
+
+
+    /*!
+    * \fn classifyCluster
+    * \brief Position of the box of a cluster w.r.t. the selection: all the corners outside the same plane
+    * of the view frustum or a screen rectangle outside the region gives OUTSIDE, a box between the near and far planes
+    * with a screen rectangle inside the region gives INSIDE.
+    */
+    qgltoolkit::SelectionRegion::Coverage classifyCluster(const VertexCluster &_cluster, const ScreenProjection &_projection,
+                                                           const qgltoolkit::SelectionRegion &_region)
+    {
+        unsigned int allOutside = 0x3f;     // planes -x, +x, -y, +y, -z, +z which have all the corners outside
+        bool inDepthRange = true;
+        glm::vec4 corners[8];
+        for (unsigned int k = 0; k < 8; k++)
+        {
+            const glm::vec3 corner( (k & 1) ? _cluster.bBoxMax.x : _cluster.bBoxMin.x,
+                                    (k & 2) ? _cluster.bBoxMax.y : _cluster.bBoxMin.y,
+                                    (k & 4) ? _cluster.bBoxMax.z : _cluster.bBoxMin.z );
+            inDepthRange = _projection.clip(corner, corners[k]) && inDepthRange;
+
+            const glm::vec4 &c = corners[k];
+            const unsigned int outside = ((c.x < -c.w) ? 1u : 0u) | ((c.x > c.w) ? 2u : 0u)
+                                       | ((c.y < -c.w) ? 4u : 0u) | ((c.y > c.w) ? 8u : 0u)
+                                       | ((c.z < -c.w) ? 16u : 0u) | ((c.z > c.w) ? 32u : 0u);
+            allOutside &= outside;
+        }
+
+        if (allOutside != 0)
+            return qgltoolkit::SelectionRegion::OUTSIDE;
+
+        // the projection of a box crossing the near plane is not bounded by its corners
+        if (!inDepthRange)
+            return qgltoolkit::SelectionRegion::INTERSECTING;
+
+        glm::vec2 screenMin(std::numeric_limits<float>::infinity());
+        glm::vec2 screenMax(-std::numeric_limits<float>::infinity());
+        for (unsigned int k = 0; k < 8; k++)
+        {
+            const glm::vec2 pixel = _projection.pixel(corners[k]);
+            screenMin = glm::min(screenMin, pixel);
+            screenMax = glm::max(screenMax, pixel);
+        }
+
+        return _region.classifyRect(screenMin, screenMax);
+    }
+
+
+    /*!
+    * \fn selectClusterVertices
+    * \brief Test the vertices of a cluster one by one (by SIMD registers), returns their selection bits
+    * \param _vertices : first vertex of the cluster
+    * \param _count : number of vertices (at most VERTEX_CLUSTER_SIZE)
+    * \param _words : output, VERTEX_CLUSTER_SIZE / 64 selection words
+    */
+    void selectClusterVertices(const glm::vec3 *_vertices, size_t _count, const ScreenProjection &_projection,
+                               const qgltoolkit::SelectionRegion &_region, uint64_t *_words)
+    {
+        for (size_t w = 0; w < VERTEX_CLUSTER_SIZE / 64; w++)
+            _words[w] = 0;
+
+        size_t i = 0;
+
+#if defined(QGL_USE_AVX) || defined(QGL_USE_SSE2)
+        // vertices gathered in SoA layout
+        float xs[VERTEX_CLUSTER_SIZE], ys[VERTEX_CLUSTER_SIZE], zs[VERTEX_CLUSTER_SIZE];
+        for (size_t k = 0; k < _count; k++)
+        {
+            xs[k] = _vertices[k].x;
+            ys[k] = _vertices[k].y;
+            zs[k] = _vertices[k].z;
+        }
+
+        const bool isLasso = (_region.shape() == qgltoolkit::SelectionRegion::LASSO);
+        const glm::vec2 &bBoxMin = _region.bBoxMin();
+        const glm::vec2 &bBoxMax = _region.bBoxMax();
+        const glm::mat4 &m = _projection.viewProjection;
+        const SimdFloat regionMinX = simdSet1(bBoxMin.x), regionMaxX = simdSet1(bBoxMax.x);
+        const SimdFloat regionMinY = simdSet1(bBoxMin.y), regionMaxY = simdSet1(bBoxMax.y);
+        const SimdFloat scaleX = simdSet1(_projection.scaleX), offsetX = simdSet1(_projection.offsetX);
+        const SimdFloat scaleY = simdSet1(_projection.scaleY), offsetY = simdSet1(_projection.offsetY);
+
+        for (; i + SIMD_WIDTH <= _count; i += SIMD_WIDTH)
+        {
+            const SimdFloat x = simdLoad(xs + i);
+            const SimdFloat y = simdLoad(ys + i);
+            const SimdFloat z = simdLoad(zs + i);
+
+            // clip coords (glm matrices are column major: m[column][row])
+            const SimdFloat cx = simdAdd( simdAdd(simdMul(simdSet1(m[0][0]), x), simdMul(simdSet1(m[1][0]), y)),
+                                          simdAdd(simdMul(simdSet1(m[2][0]), z), simdSet1(m[3][0])) );
+            const SimdFloat cy = simdAdd( simdAdd(simdMul(simdSet1(m[0][1]), x), simdMul(simdSet1(m[1][1]), y)),
+                                          simdAdd(simdMul(simdSet1(m[2][1]), z), simdSet1(m[3][1])) );
+            const SimdFloat cz = simdAdd( simdAdd(simdMul(simdSet1(m[0][2]), x), simdMul(simdSet1(m[1][2]), y)),
+                                          simdAdd(simdMul(simdSet1(m[2][2]), z), simdSet1(m[3][2])) );
+            const SimdFloat cw = simdAdd( simdAdd(simdMul(simdSet1(m[0][3]), x), simdMul(simdSet1(m[1][3]), y)),
+                                          simdAdd(simdMul(simdSet1(m[2][3]), z), simdSet1(m[3][3])) );
+
+            const SimdFloat px = simdAdd(simdMul(simdDiv(cx, cw), scaleX), offsetX);
+            const SimdFloat py = simdAdd(simdMul(simdDiv(cy, cw), scaleY), offsetY);
+
+            // between the near and far planes, and in the bounding box of the region (false for NaN)
+            SimdFloat inside = simdAnd( simdLessEqual(simdNeg(cw), cz), simdLessEqual(cz, cw) );
+            inside = simdAnd( inside, simdAnd(simdLessEqual(regionMinX, px), simdLessEqual(px, regionMaxX)) );
+            inside = simdAnd( inside, simdAnd(simdLessEqual(regionMinY, py), simdLessEqual(py, regionMaxY)) );
+
+            int bits = simdMoveMask(inside);
+            if (isLasso && bits != 0)
+            {
+                float pxs[SIMD_WIDTH], pys[SIMD_WIDTH];
+                simdStore(pxs, px);
+                simdStore(pys, py);
+                for (size_t k = 0; k < SIMD_WIDTH; k++)
+                {
+                    if ((bits & (1 << k)) && !_region.contains(pxs[k], pys[k]))
+                        bits &= ~(1 << k);
+                }
+            }
+
+            // SIMD_WIDTH divides 64: the bits of a register are in the same word
+            _words[i / 64] |= static_cast<uint64_t>(bits) << (i % 64);
+        }
+#endif
+
+        // remaining vertices
+        for (; i < _count; i++)
+        {
+            glm::vec4 clip;
+            if (!_projection.clip(_vertices[i], clip))
+                continue;
+
+            const glm::vec2 pixel = _projection.pixel(clip);
+            if (_region.contains(pixel.x, pixel.y))
+                _words[i / 64] |= uint64_t(1) << (i % 64);
+        }
+    }
+
+} // namespace
+
+
+/*------------------------------------------------------------------------------------------------------------+
+|                                                  SELECTION                                                  |
++-------------------------------------------------------------------------------------------------------------*/
+
+void buildVertexClusters(const glm::vec3 *_vertices, size_t _nbVertices, std::vector<VertexCluster> &_clusters, ThreadPool &_pool)
+{
+    QGL_TRACE_SCOPE("buildVertexClusters");
+    const size_t nbClusters = (_nbVertices + VERTEX_CLUSTER_SIZE - 1) / VERTEX_CLUSTER_SIZE;
+    _clusters.resize(nbClusters);
+
+    _pool.run((nbClusters + CLUSTERS_PER_TASK - 1) / CLUSTERS_PER_TASK, [&](size_t _task)
+    {
+        const size_t end = std::min(nbClusters, (_task + 1) * CLUSTERS_PER_TASK);
+        for (size_t c = _task * CLUSTERS_PER_TASK; c < end; c++)
+        {
+            const size_t first = c * VERTEX_CLUSTER_SIZE;
+            const size_t last = std::min(_nbVertices, first + VERTEX_CLUSTER_SIZE);
+
+            glm::vec3 bBoxMin(std::numeric_limits<float>::infinity());
+            glm::vec3 bBoxMax(-std::numeric_limits<float>::infinity());
+            bool finite = true;
+            for (size_t i = first; i < last; i++)
+            {
+                const glm::vec3 &v = _vertices[i];
+                finite = finite && std::isfinite(v.x) && std::isfinite(v.y) && std::isfinite(v.z);
+                bBoxMin = glm::min(bBoxMin, v);
+                bBoxMax = glm::max(bBoxMax, v);
+            }
+
+            // a NaN box is never selected or rejected at once: its vertices are tested one by one
+            if (!finite)
+                bBoxMin = bBoxMax = glm::vec3(std::numeric_limits<float>::quiet_NaN());
+
+            _clusters[c].bBoxMin = bBoxMin;
+            _clusters[c].bBoxMax = bBoxMax;
+        }
+    });
+}
+
+
+void selectVertices(const glm::vec3 *_vertices, size_t _nbVertices, const VertexCluster *_clusters,
+                    const qgltoolkit::SelectionRegion &_region, const glm::mat4 &_viewProjection, const glm::vec2 &_screenSize,
+                    std::vector<uint64_t> &_selection, ThreadPool &_pool)
+{
+    QGL_TRACE_SCOPE("selectVertices");
+    const size_t nbWords = (_nbVertices + 63) / 64;
+    if (_region.isEmpty())
+    {
+        _selection.assign(nbWords, 0);
+        return;
+    }
+    _selection.resize(nbWords);
+
+    ScreenProjection projection;
+    projection.viewProjection = _viewProjection;
+    projection.scaleX = 0.5f * _screenSize.x;
+    projection.offsetX = 0.5f * _screenSize.x;
+    projection.scaleY = -0.5f * _screenSize.y;
+    projection.offsetY = 0.5f * _screenSize.y;
+
+    const size_t nbClusters = (_nbVertices + VERTEX_CLUSTER_SIZE - 1) / VERTEX_CLUSTER_SIZE;
+    const size_t wordsPerCluster = VERTEX_CLUSTER_SIZE / 64;
+
+    _pool.run((nbClusters + CLUSTERS_PER_TASK - 1) / CLUSTERS_PER_TASK, [&](size_t _task)
+    {
+        const size_t end = std::min(nbClusters, (_task + 1) * CLUSTERS_PER_TASK);
+        for (size_t c = _task * CLUSTERS_PER_TASK; c < end; c++)
+        {
+            const size_t first = c * VERTEX_CLUSTER_SIZE;
+            const size_t count = std::min(_nbVertices - first, VERTEX_CLUSTER_SIZE);
+
+            uint64_t words[VERTEX_CLUSTER_SIZE / 64];
+            switch (classifyCluster(_clusters[c], projection, _region))
+            {
+                case qgltoolkit::SelectionRegion::OUTSIDE:
+                    std::fill(words, words + wordsPerCluster, uint64_t(0));
+                    break;
+
+                case qgltoolkit::SelectionRegion::INSIDE:
+                    for (size_t w = 0; w < wordsPerCluster; w++)
+                    {
+                        const size_t bits = std::min<size_t>(64, count - std::min(count, 64 * w));
+                        words[w] = (bits == 64) ? ~uint64_t(0) : (uint64_t(1) << bits) - 1;
+                    }
+                    break;
+
+                default:
+                    selectClusterVertices(_vertices + first, count, projection, _region, words);
+                    break;
+            }
+
+            // the last cluster may have fewer words
+            const size_t firstWord = c * wordsPerCluster;
+            std::copy(words, words + std::min(wordsPerCluster, nbWords - firstWord), _selection.begin() + firstWord);
+        }
+    });
+}
+
+
+void removeOccludedVertices(const glm::vec3 *_vertices, size_t _nbVertices, const Bvh &_bvh,
+                            const glm::vec3 &_eye, const glm::vec3 &_viewDirection, bool _perspective, float _epsilon,
+                            std::vector<uint64_t> &_selection, ThreadPool &_pool)
+{
+    QGL_TRACE_SCOPE("removeOccludedVertices");
+    if (_bvh.empty())
+        return;
+
+    const size_t nbWords = std::min(_selection.size(), (_nbVertices + 63) / 64);
+    const glm::vec3 towardCamera = -glm::normalize(_viewDirection);
+
+    _pool.run((nbWords + WORDS_PER_TASK - 1) / WORDS_PER_TASK, [&](size_t _task)
+    {
+        Ray rays[RAY_BATCH_SIZE];
+        uint32_t vertices[RAY_BATCH_SIZE];
+        uint8_t occluded[RAY_BATCH_SIZE];
+        size_t nbRays = 0;
+
+        auto flush = [&]()
+        {
+            _bvh.occluded(rays, nbRays, occluded);
+            for (size_t k = 0; k < nbRays; k++)
+            {
+                if (occluded[k])
+                    _selection[vertices[k] / 64] &= ~(uint64_t(1) << (vertices[k] % 64));
+            }
+            nbRays = 0;
+        };
+
+        const size_t end = std::min(nbWords, (_task + 1) * WORDS_PER_TASK);
+        for (size_t w = _task * WORDS_PER_TASK; w < end; w++)
+        {
+            for (uint64_t bits = _selection[w]; bits != 0; bits &= bits - 1)
+            {
+                // index of the lowest bit set
+                unsigned int b = 0;
+                while (!(bits & (uint64_t(1) << b)))
+                    b++;
+
+                const uint32_t v = static_cast<uint32_t>(64 * w + b);
+                Ray &ray = rays[nbRays];
+                ray.origin = _vertices[v];
+                if (_perspective)
+                {
+                    // segment from the vertex to the camera
+                    ray.direction = _eye - ray.origin;
+                    const float length = glm::length(ray.direction);
+                    ray.tMin = (length > 0.0f) ? _epsilon / length : 1.0f;
+                    ray.tMax = 1.0f;
+                }
+                else
+                {
+                    ray.direction = towardCamera;
+                    ray.tMin = _epsilon;
+                    ray.tMax = std::numeric_limits<float>::infinity();
+                }
+                vertices[nbRays++] = v;
+
+                if (nbRays == RAY_BATCH_SIZE)
+                    flush();
+            }
+        }
+        if (nbRays > 0)
+            flush();
+    });
+}
+
+
+void selectFaces(const uint32_t *_indices, size_t _nbIndices, const std::vector<uint64_t> &_vertexSelection,
+                 std::vector<uint64_t> &_faceSelection, ThreadPool &_pool)
+{
+    QGL_TRACE_SCOPE("selectFaces");
+    const size_t nbFaces = _nbIndices / 3;
+    const size_t nbWords = (nbFaces + 63) / 64;
+    _faceSelection.resize(nbWords);
+
+    const size_t nbVertexBits = 64 * _vertexSelection.size();
+    auto isSelected = [&](uint32_t _v)
+    {
+        return _v < nbVertexBits && ((_vertexSelection[_v / 64] >> (_v % 64)) & 1);
+    };
+
+    _pool.run((nbWords + WORDS_PER_TASK - 1) / WORDS_PER_TASK, [&](size_t _task)
+    {
+        const size_t end = std::min(nbWords, (_task + 1) * WORDS_PER_TASK);
+        for (size_t w = _task * WORDS_PER_TASK; w < end; w++)
+        {
+            uint64_t word = 0;
+            const size_t last = std::min(nbFaces, 64 * (w + 1));
+            for (size_t f = 64 * w; f < last; f++)
+            {
+                const uint32_t *face = _indices + 3 * f;
+                if (isSelected(face[0]) && isSelected(face[1]) && isSelected(face[2]))
+                    word |= uint64_t(1) << (f % 64);
+            }
+            _faceSelection[w] = word;
+        }
+    });
+}
+
+
+size_t countSelected(const std::vector<uint64_t> &_selection)
+{
+    size_t count = 0;
+    for (size_t w = 0; w < _selection.size(); w++)
+        count += std::bitset<64>(_selection[w]).count();
+    return count;
+}
@@ -0,0 +1,112 @@
+/*********************************************************************************************************************
+ *
+ * vertexselection.h
+ *
+ * Selection of the vertices and faces of a mesh inside a region of the screen
+ *
+ * QGL_toolkit demo
+ * Ludovic Blache
+ *
+ *********************************************************************************************************************/
+
+#ifndef VERTEXSELECTION_H
+#define VERTEXSELECTION_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+
+
+#include "QGLtoolkit/selectionRegion.h"
+
+
+class ThreadPool;
+class Bvh;
+
+
+// Number of consecutive vertices of a VertexCluster (multiple of 64, the size of the selection words)
+const size_t VERTEX_CLUSTER_SIZE = 256;
+
+
+/*!
+* \struct VertexCluster
+* \brief Bounding box of VERTEX_CLUSTER_SIZE consecutive vertices, used to select or reject them at once.
+* Vertices sorted by first use (see TriMesh::optimizeIndexOrder()) or read from scans are spatially coherent.
+*/
+struct VertexCluster
+{
+    glm::vec3 bBoxMin;          /*!< min corner of the bounding box (NaN if a vertex is not finite) */
+    glm::vec3 bBoxMax;          /*!< max corner of the bounding box (NaN if a vertex is not finite) */
+};
+
+
+/*!
+* \fn buildVertexClusters
+* \brief Compute the bounding boxes of the clusters of VERTEX_CLUSTER_SIZE consecutive vertices
+* \param _vertices : vertex positions
+* \param _nbVertices : number of vertices
+* \param _clusters : output clusters, (_nbVertices + VERTEX_CLUSTER_SIZE - 1) / VERTEX_CLUSTER_SIZE
+* \param _pool : threads used to compute the clusters
+*/
+void buildVertexClusters(const glm::vec3 *_vertices, size_t _nbVertices, std::vector<VertexCluster> &_clusters, ThreadPool &_pool);
+
+/*!
+* \fn selectVertices
+* \brief Select the vertices in the view frustum whose projection is inside a region of the screen.
+* The corners of the box of each cluster are projected first: clusters whose screen rectangle is outside
+* (or inside) the region are rejected (or selected) at once, the vertices of the others are projected
+* by SIMD registers. Blocks of clusters are processed in parallel.
+* \param _vertices : vertex positions
+* \param _nbVertices : number of vertices
+* \param _clusters : clusters of the vertices (see buildVertexClusters())
+* \param _region : selection region, in pixel coords
+* \param _viewProjection : view-projection matrix (perspective or orthographic projection)
+* \param _screenSize : width and height of the screen (in pixels)
+* \param _selection : output bitset, bit (i % 64) of word (i / 64) is set if vertex i is selected
+* \param _pool : threads used for the selection
+*/
+void selectVertices(const glm::vec3 *_vertices, size_t _nbVertices, const VertexCluster *_clusters,
+                    const qgltoolkit::SelectionRegion &_region, const glm::mat4 &_viewProjection, const glm::vec2 &_screenSize,
+                    std::vector<uint64_t> &_selection, ThreadPool &_pool);
+
+/*!
+* \fn removeOccludedVertices
+* \brief Unselect the vertices hidden by a triangle: a ray from each selected vertex toward the camera
+* is tested against the hierarchy of the triangles (by packets of rays).
+* \param _vertices : vertex positions
+* \param _nbVertices : number of vertices
+* \param _bvh : hierarchy of the triangles of the mesh
+* \param _eye : position of the camera
+* \param _viewDirection : view direction of the camera (used for an orthographic projection)
+* \param _perspective : true for a perspective projection, false for an orthographic one
+* \param _epsilon : length of the start of the rays which is ignored, to skip the faces of the vertex
+* \param _selection : selection bitset of the vertices (see selectVertices()), updated in place
+* \param _pool : threads used for the ray queries
+*/
+void removeOccludedVertices(const glm::vec3 *_vertices, size_t _nbVertices, const Bvh &_bvh,
+                            const glm::vec3 &_eye, const glm::vec3 &_viewDirection, bool _perspective, float _epsilon,
+                            std::vector<uint64_t> &_selection, ThreadPool &_pool);
+
+/*!
+* \fn selectFaces
+* \brief Select the triangles whose three vertices are selected
+* \param _indices : vertex indices, 3 per triangle
+* \param _nbIndices : number of indices
+* \param _vertexSelection : selection bitset of the vertices
+* \param _faceSelection : output bitset of the triangles
+* \param _pool : threads used for the selection
+*/
+void selectFaces(const uint32_t *_indices, size_t _nbIndices, const std::vector<uint64_t> &_vertexSelection,
+                 std::vector<uint64_t> &_faceSelection, ThreadPool &_pool);
+
+/*!
+* \fn countSelected
+* \brief Returns the number of bits set in a selection bitset
+*/
+size_t countSelected(const std::vector<uint64_t> &_selection);
+
+#endif // VERTEXSELECTION_H
@@ -9,7 +9,14 @@
  *
  *********************************************************************************************************************/
 
+#include <limits>
+
 #include "trimesh.h"
+#include "scene.h"
+#include "glstatecache.h"
+#include "threadpool.h"
+#include "trace.h"
+#include "instancing.h"
 
 #include "viewer.h"
 
@@ -19,15 +26,22 @@ using namespace std;
 
 
 
-Viewer::Viewer(QWidget *parent) : qgltoolkit::QGLViewer(parent)
+Viewer::Viewer(QWidget *parent) : qgltoolkit::QGLViewer(parent), m_scene(nullptr), m_triMesh(nullptr), m_cameraUniforms(nullptr), m_glState(nullptr)
 { }
 
-Viewer::Viewer() : qgltoolkit::QGLViewer()
+Viewer::Viewer() : qgltoolkit::QGLViewer(), m_scene(nullptr), m_triMesh(nullptr), m_cameraUniforms(nullptr), m_glState(nullptr)
 { }
 
 Viewer::~Viewer()
 {
-    delete m_triMesh;
+    // GL resources are deleted in their context
+    makeCurrent();
+
+    // waits for the loading threads, if any
+    delete m_scene;
+    delete m_cameraUniforms;
+    delete m_glState;
+    doneCurrent();
     std::cout << std::endl << "Bye!" << std::endl;
 }
 
@@ -35,6 +49,8 @@ Viewer::~Viewer()
 
 void Viewer::init()
 {
+    QGL_TRACE_THREAD_NAME("GUI");
+    QGL_TRACE_SCOPE("Viewer::init");
 
     // Load OpenGL functions
     glewExperimental = true;
@@ -58,28 +74,58 @@ void Viewer::init()
 
     glViewport(0, 0, width(), height());
 
-    m_triMesh = new TriMesh();
-    m_triMesh->readFile("../../models/teapot.obj");
-    m_triMesh->computeAABB();
+    m_scene = new Scene();
+    m_glState = new GLStateCache();
+
+    m_triMesh = m_scene->addMesh(new TriMesh());
+    // upload large meshes progressively, with a bounded amount of data per frame
+    m_triMesh->setStreamingUpload(true);
+    m_triMesh->setUploadBudget(32 * 1024 * 1024);
     m_triMesh->setProgram("../../src/demo/shaders/phong.vert", "../../src/demo/shaders/phong.frag");
-    m_triMesh->createVAO();
 
+    m_lightCol = glm::vec3(1.0f, 1.0f, 1.0f);
+
+    m_cameraUniforms = new UniformBuffer();
+    m_cameraUniformsVersion = 0;
 
-    // scene AABBox
-    glm::vec3 bBoxMin = m_triMesh->getBBoxMin();
-    glm::vec3 bBoxMax = m_triMesh->getBBoxMax();
+    m_selectVisibleOnly = false;
 
-    if(bBoxMin != bBoxMax)
+    // Read the mesh on a worker thread, the empty scene is drawn until it is ready.
+    // GL upload is done on the GUI thread by onMeshRead().
+    m_triMesh->readFileAsync("../../models/teapot.obj", 0, [this](bool _success) 
     {
-        // scene setup
-        glm::vec3 min(bBoxMin.x, bBoxMin.y, bBoxMin.z);
-        glm::vec3 max(bBoxMax.x, bBoxMax.y, bBoxMax.z);
-        glm::vec3 centerCoords( (bBoxMin.x + bBoxMax.x) * 0.5f, (bBoxMin.y + bBoxMax.y) * 0.5f, (bBoxMin.z + bBoxMax.z) * 0.5f );
+        QMetaObject::invokeMethod(this, "onMeshRead", Qt::QueuedConnection, Q_ARG(bool, _success));
+    });
+}
+
 
-        // Set scene radius and center from AABBox.
+void Viewer::onMeshRead(bool _success)
+{
+    QGL_TRACE_SCOPE("Viewer::onMeshRead");
+    if(!_success)
+    {
+        Q_EMIT meshLoaded(false);
+        return;
+    }
+
+    // upload mesh data in the viewer GL context
+    makeCurrent();
+    m_triMesh->createVAO();
+    doneCurrent();
+
+
+    // scene bounding sphere
+    glm::vec3 centerCoords = m_triMesh->getBSphereCenter();
+    float radius = m_triMesh->getBSphereRadius();
+
+    if(radius > 0.0f)
+    {
+        // Set scene radius and center from the bounding sphere,
+        // which is tighter than the sphere around the AABBox (and so are near and far planes).
         // Pivot point is set to scene center by default, 
         // use camera()->setPivotPoint() to change it.
-        this->setSceneBoundingBox(min, max);
+        this->setSceneCenter(centerCoords);
+        this->setSceneRadius(radius);
 
         // camera setup
         this->camera()->setPosition( centerCoords + glm::vec3(0.0f, 0.0f, this->sceneRadius()*2.5f) );
@@ -88,12 +134,15 @@ void Viewer::init()
 
     }
 
-    m_lightCol = glm::vec3(1.0f, 1.0f, 1.0f);
+    Q_EMIT meshLoaded(true);
+
+    updateIfModified();
 }
 
 
 void Viewer::draw()
 {
+    QGL_TRACE_SCOPE("Viewer::draw");
     glClearColor(0.0, 0.0, 0.0, 0.0);
 
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -112,7 +161,35 @@ void Viewer::draw()
     // get camera position
     glm::vec3 cam_pos(this->camera()->position().x, this->camera()->position().y, this->camera()->position().z);
 
-    m_triMesh->draw(mv, mvp, cam_pos , m_lightCol);
+    // camera uniform block, shared by the programs: only uploaded when the camera changed
+    // (the light is at the camera position)
+    if(this->camera()->version() != m_cameraUniformsVersion)
+    {
+        CameraUniforms cameraUniforms;
+        cameraUniforms.mv = mv;
+        cameraUniforms.mvp = mvp;
+        cameraUniforms.lightPosition = glm::vec4(cam_pos, 1.0f);
+        cameraUniforms.lightColor = glm::vec4(m_lightCol, 0.0f);
+        m_cameraUniforms->upload(&cameraUniforms, sizeof(cameraUniforms));
+        m_cameraUniformsVersion = this->camera()->version();
+    }
+
+    // the state may have been changed since the last frame (e.g. by the QPainter of the overlays)
+    m_glState->invalidate();
+    m_glState->bindUniformBuffer(CAMERA_UNIFORM_BINDING, m_cameraUniforms->name());
+
+    // meshes sorted by program and material, with no redundant state change between them
+    // (the meshes which are loading are not drawn, the level of detail depends on the projected size of each mesh)
+    m_scene->draw(mv, mvp, projection, this->camera()->screenHeight(), this->camera()->version(), *m_glState);
+    addDrawStats(m_scene->numDrawnIndices() / 3, m_scene->numDrawCalls());
+
+    m_glState->bindVertexArray(m_defaultVAO);
+    m_glState->setCullFace(false);
+    m_glState->useProgram(0);
+
+    // keep repainting until the meshes are completely uploaded
+    if(m_scene->isUploading())
+        update();
 
 }
 
@@ -127,6 +204,9 @@ std::string Viewer::helpString() const
 {
     std::string text = QGLViewer::helpString();
                 text += " R key : reset camera \n";
+                text += " V key : toggle selection of the visible vertices only \n";
+                text += " T key : write the profiling zones to qgltoolkit_trace.json (Chrome trace, for Perfetto) \n";
+                text += " I key : toggle instanced drawing of the mesh (grid of copies) \n";
 
     return text;
 }
@@ -157,6 +237,73 @@ void Viewer::resizeGL(int width, int height)
 }
 
 
+bool Viewer::intersectRay(const glm::vec3 &_origin, const glm::vec3 &_direction, qgltoolkit::PickResult &_result) const
+{
+    QGL_TRACE_SCOPE("Viewer::intersectRay");
+    // the triangle hierarchy is built by the loading thread
+    if(m_triMesh->isLoading())
+        return false;
+
+    // the mesh is drawn without model transform: its coordinates are world coordinates
+    Ray ray;
+    ray.origin = _origin;
+    ray.direction = _direction;
+    ray.tMin = 0.0f;
+    ray.tMax = std::numeric_limits<float>::infinity();
+
+    RayHit hit;
+    if(!m_triMesh->bvh().intersect(ray, hit))
+        return false;
+
+    _result.point = _origin + hit.t * _direction;
+    _result.distance = hit.t;
+    _result.triangle = hit.triangle;
+    _result.barycentric = glm::vec2(hit.u, hit.v);
+    return true;
+}
+
+
+uint64_t Viewer::sceneVersion() const
+{
+    // (meshes which are loading are not drawn, their version does not change)
+    if(!m_scene)
+        return 0;
+
+    return m_scene->version();
+}
+
+
+void Viewer::selectRegion(const qgltoolkit::SelectionRegion &_region, bool _finished)
+{
+    QGL_TRACE_SCOPE("Viewer::selectRegion");
+    // the vertex clusters are computed by the loading thread
+    if(m_triMesh->isLoading())
+        return;
+
+    // the mesh is drawn without model transform: the view-projection matrix projects its vertices
+    const glm::vec2 screenSize(camera()->screenWidth(), camera()->screenHeight());
+    selectVertices(m_triMesh->vertexData(), m_triMesh->numVertexData(), m_triMesh->vertexClusters().data(),
+                   _region, camera()->viewProjectionMatrix(), screenSize, m_selectedVertices, ThreadPool::global());
+
+    if(!_finished)
+        return;
+
+    // occlusion rays are only traced for the final selection
+    if(m_selectVisibleOnly)
+    {
+        const bool perspective = (camera()->projType() == qgltoolkit::CameraFrame::PERSPECTIVE);
+        removeOccludedVertices(m_triMesh->vertexData(), m_triMesh->numVertexData(), m_triMesh->bvh(),
+                               camera()->position(), camera()->viewDirection(), perspective, 1e-4f * float(sceneRadius()),
+                               m_selectedVertices, ThreadPool::global());
+    }
+
+    selectFaces(m_triMesh->indexData(), m_triMesh->numIndexData(), m_selectedVertices, m_selectedFaces, ThreadPool::global());
+
+    std::cout << "[INFO] Viewer::selectRegion(): " << countSelected(m_selectedVertices) << " vertices and "
+              << countSelected(m_selectedFaces) << " faces selected" << std::endl;
+}
+
+
 void Viewer::keyPressEvent(QKeyEvent *e)
 {
     if (e->key() == Qt::Key_H)
@@ -170,9 +317,76 @@ void Viewer::keyPressEvent(QKeyEvent *e)
         camera()->setViewDirection( sceneCenter() - camera()->position() );
         camera()->setUpVector( glm::vec3(0.0f, 1.0f, 0.0f) );
     }
+    if (e->key() == Qt::Key_V)
+    {
+        m_selectVisibleOnly = !m_selectVisibleOnly;
+        std::cout << "[INFO] Selection of the visible vertices only: " << (m_selectVisibleOnly ? "on" : "off") << std::endl;
+    }
+    if (e->key() == Qt::Key_T)
+    {
+        // zones recorded since the start (if the QGL_ENABLE_TRACING option is enabled)
+        writeChromeTrace("qgltoolkit_trace.json");
+    }
+    if (e->key() == Qt::Key_I)
+    {
+        toggleInstances();
+    }
      
     QGLViewer::keyPressEvent(e);
 
-    update();
+    updateIfModified();
 }
 
+
+void Viewer::toggleInstances()
+{
+    // the bounding sphere of the mesh is needed to lay out the grid
+    if(m_triMesh->isLoading() || !m_triMesh->hasVAO())
+        return;
+
+    if(!m_triMesh->instancingSupported())
+    {
+        std::cerr << "[WARNING] Viewer::toggleInstances(): Instanced drawing requires OpenGL 3.3 or ARB_instanced_arrays" << std::endl;
+        return;
+    }
+
+    const glm::vec3 center = m_triMesh->getBSphereCenter();
+    const float radius = m_triMesh->getBSphereRadius();
+
+    if(m_triMesh->hasInstances())
+    {
+        m_triMesh->clearInstances();
+        setSceneCenter(center);
+        setSceneRadius(radius);
+        std::cout << "[INFO] Viewer::toggleInstances(): instancing off" << std::endl;
+        return;
+    }
+
+    // grid of frames in the xz plane, each one turned around the vertical axis of the mesh center
+    const int gridSize = 32;
+    const float spacing = 2.5f * radius;
+    std::vector<qgltoolkit::Frame> frames(gridSize * gridSize);
+    for(int i = 0; i < gridSize; i++)
+    {
+        for(int j = 0; j < gridSize; j++)
+        {
+            const glm::vec3 offset((i - 0.5f * (gridSize - 1)) * spacing, 0.0f, (j - 0.5f * (gridSize - 1)) * spacing);
+            const qgltoolkit::Quaternion orientation(glm::vec3(0.0f, 1.0f, 0.0f), 0.1 * (i * gridSize + j));
+
+            // the instance is rotated around the mesh center, then moved by offset
+            qgltoolkit::Frame &frame = frames[i * gridSize + j];
+            frame.setOrientation(orientation);
+            frame.setPosition(center + offset - orientation.rotate(center));
+        }
+    }
+
+    std::vector<InstanceTransform> instances(frames.size());
+    for(size_t i = 0; i < frames.size(); i++)
+        instances[i] = makeInstanceTransform(frames[i].position(), frames[i].orientation());
+    m_triMesh->setInstances(instances);
+
+    // near and far planes enclose the whole grid
+    setSceneCenter(m_triMesh->getInstancesBSphereCenter());
+    setSceneRadius(m_triMesh->getInstancesBSphereRadius());
+    std::cout << "[INFO] Viewer::toggleInstances(): " << instances.size() << " instances" << std::endl;
+}
@@ -9,11 +9,17 @@
  *
  *********************************************************************************************************************/
 
+#include <vector>
+#include <cstdint>
+
 #include "QGLtoolkit/qglviewer.h"
 
 
 class DrawableMesh;
 class TriMesh;
+class Scene;
+class UniformBuffer;
+class GLStateCache;
 
 
 
@@ -29,17 +35,44 @@ class Viewer : public qgltoolkit::QGLViewer
         ~Viewer();
 
 
-        
+    Q_SIGNALS:
+
+        /*!
+        * \fn meshLoaded
+        * \brief Emitted (on the GUI thread) when the mesh loaded asynchronously is uploaded and ready to draw
+        * \param _success : false if the mesh could not be read
+        */
+        void meshLoaded(bool _success);
+
+
+    protected Q_SLOTS:
+
+        /*!
+        * \fn onMeshRead
+        * \brief Called on the GUI thread when the worker thread is done reading the mesh:
+        * uploads it to the GPU and fits the camera to its bounding box.
+        */
+        void onMeshRead(bool _success);
+
 
     protected:
         GLuint m_defaultVAO; 
-        TriMesh* m_triMesh;
+        Scene* m_scene;                             /*!< meshes drawn by the viewer */
+        TriMesh* m_triMesh;                         /*!< mesh read at startup (owned by m_scene), picked and selected */
         DrawableMesh* m_drawMesh;
 
         glm::vec3 m_backCol;
         glm::vec3 m_lightPos;
         glm::vec3 m_lightCol;
 
+        UniformBuffer* m_cameraUniforms;            /*!< camera uniform block (matrices and light) */
+        uint64_t m_cameraUniformsVersion;           /*!< version of the camera in m_cameraUniforms */
+        GLStateCache* m_glState;                    /*!< GL bindings set by draw() */
+
+        std::vector<uint64_t> m_selectedVertices;   /*!< selection bitset of the vertices of the mesh */
+        std::vector<uint64_t> m_selectedFaces;      /*!< selection bitset of the triangles of the mesh */
+        bool m_selectVisibleOnly;                   /*!< unselect the occluded vertices when a selection is finished */
+
 
         virtual void init();
         virtual void draw();
@@ -51,5 +84,15 @@ class Viewer : public qgltoolkit::QGLViewer
         void resizeGL(int width, int height);
         void keyPressEvent(QKeyEvent *e);
 
+        /*!
+        * \fn toggleInstances
+        * \brief Draw the mesh as a grid of 32 x 32 rotated instances
+        * (one instanced draw call, see TriMesh::setInstances()), or once again
+        */
+        void toggleInstances();
+        virtual bool intersectRay(const glm::vec3 &_origin, const glm::vec3 &_direction, qgltoolkit::PickResult &_result) const;
+        virtual void selectRegion(const qgltoolkit::SelectionRegion &_region, bool _finished);
+        virtual uint64_t sceneVersion() const;
+
 
 };
\ No newline at end of file